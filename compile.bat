@@ -1 +1,2 @@
-gcc -fopenmp -O2 -I./include/ src/main.c src/imageproc_A.c src/imageproc_B.c src/input_output.c -o imgproc.exe
\ No newline at end of file
+gcc -fopenmp -O2 -I./include/ src/main.c src/imageproc_A.c src/imageproc_B.c src/input_output.c src/pipeline.c src/manifest.c src/context.c src/autotune.c src/simd.c src/buffer.c src/region.c src/tiled.c src/cache.c src/image_cache.c src/batch_io.c src/nlmeans.c src/hog.c src/lbp.c src/color.c src/levels.c -lpthread -o imgproc.exe
+gcc -fopenmp -O2 -I./include/ tests/large_image_check.c src/imageproc_A.c src/imageproc_B.c src/input_output.c src/pipeline.c src/manifest.c src/context.c src/autotune.c src/simd.c src/buffer.c src/region.c src/tiled.c src/cache.c src/image_cache.c src/batch_io.c src/nlmeans.c src/hog.c src/lbp.c src/color.c src/levels.c -lpthread -o large_image_check.exe
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef BATCH_IO_H
+#define BATCH_IO_H
+
+#include <stddef.h>
+#include "imageproc.h"
+
+// Количество файлов, читаемых заранее, по умолчанию (переменная окружения IPL_BATCH_DEPTH).
+#define IPL_BATCH_DEFAULT_DEPTH 8
+// Размер зарегистрированного буфера чтения io_uring: файлы больше читаются в обычную память.
+#define IPL_BATCH_BUFFER_SIZE (4u << 20)
+
+// @brief Реализация пакетного ввода-вывода.
+typedef enum
+{
+    BATCH_IO_URING,   // Linux io_uring: чтения и записи ставятся в очередь ядра, чтения - в зарегистрированные буферы
+    BATCH_IO_THREADS  // Пул потоков, выполняющих обычные чтения и записи
+} BatchIOBackend;
+
+// @brief Пакетный ввод-вывод: чтение следующих файлов пакета заранее, пока декодируются текущие,
+//        и асинхронная запись результатов. Состояние зависит от платформы и скрыто в batch_io.c.
+typedef struct BatchIO BatchIO;
+
+BatchIO* ipl_batch_io_create(const int depth);
+BatchIO* ipl_batch_io_create_default(void);
+void ipl_batch_io_free(BatchIO* io);
+BatchIOBackend ipl_batch_io_backend(const BatchIO* io);
+int ipl_batch_io_depth(const BatchIO* io);
+ImageProcStatus ipl_batch_io_prefetch(BatchIO* io, const char* path);
+ImageProcStatus ipl_batch_io_take(BatchIO* io, const char* path, const unsigned char** data, size_t* size);
+void ipl_batch_io_release(BatchIO* io, const unsigned char* data);
+void ipl_batch_io_discard(BatchIO* io, const char* path);
+ImageProcStatus ipl_batch_io_write(BatchIO* io, const char* path, unsigned char* data, const size_t size);
+ImageProcStatus ipl_batch_io_flush(BatchIO* io);
+ImageProcStatus ipl_load_image_batch(BatchIO* io, const char* file_name, Image* image, const ImageFormat file_format);
+
+#endif
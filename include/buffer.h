@@ -0,0 +1,12 @@
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include <stddef.h>
+
+// Размер большой страницы (Transparent Huge Pages в Linux x86-64).
+#define IPL_HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+void* ipl_buffer_alloc(const size_t bytes);
+void ipl_buffer_prefault(void* data, const size_t bytes);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "imageproc.h"
+
+// Версия формата ключей: увеличивается при изменении алгоритмов, чтобы старые результаты не использовались.
+#define IPL_CACHE_VERSION 2
+// Размер кэша по умолчанию, если не задана переменная окружения IPL_CACHE_SIZE_MB.
+#define IPL_CACHE_DEFAULT_MB 1024
+
+// @brief Ключ результата: хэш входных байтов и хэш канонической строки операций.
+typedef struct
+{
+    uint64_t input;
+    uint64_t operation;
+} CacheKey;
+
+// @brief Запись индекса кэша (файл в каталоге кэша).
+typedef struct
+{
+    CacheKey key;
+    size_t bytes;
+    time_t used; // Время последнего обращения (для вытеснения давно не используемых)
+    int prev;    // Соседи в списке LRU: индексы в entries, -1 - нет соседа
+    int next;
+} CacheIndexEntry;
+
+// @brief Кэш закодированных результатов на локальном диске с ограничением размера (LRU).
+//        Один файл на результат, имя файла - ключ. Запись атомарна (временный файл + rename),
+//        поэтому каталог может использоваться несколькими процессами.
+//        Индекс в памяти: поиск по ключу в хэш-таблице, порядок вытеснения - двусвязный список записей.
+//        Кэш открывается один раз на пакет манифестов (см. ipl_run_manifests), а не на каждый манифест.
+typedef struct
+{
+    char* dir;
+    size_t max_bytes;
+    size_t total_bytes;
+    CacheIndexEntry* entries;
+    int count;
+    int capacity;
+    int* slots;                // Хэш-таблица ключей (открытая адресация): индекс записи в entries или -1
+    int slot_mask;             // Размер таблицы минус 1 (размер - степень двойки, записей не больше половины)
+    int lru_head;              // Давно не использовавшаяся запись (вытесняется первой), -1 - индекс пуст
+    int lru_tail;              // Последняя использованная запись
+    unsigned int temp_counter; // Для имен временных файлов
+} ResultCache;
+
+// @brief Найденный в кэше результат. Данные отображены в память (mmap) и доступны до ipl_cache_release.
+typedef struct
+{
+    const unsigned char* data;
+    size_t size;
+} CacheHit;
+
+uint64_t ipl_hash64(const void* data, const size_t size, const uint64_t seed);
+ImageProcStatus ipl_hash_file(const char* path, uint64_t* hash);
+CacheKey ipl_cache_key(const uint64_t input_hash, const char* operation);
+
+ResultCache* ipl_cache_open(const char* dir, const size_t max_bytes);
+ResultCache* ipl_cache_open_default(void);
+void ipl_cache_close(ResultCache* cache);
+ImageProcStatus ipl_cache_lookup(ResultCache* cache, const CacheKey key, CacheHit* hit);
+void ipl_cache_release(CacheHit* hit);
+ImageProcStatus ipl_cache_insert(ResultCache* cache, const CacheKey key, const void* data, const size_t size);
+ImageProcStatus ipl_cache_insert_file(ResultCache* cache, const CacheKey key, const char* path);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef COLOR_H
+#define COLOR_H
+
+#include "imageproc.h"
+
+ImageProcStatus ipl_rgb_to_hsv(Image* image);
+ImageProcStatus ipl_hsv_to_rgb(Image* image);
+ImageProcStatus ipl_rgb_to_hsl(Image* image);
+ImageProcStatus ipl_hsl_to_rgb(Image* image);
+ImageProcStatus ipl_rgb_to_lab(Image* image);
+ImageProcStatus ipl_lab_to_rgb(Image* image);
+ImageProcStatus ipl_adjust_hsl(Image* image, const float hue_shift, const float saturation, const float lightness);
+ImageProcStatus ipl_auto_levels(Image* image, const float clip);
+ImageProcStatus ipl_auto_white_balance(Image* image);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <stdio.h>
+#include "imageproc.h"
+#include "simd.h"
+
+// Файл профиля, который ищется в текущей папке, если не задана переменная окружения IPL_PROFILE.
+#define DEFAULT_PROFILE_PATH "imgproc_profile.txt"
+
+// @brief Параметры алгоритмов, зависящие от машины. Подбираются ipl_autotune.
+typedef struct
+{
+    int tile_width;              // Ширина тайла конвейера (пиксели)
+    int tile_height;             // Высота тайла конвейера (пиксели)
+    int num_threads;             // Количество потоков OpenMP (0 - по умолчанию OpenMP)
+    size_t parallel_min_pixels;  // Изображения меньшего размера обрабатываются в одном потоке
+    float gaussian_iir_sigma;    // Начиная с этой sigma используется рекурсивный (IIR) гауссов фильтр (по умолчанию - никогда)
+    int median_sort_max_radius;  // До этого радиуса медиана ищется сортировкой окна, а не гистограммой
+    int half_intermediates;      // Промежуточные плоскости float хранятся в половинной точности (IEEE half)
+    int huge_pages;              // Большие буферы выделяются большими страницами (Linux, MADV_HUGEPAGE)
+    int prefault_buffers;        // Страницы больших буферов заполняются параллельно сразу после выделения
+} TuningProfile;
+
+// @brief Глобальный контекст библиотеки. Создается один раз при первом обращении
+//        (или явно через ipl_context_init) и далее только читается фильтрами.
+typedef struct
+{
+    TuningProfile profile;
+    SimdLevel simd_level; // Уровень SIMD, для которого заполнена таблица kernels
+    KernelTable kernels;  // Реализации горячих ядер для simd_level
+    int default_threads;  // Количество потоков OpenMP до применения профиля (OMP_NUM_THREADS или число процессоров)
+    int initialized;
+} LibraryContext;
+
+void ipl_default_profile(TuningProfile* profile);
+ImageProcStatus ipl_load_profile(const char* file_name, TuningProfile* profile);
+ImageProcStatus ipl_save_profile(const char* file_name, const TuningProfile* profile);
+ImageProcStatus ipl_context_init(const char* profile_path);
+const LibraryContext* ipl_get_context(void);
+void ipl_set_profile(const TuningProfile* profile);
+SimdLevel ipl_set_simd_level(const SimdLevel level);
+ImageProcStatus ipl_autotune(const char* profile_path);
+
+#endif
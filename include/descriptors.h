@@ -0,0 +1,20 @@
+#ifndef DESCRIPTORS_H
+#define DESCRIPTORS_H
+
+#include <stddef.h>
+#include "imageproc.h"
+
+// Наибольшее количество интервалов ориентации гистограммы ячейки HOG.
+#define IPL_HOG_MAX_BINS 64
+
+// Количество меток равномерного LBP: 58 равномерных кодов (не больше 2-х переходов 0/1 по кругу) и общая метка
+// для остальных.
+#define IPL_LBP_BINS 59
+
+size_t ipl_hog_size(const size_t width, const size_t height, const int cell_size, const int block_size, const int bins);
+ImageProcStatus ipl_hog(const Image* image, const int cell_size, const int block_size, const int bins, float* features);
+
+size_t ipl_lbp_histogram_size(const size_t width, const size_t height, const int cell_size);
+ImageProcStatus ipl_lbp(const Image* image, unsigned char* codes, const int cell_size, float* histograms);
+
+#endif
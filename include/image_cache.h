@@ -0,0 +1,47 @@
+#ifndef IMAGE_CACHE_H
+#define IMAGE_CACHE_H
+
+#include <stddef.h>
+#include <time.h>
+#include "imageproc.h"
+#include "batch_io.h"
+
+// Размер кэша декодированных изображений по умолчанию, если не задана переменная окружения IPL_IMAGE_CACHE_MB.
+#define IPL_IMAGE_CACHE_DEFAULT_MB 1024
+
+// @brief Декодированное изображение в кэше. Ключ - путь, время изменения и размер файла,
+//        поэтому измененный файл декодируется заново.
+typedef struct
+{
+    char* path;
+    time_t mtime;
+    long long file_size;
+    Image image;      // Только для чтения: разделяется всеми заданиями, получившими запись
+    size_t bytes;     // Размер пикселей
+    int refcount;     // Количество заданий, использующих изображение (запись с refcount > 0 не вытесняется)
+    int referenced;   // Бит обращения для алгоритма часов
+    int stale;        // Файл изменился: запись удаляется, как только освобождается последним заданием
+} ImageCacheEntry;
+
+// @brief Кэш декодированных изображений в памяти с ограничением размера и вытеснением по алгоритму часов.
+//        Потокобезопасен: задания, исполняемые параллельно, разделяют одно декодированное изображение.
+typedef struct
+{
+    size_t max_bytes;
+    size_t total_bytes;
+    ImageCacheEntry** entries;
+    int count;
+    int capacity;
+    int hand;       // Стрелка часов
+    BatchIO* io;    // Источник содержимого файлов (чтение заранее); NULL - файлы читаются ipl_load_image
+    size_t hits;    // Статистика обращений
+    size_t misses;
+} ImageCache;
+
+ImageCache* ipl_image_cache_create(const size_t max_bytes);
+ImageCache* ipl_image_cache_create_default(void);
+void ipl_image_cache_free(ImageCache* cache);
+ImageProcStatus ipl_image_cache_acquire(ImageCache* cache, const char* file_name, const ImageFormat file_format, const Image** image);
+void ipl_image_cache_release(ImageCache* cache, const Image* image);
+
+#endif
@@ -54,18 +54,28 @@ Kernel* generate_gaussian_kernel(const float sigma);
 void free_kernel(Kernel* kernel);
 void horizontal_convolution(const unsigned char* input_data, unsigned char* output_data, const int channels, const size_t width, const size_t height, const Kernel* kernel);
 void vertical_convolution(const unsigned char* input_data, unsigned char* output_data, const int channels, const size_t width, const size_t height, const Kernel* kernel);
+size_t gaussian_iir_buffer_size(const int channels, const size_t width, const size_t height, const float sigma);
+void gaussian_iir_filter(unsigned char* data, void* buffer, const int channels, const size_t width, const size_t height, const float sigma);
 ImageProcStatus ipl_gaussian_filter(Image* image, const float sigma);
 void convert_to_one_channel(const unsigned char* input_data, unsigned char* output_data, const size_t width, const size_t height, const int channels_in);
-void compute_sobel_magnitude(const unsigned char* input_grayscale_data, unsigned char* output_gradient_map, const size_t width, const size_t height);
+ImageProcStatus compute_sobel_magnitude(const unsigned char* input_grayscale_data, unsigned char* output_gradient_map, const size_t width, const size_t height);
+ImageProcStatus compute_sobel_magnitude_channels(const unsigned char* input_data, unsigned char* output_gradient_map, const size_t width, const size_t height, const int channels);
 ImageProcStatus ipl_sobel_edge_detection(Image* image);
 
 // PART B
 
+// Максимальный радиус, для которого медиана может считаться сортировкой окна.
+#define MEDIAN_SORT_LIMIT 3
+
 static inline int clamp(int val, int min_val, int max_val);
 ImageProcStatus ipl_median_filter(Image *image, const int radius);
-void hist_set(int *hist, unsigned char *original, unsigned char *padded, int y, int ldp, int x, int channels, int c, int r, int *hy, int *hx);
-void hist_move(int *hist, unsigned char *original, unsigned char *padded, int y, int ldp, int *hx, int channels, int c, int r);
+void hist_set(int *hist, unsigned char *original, unsigned char *padded, size_t y, size_t ldp, size_t x, int channels, int c, int r, size_t *hy, size_t *hx);
+void hist_move(int *hist, unsigned char *original, unsigned char *padded, size_t y, size_t ldp, size_t *hx, int channels, int c, int r);
 unsigned char get_median(int *hist, int r);
+void median_sort_rows(const unsigned char *padded, size_t ldp, unsigned char *output, size_t ldo, int channels, size_t width, size_t rows, int radius);
+void median_histogram_rows(const unsigned char *padded, size_t ldp, unsigned char *output, size_t ldo, int channels, size_t width, size_t rows, int radius);
 ImageProcStatus ipl_grayscale(Image *image);
+ImageProcStatus ipl_threshold(Image *image, const unsigned char level);
+void threshold_row(const unsigned char *input_data, unsigned char *output_data, const size_t count, const unsigned char level);
 
 #endif 
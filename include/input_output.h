@@ -3,10 +3,19 @@
 
 #include <stdio.h>
 #include "imageproc.h"
+#include "region.h"
 
 void write_to_file_contextual(void *context, void *data, int size);
 ImageProcStatus free_image_data(Image* image);
 ImageProcStatus ipl_load_image(const char* file_name, Image* image, const ImageFormat file_format);
 ImageProcStatus ipl_save_image(const char* file_name, Image* image, const ImageFormat file_format);
+ImageProcStatus ipl_load_image_from_memory(const unsigned char* data, const size_t size, Image* image, const ImageFormat file_format);
+ImageProcStatus ipl_load_image_roi(const char* file_name, Image* image, const ImageFormat file_format, const Rect* roi);
+ImageProcStatus ipl_load_image_roi_from_memory(const unsigned char* data, const size_t size, Image* image, const ImageFormat file_format, const Rect* roi);
+ImageProcStatus ipl_load_embedded_thumbnail(const char* file_name, Image* image, const ImageFormat file_format);
+ImageProcStatus ipl_load_embedded_thumbnail_from_memory(const unsigned char* data, const size_t size, Image* image, const ImageFormat file_format);
+ImageProcStatus ipl_encode_image(const Image* image, const ImageFormat file_format, unsigned char** data, size_t* size);
+ImageProcStatus ipl_save_image_indexed(const char* file_name, Image* image, const int colors, const int dither);
+ImageProcStatus ipl_encode_image_indexed(const Image* image, const int colors, const int dither, unsigned char** data, size_t* size);
 
 #endif
\ No newline at end of file
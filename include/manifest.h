@@ -0,0 +1,39 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <stdio.h>
+#include "imageproc.h"
+#include "image_cache.h"
+#include "cache.h"
+
+// @brief Тип значения JSON.
+typedef enum
+{
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} JsonType;
+
+// @brief Значение JSON (дерево, освобождается json_free).
+typedef struct JsonValue
+{
+    JsonType type;
+    double number;            // JSON_NUMBER и JSON_BOOL (0 / 1)
+    char* string;             // JSON_STRING (UTF-8, завершается нулем)
+    struct JsonValue* items;  // Элементы JSON_ARRAY или значения JSON_OBJECT
+    char** keys;              // Ключи JSON_OBJECT
+    int count;                // Количество элементов / пар ключ-значение
+} JsonValue;
+
+JsonValue* json_parse(const char* text);
+void json_free(JsonValue* value);
+const JsonValue* json_get(const JsonValue* object, const char* key);
+
+ImageProcStatus ipl_run_manifest(const char* manifest_path);
+ImageProcStatus ipl_run_manifest_with_cache(const char* manifest_path, ImageCache* images, ResultCache* result_cache);
+ImageProcStatus ipl_run_manifests(const char* const* manifest_paths, const int count);
+
+#endif
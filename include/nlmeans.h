@@ -0,0 +1,12 @@
+#ifndef NLMEANS_H
+#define NLMEANS_H
+
+#include "imageproc.h"
+
+// Наибольший радиус патча: сумма квадратов разностей патча из 4-х каналов должна помещаться в 32 бита.
+#define IPL_NLMEANS_MAX_PATCH_RADIUS 16
+
+ImageProcStatus ipl_nlmeans(Image* image, const float h, const int patch_radius, const int search_radius);
+ImageProcStatus ipl_nlmeans_luma(Image* image, const float h, const int patch_radius, const int search_radius);
+
+#endif
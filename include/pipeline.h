@@ -0,0 +1,61 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include "imageproc.h"
+#include "region.h"
+
+// Идентификатор узла-источника, создаваемого вместе с конвейером.
+#define PIPELINE_SOURCE 0
+
+// @brief Тип операции узла конвейера.
+//        Точечные операции (GRAYSCALE, THRESHOLD) зависят только от значения пикселя
+//        и сливаются с соседними трафаретными (stencil) операциями.
+typedef enum
+{
+    PIPELINE_OP_SOURCE,
+    PIPELINE_OP_GRAYSCALE, // точечная
+    PIPELINE_OP_THRESHOLD, // точечная
+    PIPELINE_OP_GAUSSIAN,  // трафаретная
+    PIPELINE_OP_MEDIAN,    // трафаретная
+    PIPELINE_OP_SOBEL      // трафаретная
+} PipelineOp;
+
+// @brief Узел графа операций.
+typedef struct
+{
+    PipelineOp op;
+    int input;    // Индекс входного узла (-1 для источника). Всегда меньше индекса самого узла.
+    float param;  // Параметр операции (sigma, радиус или порог).
+    int channels; // Количество каналов результата узла.
+} PipelineNode;
+
+// @brief Ленивый конвейер обработки: граф операций над одним исходным изображением.
+//        Узлы только описывают вычисление, сами вычисления выполняются в ipl_pipeline_execute.
+typedef struct
+{
+    const Image* source;  // Исходное изображение (не копируется, должно жить до вызова execute).
+    PipelineNode* nodes;  // Узлы в топологическом порядке (вход узла всегда раньше него).
+    int count;
+    int capacity;
+} Pipeline;
+
+// @brief Функция, вызываемая исполнителем, как только готов очередной запрошенный результат.
+// @param context      Пользовательский контекст.
+// @param output_index Индекс результата в массиве outputs.
+// @param result       Готовый результат (может быть забран вызываемой функцией).
+typedef void (*PipelineOutputCallback)(void* context, int output_index, Image* result);
+
+Pipeline* ipl_pipeline_create(const Image* source);
+void ipl_pipeline_free(Pipeline* pipeline);
+int ipl_pipeline_grayscale(Pipeline* pipeline, const int input);
+int ipl_pipeline_threshold(Pipeline* pipeline, const int input, const unsigned char level);
+int ipl_pipeline_gaussian(Pipeline* pipeline, const int input, const float sigma);
+int ipl_pipeline_median(Pipeline* pipeline, const int input, const int radius);
+int ipl_pipeline_sobel(Pipeline* pipeline, const int input);
+ImageProcStatus ipl_pipeline_execute(Pipeline* pipeline, const int* outputs, Image* results, const int count);
+ImageProcStatus ipl_pipeline_execute_with_callback(Pipeline* pipeline, const int* outputs, Image* results, const int count,
+                                                   PipelineOutputCallback callback, void* context);
+ImageProcStatus ipl_pipeline_update(Pipeline* pipeline, const Rect* dirty, const int dirty_count, const int* outputs, Image* results, const int count);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef REGION_H
+#define REGION_H
+
+#include <stddef.h>
+#include "imageproc.h"
+
+// Размер тайла (в пикселях), по которому области маски группируются в связные компоненты.
+#define IPL_REGION_TILE 32
+
+// @brief Прямоугольник в пикселях: столбцы [x, x + width), строки [y, y + height).
+typedef struct
+{
+    size_t x;
+    size_t y;
+    size_t width;
+    size_t height;
+} Rect;
+
+// @brief Отрезок строки маски: столбцы [begin, end).
+typedef struct
+{
+    size_t begin;
+    size_t end;
+} Span;
+
+// @brief Маска в виде отрезков (run-length). Отрезки строки y - spans[row_offsets[y]] .. spans[row_offsets[y + 1] - 1],
+//        они упорядочены по begin и не пересекаются.
+typedef struct
+{
+    size_t width;
+    size_t height;
+    size_t* row_offsets; // height + 1 элементов
+    Span* spans;
+    size_t count;        // Общее количество отрезков
+} SpanSet;
+
+ImageProcStatus ipl_spans_from_mask(SpanSet* set, const unsigned char* mask, const size_t width, const size_t height);
+ImageProcStatus ipl_spans_from_rects(SpanSet* set, const Rect* rects, const int count, const size_t width, const size_t height);
+void ipl_spans_free(SpanSet* set);
+
+ImageProcStatus ipl_gaussian_filter_spans(Image* image, const float sigma, const SpanSet* spans);
+ImageProcStatus ipl_gaussian_filter_masked(Image* image, const float sigma, const unsigned char* mask);
+ImageProcStatus ipl_gaussian_filter_rects(Image* image, const float sigma, const Rect* rects, const int count);
+ImageProcStatus ipl_median_filter_spans(Image* image, const int radius, const SpanSet* spans);
+ImageProcStatus ipl_median_filter_masked(Image* image, const int radius, const unsigned char* mask);
+ImageProcStatus ipl_median_filter_rects(Image* image, const int radius, const Rect* rects, const int count);
+
+size_t ipl_gaussian_halo(const float sigma);
+int ipl_grow_rects(const Rect* rects, const int count, const size_t halo, const size_t width, const size_t height, Rect* out);
+ImageProcStatus ipl_gaussian_filter_update(const Image* input, Image* output, const float sigma, const Rect* dirty, const int count,
+                                           Rect* output_dirty, int* output_count);
+ImageProcStatus ipl_median_filter_update(const Image* input, Image* output, const int radius, const Rect* dirty, const int count,
+                                         Rect* output_dirty, int* output_count);
+
+#endif
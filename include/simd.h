@@ -0,0 +1,120 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stddef.h>
+
+// @brief Уровень набора векторных инструкций. Уровни упорядочены: каждый следующий включает предыдущие.
+typedef enum
+{
+    IPL_SIMD_SCALAR = 0, // Без явных векторных инструкций (только автовекторизация компилятора)
+    IPL_SIMD_SSE41,      // SSE4.1
+    IPL_SIMD_AVX2,       // AVX2
+    IPL_SIMD_AVX512      // AVX-512 F + BW
+} SimdLevel;
+
+// @brief Свертка отрезка из len отсчетов: output[x] = sum(taps[k][x] * weights[k]), k = 0..2*radius.
+//        Отсчеты суммируются в порядке k = 0..2*radius, поэтому все реализации дают побитово одинаковый результат.
+typedef void (*ConvolveSegmentFn)(const unsigned char* const* taps, unsigned char* output, const size_t len, const float* weights, const int radius);
+
+// Максимальный радиус, для которого в таблице ядер есть свертка отрезка с радиусом, известным при компиляции
+#define IPL_CONVOLVE_UNROLL_MAX 8
+
+// @brief Пороговая обработка последовательности байтов (см. threshold_row).
+typedef void (*ThresholdRowFn)(const unsigned char* input_data, unsigned char* output_data, const size_t count, const unsigned char level);
+
+// @brief Преобразование отрезка float <-> IEEE half (округление к ближайшему четному).
+typedef void (*FloatToHalfFn)(const float* input_data, unsigned short* output_data, const size_t count);
+typedef void (*HalfToFloatFn)(const unsigned short* input_data, float* output_data, const size_t count);
+
+// @brief Обратное DCT count блоков 8x8 строки блоков JPEG: коэффициенты блока k (64 значения после деквантования,
+//        в естественном порядке) - coefficients[64 * k ...], пиксели - output[8 * k ...] с шагом строки stride.
+//        Арифметика совпадает с целочисленным IDCT stb_image, поэтому результат побитово тот же.
+typedef void (*IdctRowFn)(const short* coefficients, unsigned char* output, const int stride, const size_t count);
+
+// @brief Преобразование отрезка JPEG YCbCr -> RGB (3 байта на пиксель) с арифметикой stb_image.
+typedef void (*YCbCrToRgbFn)(unsigned char* output, const unsigned char* y, const unsigned char* cb, const unsigned char* cr, const size_t count);
+
+// @brief Тип фильтра строки PNG (RFC 2083, 6).
+typedef enum
+{
+    PNG_FILTER_NONE = 0,
+    PNG_FILTER_SUB,
+    PNG_FILTER_UP,
+    PNG_FILTER_AVG,
+    PNG_FILTER_PAETH
+} PngFilter;
+
+// @brief Восстановление строки PNG из size байт по фильтру filter: output[i] = input[i] + предсказание по уже
+//        восстановленным байтам output на bpp байт левее и по предыдущей восстановленной строке prior
+//        (для первой строки - нулевой). output может совпадать с input. Неизвестный фильтр копирует строку.
+typedef void (*PngUnfilterFn)(const int filter, const unsigned char* input, const unsigned char* prior, unsigned char* output, const size_t size, const int bpp);
+
+// @brief Метки равномерного LBP (8 соседей, радиус 1) отрезка из count пикселей строки row. Бит k кода установлен,
+//        если сосед k не меньше центрального пикселя; соседи по часовой стрелке от левого верхнего: (-1, -1), (0, -1),
+//        (1, -1), (1, 0), (1, 1), (0, 1), (-1, 1), (-1, 0). Равномерный код (не больше 2-х переходов 0/1 по кругу)
+//        из n единиц (1..7), серия которых начинается с бита r, получает метку 1 + 8 * (n - 1) + r, код 0 - метку 0,
+//        код 255 - метку 57, остальные коды - метку 58. above и below - строки выше и ниже; байты [-1] и [count]
+//        всех трех строк должны быть доступны.
+typedef void (*LbpRowFn)(const unsigned char* above, const unsigned char* row, const unsigned char* below, unsigned char* output, const size_t count);
+
+// @brief Преобразование отрезка из count пикселей RGB(A) (channels = 3 или 4) в 8-битные HSV / HSL или обратно.
+//        Тон занимает весь байт (0..255 - 0..360 градусов), насыщенность, яркость и значение - 0..255;
+//        альфа-канал копируется. output может совпадать с input. Все реализации дают побитово одинаковый результат.
+typedef void (*ColorRowFn)(const unsigned char* input, unsigned char* output, const size_t count, const int channels);
+
+// @brief Сдвиг тона, насыщенность и светлота отрезка RGB(A) за один проход (HSL без промежуточного кадра).
+//        hue_shift - сдвиг тона в 1/4096 сектора (0 .. 6 * 4096 - 1), saturation - множитель насыщенности
+//        в Q8 (256 - без изменений), lightness - доля смешивания с белым (> 0) или черным (< 0) в Q8 (-256..256).
+typedef void (*HslAdjustRowFn)(const unsigned char* input, unsigned char* output, const size_t count, const int channels,
+                               const int hue_shift, const int saturation, const int lightness);
+
+#define LAB_CBRT_SIZE 4096    // Шаг таблицы f(t) CIELab: 1/4096, значения между записями интерполируются
+#define LAB_ENCODE_SIZE 16384 // Шаг таблицы линейная яркость -> sRGB: 1/16384
+
+// @brief Таблицы преобразований sRGB <-> CIELab (белая точка D65), строятся один раз (см. color.c).
+//        Таблицы байтов дополнены 3-мя байтами, чтобы векторные версии читали их 32-битными gather.
+typedef struct
+{
+    float to_linear[256];                   // sRGB -> линейная яркость
+    float to_xyz[3][3];                     // Линейный RGB -> XYZ, отнесенные к белой точке
+    float to_rgb[3][3];                     // XYZ, отнесенные к белой точке -> линейный RGB
+    float cbrt[LAB_CBRT_SIZE + 2];          // f(t) для t = i / LAB_CBRT_SIZE (и запись за 1 для интерполяции)
+    float f_light[256];                     // L8 -> fy
+    float f_a[256];                         // a8 -> fx - fy
+    float f_b[256];                         // b8 -> fy - fz
+    unsigned char to_srgb[LAB_ENCODE_SIZE + 4]; // i / LAB_ENCODE_SIZE -> sRGB
+} LabTables;
+
+// @brief Преобразование отрезка sRGB(A) <-> 8-битный CIELab (L * 255 / 100, a + 128, b + 128) по таблицам tables.
+//        Арифметика float в фиксированном порядке операций (без FMA), поэтому все реализации дают побитово
+//        одинаковый результат. Альфа-канал копируется, output может совпадать с input.
+typedef void (*LabRowFn)(const LabTables* tables, const unsigned char* input, unsigned char* output, const size_t count, const int channels);
+
+// @brief Таблица реализаций горячих ядер для выбранного уровня SIMD.
+//        Заполняется один раз при создании контекста (или при смене уровня через ipl_set_simd_level).
+typedef struct
+{
+    ConvolveSegmentFn convolve_segment;
+    ConvolveSegmentFn convolve_segment_radius[IPL_CONVOLVE_UNROLL_MAX + 1]; // Развернутые по радиусу 1..8 ([0] = NULL)
+    ThresholdRowFn threshold_row;
+    FloatToHalfFn float_to_half;
+    HalfToFloatFn half_to_float;
+    IdctRowFn idct_row;
+    YCbCrToRgbFn ycbcr_to_rgb;
+    PngUnfilterFn png_unfilter;
+    LbpRowFn lbp_row;
+    ColorRowFn rgb_to_hsv;
+    ColorRowFn hsv_to_rgb;
+    ColorRowFn rgb_to_hsl;
+    ColorRowFn hsl_to_rgb;
+    HslAdjustRowFn hsl_adjust;
+    LabRowFn rgb_to_lab;
+    LabRowFn lab_to_rgb;
+} KernelTable;
+
+SimdLevel ipl_detect_simd_level(void);
+SimdLevel ipl_parse_simd_level(const char* name, const SimdLevel fallback);
+const char* ipl_simd_level_name(const SimdLevel level);
+void ipl_fill_kernel_table(const SimdLevel level, KernelTable* table);
+
+#endif
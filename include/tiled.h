@@ -0,0 +1,46 @@
+#ifndef TILED_H
+#define TILED_H
+
+#include <stddef.h>
+#include "imageproc.h"
+#include "region.h"
+
+// Сторона тайла изображения с копированием при записи (пиксели).
+#define IPL_COW_TILE 128
+
+// @brief Тайл пиксельных данных с количеством ссылок. Тайл разделяется версиями изображения,
+//        пока одна из них не запишет в него (тогда она получает собственную копию).
+typedef struct
+{
+    int refcount;          // Изменяется атомарно (omp atomic)
+    size_t bytes;
+    unsigned char data[];  // Строки тайла подряд, шаг строки - ширина тайла * channels
+} ImageTile;
+
+// @brief Изображение из тайлов IPL_COW_TILE x IPL_COW_TILE (крайние тайлы меньше) с копированием при записи.
+//        Копия версии (ipl_tiled_clone) разделяет все тайлы и стоит только массива указателей.
+typedef struct
+{
+    ImageFormat format;
+    size_t width;
+    size_t height;
+    ImageColorChannels channels;
+    size_t tiles_x;
+    size_t tiles_y;
+    ImageTile** tiles; // tiles_x * tiles_y, по строкам тайлов
+} TiledImage;
+
+TiledImage* ipl_tiled_from_image(const Image* image);
+TiledImage* ipl_tiled_clone(const TiledImage* image);
+void ipl_tiled_free(TiledImage* image);
+ImageProcStatus ipl_tiled_to_image(const TiledImage* image, Image* output);
+const unsigned char* ipl_tiled_tile(const TiledImage* image, const size_t tx, const size_t ty);
+unsigned char* ipl_tiled_tile_for_write(TiledImage* image, const size_t tx, const size_t ty);
+ImageProcStatus ipl_tiled_read(const TiledImage* image, const Rect* rect, unsigned char* output);
+ImageProcStatus ipl_tiled_write(TiledImage* image, const Rect* rect, const unsigned char* input);
+size_t ipl_tiled_unique_bytes(const TiledImage* image);
+
+ImageProcStatus ipl_tiled_gaussian_filter_rects(TiledImage* image, const float sigma, const Rect* rects, const int count);
+ImageProcStatus ipl_tiled_median_filter_rects(TiledImage* image, const int radius, const Rect* rects, const int count);
+
+#endif
@@ -0,0 +1,202 @@
+#include "context.h"
+#include "pipeline.h"
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+// Количество повторов каждого замера (берется лучшее время)
+#define AUTOTUNE_REPEATS 3
+
+// @brief Создает детерминированное тестовое изображение (градиент с шумом).
+static ImageProcStatus make_test_image(Image* image, const size_t width, const size_t height, const int channels)
+{
+    image->format = PNG;
+    image->width = width;
+    image->height = height;
+    image->channels = channels;
+    image->data = (unsigned char*)malloc(width * height * channels);
+    if (!image->data) return OUT_OF_MEMORY;
+
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < width * height * channels; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t x = (i / channels) % width;
+        image->data[i] = (unsigned char)((x * 255 / width + (seed >> 24)) / 2);
+    }
+
+    return SUCCESS;
+}
+
+// @brief Тип замеряемой операции.
+typedef enum
+{
+    BENCH_GAUSSIAN,
+    BENCH_MEDIAN,
+    BENCH_PIPELINE
+} BenchOp;
+
+// @brief Замеряет время операции над копией source с профилем profile. Возвращает лучшее время в секундах.
+static double bench(const BenchOp op, const float param, const Image* source, Image* work, const TuningProfile* profile)
+{
+    size_t bytes = source->width * source->height * source->channels;
+    double best = 1e30;
+
+    ipl_set_profile(profile);
+
+    for (int r = 0; r < AUTOTUNE_REPEATS; r++)
+    {
+        memcpy(work->data, source->data, bytes);
+
+        double start = omp_get_wtime();
+        if (op == BENCH_GAUSSIAN)
+        {
+            ipl_gaussian_filter(work, param);
+        }
+        else if (op == BENCH_MEDIAN)
+        {
+            ipl_median_filter(work, (int)param);
+        }
+        else
+        {
+            Pipeline* pipeline = ipl_pipeline_create(work);
+            int node = ipl_pipeline_grayscale(pipeline, PIPELINE_SOURCE);
+            node = ipl_pipeline_gaussian(pipeline, node, param);
+            node = ipl_pipeline_threshold(pipeline, node, 128);
+            Image result;
+            if (ipl_pipeline_execute(pipeline, &node, &result, 1) == SUCCESS) free(result.data);
+            ipl_pipeline_free(pipeline);
+        }
+        double elapsed = omp_get_wtime() - start;
+
+        if (elapsed < best) best = elapsed;
+    }
+
+    return best;
+}
+
+// @brief Подбирает параметры профиля замерами на текущей машине и сохраняет профиль.
+//        Подбираются: количество потоков, минимальный размер изображения для распараллеливания,
+//        точка перехода от прямой свертки к рекурсивному гауссову фильтру,
+//        максимальный радиус медианы сортировкой окна и размер тайла конвейера.
+//        Остальные ключи берутся из профиля текущего контекста без изменений.
+//        Найденный профиль сразу применяется к текущему контексту.
+//
+// @param profile_path [in] Путь для сохранения профиля (NULL - DEFAULT_PROFILE_PATH).
+//
+// @return OUT_OF_MEMORY Не удалось выделить память для тестовых изображений.
+// @return FILE_WRITE    Не удалось сохранить профиль.
+// @return SUCCESS       Профиль подобран и сохранен.
+ImageProcStatus ipl_autotune(const char* profile_path)
+{
+    if (!profile_path) profile_path = DEFAULT_PROFILE_PATH;
+
+    // Ключи, которые не замеряются (half_intermediates, huge_pages, ...), сохраняются из загруженного профиля
+    TuningProfile best = ipl_get_context()->profile;
+
+    Image source, work;
+    source.data = NULL;
+    work.data = NULL;
+    if (make_test_image(&source, 1920, 1080, 3) != SUCCESS || make_test_image(&work, 1920, 1080, 3) != SUCCESS)
+    {
+        free(source.data);
+        free(work.data);
+        return OUT_OF_MEMORY;
+    }
+
+    TuningProfile trial = best;
+    printf("autotune: SIMD level %s\n", ipl_simd_level_name(ipl_get_context()->simd_level));
+
+    // 1. Количество потоков
+    int procs = omp_get_num_procs();
+    double best_time = 1e30;
+    for (int threads = 1; ; threads = threads * 2 < procs ? threads * 2 : procs)
+    {
+        trial.num_threads = threads;
+        double t = bench(BENCH_GAUSSIAN, 2.0f, &source, &work, &trial);
+        printf("autotune: threads %d: %.2f ms\n", threads, t * 1000.0);
+        if (t < best_time) { best_time = t; best.num_threads = threads; }
+        if (threads == procs) break;
+    }
+    if (best.num_threads == ipl_get_context()->default_threads) best.num_threads = 0; // значение OpenMP по умолчанию
+    trial = best;
+
+    // 2. Минимальный размер изображения для распараллеливания
+    best.parallel_min_pixels = (size_t)4096 * 4096;
+    for (size_t side = 32; side <= 1024; side *= 2)
+    {
+        Image small_source = source, small_work = work;
+        small_source.width = small_work.width = side;
+        small_source.height = small_work.height = side;
+
+        trial.parallel_min_pixels = 0;
+        double parallel_time = bench(BENCH_GAUSSIAN, 1.0f, &small_source, &small_work, &trial);
+        trial.parallel_min_pixels = (size_t)-1;
+        double serial_time = bench(BENCH_GAUSSIAN, 1.0f, &small_source, &small_work, &trial);
+        printf("autotune: %dx%d serial %.3f ms, parallel %.3f ms\n", (int)side, (int)side, serial_time * 1000.0, parallel_time * 1000.0);
+
+        if (parallel_time < serial_time)
+        {
+            best.parallel_min_pixels = side * side;
+            break;
+        }
+    }
+    trial = best;
+
+    // 3. Прямая свертка или рекурсивный гауссов фильтр
+    const float sigmas[] = {1.0f, 1.5f, 2.0f, 3.0f, 4.0f, 6.0f, 8.0f, 12.0f, 16.0f, 24.0f};
+    best.gaussian_iir_sigma = 32.0f;
+    for (size_t k = 0; k < sizeof(sigmas) / sizeof(sigmas[0]); k++)
+    {
+        trial.gaussian_iir_sigma = 1e9f;
+        double direct_time = bench(BENCH_GAUSSIAN, sigmas[k], &source, &work, &trial);
+        trial.gaussian_iir_sigma = 0.5f;
+        double iir_time = bench(BENCH_GAUSSIAN, sigmas[k], &source, &work, &trial);
+        printf("autotune: sigma %.1f direct %.2f ms, iir %.2f ms\n", sigmas[k], direct_time * 1000.0, iir_time * 1000.0);
+
+        if (iir_time < direct_time)
+        {
+            best.gaussian_iir_sigma = sigmas[k];
+            break;
+        }
+    }
+    trial = best;
+
+    // 4. Медиана сортировкой окна или гистограммой
+    best.median_sort_max_radius = 0;
+    for (int radius = 1; radius <= MEDIAN_SORT_LIMIT; radius++)
+    {
+        trial.median_sort_max_radius = radius;
+        double sort_time = bench(BENCH_MEDIAN, (float)radius, &source, &work, &trial);
+        trial.median_sort_max_radius = 0;
+        double hist_time = bench(BENCH_MEDIAN, (float)radius, &source, &work, &trial);
+        printf("autotune: median radius %d sort %.2f ms, histogram %.2f ms\n", radius, sort_time * 1000.0, hist_time * 1000.0);
+
+        if (sort_time >= hist_time) break;
+        best.median_sort_max_radius = radius;
+    }
+    trial = best;
+
+    // 5. Размер тайла конвейера
+    const int tiles[][2] = {{128, 64}, {256, 64}, {256, 128}, {512, 64}, {512, 128}, {256, 256}, {1024, 32}};
+    best_time = 1e30;
+    for (size_t k = 0; k < sizeof(tiles) / sizeof(tiles[0]); k++)
+    {
+        trial.tile_width = tiles[k][0];
+        trial.tile_height = tiles[k][1];
+        double t = bench(BENCH_PIPELINE, 1.5f, &source, &work, &trial);
+        printf("autotune: tile %dx%d: %.2f ms\n", tiles[k][0], tiles[k][1], t * 1000.0);
+        if (t < best_time)
+        {
+            best_time = t;
+            best.tile_width = tiles[k][0];
+            best.tile_height = tiles[k][1];
+        }
+    }
+
+    free(source.data);
+    free(work.data);
+
+    ipl_set_profile(&best);
+    return ipl_save_profile(profile_path, &best);
+}
@@ -0,0 +1,807 @@
+#include "batch_io.h"
+#include "input_output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// io_uring используется без liburing: кольца создаются и обслуживаются системными вызовами напрямую
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define BATCH_URING
+#endif
+#endif
+
+#if defined(BATCH_URING)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#endif
+
+// Максимальная длина одной операции чтения / записи (длина в SQE 32-битная)
+#define BATCH_MAX_CHUNK (1u << 30)
+
+typedef enum
+{
+    REQUEST_QUEUED,  // Ожидает свободного потока (только BATCH_IO_THREADS)
+    REQUEST_RUNNING, // Выполняется
+    REQUEST_DONE     // Завершен, status содержит результат
+} RequestState;
+
+// @brief Запрос чтения или записи целого файла.
+typedef struct BatchRequest
+{
+    struct BatchRequest* next;
+    char* path;
+    int write;             // 0 - чтение, 1 - запись
+    int taken;             // Данные чтения выданы ipl_batch_io_take
+    RequestState state;
+    ImageProcStatus status;
+    unsigned char* data;
+    size_t size;
+    size_t done;           // Прочитано / записано байт
+    int slot;              // Зарегистрированный буфер io_uring или -1 (обычная память)
+#if defined(BATCH_URING)
+    int fd;
+    struct iovec iov;      // Должен жить до завершения операции
+#endif
+} BatchRequest;
+
+#if defined(BATCH_URING)
+// @brief Кольца io_uring, отображенные в память процесса.
+typedef struct
+{
+    int fd;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned sq_entries;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void* sq_map;
+    size_t sq_map_size;
+    void* cq_map;
+    size_t cq_map_size;
+    size_t sqes_size;
+} Uring;
+#endif
+
+struct BatchIO
+{
+    BatchIOBackend backend;
+    int depth;
+    BatchRequest* requests;       // Чтения (до release) и незавершенные записи, в порядке постановки
+    ImageProcStatus write_status; // Первая ошибка записи после последнего ipl_batch_io_flush
+    pthread_mutex_t lock;         // Запросы могут ставиться из рабочих потоков конвейера
+    pthread_cond_t changed;       // Запрос поставлен в очередь или завершен (BATCH_IO_THREADS)
+    pthread_t* threads;
+    int thread_count;
+    int stop;
+#if defined(BATCH_URING)
+    Uring ring;
+    int in_flight;                // Операций в ядре (не больше sq_entries, поэтому очередь завершений не переполняется)
+    int reaping;                  // Поток ждет завершений в io_uring_enter без блокировки; только он забирает завершения
+    unsigned char* slots;         // Зарегистрированные буферы чтения, depth штук по IPL_BATCH_BUFFER_SIZE
+    int* slot_used;
+    int fixed;                    // Буферы зарегистрированы (иначе все чтения в обычную память)
+#endif
+};
+
+// -----------------------
+// ---- ОБЩИЕ ФУНКЦИИ ----
+// -----------------------
+
+static BatchRequest* create_request(const char* path, const int write)
+{
+    BatchRequest* request = (BatchRequest*)calloc(1, sizeof(BatchRequest));
+    if (request) request->path = (char*)malloc(strlen(path) + 1);
+    if (!request || !request->path)
+    {
+        free(request);
+        return NULL;
+    }
+    strcpy(request->path, path);
+    request->write = write;
+    request->slot = -1;
+#if defined(BATCH_URING)
+    request->fd = -1;
+#endif
+    return request;
+}
+
+// @brief Добавляет запрос в конец списка (запросы обслуживаются в порядке постановки).
+static void append_request(BatchIO* io, BatchRequest* request)
+{
+    BatchRequest** tail = &io->requests;
+    while (*tail) tail = &(*tail)->next;
+    *tail = request;
+}
+
+// @brief Удаляет запрос из списка и освобождает его вместе с данными.
+static void destroy_request(BatchIO* io, BatchRequest* request)
+{
+    for (BatchRequest** link = &io->requests; *link; link = &(*link)->next)
+    {
+        if (*link != request) continue;
+        *link = request->next;
+        break;
+    }
+
+#if defined(BATCH_URING)
+    if (request->slot >= 0) io->slot_used[request->slot] = 0;
+    else free(request->data);
+#else
+    free(request->data);
+#endif
+    free(request->path);
+    free(request);
+}
+
+// @brief Отмечает запрос завершенным. Завершенная запись сразу удаляется, ее ошибка запоминается для flush.
+static void finish_request(BatchIO* io, BatchRequest* request, const ImageProcStatus status)
+{
+    request->state = REQUEST_DONE;
+    request->status = status;
+    if (request->write)
+    {
+        if (status != SUCCESS && io->write_status == SUCCESS) io->write_status = status;
+        destroy_request(io, request);
+    }
+}
+
+// -------------------------------
+// ---- РЕАЛИЗАЦИЯ: io_uring ----
+// -------------------------------
+
+#if defined(BATCH_URING)
+
+static int uring_init(Uring* ring, const unsigned entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(Uring));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) return -1;
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && ring->cq_map_size > ring->sq_map_size) ring->sq_map_size = ring->cq_map_size;
+
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_map = single ? ring->sq_map
+                          : mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sq_map == MAP_FAILED || ring->cq_map == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        if (ring->sqes != MAP_FAILED) munmap(ring->sqes, ring->sqes_size);
+        if (!single && ring->cq_map != MAP_FAILED) munmap(ring->cq_map, ring->cq_map_size);
+        if (ring->sq_map != MAP_FAILED) munmap(ring->sq_map, ring->sq_map_size);
+        close(ring->fd);
+        return -1;
+    }
+
+    char* sq = (char*)ring->sq_map;
+    char* cq = (char*)ring->cq_map;
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+static void uring_destroy(Uring* ring)
+{
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map != ring->sq_map) munmap(ring->cq_map, ring->cq_map_size);
+    munmap(ring->sq_map, ring->sq_map_size);
+    close(ring->fd);
+}
+
+// @brief Передает ядру поставленные SQE и при wait > 0 ждет хотя бы wait завершений.
+static void uring_enter(Uring* ring, const unsigned submit, const unsigned wait)
+{
+    while (syscall(__NR_io_uring_enter, ring->fd, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0) < 0 && errno == EINTR);
+}
+
+static void wait_completion(BatchIO* io);
+
+// @brief Ставит в кольцо операцию для оставшейся части запроса. Вызывается под блокировкой.
+static void uring_submit(BatchIO* io, BatchRequest* request)
+{
+    Uring* ring = &io->ring;
+    while (io->in_flight >= (int)ring->sq_entries) wait_completion(io);
+
+    // Каждая SQE сразу передается ядру, поэтому очередь отправки всегда пуста
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+
+    size_t remaining = request->size - request->done;
+    unsigned length = remaining > BATCH_MAX_CHUNK ? BATCH_MAX_CHUNK : (unsigned)remaining;
+    sqe->fd = request->fd;
+    sqe->off = request->done;
+    sqe->user_data = (uint64_t)(uintptr_t)request;
+    if (request->slot >= 0)
+    {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->addr = (uint64_t)(uintptr_t)(request->data + request->done);
+        sqe->len = length;
+        sqe->buf_index = (uint16_t)request->slot;
+    }
+    else
+    {
+        request->iov.iov_base = request->data + request->done;
+        request->iov.iov_len = length;
+        sqe->opcode = request->write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqe->addr = (uint64_t)(uintptr_t)&request->iov;
+        sqe->len = 1;
+    }
+
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    io->in_flight++;
+    uring_enter(ring, 1, 0);
+}
+
+// @brief Обрабатывает уже поступившие завершения из кольца, не дожидаясь новых. Вызывается под блокировкой.
+//        Неполные чтения и записи продолжаются с достигнутого смещения.
+static void uring_reap(BatchIO* io)
+{
+    Uring* ring = &io->ring;
+
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++)
+    {
+        struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+        BatchRequest* request = (BatchRequest*)(uintptr_t)cqe->user_data;
+        int result = cqe->res;
+        __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+        io->in_flight--;
+
+        if (result > 0)
+        {
+            request->done += (size_t)result;
+            if (request->done < request->size)
+            {
+                uring_submit(io, request);
+                continue;
+            }
+        }
+
+        close(request->fd);
+        request->fd = -1;
+        int complete = result >= 0 && request->done == request->size;
+        finish_request(io, request, complete ? SUCCESS : (request->write ? FILE_WRITE : FILE_READ));
+    }
+}
+
+static void uring_prefetch(BatchIO* io, BatchRequest* request)
+{
+    struct stat info;
+    request->fd = open(request->path, O_RDONLY | O_CLOEXEC);
+    if (request->fd < 0 || fstat(request->fd, &info) != 0 || info.st_size <= 0)
+    {
+        ImageProcStatus status = request->fd < 0 && errno == ENOENT ? FILE_NOT_FOUND : FILE_READ;
+        if (request->fd >= 0) close(request->fd);
+        request->fd = -1;
+        finish_request(io, request, status);
+        return;
+    }
+    request->size = (size_t)info.st_size;
+
+    // Небольшие файлы читаются в зарегистрированный буфер (без отображения страниц на каждую операцию)
+    if (io->fixed && request->size <= IPL_BATCH_BUFFER_SIZE)
+    {
+        for (int s = 0; s < io->depth && request->slot < 0; s++)
+        {
+            if (io->slot_used[s]) continue;
+            io->slot_used[s] = 1;
+            request->slot = s;
+            request->data = io->slots + (size_t)s * IPL_BATCH_BUFFER_SIZE;
+        }
+    }
+    if (request->slot < 0) request->data = (unsigned char*)malloc(request->size);
+    if (!request->data)
+    {
+        close(request->fd);
+        request->fd = -1;
+        finish_request(io, request, OUT_OF_MEMORY);
+        return;
+    }
+
+    request->state = REQUEST_RUNNING;
+    uring_submit(io, request);
+}
+
+static ImageProcStatus uring_write(BatchIO* io, BatchRequest* request)
+{
+    request->fd = open(request->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (request->fd < 0) return FILE_NOT_FOUND;
+
+    request->state = REQUEST_RUNNING;
+    uring_submit(io, request);
+    return SUCCESS;
+}
+
+// @brief Создает кольцо на 2 * depth операций (чтения заранее и записи) и регистрирует буферы чтения.
+static int uring_create(BatchIO* io)
+{
+    const char* backend = getenv("IPL_BATCH_IO");
+    if (backend && strcmp(backend, "threads") == 0) return -1;
+
+    if (uring_init(&io->ring, (unsigned)(2 * io->depth)) != 0) return -1;
+
+    // Регистрация может не пройти из-за ограничения заблокированной памяти (RLIMIT_MEMLOCK на старых ядрах)
+    size_t bytes = (size_t)io->depth * IPL_BATCH_BUFFER_SIZE;
+    io->slot_used = (int*)calloc((size_t)io->depth, sizeof(int));
+    io->slots = (unsigned char*)mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (io->slots == MAP_FAILED) io->slots = NULL;
+    if (io->slots && io->slot_used)
+    {
+        struct iovec* buffers = (struct iovec*)malloc((size_t)io->depth * sizeof(struct iovec));
+        for (int s = 0; buffers && s < io->depth; s++)
+        {
+            buffers[s].iov_base = io->slots + (size_t)s * IPL_BATCH_BUFFER_SIZE;
+            buffers[s].iov_len = IPL_BATCH_BUFFER_SIZE;
+        }
+        io->fixed = buffers && syscall(__NR_io_uring_register, io->ring.fd, IORING_REGISTER_BUFFERS, buffers, io->depth) == 0;
+        free(buffers);
+    }
+    if (!io->fixed && io->slots)
+    {
+        munmap(io->slots, bytes);
+        io->slots = NULL;
+    }
+
+    io->backend = BATCH_IO_URING;
+    return 0;
+}
+
+static void uring_free(BatchIO* io)
+{
+    if (io->slots) munmap(io->slots, (size_t)io->depth * IPL_BATCH_BUFFER_SIZE);
+    free(io->slot_used);
+    uring_destroy(&io->ring); // Закрытие кольца снимает и регистрацию буферов
+}
+
+#endif
+
+// -------------------------------
+// ---- РЕАЛИЗАЦИЯ: ПОТОКИ ----
+// -------------------------------
+
+static ImageProcStatus read_whole_file(const char* path, unsigned char** data, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) return FILE_NOT_FOUND;
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    ImageProcStatus status = SUCCESS;
+    *data = length > 0 ? (unsigned char*)malloc((size_t)length) : NULL;
+    if (length <= 0) status = FILE_READ;
+    else if (!*data) status = OUT_OF_MEMORY;
+    else if (fread(*data, 1, (size_t)length, file) != (size_t)length) status = FILE_READ;
+    fclose(file);
+
+    *size = status == SUCCESS ? (size_t)length : 0;
+    return status;
+}
+
+static ImageProcStatus write_whole_file(const char* path, const unsigned char* data, const size_t size)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file) return FILE_NOT_FOUND;
+
+    int written = fwrite(data, 1, size, file) == size;
+    written = (fclose(file) == 0) && written;
+    if (!written)
+    {
+        remove(path);
+        return FILE_WRITE;
+    }
+    return SUCCESS;
+}
+
+// @brief Рабочий поток: выполняет запросы из очереди в порядке постановки.
+static void* worker_main(void* argument)
+{
+    BatchIO* io = (BatchIO*)argument;
+
+    pthread_mutex_lock(&io->lock);
+    for (;;)
+    {
+        BatchRequest* request = io->requests;
+        while (request && request->state != REQUEST_QUEUED) request = request->next;
+        if (!request)
+        {
+            if (io->stop) break;
+            pthread_cond_wait(&io->changed, &io->lock);
+            continue;
+        }
+
+        request->state = REQUEST_RUNNING;
+        pthread_mutex_unlock(&io->lock);
+
+        ImageProcStatus status;
+        if (request->write)
+        {
+            status = write_whole_file(request->path, request->data, request->size);
+        }
+        else
+        {
+            status = read_whole_file(request->path, &request->data, &request->size);
+            if (status != SUCCESS)
+            {
+                free(request->data);
+                request->data = NULL;
+            }
+        }
+
+        pthread_mutex_lock(&io->lock);
+        finish_request(io, request, status);
+        pthread_cond_broadcast(&io->changed);
+    }
+    pthread_mutex_unlock(&io->lock);
+
+    return NULL;
+}
+
+static int threads_create(BatchIO* io)
+{
+    io->threads = (pthread_t*)malloc((size_t)io->depth * sizeof(pthread_t));
+    if (!io->threads) return -1;
+
+    // По потоку на файл в очереди: на сетевых дисках время уходит на ожидание, а не на копирование
+    for (int t = 0; t < io->depth; t++)
+    {
+        if (pthread_create(&io->threads[t], NULL, worker_main, io) != 0) break;
+        io->thread_count++;
+    }
+
+    io->backend = BATCH_IO_THREADS;
+    return io->thread_count > 0 ? 0 : -1;
+}
+
+static void threads_free(BatchIO* io)
+{
+    pthread_mutex_lock(&io->lock);
+    io->stop = 1;
+    pthread_cond_broadcast(&io->changed);
+    pthread_mutex_unlock(&io->lock);
+
+    for (int t = 0; t < io->thread_count; t++) pthread_join(io->threads[t], NULL);
+    free(io->threads);
+}
+
+// @brief Ждет завершения хотя бы одной операции. Вызывается под блокировкой.
+//        io_uring: блокировка на время ожидания в ядре снимается, чтобы другие потоки могли ставить запросы.
+//        В ядре ждет один поток (reaping), и только он забирает завершения: иначе другой поток мог бы забрать
+//        завершение, которого он ждет, и io_uring_enter не вернулся бы. Остальные ждут changed.
+//        Если в ядре нет операций, ожидаемый запрос еще ставит другой поток (он ждет места в кольце):
+//        ждем changed, а не проверяем кольцо в цикле, не отпуская блокировку.
+static void wait_completion(BatchIO* io)
+{
+#if defined(BATCH_URING)
+    if (io->backend == BATCH_IO_URING)
+    {
+        Uring* ring = &io->ring;
+        int empty = *ring->cq_head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        if (io->reaping || (empty && io->in_flight == 0))
+        {
+            pthread_cond_wait(&io->changed, &io->lock);
+            return;
+        }
+
+        if (empty)
+        {
+            io->reaping = 1;
+            pthread_mutex_unlock(&io->lock);
+            uring_enter(ring, 0, 1);
+            pthread_mutex_lock(&io->lock);
+            io->reaping = 0;
+        }
+        uring_reap(io);
+        pthread_cond_broadcast(&io->changed);
+        return;
+    }
+#endif
+    pthread_cond_wait(&io->changed, &io->lock);
+}
+
+// @brief Ждет завершения чтения (завершенные чтения остаются в списке до release). Вызывается под блокировкой.
+static void wait_read(BatchIO* io, BatchRequest* request)
+{
+    while (request->state != REQUEST_DONE) wait_completion(io);
+}
+
+// -------------------------
+// ---- ПУБЛИЧНЫЕ ФУНКЦИИ ----
+// -------------------------
+
+// @brief Создает пакетный ввод-вывод: io_uring, если он доступен (Linux 5.1+ и не запрещен переменной окружения
+//        IPL_BATCH_IO=threads), иначе пул из depth потоков.
+//
+// @param depth [in] Сколько файлов читается заранее (и размер пула потоков / зарегистрированных буферов).
+//
+// @return Пакетный ввод-вывод или NULL, если не удалось выделить память или создать потоки.
+BatchIO* ipl_batch_io_create(const int depth)
+{
+    if (depth <= 0) return NULL;
+
+    BatchIO* io = (BatchIO*)calloc(1, sizeof(BatchIO));
+    if (!io) return NULL;
+    io->depth = depth;
+    io->write_status = SUCCESS;
+    pthread_mutex_init(&io->lock, NULL);
+    pthread_cond_init(&io->changed, NULL);
+
+#if defined(BATCH_URING)
+    if (uring_create(io) == 0) return io;
+#endif
+    if (threads_create(io) == 0) return io;
+
+    threads_free(io);
+    pthread_cond_destroy(&io->changed);
+    pthread_mutex_destroy(&io->lock);
+    free(io);
+    return NULL;
+}
+
+// @brief Создает пакетный ввод-вывод с глубиной из переменной окружения IPL_BATCH_DEPTH (по умолчанию IPL_BATCH_DEFAULT_DEPTH).
+BatchIO* ipl_batch_io_create_default(void)
+{
+    const char* value = getenv("IPL_BATCH_DEPTH");
+    int depth = value ? atoi(value) : IPL_BATCH_DEFAULT_DEPTH;
+    return ipl_batch_io_create(depth > 0 ? depth : IPL_BATCH_DEFAULT_DEPTH);
+}
+
+// @brief Дожидается незавершенных операций и освобождает пакетный ввод-вывод вместе с невыданными данными.
+void ipl_batch_io_free(BatchIO* io)
+{
+    if (!io) return;
+
+    // Сначала завершаются все операции: ядро и потоки больше не обращаются к буферам запросов
+#if defined(BATCH_URING)
+    if (io->backend == BATCH_IO_URING)
+    {
+        pthread_mutex_lock(&io->lock);
+        while (io->in_flight > 0) wait_completion(io);
+        pthread_mutex_unlock(&io->lock);
+    }
+#endif
+    if (io->backend == BATCH_IO_THREADS) threads_free(io); // Потоки выполняют оставшуюся очередь и завершаются
+
+    while (io->requests) destroy_request(io, io->requests);
+#if defined(BATCH_URING)
+    if (io->backend == BATCH_IO_URING) uring_free(io);
+#endif
+
+    pthread_cond_destroy(&io->changed);
+    pthread_mutex_destroy(&io->lock);
+    free(io);
+}
+
+BatchIOBackend ipl_batch_io_backend(const BatchIO* io)
+{
+    return io->backend;
+}
+
+int ipl_batch_io_depth(const BatchIO* io)
+{
+    return io->depth;
+}
+
+// @brief Ставит в очередь чтение файла целиком. Данные забираются ipl_batch_io_take; если файл не понадобился,
+//        запрос удаляется ipl_batch_io_discard. Ошибки чтения возвращаются из ipl_batch_io_take.
+//
+// @return INVALID_ARGUMENT Указатели равны NULL.
+// @return OUT_OF_MEMORY    Не удалось выделить запрос.
+// @return SUCCESS          Чтение поставлено в очередь.
+ImageProcStatus ipl_batch_io_prefetch(BatchIO* io, const char* path)
+{
+    if (!io || !path) return INVALID_ARGUMENT;
+
+    BatchRequest* request = create_request(path, 0);
+    if (!request) return OUT_OF_MEMORY;
+
+    pthread_mutex_lock(&io->lock);
+    append_request(io, request);
+#if defined(BATCH_URING)
+    if (io->backend == BATCH_IO_URING) uring_prefetch(io, request);
+#endif
+    pthread_cond_broadcast(&io->changed);
+    pthread_mutex_unlock(&io->lock);
+
+    return SUCCESS;
+}
+
+// @brief Возвращает содержимое файла: ждет чтения, поставленного ipl_batch_io_prefetch, или ставит его сейчас.
+//        Данные доступны только для чтения до ipl_batch_io_release.
+//
+// @param io   [in]  Пакетный ввод-вывод.
+// @param path [in]  Путь к файлу.
+// @param data [out] Содержимое файла.
+// @param size [out] Размер содержимого.
+//
+// @return FILE_NOT_FOUND Файл не найден.
+// @return FILE_READ      Ошибка чтения или пустой файл.
+// @return OUT_OF_MEMORY  Не удалось выделить память.
+// @return SUCCESS        Данные получены.
+ImageProcStatus ipl_batch_io_take(BatchIO* io, const char* path, const unsigned char** data, size_t* size)
+{
+    if (!io || !path || !data || !size) return INVALID_ARGUMENT;
+    *data = NULL;
+    *size = 0;
+
+    pthread_mutex_lock(&io->lock);
+    BatchRequest* request = io->requests;
+    while (request && (request->write || request->taken || strcmp(request->path, path) != 0)) request = request->next;
+    if (!request)
+    {
+        // Файл не читался заранее: чтение ставится сейчас
+        pthread_mutex_unlock(&io->lock);
+        ImageProcStatus status = ipl_batch_io_prefetch(io, path);
+        if (status != SUCCESS) return status;
+        return ipl_batch_io_take(io, path, data, size);
+    }
+
+    request->taken = 1;
+    wait_read(io, request);
+
+    ImageProcStatus status = request->status;
+    if (status == SUCCESS)
+    {
+        *data = request->data;
+        *size = request->size;
+    }
+    else
+    {
+        destroy_request(io, request);
+    }
+    pthread_mutex_unlock(&io->lock);
+
+    return status;
+}
+
+// @brief Освобождает данные, полученные ipl_batch_io_take (буфер возвращается в пул).
+void ipl_batch_io_release(BatchIO* io, const unsigned char* data)
+{
+    if (!io || !data) return;
+
+    pthread_mutex_lock(&io->lock);
+    for (BatchRequest* request = io->requests; request; request = request->next)
+    {
+        if (request->write || !request->taken || request->data != data) continue;
+        destroy_request(io, request);
+        break;
+    }
+    pthread_mutex_unlock(&io->lock);
+}
+
+// @brief Удаляет невыданные чтения файла (например, если результат задания нашелся в кэше и вход не декодировался).
+void ipl_batch_io_discard(BatchIO* io, const char* path)
+{
+    if (!io || !path) return;
+
+    pthread_mutex_lock(&io->lock);
+    BatchRequest* request = io->requests;
+    while (request)
+    {
+        BatchRequest* next = request->next;
+        if (!request->write && !request->taken && strcmp(request->path, path) == 0)
+        {
+            // Выполняющийся запрос нельзя отменить: буфер нужен ядру / потоку до завершения
+            if (request->state == REQUEST_RUNNING)
+            {
+                wait_read(io, request);
+                next = request->next;
+            }
+            destroy_request(io, request);
+        }
+        request = next;
+    }
+    pthread_mutex_unlock(&io->lock);
+}
+
+// @brief Ставит в очередь запись файла целиком. Владение data (выделенной malloc) переходит к io:
+//        буфер освобождается после записи. Ошибки записи возвращаются из ipl_batch_io_flush.
+//
+// @return INVALID_ARGUMENT Указатели равны NULL или данные пусты (data освобождается).
+// @return FILE_NOT_FOUND   Файл не удалось создать (io_uring открывает файл сразу).
+// @return OUT_OF_MEMORY    Не удалось выделить запрос.
+// @return SUCCESS          Запись поставлена в очередь.
+ImageProcStatus ipl_batch_io_write(BatchIO* io, const char* path, unsigned char* data, const size_t size)
+{
+    if (!io || !path || !data || size == 0)
+    {
+        free(data);
+        return INVALID_ARGUMENT;
+    }
+
+    BatchRequest* request = create_request(path, 1);
+    if (!request)
+    {
+        free(data);
+        return OUT_OF_MEMORY;
+    }
+    request->data = data;
+    request->size = size;
+
+    ImageProcStatus status = SUCCESS;
+    pthread_mutex_lock(&io->lock);
+    append_request(io, request);
+#if defined(BATCH_URING)
+    if (io->backend == BATCH_IO_URING)
+    {
+        status = uring_write(io, request);
+        if (status != SUCCESS) destroy_request(io, request);
+        else if (!io->reaping) uring_reap(io); // Попутно забираем уже завершенные операции, чтобы освободить буферы
+    }
+#endif
+    pthread_cond_broadcast(&io->changed);
+    pthread_mutex_unlock(&io->lock);
+
+    return status;
+}
+
+// @brief Дожидается завершения всех поставленных записей.
+//
+// @return Первая ошибка записи после предыдущего ipl_batch_io_flush или SUCCESS.
+ImageProcStatus ipl_batch_io_flush(BatchIO* io)
+{
+    if (!io) return SUCCESS;
+
+    pthread_mutex_lock(&io->lock);
+    for (;;)
+    {
+        BatchRequest* request = io->requests;
+        while (request && !request->write) request = request->next;
+        if (!request) break;
+        wait_completion(io); // Завершенная запись удаляется из списка
+    }
+
+    ImageProcStatus status = io->write_status;
+    io->write_status = SUCCESS;
+    pthread_mutex_unlock(&io->lock);
+
+    return status;
+}
+
+// @brief Загружает изображение через пакетный ввод-вывод: содержимое файла берется из чтения заранее
+//        (или читается сейчас) и декодируется из памяти. Без io работает как ipl_load_image.
+ImageProcStatus ipl_load_image_batch(BatchIO* io, const char* file_name, Image* image, const ImageFormat file_format)
+{
+    if (!io) return ipl_load_image(file_name, image, file_format);
+
+    const unsigned char* data;
+    size_t size;
+    ImageProcStatus status = ipl_batch_io_take(io, file_name, &data, &size);
+    if (status != SUCCESS) return status;
+
+    status = ipl_load_image_from_memory(data, size, image, file_format);
+    ipl_batch_io_release(io, data);
+    return status;
+}
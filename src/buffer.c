@@ -0,0 +1,68 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // posix_memalign, madvise
+#endif
+
+#include "buffer.h"
+#include "context.h"
+#include <stdlib.h>
+#include <stddef.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+// Шаг касания страниц при предварительном заполнении (минимальный размер страницы)
+#define PREFAULT_STEP 4096
+
+// @brief Выделяет буфер для пиксельных данных.
+//        Буферы от IPL_HUGE_PAGE_SIZE в Linux выравниваются на 2 МБ и помечаются MADV_HUGEPAGE (если включено
+//        huge_pages в профиле), чтобы ядро отображало их большими страницами: первое обращение к 24 МП буферу
+//        стоит десятки страничных прерываний вместо десятков тысяч, и меньше промахов TLB.
+//        При prefault_buffers в профиле страницы сразу заполняются параллельно (см. ipl_buffer_prefault).
+//        Память освобождается обычным free, поэтому буфер можно отдавать пользователю как image->data.
+//
+// @param bytes [in] Размер буфера в байтах.
+//
+// @return Указатель на буфер или NULL, если не удалось выделить память.
+void* ipl_buffer_alloc(const size_t bytes)
+{
+    const TuningProfile* profile = &ipl_get_context()->profile;
+    void* data = NULL;
+
+#if defined(__linux__)
+    if (profile->huge_pages && bytes >= IPL_HUGE_PAGE_SIZE)
+    {
+        // Размер округляется до целого числа больших страниц, чтобы и хвост буфера попал в большую страницу
+        size_t rounded = (bytes + IPL_HUGE_PAGE_SIZE - 1) / IPL_HUGE_PAGE_SIZE * IPL_HUGE_PAGE_SIZE;
+        if (posix_memalign(&data, IPL_HUGE_PAGE_SIZE, rounded) == 0)
+            madvise(data, rounded, MADV_HUGEPAGE); // Ошибка не критична: останутся обычные страницы
+        else
+            data = NULL;
+    }
+#endif
+
+    if (!data) data = malloc(bytes);
+    if (data && profile->prefault_buffers && bytes >= IPL_HUGE_PAGE_SIZE) ipl_buffer_prefault(data, bytes);
+
+    return data;
+}
+
+// @brief Заранее отображает страницы буфера, записывая по одному байту в каждую страницу.
+//        Для больших буферов страницы касаются несколько потоков, поэтому страничные прерывания
+//        обрабатываются параллельно и не попадают в задержку фильтра. Содержимое буфера портится,
+//        поэтому функция вызывается только для только что выделенной памяти.
+//
+// @param data  [in, out] Буфер.
+// @param bytes [in]      Размер буфера в байтах.
+void ipl_buffer_prefault(void* data, const size_t bytes)
+{
+    unsigned char* bytes_data = (unsigned char*)data;
+    ptrdiff_t pages = (ptrdiff_t)((bytes + PREFAULT_STEP - 1) / PREFAULT_STEP);
+    int parallel = bytes / 4 >= ipl_get_context()->profile.parallel_min_pixels; // порог в пикселях RGBA
+
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t p = 0; p < pages; p++)
+    {
+        bytes_data[(size_t)p * PREFAULT_STEP] = 0;
+    }
+}
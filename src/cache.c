@@ -0,0 +1,603 @@
+#include "cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <utime.h>
+#include <omp.h>
+
+#if defined(_WIN32)
+#include <direct.h>  // _mkdir
+#include <process.h> // _getpid
+#define cache_mkdir(dir) _mkdir(dir)
+#define cache_pid() ((unsigned int)_getpid())
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#define cache_mkdir(dir) mkdir(dir, 0755)
+#define cache_pid() ((unsigned int)getpid())
+#define CACHE_MMAP // Попадания отображаются в память, а не читаются в буфер
+#endif
+
+// Временные файлы старше этого возраста (секунды) остались от прерванных процессов и удаляются при открытии кэша
+#define CACHE_STALE_TEMP_SECONDS 3600
+// Длина имени файла записи: 32 шестнадцатеричные цифры ключа и расширение
+#define CACHE_NAME_LENGTH 36
+
+// ---------------------
+// ---- ХЭШ (XXH64) ----
+// ---------------------
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t xxh_rotl(const uint64_t x, const int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t xxh_read64(const unsigned char* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v)); // x86: порядок байтов little-endian, как в эталонной реализации
+    return v;
+}
+
+static inline uint32_t xxh_read32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t xxh_round(uint64_t acc, const uint64_t input)
+{
+    acc += input * XXH_PRIME64_2;
+    acc = xxh_rotl(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxh_merge_round(uint64_t acc, const uint64_t value)
+{
+    acc ^= xxh_round(0, value);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+// @brief 64-битный хэш XXH64 (совместим с эталонной реализацией xxHash). Основной цикл обрабатывает
+//        32 байта за итерацию четырьмя независимыми сумматорами, поэтому хэш входного файла стоит
+//        намного меньше его декодирования.
+//
+// @param data [in] Данные.
+// @param size [in] Размер данных в байтах.
+// @param seed [in] Начальное значение.
+//
+// @return Хэш.
+uint64_t ipl_hash64(const void* data, const size_t size, const uint64_t seed)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + size;
+    uint64_t h;
+
+    if (size >= 32)
+    {
+        const unsigned char* limit = end - 32;
+        uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = seed + XXH_PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME64_1;
+        do
+        {
+            v1 = xxh_round(v1, xxh_read64(p));
+            v2 = xxh_round(v2, xxh_read64(p + 8));
+            v3 = xxh_round(v3, xxh_read64(p + 16));
+            v4 = xxh_round(v4, xxh_read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = xxh_rotl(v1, 1) + xxh_rotl(v2, 7) + xxh_rotl(v3, 12) + xxh_rotl(v4, 18);
+        h = xxh_merge_round(h, v1);
+        h = xxh_merge_round(h, v2);
+        h = xxh_merge_round(h, v3);
+        h = xxh_merge_round(h, v4);
+    }
+    else
+    {
+        h = seed + XXH_PRIME64_5;
+    }
+
+    h += (uint64_t)size;
+
+    for (; p + 8 <= end; p += 8)
+    {
+        h ^= xxh_round(0, xxh_read64(p));
+        h = xxh_rotl(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    if (p + 4 <= end)
+    {
+        h ^= (uint64_t)xxh_read32(p) * XXH_PRIME64_1;
+        h = xxh_rotl(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; p++)
+    {
+        h ^= (*p) * XXH_PRIME64_5;
+        h = xxh_rotl(h, 11) * XXH_PRIME64_1;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+// @brief Читает файл целиком в буфер (освобождается free).
+static unsigned char* read_file(const char* path, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char* data = length > 0 ? (unsigned char*)malloc((size_t)length) : NULL;
+    if (data && fread(data, 1, (size_t)length, file) != (size_t)length)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+
+    *size = data ? (size_t)length : 0;
+    return data;
+}
+
+// @brief Хэш содержимого файла (ipl_hash64 с нулевым начальным значением).
+//
+// @param path [in]  Путь к файлу.
+// @param hash [out] Хэш.
+//
+// @return FILE_NOT_FOUND Файл не найден или пуст.
+// @return SUCCESS        Хэш вычислен.
+ImageProcStatus ipl_hash_file(const char* path, uint64_t* hash)
+{
+    if (!path || !hash) return INVALID_ARGUMENT;
+
+    size_t size;
+    unsigned char* data = read_file(path, &size);
+    if (!data) return FILE_NOT_FOUND;
+
+    *hash = ipl_hash64(data, size, 0);
+    free(data);
+    return SUCCESS;
+}
+
+// @brief Ключ результата: хэш входных байтов (например, файла изображения) и хэш канонической строки
+//        операций с параметрами, форматом результата и версией ключей.
+//
+// @param input_hash [in] Хэш входа (ipl_hash64 или ipl_hash_file).
+// @param operation  [in] Каноническая строка операций (одинаковые операции - одинаковые строки).
+CacheKey ipl_cache_key(const uint64_t input_hash, const char* operation)
+{
+    CacheKey key;
+    key.input = input_hash;
+    key.operation = ipl_hash64(operation, strlen(operation), IPL_CACHE_VERSION);
+    return key;
+}
+
+// -------------------------
+// ---- КЭШ НА ДИСКЕ ----
+// -------------------------
+
+// @brief Путь к файлу записи: <каталог>/<ключ>.ipc
+static void cache_entry_path(const ResultCache* cache, const CacheKey key, char* path, const size_t size)
+{
+    snprintf(path, size, "%s/%016llx%016llx.ipc", cache->dir, (unsigned long long)key.input, (unsigned long long)key.operation);
+}
+
+// @brief Позиция ключа в хэш-таблице. Ключ уже состоит из хэшей, поэтому достаточно перемешать его половины.
+static inline int slot_home(const ResultCache* cache, const CacheKey key)
+{
+    uint64_t h = (key.input ^ key.operation) * XXH_PRIME64_1;
+    return (int)(h >> 32) & cache->slot_mask;
+}
+
+static inline int key_equal(const CacheKey a, const CacheKey b)
+{
+    return a.input == b.input && a.operation == b.operation;
+}
+
+// @brief Ячейка хэш-таблицы с ключом key или пустая ячейка, в которую его нужно добавить (линейное пробирование).
+static int slot_find(const ResultCache* cache, const CacheKey key)
+{
+    int s = slot_home(cache, key);
+    while (cache->slots[s] >= 0 && !key_equal(cache->entries[cache->slots[s]].key, key)) s = (s + 1) & cache->slot_mask;
+    return s;
+}
+
+static int index_find(const ResultCache* cache, const CacheKey key)
+{
+    if (!cache->slots) return -1;
+    return cache->slots[slot_find(cache, key)];
+}
+
+// @brief Освобождает ячейку s, сдвигая назад следующие за ней записи цепочки (без "надгробий").
+static void slot_erase(ResultCache* cache, int s)
+{
+    int next = s;
+    for (;;)
+    {
+        next = (next + 1) & cache->slot_mask;
+        if (cache->slots[next] < 0) break;
+
+        // Запись из next можно перенести в s, если ее исходная ячейка не лежит в циклическом интервале (s, next]
+        int home = slot_home(cache, cache->entries[cache->slots[next]].key);
+        int movable = s <= next ? (home <= s || home > next) : (home <= s && home > next);
+        if (movable)
+        {
+            cache->slots[s] = cache->slots[next];
+            s = next;
+        }
+    }
+    cache->slots[s] = -1;
+}
+
+// @brief Перестраивает хэш-таблицу под размер slot_count (степень двойки).
+//
+// @return 0 - не удалось выделить память (старая таблица остается).
+static int slots_resize(ResultCache* cache, const int slot_count)
+{
+    int* slots = (int*)malloc((size_t)slot_count * sizeof(int));
+    if (!slots) return 0;
+
+    free(cache->slots);
+    cache->slots = slots;
+    cache->slot_mask = slot_count - 1;
+    for (int s = 0; s < slot_count; s++) slots[s] = -1;
+    for (int i = 0; i < cache->count; i++) slots[slot_find(cache, cache->entries[i].key)] = i;
+    return 1;
+}
+
+static void lru_unlink(ResultCache* cache, const int i)
+{
+    CacheIndexEntry* entry = &cache->entries[i];
+    if (entry->prev >= 0) cache->entries[entry->prev].next = entry->next;
+    else cache->lru_head = entry->next;
+    if (entry->next >= 0) cache->entries[entry->next].prev = entry->prev;
+    else cache->lru_tail = entry->prev;
+}
+
+// @brief Ставит запись в конец списка LRU (последней использованной).
+static void lru_append(ResultCache* cache, const int i)
+{
+    cache->entries[i].prev = cache->lru_tail;
+    cache->entries[i].next = -1;
+    if (cache->lru_tail >= 0) cache->entries[cache->lru_tail].next = i;
+    else cache->lru_head = i;
+    cache->lru_tail = i;
+}
+
+// @brief Добавляет запись в индекс или обновляет существующую; запись становится последней использованной.
+//        Вызывается внутри критической секции.
+static void index_put(ResultCache* cache, const CacheKey key, const size_t bytes, const time_t used)
+{
+    int i = index_find(cache, key);
+    if (i >= 0)
+    {
+        cache->total_bytes -= cache->entries[i].bytes;
+        lru_unlink(cache, i);
+    }
+    else
+    {
+        if (cache->count == cache->capacity)
+        {
+            int capacity = cache->capacity ? cache->capacity * 2 : 64;
+            CacheIndexEntry* entries = (CacheIndexEntry*)realloc(cache->entries, capacity * sizeof(CacheIndexEntry));
+            if (!entries) return; // Запись останется на диске и будет найдена следующим поиском
+            cache->entries = entries;
+            cache->capacity = capacity;
+        }
+        // Таблица заполнена не больше чем наполовину, чтобы цепочки пробирования оставались короткими
+        if (!cache->slots || 2 * (cache->count + 1) > cache->slot_mask + 1)
+        {
+            if (!slots_resize(cache, cache->slots ? 2 * (cache->slot_mask + 1) : 2 * cache->capacity)) return;
+        }
+        i = cache->count++;
+        cache->entries[i].key = key;
+        cache->slots[slot_find(cache, key)] = i;
+    }
+
+    cache->entries[i].bytes = bytes;
+    cache->entries[i].used = used;
+    cache->total_bytes += bytes;
+    lru_append(cache, i);
+}
+
+// @brief Удаляет запись i из индекса. На ее место переносится последняя запись массива.
+static void index_remove(ResultCache* cache, const int i)
+{
+    cache->total_bytes -= cache->entries[i].bytes;
+    slot_erase(cache, slot_find(cache, cache->entries[i].key));
+    lru_unlink(cache, i);
+
+    int last = --cache->count;
+    if (i == last) return;
+
+    // Ссылки на последнюю запись (ячейка таблицы и соседи в списке) переводятся на индекс i
+    CacheIndexEntry* moved = &cache->entries[i];
+    *moved = cache->entries[last];
+    cache->slots[slot_find(cache, moved->key)] = i;
+    if (moved->prev >= 0) cache->entries[moved->prev].next = i;
+    else cache->lru_head = i;
+    if (moved->next >= 0) cache->entries[moved->next].prev = i;
+    else cache->lru_tail = i;
+}
+
+// @brief Удаляет давно не использовавшиеся записи (с начала списка LRU), пока размер кэша больше max_bytes.
+//        Запись keep (только что вставленная, может быть NULL) не удаляется. Вызывается внутри критической секции.
+static void cache_evict(ResultCache* cache, const CacheKey* keep)
+{
+    char path[4096];
+    while (cache->total_bytes > cache->max_bytes)
+    {
+        int oldest = cache->lru_head;
+        if (oldest >= 0 && keep && key_equal(cache->entries[oldest].key, *keep)) oldest = cache->entries[oldest].next;
+        if (oldest < 0) break;
+
+        cache_entry_path(cache, cache->entries[oldest].key, path, sizeof(path));
+        remove(path);
+        index_remove(cache, oldest);
+    }
+}
+
+// @brief Сравнение записей индекса по времени последнего обращения (для qsort).
+static int compare_used(const void* a, const void* b)
+{
+    time_t ua = ((const CacheIndexEntry*)a)->used;
+    time_t ub = ((const CacheIndexEntry*)b)->used;
+    return (ua > ub) - (ua < ub);
+}
+
+// @brief Упорядочивает список LRU по времени обращения записей (после построения индекса по файлам каталога).
+static void index_sort_by_use(ResultCache* cache)
+{
+    if (cache->count == 0) return;
+
+    qsort(cache->entries, (size_t)cache->count, sizeof(CacheIndexEntry), compare_used);
+    for (int i = 0; i < cache->count; i++)
+    {
+        cache->entries[i].prev = i - 1;
+        cache->entries[i].next = i + 1 < cache->count ? i + 1 : -1;
+    }
+    for (int s = 0; s <= cache->slot_mask; s++) cache->slots[s] = -1;
+    for (int i = 0; i < cache->count; i++) cache->slots[slot_find(cache, cache->entries[i].key)] = i;
+    cache->lru_head = 0;
+    cache->lru_tail = cache->count - 1;
+}
+
+// @brief Открывает (и при необходимости создает) каталог кэша и строит индекс по файлам в нем.
+//        Время обращения записи - время изменения файла (обновляется при каждом попадании),
+//        поэтому порядок вытеснения сохраняется между процессами.
+//
+// @param dir       [in] Каталог кэша.
+// @param max_bytes [in] Максимальный суммарный размер записей.
+//
+// @return Кэш или NULL, если каталог недоступен.
+ResultCache* ipl_cache_open(const char* dir, const size_t max_bytes)
+{
+    if (!dir || !*dir) return NULL;
+
+    cache_mkdir(dir); // Ошибка, если каталог уже есть, не важна: ниже он открывается
+    DIR* handle = opendir(dir);
+    if (!handle) return NULL;
+
+    ResultCache* cache = (ResultCache*)calloc(1, sizeof(ResultCache));
+    if (cache) cache->dir = (char*)malloc(strlen(dir) + 1);
+    if (!cache || !cache->dir)
+    {
+        free(cache);
+        closedir(handle);
+        return NULL;
+    }
+    strcpy(cache->dir, dir);
+    cache->max_bytes = max_bytes;
+    cache->lru_head = -1;
+    cache->lru_tail = -1;
+
+    time_t now = time(NULL);
+    char path[4096];
+    struct dirent* item;
+    while ((item = readdir(handle)) != NULL)
+    {
+        struct stat info;
+        snprintf(path, sizeof(path), "%s/%s", dir, item->d_name);
+
+        if (strncmp(item->d_name, "tmp-", 4) == 0)
+        {
+            if (stat(path, &info) == 0 && now - info.st_mtime > CACHE_STALE_TEMP_SECONDS) remove(path);
+            continue;
+        }
+
+        unsigned long long input, operation;
+        if (strlen(item->d_name) != CACHE_NAME_LENGTH || strcmp(item->d_name + 32, ".ipc") != 0 ||
+            sscanf(item->d_name, "%16llx%16llx", &input, &operation) != 2) continue;
+        if (stat(path, &info) != 0) continue;
+
+        CacheKey key = { (uint64_t)input, (uint64_t)operation };
+        index_put(cache, key, (size_t)info.st_size, info.st_mtime);
+    }
+    closedir(handle);
+
+    index_sort_by_use(cache);
+    cache_evict(cache, NULL);
+    return cache;
+}
+
+// @brief Открывает кэш, заданный переменными окружения: IPL_CACHE_DIR (каталог) и IPL_CACHE_SIZE_MB
+//        (размер, по умолчанию IPL_CACHE_DEFAULT_MB).
+//
+// @return Кэш или NULL, если IPL_CACHE_DIR не задана (кэш выключен) или каталог недоступен.
+ResultCache* ipl_cache_open_default(void)
+{
+    const char* dir = getenv("IPL_CACHE_DIR");
+    if (!dir || !*dir) return NULL;
+
+    const char* size = getenv("IPL_CACHE_SIZE_MB");
+    double megabytes = size ? atof(size) : 0.0;
+    if (megabytes <= 0.0) megabytes = IPL_CACHE_DEFAULT_MB;
+
+    return ipl_cache_open(dir, (size_t)(megabytes * 1024.0 * 1024.0));
+}
+
+// @brief Закрывает кэш (файлы записей остаются на диске).
+void ipl_cache_close(ResultCache* cache)
+{
+    if (!cache) return;
+    free(cache->entries);
+    free(cache->slots);
+    free(cache->dir);
+    free(cache);
+}
+
+// @brief Ищет результат в кэше. При попадании файл записи отображается в память только для чтения
+//        и отмечается как недавно использованный.
+//
+// @param cache [in]  Кэш.
+// @param key   [in]  Ключ результата.
+// @param hit   [out] Данные результата (освобождаются ipl_cache_release).
+//
+// @return INVALID_ARGUMENT Указатели равны NULL.
+// @return FILE_NOT_FOUND   Результата нет в кэше.
+// @return FILE_READ        Запись есть, но ее не удалось прочитать.
+// @return SUCCESS          Результат найден.
+ImageProcStatus ipl_cache_lookup(ResultCache* cache, const CacheKey key, CacheHit* hit)
+{
+    if (!cache || !hit) return INVALID_ARGUMENT;
+    hit->data = NULL;
+    hit->size = 0;
+
+    char path[4096];
+    cache_entry_path(cache, key, path, sizeof(path));
+
+#if defined(CACHE_MMAP)
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        if (fd >= 0) close(fd);
+        // Запись могла быть вытеснена другим процессом
+        #pragma omp critical(ipl_result_cache)
+        {
+            int i = index_find(cache, key);
+            if (i >= 0) index_remove(cache, i);
+        }
+        return FILE_NOT_FOUND;
+    }
+
+    void* mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // Отображение остается валидным и после закрытия файла
+    if (mapping == MAP_FAILED) return FILE_READ;
+
+    hit->data = (const unsigned char*)mapping;
+    hit->size = (size_t)info.st_size;
+#else
+    size_t size;
+    unsigned char* data = read_file(path, &size);
+    if (!data) return FILE_NOT_FOUND;
+
+    hit->data = data;
+    hit->size = size;
+#endif
+
+    // Время изменения файла - время последнего обращения для вытеснения (в том числе в других процессах)
+    utime(path, NULL);
+    #pragma omp critical(ipl_result_cache)
+    index_put(cache, key, hit->size, time(NULL));
+
+    return SUCCESS;
+}
+
+// @brief Освобождает результат, найденный ipl_cache_lookup.
+void ipl_cache_release(CacheHit* hit)
+{
+    if (!hit || !hit->data) return;
+#if defined(CACHE_MMAP)
+    munmap((void*)hit->data, hit->size);
+#else
+    free((void*)hit->data);
+#endif
+    hit->data = NULL;
+    hit->size = 0;
+}
+
+// @brief Атомарно добавляет результат в кэш: данные пишутся во временный файл, который затем
+//        переименовывается в файл записи, поэтому читатели (в том числе другие процессы) видят либо
+//        целую запись, либо ее отсутствие. Если кэш переполнен, вытесняются давно не использовавшиеся записи.
+//
+// @param cache [in] Кэш.
+// @param key   [in] Ключ результата.
+// @param data  [in] Закодированный результат.
+// @param size  [in] Размер результата в байтах.
+//
+// @return INVALID_ARGUMENT Указатели равны NULL или результат больше всего кэша.
+// @return FILE_WRITE       Не удалось записать файл.
+// @return SUCCESS          Результат добавлен.
+ImageProcStatus ipl_cache_insert(ResultCache* cache, const CacheKey key, const void* data, const size_t size)
+{
+    if (!cache || !data || size == 0 || size > cache->max_bytes) return INVALID_ARGUMENT;
+
+    unsigned int counter;
+    #pragma omp atomic capture
+    counter = cache->temp_counter++;
+
+    char temp[4096], path[4096];
+    snprintf(temp, sizeof(temp), "%s/tmp-%u-%u", cache->dir, cache_pid(), counter);
+    cache_entry_path(cache, key, path, sizeof(path));
+
+    FILE* file = fopen(temp, "wb");
+    if (!file) return FILE_WRITE;
+    int written = fwrite(data, 1, size, file) == size;
+    written = (fclose(file) == 0) && written;
+    if (!written)
+    {
+        remove(temp);
+        return FILE_WRITE;
+    }
+
+    if (rename(temp, path) != 0)
+    {
+        // В Windows rename не заменяет существующий файл: запись с тем же ключом уже вставлена другим процессом
+        remove(temp);
+        struct stat info;
+        if (stat(path, &info) != 0) return FILE_WRITE;
+    }
+
+    #pragma omp critical(ipl_result_cache)
+    {
+        index_put(cache, key, size, time(NULL));
+        cache_evict(cache, &key);
+    }
+
+    return SUCCESS;
+}
+
+// @brief Добавляет в кэш содержимое файла (например, только что сохраненного результата).
+ImageProcStatus ipl_cache_insert_file(ResultCache* cache, const CacheKey key, const char* path)
+{
+    if (!cache || !path) return INVALID_ARGUMENT;
+
+    size_t size;
+    unsigned char* data = read_file(path, &size);
+    if (!data) return FILE_READ;
+
+    ImageProcStatus status = ipl_cache_insert(cache, key, data, size);
+    free(data);
+
+    return status;
+}
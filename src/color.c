@@ -0,0 +1,246 @@
+#include "color.h"
+#include "context.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <omp.h>
+
+#define HSL_HUE_UNITS (6 * 4096) // Единиц тона на полный круг в ядре hsl_adjust (см. HslAdjustRowFn)
+
+static LabTables lab_tables;
+static int lab_tables_ready = 0;
+
+static double lab_srgb_to_linear(const double v)
+{
+    return v <= 0.04045 ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4);
+}
+
+static double lab_linear_to_srgb(const double v)
+{
+    return v <= 0.0031308 ? v * 12.92 : 1.055 * pow(v, 1.0 / 2.4) - 0.055;
+}
+
+// @brief Заполняет таблицы CIELab (вызывается под критической секцией).
+static void lab_build_tables(LabTables* t)
+{
+    // Матрица sRGB -> XYZ (IEC 61966-2-1), белая точка - суммы ее строк (D65): белый переходит в a = b = 0
+    static const double m[3][3] = {
+        { 0.4124564, 0.3575761, 0.1804375 },
+        { 0.2126729, 0.7151522, 0.0721750 },
+        { 0.0193339, 0.1191920, 0.9503041 }
+    };
+    static const double m_inv[3][3] = {
+        { 3.2404542, -1.5371385, -0.4985314 },
+        { -0.9692660, 1.8760108, 0.0415560 },
+        { 0.0556434, -0.2040259, 1.0572252 }
+    };
+
+    for (int i = 0; i < 3; i++)
+    {
+        double white = m[i][0] + m[i][1] + m[i][2];
+        for (int k = 0; k < 3; k++)
+        {
+            t->to_xyz[i][k] = (float)(m[i][k] / white);
+            t->to_rgb[i][k] = (float)(m_inv[i][k] * (m[k][0] + m[k][1] + m[k][2]));
+        }
+    }
+
+    for (int v = 0; v < 256; v++)
+    {
+        t->to_linear[v] = (float)lab_srgb_to_linear(v / 255.0);
+        t->f_light[v] = (float)((v * 100.0 / 255.0 + 16.0) / 116.0);
+        t->f_a[v] = (float)((v - 128) / 500.0);
+        t->f_b[v] = (float)((v - 128) / 200.0);
+    }
+
+    const double knee = 6.0 / 29.0;
+    for (int i = 0; i < LAB_CBRT_SIZE + 2; i++)
+    {
+        double x = (double)i / LAB_CBRT_SIZE;
+        t->cbrt[i] = (float)(x > knee * knee * knee ? cbrt(x) : x / (3.0 * knee * knee) + 4.0 / 29.0);
+    }
+    for (int i = 0; i <= LAB_ENCODE_SIZE; i++)
+        t->to_srgb[i] = (unsigned char)lround(lab_linear_to_srgb((double)i / LAB_ENCODE_SIZE) * 255.0);
+    memset(t->to_srgb + LAB_ENCODE_SIZE + 1, 0, 3);
+}
+
+// @brief Возвращает таблицы CIELab, при первом обращении строит их (как ipl_get_context).
+static const LabTables* lab_get_tables(void)
+{
+    int ready;
+    #pragma omp atomic read
+    ready = lab_tables_ready;
+    if (ready) return &lab_tables;
+
+    #pragma omp critical(ipl_lab_tables)
+    {
+        if (!lab_tables_ready)
+        {
+            lab_build_tables(&lab_tables);
+            #pragma omp atomic write
+            lab_tables_ready = 1;
+        }
+    }
+    return &lab_tables;
+}
+
+// @brief Применяет преобразование отрезка к каждой строке изображения на месте; строки обрабатываются параллельно.
+static ImageProcStatus color_convert(Image* image, ColorRowFn convert)
+{
+    if (!image || !image->data) return INVALID_ARGUMENT;
+    if (image->channels != 3 && image->channels != 4) return INVALID_ARGUMENT;
+
+    size_t width = image->width;
+    size_t row_size = width * image->channels;
+    int parallel = width * image->height >= ipl_get_context()->profile.parallel_min_pixels;
+
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t y = 0; y < (ptrdiff_t)image->height; y++)
+    {
+        unsigned char* row = image->data + (size_t)y * row_size;
+        convert(row, row, width, image->channels);
+    }
+    return SUCCESS;
+}
+
+// @brief То же для преобразований CIELab, которым нужны таблицы.
+static ImageProcStatus lab_convert(Image* image, LabRowFn convert)
+{
+    if (!image || !image->data) return INVALID_ARGUMENT;
+    if (image->channels != 3 && image->channels != 4) return INVALID_ARGUMENT;
+
+    const LabTables* tables = lab_get_tables();
+    size_t width = image->width;
+    size_t row_size = width * image->channels;
+    int parallel = width * image->height >= ipl_get_context()->profile.parallel_min_pixels;
+
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t y = 0; y < (ptrdiff_t)image->height; y++)
+    {
+        unsigned char* row = image->data + (size_t)y * row_size;
+        convert(tables, row, row, width, image->channels);
+    }
+    return SUCCESS;
+}
+
+// @brief Преобразует изображение RGB(A) в 8-битный HSV на месте: H - весь байт на круг (0..255 - 0..360 градусов),
+//        S и V - 0..255, альфа-канал не меняется. Арифметика целочисленная (деление на размах - одна операция
+//        float), ядро AVX2 обрабатывает 16 пикселей за итерацию и совпадает со скалярной версией побитово.
+//
+// @param image [in, out] Изображение из 3 или 4 каналов.
+//
+// @return INVALID_ARGUMENT Невалидный аргумент.
+//                          Если `image` или `image->data` равен NULL или в изображении не 3 и не 4 канала.
+// @return SUCCESS          Изображение преобразовано.
+ImageProcStatus ipl_rgb_to_hsv(Image* image)
+{
+    if (!image) return INVALID_ARGUMENT;
+    return color_convert(image, ipl_get_context()->kernels.rgb_to_hsv);
+}
+
+// @brief Обратное к ipl_rgb_to_hsv преобразование 8-битного HSV в RGB на месте.
+//
+// @param image [in, out] Изображение из 3 или 4 каналов в HSV.
+//
+// @return INVALID_ARGUMENT Невалидный аргумент (как у ipl_rgb_to_hsv).
+// @return SUCCESS          Изображение преобразовано.
+ImageProcStatus ipl_hsv_to_rgb(Image* image)
+{
+    if (!image) return INVALID_ARGUMENT;
+    return color_convert(image, ipl_get_context()->kernels.hsv_to_rgb);
+}
+
+// @brief Преобразует изображение RGB(A) в 8-битный HSL на месте (H как в ipl_rgb_to_hsv, S и L - 0..255).
+//
+// @param image [in, out] Изображение из 3 или 4 каналов.
+//
+// @return INVALID_ARGUMENT Невалидный аргумент (как у ipl_rgb_to_hsv).
+// @return SUCCESS          Изображение преобразовано.
+ImageProcStatus ipl_rgb_to_hsl(Image* image)
+{
+    if (!image) return INVALID_ARGUMENT;
+    return color_convert(image, ipl_get_context()->kernels.rgb_to_hsl);
+}
+
+// @brief Обратное к ipl_rgb_to_hsl преобразование 8-битного HSL в RGB на месте.
+//
+// @param image [in, out] Изображение из 3 или 4 каналов в HSL.
+//
+// @return INVALID_ARGUMENT Невалидный аргумент (как у ipl_rgb_to_hsv).
+// @return SUCCESS          Изображение преобразовано.
+ImageProcStatus ipl_hsl_to_rgb(Image* image)
+{
+    if (!image) return INVALID_ARGUMENT;
+    return color_convert(image, ipl_get_context()->kernels.hsl_to_rgb);
+}
+
+// @brief Преобразует изображение sRGB(A) в 8-битный CIELab (белая точка D65) на месте: L * 255 / 100,
+//        a + 128, b + 128 (с насыщением), альфа-канал не меняется. Гамма sRGB и кубический корень берутся
+//        из таблиц (кубический корень - с интерполяцией), в ядре AVX2 - чтением gather по 8 пикселей;
+//        отличие от вычисления в double - не больше 1 уровня.
+//
+// @param image [in, out] Изображение из 3 или 4 каналов.
+//
+// @return INVALID_ARGUMENT Невалидный аргумент (как у ipl_rgb_to_hsv).
+// @return SUCCESS          Изображение преобразовано.
+ImageProcStatus ipl_rgb_to_lab(Image* image)
+{
+    if (!image) return INVALID_ARGUMENT;
+    return lab_convert(image, ipl_get_context()->kernels.rgb_to_lab);
+}
+
+// @brief Обратное к ipl_rgb_to_lab преобразование 8-битного CIELab в sRGB на месте: f(t) каждого байта
+//        и гамма sRGB берутся из таблиц. Цвета вне охвата sRGB ограничиваются по каждому каналу.
+//
+// @param image [in, out] Изображение из 3 или 4 каналов в Lab.
+//
+// @return INVALID_ARGUMENT Невалидный аргумент (как у ipl_rgb_to_hsv).
+// @return SUCCESS          Изображение преобразовано.
+ImageProcStatus ipl_lab_to_rgb(Image* image)
+{
+    if (!image) return INVALID_ARGUMENT;
+    return lab_convert(image, ipl_get_context()->kernels.lab_to_rgb);
+}
+
+// @brief Коррекция тона, насыщенности и светлоты (как в HSL) за один проход: пиксель переводится в HSL,
+//        корректируется и возвращается в RGB в регистрах, без промежуточного кадра. Тон и размах хранятся
+//        с запасом точности, поэтому при (0, 1, 0) изображение не меняется. Светлота смешивает цвет с белым
+//        (lightness > 0) или черным (lightness < 0).
+//
+// @param image      [in, out] Изображение из 3 или 4 каналов.
+// @param hue_shift  [in]      Сдвиг тона в градусах (любого знака).
+// @param saturation [in]      Множитель насыщенности 0..255 (1 - без изменений, 0 - оттенки серого).
+// @param lightness  [in]      Доля смешивания с белым или черным, -1..1 (0 - без изменений).
+//
+// @return INVALID_ARGUMENT Невалидный аргумент.
+//                          Если `image` или `image->data` равен NULL, в изображении не 3 и не 4 канала
+//                          или параметры вне допустимых диапазонов.
+// @return SUCCESS          Изображение скорректировано.
+ImageProcStatus ipl_adjust_hsl(Image* image, const float hue_shift, const float saturation, const float lightness)
+{
+    if (!image || !image->data) return INVALID_ARGUMENT;
+    if (image->channels != 3 && image->channels != 4) return INVALID_ARGUMENT;
+    if (!isfinite(hue_shift) || !(saturation >= 0.0f && saturation <= 255.0f) || !(lightness >= -1.0f && lightness <= 1.0f))
+        return INVALID_ARGUMENT;
+
+    int shift = (int)lroundf(fmodf(hue_shift, 360.0f) / 360.0f * HSL_HUE_UNITS);
+    if (shift < 0) shift += HSL_HUE_UNITS;
+    if (shift >= HSL_HUE_UNITS) shift -= HSL_HUE_UNITS;
+    int gain = (int)lroundf(saturation * 256.0f);
+    if (gain > 65535) gain = 65535;
+    int light = (int)lroundf(lightness * 256.0f);
+
+    HslAdjustRowFn adjust = ipl_get_context()->kernels.hsl_adjust;
+    size_t width = image->width;
+    size_t row_size = width * image->channels;
+    int parallel = width * image->height >= ipl_get_context()->profile.parallel_min_pixels;
+
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t y = 0; y < (ptrdiff_t)image->height; y++)
+    {
+        unsigned char* row = image->data + (size_t)y * row_size;
+        adjust(row, row, width, image->channels, shift, gain, light);
+    }
+    return SUCCESS;
+}
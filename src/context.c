@@ -0,0 +1,171 @@
+#include "context.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+static LibraryContext context; // Единственный экземпляр контекста библиотеки
+
+// @brief Заполняет профиль встроенными значениями по умолчанию (используются, если профиль не найден).
+void ipl_default_profile(TuningProfile* profile)
+{
+    profile->tile_width = 256;
+    profile->tile_height = 128;
+    profile->num_threads = 0;
+    profile->parallel_min_pixels = 128 * 128;
+    profile->gaussian_iir_sigma = INFINITY; // без профиля гауссов фильтр всегда считается точной прямой сверткой
+    profile->median_sort_max_radius = 1;
+    profile->half_intermediates = 0;
+    profile->huge_pages = 1;
+    profile->prefault_buffers = 0;
+}
+
+// @brief Загружает профиль из текстового файла формата "ключ = значение" (строки с # игнорируются).
+//        Отсутствующие ключи сохраняют значения по умолчанию, некорректные значения отбрасываются.
+//
+// @param file_name [in]  Путь к файлу профиля.
+// @param profile   [out] Заполняемый профиль.
+//
+// @return INVALID_ARGUMENT Указатели равны NULL.
+// @return FILE_NOT_FOUND   Файл не найден (profile заполняется значениями по умолчанию).
+// @return SUCCESS          Профиль загружен.
+ImageProcStatus ipl_load_profile(const char* file_name, TuningProfile* profile)
+{
+    if (!file_name || !profile) return INVALID_ARGUMENT;
+
+    ipl_default_profile(profile);
+
+    FILE* file = fopen(file_name, "r");
+    if (!file) return FILE_NOT_FOUND;
+
+    char line[256];
+    while (fgets(line, sizeof(line), file))
+    {
+        char key[64];
+        double value;
+        if (line[0] == '#' || sscanf(line, " %63[a-z_] = %lf", key, &value) != 2) continue;
+
+        if (strcmp(key, "tile_width") == 0 && value >= 16)                 profile->tile_width = (int)value;
+        else if (strcmp(key, "tile_height") == 0 && value >= 8)            profile->tile_height = (int)value;
+        else if (strcmp(key, "num_threads") == 0 && value >= 0)            profile->num_threads = (int)value;
+        else if (strcmp(key, "parallel_min_pixels") == 0 && value >= 0)    profile->parallel_min_pixels = (size_t)value;
+        else if (strcmp(key, "gaussian_iir_sigma") == 0 && value >= 0.5)   profile->gaussian_iir_sigma = (float)value;
+        else if (strcmp(key, "median_sort_max_radius") == 0 && value >= 0) profile->median_sort_max_radius = (int)value;
+        else if (strcmp(key, "half_intermediates") == 0 && value >= 0)     profile->half_intermediates = value != 0;
+        else if (strcmp(key, "huge_pages") == 0 && value >= 0)             profile->huge_pages = value != 0;
+        else if (strcmp(key, "prefault_buffers") == 0 && value >= 0)       profile->prefault_buffers = value != 0;
+    }
+
+    fclose(file);
+    return SUCCESS;
+}
+
+// @brief Сохраняет профиль в текстовый файл (формат см. ipl_load_profile).
+//
+// @return INVALID_ARGUMENT Указатели равны NULL.
+// @return FILE_WRITE       Не удалось открыть или записать файл.
+// @return SUCCESS          Профиль сохранен.
+ImageProcStatus ipl_save_profile(const char* file_name, const TuningProfile* profile)
+{
+    if (!file_name || !profile) return INVALID_ARGUMENT;
+
+    FILE* file = fopen(file_name, "w");
+    if (!file) return FILE_WRITE;
+
+    fprintf(file, "# ImageProcLib tuning profile (imgproc autotune)\n");
+    fprintf(file, "tile_width = %d\n", profile->tile_width);
+    fprintf(file, "tile_height = %d\n", profile->tile_height);
+    fprintf(file, "num_threads = %d\n", profile->num_threads);
+    fprintf(file, "parallel_min_pixels = %llu\n", (unsigned long long)profile->parallel_min_pixels);
+    fprintf(file, "gaussian_iir_sigma = %g\n", profile->gaussian_iir_sigma);
+    fprintf(file, "median_sort_max_radius = %d\n", profile->median_sort_max_radius);
+    fprintf(file, "half_intermediates = %d\n", profile->half_intermediates);
+    fprintf(file, "huge_pages = %d\n", profile->huge_pages);
+    fprintf(file, "prefault_buffers = %d\n", profile->prefault_buffers);
+
+    int failed = ferror(file);
+    if (fclose(file) != 0) failed = 1;
+
+    return failed ? FILE_WRITE : SUCCESS;
+}
+
+// @brief Создает контекст библиотеки: загружает профиль машины и применяет его,
+//        определяет возможности процессора и заполняет таблицу реализаций ядер.
+//        Вызывается автоматически при первом обращении к ipl_get_context, но может быть вызвана явно
+//        (например, в начале main), чтобы указать путь к профилю.
+//
+// @param profile_path [in] Путь к профилю. Если NULL, используется переменная окружения IPL_PROFILE,
+//                          а если она не задана - DEFAULT_PROFILE_PATH в текущей папке.
+//                          Переменная окружения IPL_SIMD (scalar, sse4.1, avx2, avx512) понижает
+//                          уровень SIMD (для тестов и сравнения производительности).
+//
+// @return FILE_NOT_FOUND Явно указанный профиль не найден (используются значения по умолчанию).
+// @return SUCCESS        Контекст создан (с профилем или со значениями по умолчанию).
+ImageProcStatus ipl_context_init(const char* profile_path)
+{
+    ImageProcStatus status = SUCCESS;
+
+    #pragma omp critical(ipl_context)
+    if (profile_path || !context.initialized) // ленивые вызовы из разных потоков создают контекст один раз
+    {
+        const char* path = profile_path;
+        if (!path) path = getenv("IPL_PROFILE");
+        if (!path) path = DEFAULT_PROFILE_PATH;
+
+        status = ipl_load_profile(path, &context.profile);
+        // Отсутствие профиля по умолчанию не является ошибкой
+        if (status == FILE_NOT_FOUND && !profile_path) status = SUCCESS;
+
+        // omp_set_num_threads меняет ICV вызывающего потока: внутри параллельной области профиль
+        // действует только на вложенные области, поэтому контекст лучше создавать вне их
+        if (!context.initialized) context.default_threads = omp_get_max_threads();
+        omp_set_num_threads(context.profile.num_threads > 0 ? context.profile.num_threads : context.default_threads);
+
+        SimdLevel detected = ipl_detect_simd_level();
+        context.simd_level = ipl_parse_simd_level(getenv("IPL_SIMD"), detected);
+        if (context.simd_level > detected) context.simd_level = detected;
+        ipl_fill_kernel_table(context.simd_level, &context.kernels);
+
+        #pragma omp atomic write
+        context.initialized = 1;
+    }
+
+    return status;
+}
+
+// @brief Возвращает контекст библиотеки, создавая его при первом обращении.
+const LibraryContext* ipl_get_context(void)
+{
+    int initialized;
+    #pragma omp atomic read
+    initialized = context.initialized;
+
+    if (!initialized) ipl_context_init(NULL);
+
+    return &context;
+}
+
+// @brief Заменяет профиль текущего контекста (используется автотюнером для замеров).
+//        Не должна вызываться одновременно с работающими фильтрами.
+void ipl_set_profile(const TuningProfile* profile)
+{
+    ipl_get_context();
+    context.profile = *profile;
+    omp_set_num_threads(profile->num_threads > 0 ? profile->num_threads : context.default_threads);
+}
+
+// @brief Выбирает уровень SIMD для всех последующих вызовов (например, чтобы сравнить реализации).
+//        Уровень выше поддерживаемого процессором понижается до поддерживаемого.
+//        Не должна вызываться одновременно с работающими фильтрами.
+//
+// @return Установленный уровень.
+SimdLevel ipl_set_simd_level(const SimdLevel level)
+{
+    ipl_get_context();
+
+    SimdLevel detected = ipl_detect_simd_level();
+    context.simd_level = level < detected ? level : detected;
+    ipl_fill_kernel_table(context.simd_level, &context.kernels);
+
+    return context.simd_level;
+}
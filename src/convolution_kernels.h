@@ -0,0 +1,157 @@
+// Шаблон ядер гауссовой фильтрации, преобразования в оттенки серого и оператора Собеля,
+// специализированных по количеству каналов на этапе компиляции.
+// Файл включается в imageproc_B.c несколько раз с разными значениями CHANNELS (1, 3, 4),
+// поэтому у него нет защиты от повторного включения.
+// Количество каналов - константа, поэтому компилятор может развернуть циклы по каналам
+// и заменить умножения индексов на сдвиги, а индексы соседей считаются от указателя на строку.
+
+#ifndef CHANNELS
+#error "CHANNELS must be defined before including convolution_kernels.h"
+#endif
+
+#ifndef SPECIALIZED
+// Имя специализации функции: SPECIALIZED(name, 3) -> name_c3
+#define SPECIALIZED_(name, channels) name##_c##channels
+#define SPECIALIZED(name, channels) SPECIALIZED_(name, channels)
+#endif
+
+// @brief Горизонтальная свертка (см. horizontal_convolution) для CHANNELS каналов.
+//        Внутренние пиксели строки обрабатываются без проверки границ,
+//        крайние radius пикселей - с отражением координат (clamp to edge).
+//        Порядок суммирования совпадает с исходной реализацией, поэтому результат побитово тот же.
+static void SPECIALIZED(horizontal_convolution, CHANNELS)(const unsigned char* input_data, unsigned char* output_data,
+                                                          const size_t width, const size_t height, const Kernel* kernel, const int parallel)
+{
+    const int radius = kernel->radius;
+    const int taps = 2 * radius + 1;
+    const float* weights = kernel->values;
+
+    // Пиксели [inner_begin, inner_end) имеют всех соседей внутри строки
+    size_t inner_begin = (size_t)radius < width ? (size_t)radius : width;
+    size_t inner_end = width > (size_t)radius ? width - (size_t)radius : 0;
+    if (inner_end < inner_begin) inner_end = inner_begin;
+    ConvolveSegmentFn convolve = select_convolve_segment(radius);
+
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t i = 0; i < (ptrdiff_t)height; i++)
+    {
+        const unsigned char* in_row = input_data + (size_t)i * width * CHANNELS;
+        unsigned char* out_row = output_data + (size_t)i * width * CHANNELS;
+
+        for (size_t j = 0; j < width; j++)
+        {
+            if (j == inner_begin)
+            {
+                // Внутренняя часть строки: соседи на постоянных смещениях относительно указателя на строку
+                if (inner_end > inner_begin)
+                {
+                    const unsigned char* neighbors[taps];
+                    for (int k = 0; k < taps; k++)
+                        neighbors[k] = in_row + (inner_begin - (size_t)radius + k) * CHANNELS;
+                    convolve(neighbors, out_row + inner_begin * CHANNELS, (inner_end - inner_begin) * CHANNELS, weights, radius);
+                }
+                j = inner_end;
+                if (j >= width) break;
+            }
+
+            // Крайние пиксели: отражение координат соседей
+            for (int c = 0; c < CHANNELS; c++)
+            {
+                float weighted_sum = 0.0f;
+                for (int offset = -radius; offset <= radius; offset++)
+                {
+                    ptrdiff_t col = (ptrdiff_t)j + offset;
+                    if (col < 0) col = 0;
+                    else if (col >= (ptrdiff_t)width) col = (ptrdiff_t)width - 1;
+                    weighted_sum += (float)in_row[(size_t)col * CHANNELS + c] * weights[offset + radius];
+                }
+                out_row[j * CHANNELS + c] = to_uchar(weighted_sum);
+            }
+        }
+    }
+}
+
+#if CHANNELS > 1
+// @brief Преобразование строки из CHANNELS каналов в оттенки серого (см. convert_to_one_channel).
+static void SPECIALIZED(gray_row, CHANNELS)(const unsigned char* input_data, unsigned char* output_data, const size_t num_pixels)
+{
+    for (size_t i = 0; i < num_pixels; ++i)
+    {
+        const unsigned char* px = input_data + i * CHANNELS;
+        // Alpha канал (CHANNELS == 4) игнорируется
+        float gray = 0.299f * (float)px[0] + 0.587f * (float)px[1] + 0.114f * (float)px[2];
+        output_data[i] = to_uchar(gray);
+    }
+}
+#endif
+
+// @brief Магнитуда градиента Собеля (см. compute_sobel_magnitude) для строк [row_begin, row_end)
+//        изображения из CHANNELS каналов. Для многоканального входа яркость считается на лету
+//        в циклическом буфере из 3 строк, поэтому промежуточное полутоновое изображение не нужно.
+//        Все производные целочисленные, поэтому результат побитово совпадает с исходной реализацией.
+//
+// @param row_begin [in] Первая вычисляемая строка (>= 1).
+// @param row_end   [in] Строка после последней вычисляемой (<= height - 1).
+// @param scratch   [in] Рабочий буфер потока размером SOBEL_SCRATCH_SIZE(width) байтов.
+static void SPECIALIZED(sobel_rows, CHANNELS)(const unsigned char* input_data, unsigned char* output_gradient_map,
+                                              const size_t width, const size_t height, const size_t row_begin, const size_t row_end,
+                                              void* scratch)
+{
+    short* dx_buf[3];             // dI/dx для 3-х строк подряд (циклический буфер)
+    short* dy_buf = (short*)scratch + 3 * width; // dI/dy для центральной строки
+    const unsigned char* gray_rows[3];
+#if CHANNELS > 1
+    unsigned char* gray_buf[3];
+#endif
+    for (int k = 0; k < 3; k++)
+    {
+        dx_buf[k] = (short*)scratch + (size_t)k * width;
+#if CHANNELS > 1
+        gray_buf[k] = (unsigned char*)(dy_buf + width) + (size_t)k * width;
+#endif
+    }
+    (void)height;
+
+    for (size_t r = row_begin - 1; r <= row_end; r++)
+    {
+        size_t slot = r % 3;
+
+        // Строка яркости r
+#if CHANNELS > 1
+        SPECIALIZED(gray_row, CHANNELS)(input_data + r * width * CHANNELS, gray_buf[slot], width);
+        gray_rows[slot] = gray_buf[slot];
+#else
+        gray_rows[slot] = input_data + r * width;
+#endif
+        const unsigned char* g = gray_rows[slot];
+
+        // Горизонтальная производная строки r с отражением на краях
+        for (size_t j = 0; j < width; j++)
+        {
+            size_t left = j > 0 ? j - 1 : 0;
+            size_t right = j + 1 < width ? j + 1 : width - 1;
+            dx_buf[slot][j] = (short)(g[right] - g[left]);
+        }
+
+        // Для строки y = r - 1 нужны строки y - 1, y, y + 1
+        if (r < row_begin + 1) continue;
+        size_t y = r - 1;
+        const short* dx_prev = dx_buf[(r - 2) % 3];
+        const short* dx_curr = dx_buf[(r - 1) % 3];
+        const short* dx_next = dx_buf[slot];
+        const unsigned char* g_prev = gray_rows[(r - 2) % 3];
+
+        for (size_t j = 0; j < width; j++)
+            dy_buf[j] = (short)(g[j] - g_prev[j]);
+
+        unsigned char* out_row = output_gradient_map + y * width;
+        for (size_t j = 0; j < width; j++)
+        {
+            size_t left = j > 0 ? j - 1 : 0;
+            size_t right = j + 1 < width ? j + 1 : width - 1;
+            int gx = dx_prev[j] + 2 * dx_curr[j] + dx_next[j];
+            int gy = dy_buf[left] + 2 * dy_buf[j] + dy_buf[right];
+            out_row[j] = to_uchar(sqrtf((float)(gx * gx + gy * gy)));
+        }
+    }
+}
@@ -0,0 +1,264 @@
+#include "descriptors.h"
+#include "context.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <omp.h>
+
+#define HOG_PI 3.14159265358979f
+#define HOG_EPSILON 1e-5f // Слагаемое нормы блока: пустой блок остается нулевым
+#define HOG_CLIP 0.2f     // Порог L2-Hys
+
+// @brief Рабочие буферы одного потока для строки ячеек высотой cell_size пикселей.
+typedef struct
+{
+    unsigned char* gray;        // (cell_size + 2) x width: строки яркости с соседями сверху и снизу
+    short* dx;                  // (cell_size + 2) x width: горизонтальные производные тех же строк
+    short* dy;                  // width + 2: вертикальная производная текущей строки с повторенными краями
+    float* magnitude;           // width: квадрат магнитуды градиента
+    float* fraction;            // width: доля веса второго из двух ближайших интервалов ориентации
+    int* bin;                   // width: первый из двух ближайших интервалов ориентации
+    const unsigned char** rows; // cell_size + 2: указатели на строки яркости (в изображение или в gray)
+} HogBuffers;
+
+// @brief Ориентация градиента без знака в [0, pi]. Приближение арктангенса на [0, 1]
+//        x * (pi/4 + 0.273 * (1 - x)) дает ошибку меньше 0.004 рад - это сотые доли интервала
+//        гистограммы, зато цикл по строке векторизуется. Ветви заменены умножением на 0/1 и +-1:
+//        условные операции с плавающей точкой компилятор не переводит в маски.
+static inline float hog_orientation(int gx, int gy)
+{
+    // Ориентации theta и theta + pi совпадают: вектор переносится в верхнюю полуплоскость
+    gx = gy < 0 ? -gx : gx;
+    gy = gy < 0 ? -gy : gy;
+    int ax = gx < 0 ? -gx : gx;
+    float lo = (float)(ax < gy ? ax : gy);
+    float hi = (float)(ax < gy ? gy : ax);
+    float t = lo / (hi + 1e-20f); // Нулевой градиент дает 0
+    float angle = t * (0.25f * HOG_PI + 0.273f * (1.0f - t));
+
+    int steep = gy > ax; // Угол больше pi/4: arctan(x) = pi/2 - arctan(1/x)
+    int back = gx < 0;   // Вторая четверть
+    angle = (float)steep * (0.5f * HOG_PI) + (float)(1 - 2 * steep) * angle;
+    return (float)back * HOG_PI + (float)(1 - 2 * back) * angle;
+}
+
+// @brief Гистограммы ориентаций строки ячеек cy: cells_x * bins значений в histograms.
+//        Производные те же, что в compute_sobel_magnitude (dI/dx = [-1, 0, 1], сглаженная по вертикали [1, 2, 1],
+//        dI/dy - наоборот), но крайние строки изображения повторяются, чтобы градиент был у каждого пикселя.
+//        Градиент не записывается в отдельное изображение: строка производных сразу раскладывается по ячейкам
+//        с билинейной интерполяцией между двумя ближайшими интервалами ориентации.
+static void hog_cell_row(const Image* image, const size_t cy, const int cell_size, const size_t cells_x, const int bins,
+                         float* histograms, HogBuffers* buf)
+{
+    size_t width = image->width;
+    size_t height = image->height;
+    int chan = image->channels;
+    size_t cs = (size_t)cell_size;
+    size_t y0 = cy * cs;
+    const unsigned char** rows = buf->rows;
+
+    // Строки яркости y0 - 1 .. y0 + cell_size и их горизонтальные производные с отражением на краях
+    for (size_t r = 0; r < cs + 2; r++)
+    {
+        ptrdiff_t y = (ptrdiff_t)(y0 + r) - 1;
+        if (y < 0) y = 0;
+        else if (y >= (ptrdiff_t)height) y = (ptrdiff_t)height - 1;
+
+        const unsigned char* src = image->data + (size_t)y * width * chan;
+        if (chan == 1)
+        {
+            rows[r] = src;
+        }
+        else
+        {
+            convert_to_one_channel(src, buf->gray + r * width, width, 1, chan);
+            rows[r] = buf->gray + r * width;
+        }
+
+        const unsigned char* g = rows[r];
+        short* dx = buf->dx + r * width;
+        dx[0] = (short)(g[width > 1 ? 1 : 0] - g[0]);
+        #pragma omp simd
+        for (size_t j = 1; j < width - 1; j++) dx[j] = (short)(g[j + 1] - g[j - 1]);
+        if (width > 1) dx[width - 1] = (short)(g[width - 1] - g[width - 2]);
+    }
+
+    memset(histograms, 0, cells_x * bins * sizeof(float));
+    size_t used = cells_x * cs; // Пиксели правее последней целой ячейки не учитываются
+    float scale = (float)bins / HOG_PI;
+
+    for (size_t r = 1; r <= cs; r++)
+    {
+        const short* dx_prev = buf->dx + (r - 1) * width;
+        const short* dx_curr = buf->dx + r * width;
+        const short* dx_next = buf->dx + (r + 1) * width;
+        const unsigned char* g_prev = rows[r - 1];
+        const unsigned char* g_next = rows[r + 1];
+        // dy сдвинута на один столбец: крайние столбцы повторяются слева и справа
+        short* dy = buf->dy;
+        #pragma omp simd
+        for (size_t j = 0; j < width; j++) dy[j + 1] = (short)(g_next[j] - g_prev[j]);
+        dy[0] = dy[1];
+        dy[width + 1] = dy[width];
+
+        float* magnitude = buf->magnitude;
+        float* fraction = buf->fraction;
+        int* bin = buf->bin;
+
+        #pragma omp simd
+        for (size_t j = 0; j < used; j++)
+        {
+            int gx = dx_prev[j] + 2 * dx_curr[j] + dx_next[j];
+            int gy = dy[j] + 2 * dy[j + 1] + dy[j + 2];
+            magnitude[j] = (float)(gx * gx + gy * gy); // Корень - при раскладке: sqrtf с errno мешает векторизации
+            // Центры интервалов в (b + 0.5) * pi / bins; сдвиг на bins оставляет положение неотрицательным,
+            // а раз оно в [bins - 0.5, 2 * bins - 0.5], остаток от деления - одно условное вычитание
+            float pos = hog_orientation(gx, gy) * scale - 0.5f + (float)bins;
+            int b = (int)pos;
+            fraction[j] = pos - (float)b;
+            bin[j] = b >= bins ? b - bins : b;
+        }
+
+        for (size_t cx = 0; cx < cells_x; cx++)
+        {
+            float* hist = histograms + cx * bins;
+            for (size_t j = cx * cs; j < (cx + 1) * cs; j++)
+            {
+                int b0 = bin[j];
+                int b1 = b0 + 1 < bins ? b0 + 1 : 0;
+                float frac = fraction[j];
+                float m = sqrtf(magnitude[j]);
+                hist[b0] += m * (1.0f - frac);
+                hist[b1] += m * frac;
+            }
+        }
+    }
+}
+
+// @brief Размер вектора признаков ipl_hog (количество float).
+//
+// @param width      [in] Ширина изображения в пикселях.
+// @param height     [in] Высота изображения в пикселях.
+// @param cell_size  [in] Сторона ячейки в пикселях.
+// @param block_size [in] Сторона блока нормализации в ячейках.
+// @param bins       [in] Количество интервалов ориентации.
+// @return Количество значений или 0, если параметры недопустимы или в изображение не помещается ни один блок.
+size_t ipl_hog_size(const size_t width, const size_t height, const int cell_size, const int block_size, const int bins)
+{
+    if (cell_size < 1 || block_size < 1 || bins < 2 || bins > IPL_HOG_MAX_BINS) return 0;
+
+    size_t cells_x = width / (size_t)cell_size;
+    size_t cells_y = height / (size_t)cell_size;
+    if (cells_x < (size_t)block_size || cells_y < (size_t)block_size) return 0;
+
+    size_t blocks = (cells_x - block_size + 1) * (cells_y - block_size + 1);
+    return blocks * block_size * block_size * bins;
+}
+
+// @brief Вычисляет дескриптор HOG (гистограммы направленных градиентов, Dalal-Triggs).
+//        Изображение делится на ячейки cell_size x cell_size (неполные ячейки справа и снизу отбрасываются),
+//        для каждой ячейки строится гистограмма ориентаций градиента без знака (0..180 градусов) с весом
+//        магнитуды и билинейной интерполяцией между соседними интервалами. Градиент считается по яркости
+//        той же схемой, что в compute_sobel_magnitude, и сразу раскладывается по ячейкам, строки ячеек
+//        обрабатываются параллельно. Затем блоки block_size x block_size ячеек с шагом в одну ячейку
+//        нормализуются по L2-Hys (L2, ограничение 0.2, повторная L2).
+//        Порядок значений: блоки по строкам, в блоке ячейки по строкам, в ячейке интервалы.
+//
+// @param image      [in]  Изображение из 1, 3 или 4 каналов.
+// @param cell_size  [in]  Сторона ячейки в пикселях (обычно 8).
+// @param block_size [in]  Сторона блока в ячейках (обычно 2).
+// @param bins       [in]  Количество интервалов ориентации (2..IPL_HOG_MAX_BINS, обычно 9).
+// @param features   [out] Буфер из ipl_hog_size(image->width, image->height, cell_size, block_size, bins) значений.
+//
+// @return INVALID_ARGUMENT Невалидный аргумент.
+//                          Если указатели равны NULL, параметры вне допустимых значений
+//                          или в изображение не помещается ни один блок.
+// @return OUT_OF_MEMORY    Не удалось выделить память для гистограмм ячеек или буферов потоков.
+// @return SUCCESS          Дескриптор вычислен.
+ImageProcStatus ipl_hog(const Image* image, const int cell_size, const int block_size, const int bins, float* features)
+{
+    if (!image || !image->data || !features) return INVALID_ARGUMENT;
+    if (image->channels != 1 && image->channels != 3 && image->channels != 4) return INVALID_ARGUMENT;
+    if (ipl_hog_size(image->width, image->height, cell_size, block_size, bins) == 0) return INVALID_ARGUMENT;
+
+    size_t width = image->width;
+    size_t cs = (size_t)cell_size;
+    size_t bs = (size_t)block_size;
+    size_t cells_x = width / cs;
+    size_t cells_y = image->height / cs;
+    size_t blocks_x = cells_x - bs + 1;
+    size_t blocks_y = cells_y - bs + 1;
+    size_t row_size = cells_x * bins; // Значений в строке гистограмм ячеек
+    size_t block_len = bs * bs * bins;
+
+    float* histograms = (float*)malloc(cells_y * row_size * sizeof(float));
+    if (!histograms) return OUT_OF_MEMORY;
+
+    int parallel = width * image->height >= ipl_get_context()->profile.parallel_min_pixels;
+    int failed = 0;
+
+    #pragma omp parallel if (parallel)
+    {
+        HogBuffers buf;
+        buf.gray = (unsigned char*)malloc((cs + 2) * width);
+        buf.dx = (short*)malloc((cs + 2) * width * sizeof(short));
+        buf.dy = (short*)malloc((width + 2) * sizeof(short));
+        buf.magnitude = (float*)malloc(width * sizeof(float));
+        buf.fraction = (float*)malloc(width * sizeof(float));
+        buf.bin = (int*)malloc(width * sizeof(int));
+        buf.rows = (const unsigned char**)malloc((cs + 2) * sizeof(*buf.rows));
+        int ok = buf.gray && buf.dx && buf.dy && buf.magnitude && buf.fraction && buf.bin && buf.rows;
+        if (!ok)
+        {
+            #pragma omp atomic write
+            failed = 1;
+        }
+
+        #pragma omp for
+        for (ptrdiff_t cy = 0; cy < (ptrdiff_t)cells_y; cy++)
+        {
+            if (ok) hog_cell_row(image, (size_t)cy, cell_size, cells_x, bins, histograms + (size_t)cy * row_size, &buf);
+        }
+
+        free(buf.gray);
+        free(buf.dx);
+        free(buf.dy);
+        free(buf.magnitude);
+        free(buf.fraction);
+        free(buf.bin);
+        free((void*)buf.rows);
+
+        // Нормализация блоков (L2-Hys) читает готовые гистограммы ячеек: неявный барьер omp for выше
+        if (!failed)
+        {
+            #pragma omp for
+            for (ptrdiff_t by = 0; by < (ptrdiff_t)blocks_y; by++)
+            {
+                for (size_t bx = 0; bx < blocks_x; bx++)
+                {
+                    float* out = features + ((size_t)by * blocks_x + bx) * block_len;
+                    for (size_t i = 0; i < bs; i++)
+                        memcpy(out + i * bs * bins, histograms + ((size_t)by + i) * row_size + bx * bins, bs * bins * sizeof(float));
+
+                    float norm = HOG_EPSILON * HOG_EPSILON;
+                    for (size_t k = 0; k < block_len; k++) norm += out[k] * out[k];
+                    float inv = 1.0f / sqrtf(norm);
+
+                    norm = HOG_EPSILON * HOG_EPSILON;
+                    for (size_t k = 0; k < block_len; k++)
+                    {
+                        float v = out[k] * inv;
+                        out[k] = v < HOG_CLIP ? v : HOG_CLIP;
+                        norm += out[k] * out[k];
+                    }
+                    inv = 1.0f / sqrtf(norm);
+                    for (size_t k = 0; k < block_len; k++) out[k] *= inv;
+                }
+            }
+        }
+    }
+
+    free(histograms);
+    return failed ? OUT_OF_MEMORY : SUCCESS;
+}
@@ -0,0 +1,218 @@
+#include "image_cache.h"
+#include "input_output.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <omp.h>
+
+// @brief Создает пустой кэш декодированных изображений.
+//
+// @param max_bytes [in] Максимальный суммарный размер пикселей в кэше. Изображения, используемые заданиями,
+//                       не вытесняются, поэтому пока они не освобождены, размер может быть превышен.
+//
+// @return Кэш или NULL, если не удалось выделить память.
+ImageCache* ipl_image_cache_create(const size_t max_bytes)
+{
+    ImageCache* cache = (ImageCache*)calloc(1, sizeof(ImageCache));
+    if (cache) cache->max_bytes = max_bytes;
+    return cache;
+}
+
+// @brief Создает кэш размером из переменной окружения IPL_IMAGE_CACHE_MB (по умолчанию IPL_IMAGE_CACHE_DEFAULT_MB).
+ImageCache* ipl_image_cache_create_default(void)
+{
+    const char* size = getenv("IPL_IMAGE_CACHE_MB");
+    double megabytes = size ? atof(size) : -1.0;
+    if (megabytes < 0.0) megabytes = IPL_IMAGE_CACHE_DEFAULT_MB;
+
+    return ipl_image_cache_create((size_t)(megabytes * 1024.0 * 1024.0));
+}
+
+// @brief Удаляет запись из кэша. Вызывается внутри критической секции.
+static void remove_entry(ImageCache* cache, const int i)
+{
+    ImageCacheEntry* entry = cache->entries[i];
+    cache->total_bytes -= entry->bytes;
+    free_image_data(&entry->image);
+    free(entry->path);
+    free(entry);
+
+    cache->entries[i] = cache->entries[--cache->count];
+}
+
+// @brief Вытесняет записи по алгоритму часов, пока размер кэша больше max_bytes: стрелка обходит записи,
+//        запись с битом обращения получает второй шанс (бит сбрасывается), запись без него удаляется.
+//        Используемые заданиями записи пропускаются. Вызывается внутри критической секции.
+static void evict_entries(ImageCache* cache)
+{
+    // За два оборота стрелки бит обращения сбрасывается у всех свободных записей
+    for (int steps = 2 * cache->count; cache->total_bytes > cache->max_bytes && cache->count > 0 && steps > 0; steps--)
+    {
+        if (cache->hand >= cache->count) cache->hand = 0;
+
+        ImageCacheEntry* entry = cache->entries[cache->hand];
+        if (entry->refcount > 0)
+        {
+            cache->hand++;
+        }
+        else if (entry->referenced)
+        {
+            entry->referenced = 0;
+            cache->hand++;
+        }
+        else
+        {
+            remove_entry(cache, cache->hand); // На место стрелки переставлена последняя запись
+        }
+    }
+}
+
+// @brief Ищет актуальную запись файла и захватывает ее. Записи, файл которых изменился, помечаются устаревшими
+//        (и удаляются, если не используются). Вызывается внутри критической секции.
+static ImageCacheEntry* find_entry(ImageCache* cache, const char* file_name, const struct stat* info)
+{
+    for (int i = 0; i < cache->count; i++)
+    {
+        ImageCacheEntry* entry = cache->entries[i];
+        if (entry->stale || strcmp(entry->path, file_name) != 0) continue;
+
+        if (entry->mtime == info->st_mtime && entry->file_size == (long long)info->st_size)
+        {
+            entry->refcount++;
+            entry->referenced = 1;
+            return entry;
+        }
+
+        entry->stale = 1;
+        if (entry->refcount == 0) remove_entry(cache, i--);
+    }
+    return NULL;
+}
+
+// @brief Освобождает кэш вместе со всеми изображениями. Изображения не должны использоваться заданиями.
+void ipl_image_cache_free(ImageCache* cache)
+{
+    if (!cache) return;
+    while (cache->count > 0) remove_entry(cache, cache->count - 1);
+    free(cache->entries);
+    free(cache);
+}
+
+// @brief Возвращает декодированное изображение файла: из кэша, если файл не менялся с момента декодирования,
+//        иначе загружает его (ipl_load_image_batch через cache->io) и добавляет в кэш. Изображение разделяется заданиями
+//        и доступно только для чтения до вызова ipl_image_cache_release.
+//
+// @param cache       [in]  Кэш.
+// @param file_name   [in]  Путь к файлу.
+// @param file_format [in]  Формат файла.
+// @param image       [out] Изображение.
+//
+// @return INVALID_ARGUMENT Указатели равны NULL.
+// @return OUT_OF_MEMORY    Не удалось выделить память для записи.
+// @return SUCCESS          Изображение получено.
+//         Иначе возвращается статус ipl_load_image.
+ImageProcStatus ipl_image_cache_acquire(ImageCache* cache, const char* file_name, const ImageFormat file_format, const Image** image)
+{
+    if (!cache || !file_name || !image) return INVALID_ARGUMENT;
+    *image = NULL;
+
+    struct stat info;
+    if (stat(file_name, &info) != 0) return FILE_NOT_FOUND;
+
+    ImageCacheEntry* found;
+    #pragma omp critical(ipl_image_cache)
+    {
+        found = find_entry(cache, file_name, &info);
+        if (found) cache->hits++;
+        else cache->misses++;
+    }
+    if (found)
+    {
+        *image = &found->image;
+        return SUCCESS;
+    }
+
+    // Декодирование выполняется вне критической секции: остальные задания продолжают получать изображения из кэша
+    ImageCacheEntry* entry = (ImageCacheEntry*)calloc(1, sizeof(ImageCacheEntry));
+    if (entry) entry->path = (char*)malloc(strlen(file_name) + 1);
+    if (!entry || !entry->path)
+    {
+        free(entry);
+        return OUT_OF_MEMORY;
+    }
+    strcpy(entry->path, file_name);
+
+    ImageProcStatus status = ipl_load_image_batch(cache->io, file_name, &entry->image, file_format);
+    if (status != SUCCESS)
+    {
+        free(entry->path);
+        free(entry);
+        return status;
+    }
+    entry->mtime = info.st_mtime;
+    entry->file_size = (long long)info.st_size;
+    entry->bytes = entry->image.width * entry->image.height * entry->image.channels;
+    entry->refcount = 1;
+    entry->referenced = 1;
+
+    #pragma omp critical(ipl_image_cache)
+    {
+        // Пока файл декодировался, его могло добавить другое задание
+        found = find_entry(cache, file_name, &info);
+        if (!found)
+        {
+            if (cache->count == cache->capacity)
+            {
+                int capacity = cache->capacity ? cache->capacity * 2 : 16;
+                ImageCacheEntry** entries = (ImageCacheEntry**)realloc(cache->entries, capacity * sizeof(ImageCacheEntry*));
+                if (entries)
+                {
+                    cache->entries = entries;
+                    cache->capacity = capacity;
+                }
+            }
+            if (cache->count < cache->capacity)
+            {
+                cache->entries[cache->count++] = entry;
+                cache->total_bytes += entry->bytes;
+                evict_entries(cache);
+            }
+            else
+            {
+                status = OUT_OF_MEMORY;
+            }
+        }
+    }
+
+    if (found || status != SUCCESS)
+    {
+        free_image_data(&entry->image);
+        free(entry->path);
+        free(entry);
+    }
+    if (status != SUCCESS) return status;
+
+    *image = found ? &found->image : &entry->image;
+    return SUCCESS;
+}
+
+// @brief Освобождает изображение, полученное ipl_image_cache_acquire. Изображение остается в кэше,
+//        пока не будет вытеснено (или удаляется сразу, если его файл изменился).
+void ipl_image_cache_release(ImageCache* cache, const Image* image)
+{
+    if (!cache || !image) return;
+
+    #pragma omp critical(ipl_image_cache)
+    {
+        for (int i = 0; i < cache->count; i++)
+        {
+            ImageCacheEntry* entry = cache->entries[i];
+            if (&entry->image != image) continue;
+
+            entry->refcount--;
+            if (entry->refcount == 0 && entry->stale) remove_entry(cache, i);
+            break;
+        }
+        evict_entries(cache);
+    }
+}
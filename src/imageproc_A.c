@@ -1,5 +1,9 @@
 #include "imageproc.h"
+#include "context.h"
+#include "buffer.h"
 #include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
 #include <omp.h>
 
 // FOR DEBUG //
@@ -22,18 +26,14 @@ static inline int clamp(int val, int min_val, int max_val) {
 ImageProcStatus ipl_median_filter(Image *image, const int radius)
 {
     unsigned char *source = image->data;
-    int win_size = radius * 2 + 1;
-    int win_area = win_size * win_size;
-
-    int width = image->width;           // Ширина оригинального изображения в пикселях
-    int height = image->height;         // Высота оригинального изображения в пикселях
+    size_t width = image->width;        // Ширина оригинального изображения в пикселях
+    size_t height = image->height;      // Высота оригинального изображения в пикселях
     int chan = image->channels;         // Число каналов
-    int wc = width * chan;              // Байтовая ширина строки исходного изображения
+    size_t wc = width * chan;           // Байтовая ширина строки исходного изображения
 
-    int w_pad = image->width + radius * 2;          // Ширина холста, дополненного 2-мя радиусами
-    int wc_pad = w_pad * chan;                      // Байтовая ширина строки дополненного холста (Leading Dimension)
-    int h_pad = image->height + radius * 2;    // Высота дополненного холста
-    int size_pad = w_pad * h_pad;              // Кол-во пикселей на холсте
+    size_t w_pad = width + (size_t)radius * 2;   // Ширина холста, дополненного 2-мя радиусами
+    size_t wc_pad = w_pad * chan;                // Байтовая ширина строки дополненного холста (Leading Dimension)
+    size_t h_pad = height + (size_t)radius * 2;  // Высота дополненного холста
 
     //////////////////////////////////////////////////////////
     // Создание дополненной копии оригинального изображения //
@@ -41,25 +41,25 @@ ImageProcStatus ipl_median_filter(Image *image, const int radius)
 
     printf("Making a padded copy.\n");
 
-    unsigned char* padded = malloc(w_pad * h_pad * chan);
+    unsigned char* padded = ipl_buffer_alloc(wc_pad * h_pad);
     if (padded == NULL) return OUT_OF_MEMORY;
 
-    int c;
+    // Строки холста независимы: середина копируется целиком, края дублируют крайние пиксели
     #pragma omp parallel for
-    for (c = 0; c < chan; c++)
+    for (ptrdiff_t i = 0; i < (ptrdiff_t)h_pad; i++)
     {
-        int i, j;
-        for (i = 0; i < h_pad; i++)
+        ptrdiff_t i_src = i - radius;
+        if (i_src < 0) i_src = 0;
+        else if (i_src >= (ptrdiff_t)height) i_src = (ptrdiff_t)height - 1;
+
+        const unsigned char *src = source + (size_t)i_src * wc;
+        unsigned char *dst = padded + (size_t)i * wc_pad;
+        for (int j = 0; j < radius; j++)
         {
-            int i_src = clamp(i - radius, 0, height-1);
-            int offset_src = i_src * wc;
-            int offset_pad = i * wc_pad;
-            for (j = 0; j < w_pad; j++)
-            {
-                int j_src = clamp(j - radius, 0, width-1);
-                padded[offset_pad + j*chan + c] = source[offset_src + j_src*chan + c];
-            }
+            memcpy(dst + (size_t)j*chan, src, chan);
+            memcpy(dst + (radius + width + j)*chan, src + (width-1)*chan, chan);
         }
+        memcpy(dst + (size_t)radius*chan, src, wc);
     }
 
     // Image pdd;
@@ -74,31 +74,13 @@ ImageProcStatus ipl_median_filter(Image *image, const int radius)
     // Применение медианнго фильтра к изображению //
     ////////////////////////////////////////////////
 
-    int histogram[4][256];
-    int hpos_x[4];
-    int hpos_y[4];
-    
     printf("Applying the median filter.\n");
-    
-    // Количество каналов варьируется от 1 до 4, поэтому c можно считать за константу
-    #pragma omp parallel for
-    for (int c = 0; c < chan; c++)
-    {
-        for (int i = 0; i < height; i++)
-        {
-            // printf("Row %d/%d...\n", i, height-1);
-            hist_set(histogram[c], source, padded, i, wc_pad, 0, chan, c, win_size, &hpos_y[c], &hpos_x[c]);
-
-            int i_offset = i * wc;
-            for (int j = 0; j < width-1; j++)
-            {
-                source[i_offset + j*chan + c] = get_median(histogram[c], win_area);
-                // if (c == 2) printf("hpos_x = %d, hpos_y = %d\n", hpos_x[c], hpos_y[c]);
-                hist_move(histogram[c], source, padded, hpos_y[c], wc_pad, &hpos_x[c], chan, c, win_size);
-            }
-            source[i_offset + (width-1)*chan + c] = get_median(histogram[c], win_area);
-        }
-    }
+
+    // Для маленьких окон сортировка окна быстрее поддержки гистограммы
+    if (radius <= ipl_get_context()->profile.median_sort_max_radius && radius <= MEDIAN_SORT_LIMIT)
+        median_sort_rows(padded, wc_pad, source, wc, chan, width, height, radius);
+    else
+        median_histogram_rows(padded, wc_pad, source, wc, chan, width, height, radius);
 
     printf("Median filter finished.\n");
     free(padded);
@@ -106,8 +88,76 @@ ImageProcStatus ipl_median_filter(Image *image, const int radius)
     return SUCCESS;
 }
 
+// @brief Медиана 9 значений сетью сортировки (19 сравнений-обменов без ветвлений).
+static inline unsigned char median9(unsigned char* p)
+{
+    #define MEDIAN_SORT2(a, b) { unsigned char lo = p[a] < p[b] ? p[a] : p[b]; p[b] = p[a] < p[b] ? p[b] : p[a]; p[a] = lo; }
+    MEDIAN_SORT2(1, 2); MEDIAN_SORT2(4, 5); MEDIAN_SORT2(7, 8);
+    MEDIAN_SORT2(0, 1); MEDIAN_SORT2(3, 4); MEDIAN_SORT2(6, 7);
+    MEDIAN_SORT2(1, 2); MEDIAN_SORT2(4, 5); MEDIAN_SORT2(7, 8);
+    MEDIAN_SORT2(0, 3); MEDIAN_SORT2(5, 8); MEDIAN_SORT2(4, 7);
+    MEDIAN_SORT2(3, 6); MEDIAN_SORT2(1, 4); MEDIAN_SORT2(2, 5);
+    MEDIAN_SORT2(4, 7); MEDIAN_SORT2(4, 2); MEDIAN_SORT2(6, 4);
+    MEDIAN_SORT2(4, 2);
+    #undef MEDIAN_SORT2
+    return p[4];
+}
+
+// Специализации медианного фильтра для 1, 3 и 4 каналов (см. median_kernels.h)
+#define CHANNELS 1
+#include "median_kernels.h"
+#undef CHANNELS
+#define CHANNELS 3
+#include "median_kernels.h"
+#undef CHANNELS
+#define CHANNELS 4
+#include "median_kernels.h"
+#undef CHANNELS
+
+// @brief Медианный фильтр сортировкой окна. Для радиуса 1 используется сеть сортировки,
+//        для радиусов до MEDIAN_SORT_LIMIT - сортировка вставками.
+//        Результат совпадает с гистограммным вариантом.
+//
+// @param padded    [in]  Дополненный на radius холст (как в ipl_median_filter).
+// @param ldp       [in]  Байтовая ширина строки холста.
+// @param output    [out] Результат (width x rows пикселей).
+// @param ldo       [in]  Байтовая ширина строки результата.
+// @param channels  [in]  Количество каналов (1, 3 или 4).
+// @param width     [in]  Ширина результата в пикселях.
+// @param rows      [in]  Количество строк результата.
+// @param radius    [in]  Радиус фильтра (1..MEDIAN_SORT_LIMIT).
+void median_sort_rows(const unsigned char *padded, size_t ldp, unsigned char *output, size_t ldo, int channels, size_t width, size_t rows, int radius)
+{
+    int parallel = width * rows >= ipl_get_context()->profile.parallel_min_pixels;
+
+    switch (channels)
+    {
+    case 1: median_sort_rows_c1(padded, ldp, output, ldo, width, rows, radius, parallel); break;
+    case 3: median_sort_rows_c3(padded, ldp, output, ldo, width, rows, radius, parallel); break;
+    case 4: median_sort_rows_c4(padded, ldp, output, ldo, width, rows, radius, parallel); break;
+    default: break;
+    }
+}
+
+// @brief Медианный фильтр скользящей гистограммой (любой радиус). Строки обрабатываются параллельно,
+//        для каждой строки гистограммы окна строятся заново и сдвигаются вдоль строки.
+//        Параметры такие же, как у median_sort_rows (radius >= 0).
+void median_histogram_rows(const unsigned char *padded, size_t ldp, unsigned char *output, size_t ldo, int channels, size_t width, size_t rows, int radius)
+{
+    if (width == 0) return;
+    int parallel = width * rows >= ipl_get_context()->profile.parallel_min_pixels;
+
+    switch (channels)
+    {
+    case 1: median_histogram_rows_c1(padded, ldp, output, ldo, width, rows, radius, parallel); break;
+    case 3: median_histogram_rows_c3(padded, ldp, output, ldo, width, rows, radius, parallel); break;
+    case 4: median_histogram_rows_c4(padded, ldp, output, ldo, width, rows, radius, parallel); break;
+    default: break;
+    }
+}
+
 // @brief Сброс и заполнение гистограммы для пикселя ппо координатам
-// @param hist Указалель на гистограмму (массив unsigned char[256])
+// @param hist Указалель на гистограмму (массив int[256])
 // @param padded Указатель на дополненное изображение
 // @param y Координата y в оригинальном изображении (по вертикали)
 // @param ldp Байтовая ширина строки изображения, для правильной индексации
@@ -115,37 +165,37 @@ ImageProcStatus ipl_median_filter(Image *image, const int radius)
 // @param ch Количество каналов изображения (1-4)
 // @param c Выбранный канал
 // @param window Радиус фильтра
-void hist_set(int *hist, unsigned char *original, unsigned char *padded, int y, int ldp, int x, int channels, int c, int window, int *hy, int *hx)
+void hist_set(int *hist, unsigned char *original, unsigned char *padded, size_t y, size_t ldp, size_t x, int channels, int c, int window, size_t *hy, size_t *hx)
 {
     for (int h = 0; h < 256; h++)
     {
         hist[h] = 0;
     }
     
-    for (int i = y; i < y+window; i++)
+    for (size_t i = y; i < y + (size_t)window; i++)
     {
-        for (int j = x; j < x+window; j++)
+        for (size_t j = x; j < x + (size_t)window; j++)
         {
-            hist[padded[i*ldp + j*channels + c]]++;
+            hist[padded[i * ldp + j * channels + c]]++;
         }
     }
     *hy = y;
     *hx = x;
 }
 
-void hist_move(int *hist, unsigned char *original, unsigned char *padded, int y, int ldp, int *hx, int channels, int c, int win_s)
+void hist_move(int *hist, unsigned char *original, unsigned char *padded, size_t y, size_t ldp, size_t *hx, int channels, int c, int win_s)
 {
-    int col_to_remove_idx = *hx;
+    size_t col_to_remove_idx = *hx;
     for (int i_win = 0; i_win < win_s; i_win++) {
-        int current_row_padded = y + i_win;
+        size_t current_row_padded = y + (size_t)i_win;
         hist[padded[current_row_padded * ldp + col_to_remove_idx * channels + c]]--;
     }
 
     (*hx)++;
 
-    int col_to_add_idx = (*hx) + win_s - 1;
+    size_t col_to_add_idx = *hx + (size_t)win_s - 1;
     for (int i_win = 0; i_win < win_s; i_win++) {
-        int current_row_padded = y + i_win;
+        size_t current_row_padded = y + (size_t)i_win;
         hist[padded[current_row_padded * ldp + col_to_add_idx * channels + c]]++;
     }
 }
@@ -164,7 +214,7 @@ unsigned char get_median(int *hist, int win_sqr)
 
 ImageProcStatus ipl_grayscale(Image *image)
 {
-    unsigned char *output_data = malloc(image->width * image->height);
+    unsigned char *output_data = ipl_buffer_alloc(image->width * image->height);
     if (output_data == NULL) return OUT_OF_MEMORY;
 
     convert_to_one_channel(image->data, output_data, image->width, image->height, image->channels);
@@ -174,4 +224,32 @@ ImageProcStatus ipl_grayscale(Image *image)
     image->format = JPEG;
 
     return SUCCESS;
-}
\ No newline at end of file
+}
+// @brief Пороговая бинаризация изображения (покомпонентно).
+//        Значения канала, не меньшие порога, заменяются на 255, остальные на 0.
+//
+// @param image [in, out] Указатель на структуру изображения.
+// @param level [in]      Порог бинаризации.
+//
+// @return INVALID_ARGUMENT `image` или `image->data` равен NULL.
+// @return SUCCESS          Пороговая обработка выполнена.
+ImageProcStatus ipl_threshold(Image *image, const unsigned char level)
+{
+    if (!image || !image->data) return INVALID_ARGUMENT;
+
+    threshold_row(image->data, image->data, image->width * image->height * image->channels, level);
+
+    return SUCCESS;
+}
+
+// @brief Пороговая обработка последовательности байтов (используется также в конвейере).
+//
+// @param input_data  [in]  Входные значения.
+// @param output_data [out] Выходные значения (может совпадать с input_data).
+// @param count       [in]  Количество байтов.
+// @param level       [in]  Порог бинаризации.
+void threshold_row(const unsigned char *input_data, unsigned char *output_data, const size_t count, const unsigned char level)
+{
+    // Реализация для уровня SIMD процессора (см. simd.c)
+    ipl_get_context()->kernels.threshold_row(input_data, output_data, count, level);
+}
@@ -1,7 +1,10 @@
 #include "imageproc.h"
+#include "context.h"
+#include "buffer.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <omp.h>
 
 // @brief Округляет значение float и приводит его к диапазону unsigned char [0, 255].
@@ -14,7 +17,10 @@ unsigned char to_uchar(float value)
 {
     if (value < 0.0f) value = 0.0f;
     else if (value > 255.0f) value = 255.0f;
-    return (unsigned char)roundf(value);
+    // Эквивалент roundf для [0, 255] (половина округляется вверх), но без вызова функции,
+    // поэтому циклы с to_uchar векторизуются. Разность value - truncated вычисляется точно.
+    int truncated = (int)value;
+    return (unsigned char)(truncated + (value - (float)truncated >= 0.5f));
 }
 
 
@@ -77,51 +83,55 @@ void free_kernel(Kernel* kernel)
     }
 }
 
+// @brief Выбирает реализацию свертки отрезка (один раз на вызов свертки): для радиусов 1..IPL_CONVOLVE_UNROLL_MAX -
+//        вариант с радиусом, известным при компиляции, на текущем уровне SIMD, иначе - общий вариант.
+static ConvolveSegmentFn select_convolve_segment(const int radius)
+{
+    const KernelTable* kernels = &ipl_get_context()->kernels;
+    return radius >= 1 && radius <= IPL_CONVOLVE_UNROLL_MAX ? kernels->convolve_segment_radius[radius] : kernels->convolve_segment;
+}
+
+// Рабочий буфер потока для sobel_rows: 4 строки short (dI/dx трех строк и dI/dy) и 3 строки яркости
+#define SOBEL_SCRATCH_SIZE(width) ((width) * (4 * sizeof(short) + 3))
+
+// Специализации ядер для 1, 3 и 4 каналов (см. convolution_kernels.h)
+#define CHANNELS 1
+#include "convolution_kernels.h"
+#undef CHANNELS
+#define CHANNELS 3
+#include "convolution_kernels.h"
+#undef CHANNELS
+#define CHANNELS 4
+#include "convolution_kernels.h"
+#undef CHANNELS
+
 // @brief Выполняет горизонтальную свертку изображения с использованием заданного ядра.
+//        Вызывает специализацию для количества каналов, строки обрабатываются параллельно.
 //
 // @param input_data  [in]  Указатель на массив входных данных изображения.
 // @param output_data [out] Указатель на массив для записи результатов свертки.
-// @param channels    [in]  Количество цветовых каналов в изображении.
+// @param channels    [in]  Количество цветовых каналов в изображении (1, 3 или 4).
 // @param width       [in]  Ширина изображения в пикселях.
 // @param height      [in]  Высота изображения в пикселях.
 // @param kernel      [in]  Указатель на структуру Kernel, содержащую ядро свертки.
 void horizontal_convolution(const unsigned char* input_data, unsigned char* output_data, const int channels, const size_t width, const size_t height, const Kernel* kernel)
 {
-    #pragma omp parallel for
-    for (int channel = 0; channel < channels; channel++) // Итерация по каждому цветовому каналу
+    // Для маленьких изображений накладные расходы на потоки больше выигрыша
+    int parallel = width * height >= ipl_get_context()->profile.parallel_min_pixels;
+
+    switch (channels)
     {
-        for (size_t i = 0; i < height; i++) // Итерация по каждой строке изображения
-        {
-            for (size_t j = 0; j < width; j++) // Итерация по каждому пикселю (столбцу) в строке
-            {
-                float weighted_sum = 0.0f;                                             // Аккумулятор для взвешенной суммы значений пикселей
-                for (int offset = -kernel->radius; offset <= kernel->radius; offset++) // Итерация по элементам ядра
-                {
-                    // Вычисляем координату соседнего пикселя по горизонтали
-                    int neighbor_col = (int)j + offset;
-
-                    // Обработка границ: отражение (clamp to edge)
-                    if (neighbor_col < 0)
-                        neighbor_col = 0;
-                    else if (neighbor_col >= (int)width)
-                        neighbor_col = (int)width - 1;
-
-                    // Индекс пикселя в одномерном массиве input_data
-                    size_t pixel_idx_in_data = (i * width + (size_t)neighbor_col) * channels + channel;
-                    // Коэффициент ядра (значение ядра для текущего смещения)
-                    float kernel_value = kernel->values[offset + kernel->radius];
-
-                    weighted_sum += (float)input_data[pixel_idx_in_data] * kernel_value;
-                }
-                // Индекс для записи результата в output_data
-                size_t output_pixel_idx = (i * width + j) * channels + channel;
-                output_data[output_pixel_idx] = to_uchar(weighted_sum);
-            }
-        }
+    case 1: horizontal_convolution_c1(input_data, output_data, width, height, kernel, parallel); break;
+    case 3: horizontal_convolution_c3(input_data, output_data, width, height, kernel, parallel); break;
+    case 4: horizontal_convolution_c4(input_data, output_data, width, height, kernel, parallel); break;
+    default: break; // Другое количество каналов не поддерживается (ограничено функциями I/O)
     }
 }
 
 // @brief Выполняет вертикальную свертку изображения с использованием заданного ядра.
+//        Соседи по вертикали находятся на одинаковом смещении для всех байтов строки,
+//        поэтому строка обрабатывается как width * channels независимых отсчетов
+//        и специализация по каналам не нужна.
 //
 // @param input_data  [in]  Указатель на массив входных данных изображения.
 // @param output_data [out] Указатель на массив для записи результатов свертки.
@@ -131,35 +141,228 @@ void horizontal_convolution(const unsigned char* input_data, unsigned char* outp
 // @param kernel      [in]  Указатель на структуру Kernel, содержащую ядро свертки.
 void vertical_convolution(const unsigned char* input_data, unsigned char* output_data, const int channels, const size_t width, const size_t height, const Kernel* kernel)
 {
-    #pragma omp parallel for
-    for (int channel = 0; channel < channels; channel++) // Итерация по каждому цветовому каналу
+    int parallel = width * height >= ipl_get_context()->profile.parallel_min_pixels;
+    const int radius = kernel->radius;
+    const size_t row_len = width * channels;
+    ConvolveSegmentFn convolve = select_convolve_segment(radius);
+
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t i = 0; i < (ptrdiff_t)height; i++) // Итерация по каждой строке изображения
+    {
+        // Указатели на строки окна с обработкой границ (clamp to edge)
+        const unsigned char* rows[2 * radius + 1];
+        for (int offset = -radius; offset <= radius; offset++)
+        {
+            ptrdiff_t neighbor_row = i + offset;
+            if (neighbor_row < 0) neighbor_row = 0;
+            else if (neighbor_row >= (ptrdiff_t)height) neighbor_row = (ptrdiff_t)height - 1;
+            rows[offset + radius] = input_data + (size_t)neighbor_row * row_len;
+        }
+
+        convolve(rows, output_data + (size_t)i * row_len, row_len, kernel->values, radius);
+    }
+}
+
+// @brief Вычисляет коэффициенты рекурсивного гауссова фильтра Янга - ван Флита (1995).
+//        Рекурсия третьего порядка: w[n] = B * x[n] + b1 * w[n-1] + b2 * w[n-2] + b3 * w[n-3]
+//        (коэффициенты b1..b3 уже нормированы на b0).
+//
+// @param sigma [in]  Стандартное отклонение (>= 0.5).
+// @param coefs [out] Массив из 4 элементов: B, b1, b2, b3.
+static void gaussian_iir_coefficients(const float sigma, float* coefs)
+{
+    double q = sigma >= 2.5f ? 0.98711 * sigma - 0.96330
+                             : 3.97156 - 4.14554 * sqrt(1.0 - 0.26891 * sigma);
+    double q2 = q * q;
+    double q3 = q2 * q;
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+    double b2 = -(1.4281 * q2 + 1.26661 * q3);
+    double b3 = 0.422205 * q3;
+
+    coefs[0] = (float)(1.0 - (b1 + b2 + b3) / b0);
+    coefs[1] = (float)(b1 / b0);
+    coefs[2] = (float)(b2 / b0);
+    coefs[3] = (float)(b3 / b0);
+}
+
+// @brief Длина продолжения сигнала за правой / нижней границей в рекурсивном фильтре (отсчетов).
+static size_t gaussian_iir_extension(const float sigma)
+{
+    return (size_t)ceilf(4.0f * sigma);
+}
+
+// @brief Размер рабочего буфера для gaussian_iir_filter в байтах: промежуточная плоскость и, для каждого потока,
+//        отсчеты продолжения за границей (их длина растет с sigma, поэтому они не размещаются на стеке).
+//        В режиме половинной точности (half_intermediates профиля) промежуточная плоскость хранится
+//        в формате IEEE half (2 байта на отсчет), и к ней добавляется строка float на каждый поток.
+size_t gaussian_iir_buffer_size(const int channels, const size_t width, const size_t height, const float sigma)
+{
+    size_t samples = width * height * channels;
+    size_t threads = (size_t)omp_get_max_threads();
+    size_t tails = threads * (gaussian_iir_extension(sigma) + 1) * sizeof(float);
+    if (!ipl_get_context()->profile.half_intermediates) return samples * sizeof(float) + tails;
+
+    size_t plane = (samples * sizeof(unsigned short) + sizeof(float) - 1) / sizeof(float) * sizeof(float);
+    return plane + threads * width * channels * sizeof(float) + tails;
+}
+
+// @brief Рекурсивный (IIR) гауссов фильтр. Стоимость не зависит от sigma,
+//        поэтому для больших sigma он быстрее прямой свертки (точка перехода - gaussian_iir_sigma профиля).
+//        Каждое направление обрабатывается проходом вперед и назад. На границах сигнал продолжается
+//        постоянным (clamp to edge): в начале это задает начальное состояние рекурсии, а в конце
+//        проход вперед продолжается на 4*sigma отсчетов продолжения, с которых начинается проход назад.
+//        Результат приближает гауссову свертку, но не совпадает с ней побитово.
+//
+//        Если в профиле включен half_intermediates, промежуточная плоскость хранится в половинной точности
+//        (преобразование F16C, если процессор его поддерживает). Это вдвое сокращает объем памяти, через которую
+//        проходят оба прохода. Состояние рекурсии остается float, округляются только сохраненные отсчеты:
+//        относительная ошибка half не больше 2^-11, для значений до 255 это не больше 0.0625 на отсчет,
+//        поэтому результат отличается от float-варианта не более чем на 1 уровень яркости.
+//
+// @param data     [in, out] Данные изображения.
+// @param buffer   [in]      Рабочий буфер размером gaussian_iir_buffer_size(channels, width, height, sigma) байтов.
+// @param channels [in]      Количество каналов.
+// @param width    [in]      Ширина изображения в пикселях.
+// @param height   [in]      Высота изображения в пикселях.
+// @param sigma    [in]      Стандартное отклонение (>= 0.5).
+void gaussian_iir_filter(unsigned char* data, void* buffer, const int channels, const size_t width, const size_t height, const float sigma)
+{
+    float k[4];
+    gaussian_iir_coefficients(sigma, k);
+
+    const LibraryContext* context = ipl_get_context();
+    const int half = context->profile.half_intermediates;
+    const KernelTable* kernels = &context->kernels;
+
+    size_t row_len = width * channels;
+    size_t ext = gaussian_iir_extension(sigma);
+    int parallel = width * height >= context->profile.parallel_min_pixels;
+
+    // Промежуточная плоскость: float или half (тогда после нее идут строки float потоков),
+    // затем буферы продолжения потоков (см. gaussian_iir_buffer_size)
+    float* plane = (float*)buffer;
+    unsigned short* plane_half = (unsigned short*)buffer;
+    float* thread_rows = plane + (row_len * height * sizeof(unsigned short) + sizeof(float) - 1) / sizeof(float);
+    float* thread_tails = half ? thread_rows + (size_t)omp_get_max_threads() * row_len : plane + row_len * height;
+
+    // Горизонтальный проход: каждая строка независима
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t i = 0; i < (ptrdiff_t)height; i++)
     {
-        for (size_t i = 0; i < height; i++) // Итерация по каждой строке изображения
+        const unsigned char* in = data + (size_t)i * row_len;
+        float* w = half ? thread_rows + (size_t)omp_get_thread_num() * row_len : plane + (size_t)i * row_len;
+
+        for (int c = 0; c < channels; c++)
         {
-            for (size_t j = 0; j < width; j++) // Итерация по каждому пикселю (столбцу) в строке
+            // Вперед
+            float w1 = in[c], w2 = in[c], w3 = in[c];
+            for (size_t j = 0; j < width; j++)
+            {
+                float v = k[0] * in[j * channels + c] + k[1] * w1 + k[2] * w2 + k[3] * w3;
+                w[j * channels + c] = v;
+                w3 = w2; w2 = w1; w1 = v;
+            }
+
+            // Продолжение вперед за правой границей, затем проход назад по нему (без записи)
+            float* tail = thread_tails + (size_t)omp_get_thread_num() * (ext + 1);
+            float last = in[(width - 1) * channels + c];
+            for (size_t e = 0; e < ext; e++)
+            {
+                float v = k[0] * last + k[1] * w1 + k[2] * w2 + k[3] * w3;
+                tail[e] = v;
+                w3 = w2; w2 = w1; w1 = v;
+            }
+            float o1 = w1, o2 = w1, o3 = w1;
+            for (size_t e = ext; e-- > 0;)
             {
-                float weighted_sum = 0.0f;                                             // Аккумулятор для взвешенной суммы
-                for (int offset = -kernel->radius; offset <= kernel->radius; offset++) // Итерация по элементам ядра
-                {
-                    // Вычисляем координату соседнего пикселя по вертикали
-                    int neighbor_row = (int)i + offset;
-
-                    // Обработка границ: отражение (clamp to edge)
-                    if (neighbor_row < 0)
-                        neighbor_row = 0;
-                    else if (neighbor_row >= (int)height)
-                        neighbor_row = (int)height - 1;
-
-                    // Индекс пикселя в одномерном массиве input_data
-                    size_t pixel_idx_in_data = ((size_t)neighbor_row * width + j) * channels + channel;
-                    // Коэффициент ядра
-                    float kernel_value = kernel->values[offset + kernel->radius];
-
-                    weighted_sum += (float)input_data[pixel_idx_in_data] * kernel_value;
-                }
-                // Индекс для записи результата в output_data
-                size_t output_pixel_idx = (i * width + j) * channels + channel;
-                output_data[output_pixel_idx] = to_uchar(weighted_sum);
+                float v = k[0] * tail[e] + k[1] * o1 + k[2] * o2 + k[3] * o3;
+                o3 = o2; o2 = o1; o1 = v;
+            }
+
+            // Назад
+            for (size_t j = width; j-- > 0;)
+            {
+                float v = k[0] * w[j * channels + c] + k[1] * o1 + k[2] * o2 + k[3] * o3;
+                w[j * channels + c] = v;
+                o3 = o2; o2 = o1; o1 = v;
+            }
+        }
+
+        if (half) kernels->float_to_half(w, plane_half + (size_t)i * row_len, row_len);
+    }
+
+    // Вертикальный проход: полосы столбцов независимы, внутри полосы строки идут подряд
+    const size_t stripe = 256;
+    ptrdiff_t stripes = (ptrdiff_t)((row_len + stripe - 1) / stripe);
+
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t s = 0; s < stripes; s++)
+    {
+        size_t x0 = (size_t)s * stripe;
+        size_t len = row_len - x0 < stripe ? row_len - x0 : stripe;
+        float state[3][256];
+        float back[3][256];
+        float unpacked[256]; // строка полосы, распакованная из half
+
+        // Вперед
+        float edge[256]; // значения последней строки до прохода вперед
+        for (size_t i = 0; i < height; i++)
+        {
+            float* w = plane + i * row_len + x0;
+            if (half)
+            {
+                kernels->half_to_float(plane_half + i * row_len + x0, unpacked, len);
+                w = unpacked;
+            }
+            if (i == 0)
+                for (size_t x = 0; x < len; x++)
+                    state[0][x] = state[1][x] = state[2][x] = w[x];
+            if (i == height - 1) memcpy(edge, w, len * sizeof(float));
+            for (size_t x = 0; x < len; x++)
+            {
+                float v = k[0] * w[x] + k[1] * state[0][x] + k[2] * state[1][x] + k[3] * state[2][x];
+                state[2][x] = state[1][x]; state[1][x] = state[0][x]; state[0][x] = v;
+                w[x] = v;
+            }
+            if (half) kernels->float_to_half(unpacked, plane_half + i * row_len + x0, len);
+        }
+
+        // Продолжение за нижней границей (как в горизонтальном проходе)
+        float* tail = thread_tails + (size_t)omp_get_thread_num() * (ext + 1);
+        for (size_t x = 0; x < len; x++)
+        {
+            float t0 = state[0][x], t1 = state[1][x], t2 = state[2][x];
+            for (size_t e = 0; e < ext; e++)
+            {
+                float v = k[0] * edge[x] + k[1] * t0 + k[2] * t1 + k[3] * t2;
+                tail[e] = v;
+                t2 = t1; t1 = t0; t0 = v;
+            }
+            float o1 = t0, o2 = t0, o3 = t0;
+            for (size_t e = ext; e-- > 0;)
+            {
+                float v = k[0] * tail[e] + k[1] * o1 + k[2] * o2 + k[3] * o3;
+                o3 = o2; o2 = o1; o1 = v;
+            }
+            back[0][x] = o1; back[1][x] = o2; back[2][x] = o3;
+        }
+
+        // Назад с записью результата
+        for (size_t i = height; i-- > 0;)
+        {
+            const float* w = plane + i * row_len + x0;
+            if (half)
+            {
+                kernels->half_to_float(plane_half + i * row_len + x0, unpacked, len);
+                w = unpacked;
+            }
+            unsigned char* out = data + i * row_len + x0;
+            for (size_t x = 0; x < len; x++)
+            {
+                float v = k[0] * w[x] + k[1] * back[0][x] + k[2] * back[1][x] + k[3] * back[2][x];
+                back[2][x] = back[1][x]; back[1][x] = back[0][x]; back[0][x] = v;
+                out[x] = to_uchar(v);
             }
         }
     }
@@ -174,6 +377,7 @@ void vertical_convolution(const unsigned char* input_data, unsigned char* output
 // @param sigma [in]      Стандартное отклонение (sigma) для гауссова ядра.
 //                        Определяет степень размытия. Должно быть положительным.
 //                        Если sigma очень мало (<= 1e-6f), фильтрация пропускается, так как изображение изменится незначительно.
+//                        Начиная с gaussian_iir_sigma профиля используется рекурсивный фильтр (gaussian_iir_filter).
 //
 // @return INVALID_ARGUMENT В функцию передан невалидный аргумент.
 //                          Если `image` или `image->data` равен NULL, или `sigma` отрицательное.
@@ -187,6 +391,16 @@ ImageProcStatus ipl_gaussian_filter(Image* image, const float sigma)
     // Если sigma очень мала, изображение практически не изменится
     if (sigma <= 1e-6f) return SUCCESS;
 
+    // Для больших sigma рекурсивный фильтр быстрее прямой свертки
+    if (sigma >= ipl_get_context()->profile.gaussian_iir_sigma && sigma >= 0.5f)
+    {
+        void* buffer = ipl_buffer_alloc(gaussian_iir_buffer_size(image->channels, image->width, image->height, sigma));
+        if (!buffer) return OUT_OF_MEMORY;
+        gaussian_iir_filter(image->data, buffer, image->channels, image->width, image->height, sigma);
+        free(buffer);
+        return SUCCESS;
+    }
+
     Kernel* kernel = generate_gaussian_kernel(sigma);
     if (!kernel) { // generate_gaussian_kernel вернет NULL, если не удастся выделить память
         return OUT_OF_MEMORY;
@@ -196,7 +410,7 @@ ImageProcStatus ipl_gaussian_filter(Image* image, const float sigma)
     // Это необходимо, так как вертикальная свертка должна использовать
     // полностью обработанные горизонтальные данные, а не смешанные (старые и новые).
     size_t data_size_bytes = (size_t)image->height * image->width * image->channels * sizeof(unsigned char);
-    unsigned char* tmp_data = (unsigned char*)malloc(data_size_bytes);
+    unsigned char* tmp_data = (unsigned char*)ipl_buffer_alloc(data_size_bytes);
     if (!tmp_data) 
     {
         free_kernel(kernel);
@@ -231,136 +445,91 @@ ImageProcStatus ipl_gaussian_filter(Image* image, const float sigma)
 // @param channels_in [in]  Количество каналов во входном изображении.
 void convert_to_one_channel(const unsigned char* input_data, unsigned char* output_data, const size_t width, const size_t height, const int channels_in)
 {
-    if (channels_in == 1) // Если изображение уже одноканальное (Ч/Б)
-    {
-        memcpy(output_data, input_data, height * width * sizeof(unsigned char));
-    } 
-    else if (channels_in == 3 || channels_in == 4) // RGB или RGBA
+    size_t num_pixels = width * height;
+
+    switch (channels_in)
     {
-        size_t num_pixels = width * height;
-        for (size_t i = 0; i < num_pixels; ++i)
-        {
-            // Индексы каналов в исходном массиве
-            size_t r_idx = i * channels_in;
-            size_t g_idx = i * channels_in + 1;
-            size_t b_idx = i * channels_in + 2;
-            // Alpha канал (channels_in == 4) игнорируется
-
-            float r = (float)input_data[r_idx];
-            float g = (float)input_data[g_idx];
-            float b = (float)input_data[b_idx];
-            
-            // Стандартная формула для преобразования в оттенки серого (яркость)
-            float gray = 0.299f * r + 0.587f * g + 0.114f * b;
-
-            output_data[i] = to_uchar(gray);
-        }
+    case 1: memcpy(output_data, input_data, num_pixels * sizeof(unsigned char)); break; // Уже одноканальное (Ч/Б)
+    case 3: gray_row_c3(input_data, output_data, num_pixels); break;                    // RGB
+    case 4: gray_row_c4(input_data, output_data, num_pixels); break;                    // RGBA
+    default: break; // Случаи с другим количеством каналов (например, 2) не обрабатываются (они ограничены функциями I/O)
     }
-    // Случаи с другим количеством каналов (например, 2) не обрабатываются (они ограничены функциями I/O)
 }
 
 // @brief Вычисляет магнитуду градиента изображения с помощью разделимого оператора Собеля.
 //        Функция сначала вычисляет производные по X и Y (dI/dx, dI/dy) с ядром [-1, 0, 1].
 //        Затем dI/dx сглаживается по вертикали ядром [1, 2, 1],
 //        а dI/dy сглаживается по горизонтали ядром [1, 2, 1].
-//        Используются циклические буферы для строк для оптимизации доступа к данным.
 //        Результатом является карта величин градиента: sqrt(Gx^2 + Gy^2) для каждого пикселя.
-// 
+//        Первая и последняя строки результата не заполняются.
+//
 // @param input_grayscale_data [in]  Указатель на массив данных одноканального (grayscale) входного изображения.
 // @param output_gradient_map  [out] Указатель на массив для записи карты величин градиента.
 // @param width                [in]  Ширина изображения в пикселях.
 // @param height               [in]  Высота изображения в пикселях.
-void compute_sobel_magnitude(const unsigned char* input_grayscale_data, unsigned char* output_gradient_map, const size_t width, const size_t height)
+ImageProcStatus compute_sobel_magnitude(const unsigned char* input_grayscale_data, unsigned char* output_gradient_map, const size_t width, const size_t height)
 {
-    // Ядра для оператора Собеля
-    const float deriv_kernel[3] = {-1.0f, 0.0f, 1.0f}; // Для производной
-    const float smooth_kernel[3] = {1.0f, 2.0f, 1.0f}; // Для сглаживания
+    return compute_sobel_magnitude_channels(input_grayscale_data, output_gradient_map, width, height, 1);
+}
 
-    // Циклические буферы для хранения промежуточных результатов производных по X и Y для 3-х строк.
-    float dx_buf[3][width]; // dI/dx для 3-х строк пикселей подряд
-    float dy_buf[3][width]; // dI/dy для 3-х строк пикселей подряд
+// @brief Магнитуда градиента Собеля (см. compute_sobel_magnitude) для изображения из 1, 3 или 4 каналов.
+//        Преобразование в оттенки серого выполняется на лету внутри специализации по количеству каналов.
+//        Строки обрабатываются параллельно блоками, каждому блоку нужны только соседние строки по краям.
+//        Строки производных и яркости хранятся в буфере потока в куче (размер растет с шириной).
+//
+// @param input_data          [in]  Входное изображение.
+// @param output_gradient_map [out] Одноканальная карта величин градиента (width * height).
+// @param width               [in]  Ширина изображения в пикселях.
+// @param height              [in]  Высота изображения в пикселях.
+// @param channels            [in]  Количество каналов входного изображения (1, 3 или 4).
+//
+// @return OUT_OF_MEMORY Не удалось выделить буфер потока.
+// @return SUCCESS       Карта вычислена (или изображение меньше 3 строк, и вычислять нечего).
+ImageProcStatus compute_sobel_magnitude_channels(const unsigned char* input_data, unsigned char* output_gradient_map, const size_t width, const size_t height, const int channels)
+{
+    if (height < 3 || width == 0) return SUCCESS;
 
-    for (size_t i = 0; i < height; i++) // Итерация по строкам входного изображения
+    void (*sobel_rows)(const unsigned char*, unsigned char*, const size_t, const size_t, const size_t, const size_t, void*);
+    switch (channels)
     {
-        // Индекс текущей строки в циклическом буфере (0, 1 или 2)
-        size_t current_buf_row = i % 3;
-
-        // Вычисление горизонтальной производной (dI/dx) для текущей строки i
-        for (size_t j = 0; j < width; j++) // Итерация по пикселям в строке
-        {
-            float sum_dx = 0.0f;
-            for (int offset = -1; offset <= 1; offset++) // Применение ядра deriv_kernel по горизонтали
-            {
-                int current_col = (int)j + offset;
-                // Обработка границ (clamp to edge)
-                if (current_col < 0) current_col = 0;
-                else if (current_col >= (int)width) current_col = (int)width - 1;
+    case 1: sobel_rows = sobel_rows_c1; break;
+    case 3: sobel_rows = sobel_rows_c3; break;
+    case 4: sobel_rows = sobel_rows_c4; break;
+    default: return INVALID_ARGUMENT;
+    }
 
-                size_t pixel_idx = i * width + (size_t)current_col;
-                sum_dx += (float)input_grayscale_data[pixel_idx] * deriv_kernel[offset + 1];
-            }
-            dx_buf[current_buf_row][j] = sum_dx;
-        }
+    const size_t block = 64; // Строк в блоке одного потока
+    ptrdiff_t blocks = (ptrdiff_t)((height - 2 + block - 1) / block);
+    int parallel = width * height >= ipl_get_context()->profile.parallel_min_pixels;
+    int failed = 0;
 
-        // Вычисление вертикальной производной (dI/dy) для текущей строки i
-        for (size_t j = 0; j < width; j++) // Итерация по пикселям в строке
+    #pragma omp parallel if (parallel)
+    {
+        void* scratch = malloc(SOBEL_SCRATCH_SIZE(width));
+        if (!scratch)
         {
-            float sum_dy = 0.0f;
-            for (int offset = -1; offset <= 1; offset++) // Применение ядра deriv_kernel по вертикали
-            {
-                int current_row = (int)i + offset;
-                // Обработка границ (clamp to edge)
-                if (current_row < 0) current_row = 0;
-                else if (current_row >= (int)height) current_row = (int)height - 1;
-                
-                size_t pixel_idx = (size_t)current_row * width + j;
-                sum_dy += (float)input_grayscale_data[pixel_idx] * deriv_kernel[offset + 1];
-            }
-            dy_buf[current_buf_row][j] = sum_dy;
+            #pragma omp atomic write
+            failed = 1;
         }
 
-        // Если накоплено достаточно строк (минимум 2 предыдущие + текущая = 3 строки),
-        // Вычисляем градиент для центральной из этих трех строк (т.е. для строки i-1).
-        if (i < 2) continue; // Требуется как минимум 3 строки (0, 1, 2) для обработки строки 1.
-
-        // Индексы строк в циклических буферах для окна 3x3, центрированного на строке (i-1)
-        size_t prev_prev_buf_row = (i - 2) % 3; // Строка i-2
-        size_t prev_buf_row = (i - 1) % 3;      // Строка i-1 (центральная для вычисления градиента)
-        size_t curr_buf_row = i % 3;            // Строка i
-
-        // Строка в выходном изображении, для которой вычисляется градиент
-        size_t output_row_idx = i - 1;
-
-        for (size_t j = 0; j < width; j++) // Итерация по пикселям в строке output_row_idx
+        #pragma omp for
+        for (ptrdiff_t b = 0; b < blocks; b++)
         {
-            // Gx = Сглаживание dI/dx по вертикали: [1, 2, 1]^T * [dI/dx(i-2), dI/dx(i-1), dI/dx(i)]
-            float gx = dx_buf[prev_prev_buf_row][j] * smooth_kernel[0] +
-                       dx_buf[prev_buf_row][j]      * smooth_kernel[1] +
-                       dx_buf[curr_buf_row][j]      * smooth_kernel[2];
-
-            // Gy = Сглаживание dI/dy по горизонтали: [dI/dy(j-1), dI/dy(j), dI/dy(j+1)] * [1, 2, 1]
-            // Используем значения dI/dy из центральной строки окна (prev_buf_row, т.е. строка i-1)
-            float gy = 0.0f;
-            for (int offset = -1; offset <= 1; offset++)
-            {
-                int current_col = (int)j + offset;
-                // Обработка границ (clamp to edge)
-                if (current_col < 0) current_col = 0;
-                else if (current_col >= (int)width) current_col = (int)width - 1;
-                
-                gy += dy_buf[prev_buf_row][current_col] * smooth_kernel[offset + 1];
-            }
-
-            // Магнитуда градиента
-            float magnitude = sqrtf(gx * gx + gy * gy);
-            output_gradient_map[output_row_idx * width + j] = to_uchar(magnitude);
+            if (!scratch) continue;
+            size_t row_begin = 1 + (size_t)b * block;
+            size_t row_end = row_begin + block < height - 1 ? row_begin + block : height - 1;
+            sobel_rows(input_data, output_gradient_map, width, height, row_begin, row_end, scratch);
         }
+
+        free(scratch);
     }
+
+    return failed ? OUT_OF_MEMORY : SUCCESS;
 }
 
 // @brief Выполняет обнаружение границ на изображении с использованием оператора Собеля.
-//        Изображение сначала преобразуется в оттенки серого.
-//        Затем вычисляется магнитуда градиента яркости по Собелю.
+//        Изображение преобразуется в оттенки серого (построчно, вместе с вычислением градиента),
+//        и вычисляется магнитуда градиента яркости по Собелю.
 //        Результат (одноканальная карта градиентов) заменяет исходные данные изображения.
 //
 // @param image [in, out] Указатель на структуру Image. Данные изображения будут заменены
@@ -374,26 +543,31 @@ ImageProcStatus ipl_sobel_edge_detection(Image* image)
 {
     if (!image || !image->data) return INVALID_ARGUMENT;
 
-    // Временный буфер для одноканального (grayscale) изображения
     size_t num_pixels = (size_t)image->width * image->height;
-    unsigned char* grayscale_data = (unsigned char*)malloc(num_pixels * sizeof(unsigned char));
-    if (!grayscale_data) return OUT_OF_MEMORY;
-
-    convert_to_one_channel(image->data, grayscale_data, image->width, image->height, image->channels);
 
     // Буфер для результата (карты градиентов).
-    // Использутся calloc для инициализации нулями, так как compute_sobel_magnitude
-    // не заполняет крайние пиксели (первую/последнюю строку/столбец).
-    unsigned char* gradient_map_data = (unsigned char*)calloc(num_pixels, sizeof(unsigned char));
-    if (!gradient_map_data)
+    // compute_sobel_magnitude не заполняет первую и последнюю строки, они обнуляются отдельно.
+    unsigned char* gradient_map_data = (unsigned char*)ipl_buffer_alloc(num_pixels * sizeof(unsigned char));
+    if (!gradient_map_data) return OUT_OF_MEMORY;
+
+    if (image->height < 3)
     {
-        free(grayscale_data);
-        return OUT_OF_MEMORY;
+        memset(gradient_map_data, 0, num_pixels);
+    }
+    else
+    {
+        memset(gradient_map_data, 0, image->width);
+        memset(gradient_map_data + (image->height - 1) * image->width, 0, image->width);
     }
 
-    compute_sobel_magnitude(grayscale_data, gradient_map_data, image->width, image->height);
+    // Яркость считается на лету, поэтому отдельное полутоновое изображение не создается
+    ImageProcStatus status = compute_sobel_magnitude_channels(image->data, gradient_map_data, image->width, image->height, image->channels);
+    if (status != SUCCESS)
+    {
+        free(gradient_map_data);
+        return status;
+    }
 
-    free(grayscale_data); // Временные данные в оттенках серого больше не нужны
     free(image->data);    // Освобождаем старые данные изображения
 
     image->channels = 1;             // Теперь изображение одноканальное
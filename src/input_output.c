@@ -5,8 +5,15 @@
 #include "stb_image_write.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
 #include "input_output.h"
 #include "imageproc.h"
+#include "roi_decoders.h"
+#include "png_decoder.h"
+#include "png_encoder.h"
+#include "thumbnail.h"
 
 // @brief Контекст операции записи файла для использования с функциями stb_image_write.
 //        Эта структура передается как void* context в write_to_file_contextual.
@@ -44,6 +51,59 @@ void write_to_file_contextual(void *context, void *data, int size)
     // если запись успешна (size == written_size), io_error остается в 0 (если не был ранее 1)
 }
 
+// @brief Контекст кодирования изображения в память для stb_image_write.
+typedef struct
+{
+    unsigned char* data; // Закодированные данные (растущий буфер)
+    size_t size;
+    size_t capacity;
+    int io_error;        // 1 - не удалось выделить память
+} MemoryWriteContext;
+
+// @brief Функция обратного вызова stb_image_write: дописывает блок в буфер контекста, увеличивая его вдвое.
+static void write_to_memory_contextual(void* context, void* data, int size)
+{
+    MemoryWriteContext* op_context = (MemoryWriteContext*)context;
+    if (op_context->io_error) return;
+
+    if (op_context->size + (size_t)size > op_context->capacity)
+    {
+        size_t capacity = op_context->capacity ? op_context->capacity * 2 : 65536;
+        while (capacity < op_context->size + (size_t)size) capacity *= 2;
+
+        unsigned char* grown = (unsigned char*)realloc(op_context->data, capacity);
+        if (!grown)
+        {
+            op_context->io_error = 1;
+            return;
+        }
+        op_context->data = grown;
+        op_context->capacity = capacity;
+    }
+
+    memcpy(op_context->data + op_context->size, data, (size_t)size);
+    op_context->size += (size_t)size;
+}
+
+// @brief Записывает изображение в PNG через функцию обратного вызова stb_image_write.
+//        Если изображение можно записать без потерь с палитрой или серым меньшей глубины, пишется такой PNG
+//        (png_encoder.h), при colors > 0 - PNG с палитрой не больше colors записей, иначе обычный PNG stb_image_write.
+//
+// @return 1 - успешно, 0 - ошибка кодирования (как у stbi_write_png_to_func).
+static int write_png(const Image* image, const int colors, const int dither, stbi_write_func* func, void* context)
+{
+    unsigned char* png = NULL;
+    int length = 0;
+    const int result = png_encode_indexed(image, colors, dither, &png, &length);
+    if (result == ENCODE_FAILED) return 0;
+    if (result == ENCODE_FALLBACK)
+        return stbi_write_png_to_func(func, context, image->width, image->height, image->channels, image->data, image->width * image->channels);
+
+    func(context, png, length);
+    free(png);
+    return 1;
+}
+
 // @brief Освобождает память, выделенную для пиксельных данных изображения.
 //
 // @param image [in,out] Указатель на структуру Image
@@ -61,6 +121,40 @@ ImageProcStatus free_image_data(Image* image)
     return SUCCESS;
 }
 
+// @brief Декодирует содержимое файла в памяти: baseline JPEG - параллельным декодером (jpeg_decoder.h),
+//        8-битные PNG - декодером с табличной распаковкой и векторным восстановлением строк (png_decoder.h),
+//        остальные файлы и не поддерживаемые ими варианты - stb_image. Результат совпадает с stbi_load_from_memory.
+static stbi_uc* decode_from_memory(const stbi_uc* data, const int size, int* width, int* height, int* channels)
+{
+    stbi__context s;
+    stbi_uc* pixels = NULL;
+    int result = DECODE_FALLBACK;
+    stbi__start_mem(&s, data, size);
+    if (stbi__jpeg_test(&s)) result = jpeg_decode(&s, &pixels, width, height, channels);
+    else if (stbi__png_test(&s)) result = png_decode(&s, &pixels, width, height, channels);
+
+    if (result == DECODE_DONE) return pixels;
+    if (result == DECODE_FAILED) return NULL;
+    return stbi_load_from_memory(data, size, width, height, channels, 0);
+}
+
+// @brief Читает файл целиком и декодирует его (decode_from_memory). Если файл не удалось прочитать в память
+//        (больше INT_MAX байт или не хватает памяти), он декодируется stb_image потоково.
+static stbi_uc* decode_file(FILE* file, int* width, int* height, int* channels)
+{
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+    if (fseek(file, 0, SEEK_SET) != 0) return NULL;
+
+    stbi_uc* contents = size > 0 && size <= INT_MAX ? (stbi_uc*)malloc((size_t)size) : NULL;
+    if (!contents) return stbi_load_from_file(file, width, height, channels, 0);
+
+    stbi_uc* pixels = NULL;
+    if (fread(contents, 1, (size_t)size, file) == (size_t)size) pixels = decode_from_memory(contents, (int)size, width, height, channels);
+    free(contents);
+    return pixels;
+}
+
 // @brief Загружает изображение из файла в структуру Image.
 //        Предварительно освобождает потенциальные мусорные данные из Image.
 //        Поддерживает форматы файла PNG и JPEG. Если указан UNKNOWN, функция возвращает ошибку.
@@ -70,14 +164,14 @@ ImageProcStatus free_image_data(Image* image)
 //        
 // @param file_name   [in]  Строковое значение пути к файлу хранящему изображение.
 // @param image       [out] Указатель на структуру Image, которая будет заполнена данными загруженного изображения.
-//                          Память для image->data выделяется в stbi_load_from_file и далее освобождается с помощью free_image_data.
+//                          Память для image->data выделяется при декодировании и далее освобождается с помощью free_image_data.
 // @param file_format [in]  Ожидаемый формат изображения в файле (PNG или JPEG).
 //                          Если формат UNKNOWN, функция вернет UNSUPPORTED_FORMAT.
 //
 // @return INVALID_ARGUMENT   Указатели на file_name или !image равны NULL.
 //                            format является неопределенным в структурах форматом.
 // @return UNSUPPORTED_FORMAT Формат изображения UNKNOWN.
-//                            Количество цветовых каналов после загрузки изображения с помощью stbi_load_from_file
+//                            Количество цветовых каналов после загрузки изображения
 //                            Не поддерживается 
 // @return FILE_NOT_FOUND     Файл после открытия равен NULL.
 // @return FILE_READ          Указатель на данные файла равен NULL.
@@ -93,16 +187,15 @@ ImageProcStatus ipl_load_image(const char* file_name, Image* image, const ImageF
         return UNSUPPORTED_FORMAT;
     }
 
-    // Открываем файл в бинарном режиме для чтения для дальнейшей работы с ним с помощью stbi_load_from_file
+    // Открываем файл в бинарном режиме для чтения
     FILE* file = fopen(file_name, "rb");
     if (!file) return FILE_NOT_FOUND;
 
     int width, height, channels;
-    // Загружаем данные с помощью stb_image.
-    // Последний параметр 0 означает, что количество каналов определяется из файла.
-    unsigned char *data = stbi_load_from_file(file, &width, &height, &channels, 0);
+    // Количество каналов определяется из файла
+    unsigned char *data = decode_file(file, &width, &height, &channels);
 
-    // если stbi_load_from_file вернула NULL, произошла ошибка загрузки / декодирования 
+    // если вернулся NULL, произошла ошибка загрузки / декодирования 
     if (!data)
     {   
         fclose(file);
@@ -112,7 +205,7 @@ ImageProcStatus ipl_load_image(const char* file_name, Image* image, const ImageF
     // Проверка на поддерживаемое количество каналов 
     if (channels != 1 && channels != 3 && channels != 4)
     {
-        stbi_image_free(data); // Очищаем память, выделенную stbi_load_from_file, так как формат не подходит 
+        stbi_image_free(data); // Очищаем память декодированного изображения, так как формат не подходит 
         fclose(file);
         return UNSUPPORTED_FORMAT;
     }
@@ -130,28 +223,309 @@ ImageProcStatus ipl_load_image(const char* file_name, Image* image, const ImageF
     return SUCCESS;
 }
 
-// @brief Сохраняет изображение из структуры Image в файл.
-//        Далее свобождает память структуры.
-//        В случае ошибок записи также удаляет поврежденный файл.
+// @brief Декодирует изображение из памяти (содержимого файла PNG или JPEG) в структуру Image.
+//        Аналог ipl_load_image для файлов, прочитанных заранее (например, пакетным вводом-выводом).
 //
-// @param file_name   [in] Строковое значение пути к файлу в который нужно сохранить изображение.
-// @param image       [in] Указатель на структуру изоражения сохраняемого в файл.
-// @param file_format [in] Формат файла.
-//                         При несовпадении формата изображения и формата файла возвращается ошибка.
+// @param data        [in]  Содержимое файла.
+// @param size        [in]  Размер содержимого в байтах.
+// @param image       [out] Изображение (память освобождается free_image_data).
+// @param file_format [in]  Ожидаемый формат (PNG или JPEG).
 //
-// @return INVALID_ARGUMENT   Указатели на file_name, image равны NULL.
-//                            Указатель на image->data равен NULL.
-//                            Формат изображения не соответствует форматам определенным в структуре.
-// @return UNSUPPORTED_FORMAT Формат изображения не поддерживается (UNKNOWN).
-// @return FILE_NOT_FOUND     fopen вернул нулевой указатель.
-// @return FILE_WRITE         Ошибка при записи данных в файл.
-//                            Функция write_to_file_contextual передаваемая в stbi_write записала не все байты.
+// @return INVALID_ARGUMENT   Указатели равны NULL или данные пусты.
+// @return UNSUPPORTED_FORMAT Формат UNKNOWN или неподдерживаемое количество каналов.
+// @return FILE_READ          Данные не удалось декодировать.
+// @return SUCCESS            Изображение декодировано.
+ImageProcStatus ipl_load_image_from_memory(const unsigned char* data, const size_t size, Image* image, const ImageFormat file_format)
+{
+    free_image_data(image);
+
+    if (!data || size == 0 || size > INT_MAX || !image || (file_format != PNG && file_format != JPEG && file_format != UNKNOWN)) return INVALID_ARGUMENT;
+    if (file_format == UNKNOWN) return UNSUPPORTED_FORMAT;
+
+    int width, height, channels;
+    unsigned char* pixels = decode_from_memory(data, (int)size, &width, &height, &channels);
+    if (!pixels) return FILE_READ;
+
+    if (channels != 1 && channels != 3 && channels != 4)
+    {
+        stbi_image_free(pixels);
+        return UNSUPPORTED_FORMAT;
+    }
+
+    image->format = file_format;
+    image->width = (size_t)width;
+    image->height = (size_t)height;
+    image->channels = channels;
+    image->data = pixels;
+
+    return SUCCESS;
+}
+
+// @brief Заполняет Image результатом декодирования ROI (или полного декодирования с вырезанием ROI) или превью.
+static ImageProcStatus finish_roi_image(stbi_uc* pixels, const int width, const int height, const int channels, Image* image, const ImageFormat file_format)
+{
+    if (!pixels) return FILE_READ;
+    if (channels != 1 && channels != 3 && channels != 4)
+    {
+        stbi_image_free(pixels);
+        return UNSUPPORTED_FORMAT;
+    }
+
+    image->format = file_format;
+    image->width = (size_t)width;
+    image->height = (size_t)height;
+    image->channels = channels;
+    image->data = pixels;
+    return SUCCESS;
+}
+
+// @brief Загружает из файла только область интереса (crop-on-load). Для PNG (8 бит, без чересстрочности) распаковка
+//        прекращается после последней строки ROI, фильтры строк восстанавливаются только до ее правой границы;
+//        для baseline JPEG энтропийное декодирование прекращается после последней строки MCU ROI, а обратное DCT
+//        и преобразование цвета выполняются только для MCU ROI. Время и пиковая память растут с размером ROI
+//        и ее положением, а не с размером всего изображения. Остальные файлы декодируются полностью, ROI вырезается.
+//        Результат совпадает с ipl_load_image и последующим вырезанием ROI.
+//
+// @param file_name   [in]  Путь к файлу.
+// @param image       [out] Изображение размером ROI (память освобождается free_image_data).
+// @param file_format [in]  Ожидаемый формат (PNG или JPEG).
+// @param roi         [in]  Область интереса в пикселях изображения; выходящая за границы часть отбрасывается.
+//
+// @return INVALID_ARGUMENT   Указатели равны NULL.
+// @return UNSUPPORTED_FORMAT Формат UNKNOWN или неподдерживаемое количество каналов.
+// @return FILE_NOT_FOUND     Файл не удалось открыть.
+// @return FILE_READ          Файл не удалось декодировать или ROI не пересекается с изображением.
+// @return SUCCESS            ROI загружена.
+ImageProcStatus ipl_load_image_roi(const char* file_name, Image* image, const ImageFormat file_format, const Rect* roi)
+{
+    free_image_data(image);
+
+    if (!file_name || !image || !roi || (file_format != PNG && file_format != JPEG && file_format != UNKNOWN)) return INVALID_ARGUMENT;
+    if (file_format == UNKNOWN) return UNSUPPORTED_FORMAT;
+
+    FILE* file = fopen(file_name, "rb");
+    if (!file) return FILE_NOT_FOUND;
+
+    stbi__context s;
+    stbi__start_file(&s, file);
+
+    stbi_uc* pixels = NULL;
+    int width = 0, height = 0, channels = 0;
+    int result = decode_roi(&s, roi, &pixels, &width, &height, &channels);
+    if (result == DECODE_FALLBACK)
+    {
+        // Потоковый декодер мог прочитать часть файла: полное декодирование начинается с начала
+        fseek(file, 0, SEEK_SET);
+        pixels = stbi_load_from_file(file, &width, &height, &channels, 0);
+        if (pixels) pixels = roi_crop_pixels(pixels, width, height, channels, roi, &width, &height);
+    }
+    fclose(file);
+
+    return finish_roi_image(pixels, width, height, channels, image, file_format);
+}
+
+// @brief Аналог ipl_load_image_roi для содержимого файла в памяти.
+//
+// @param data        [in]  Содержимое файла.
+// @param size        [in]  Размер содержимого в байтах.
+// @param image       [out] Изображение размером ROI.
+// @param file_format [in]  Ожидаемый формат (PNG или JPEG).
+// @param roi         [in]  Область интереса.
+//
+// @return Статусы ipl_load_image_roi; INVALID_ARGUMENT также для пустых данных.
+ImageProcStatus ipl_load_image_roi_from_memory(const unsigned char* data, const size_t size, Image* image, const ImageFormat file_format, const Rect* roi)
+{
+    free_image_data(image);
+
+    if (!data || size == 0 || size > INT_MAX || !image || !roi || (file_format != PNG && file_format != JPEG && file_format != UNKNOWN)) return INVALID_ARGUMENT;
+    if (file_format == UNKNOWN) return UNSUPPORTED_FORMAT;
+
+    stbi__context s;
+    stbi__start_mem(&s, data, (int)size);
+
+    stbi_uc* pixels = NULL;
+    int width = 0, height = 0, channels = 0;
+    int result = decode_roi(&s, roi, &pixels, &width, &height, &channels);
+    if (result == DECODE_FALLBACK)
+    {
+        pixels = stbi_load_from_memory(data, (int)size, &width, &height, &channels, 0);
+        if (pixels) pixels = roi_crop_pixels(pixels, width, height, channels, roi, &width, &height);
+    }
+
+    return finish_roi_image(pixels, width, height, channels, image, file_format);
+}
+
+// @brief Декодирует превью из содержимого файла (см. thumbnail.h): встроенное превью EXIF, иначе baseline JPEG
+//        в масштабе 1/8, иначе полное декодирование и уменьшение в 8 раз.
+static stbi_uc* decode_thumbnail(const stbi_uc* data, const int size, int* width, int* height, int* channels)
+{
+    size_t offset, length;
+    if (exif_find_thumbnail(data, (size_t)size, &offset, &length))
+    {
+        stbi_uc* pixels = decode_from_memory(data + offset, (int)length, width, height, channels);
+        if (pixels) return pixels; // Поврежденное превью заменяется уменьшенным снимком
+    }
+
+    stbi__context s;
+    stbi__start_mem(&s, data, size);
+    if (stbi__jpeg_test(&s))
+    {
+        stbi_uc* pixels = NULL;
+        const int result = jpeg_decode_scaled(&s, &pixels, width, height, channels);
+        if (result == DECODE_DONE) return pixels;
+        if (result == DECODE_FAILED) return NULL;
+    }
+
+    stbi_uc* pixels = decode_from_memory(data, size, width, height, channels);
+    return pixels ? thumbnail_reduce(pixels, *width, *height, *channels, width, height) : NULL;
+}
+
+// @brief Загружает превью изображения для быстрого предпросмотра. Если в JPEG есть превью EXIF (обычно 160x120),
+//        декодируется только оно: из файла читается лишь начало с сегментом APP1. Иначе изображение декодируется
+//        уменьшенным в 8 раз (baseline JPEG - только по коэффициентам DC, без обратного DCT).
+//        Размер результата зависит от источника: превью EXIF или ceil(width / 8) x ceil(height / 8).
+//
+// @param file_name   [in]  Путь к файлу.
+// @param image       [out] Превью (память освобождается free_image_data).
+// @param file_format [in]  Ожидаемый формат (PNG или JPEG).
+//
+// @return INVALID_ARGUMENT   Указатели равны NULL.
+// @return UNSUPPORTED_FORMAT Формат UNKNOWN или неподдерживаемое количество каналов.
+// @return FILE_NOT_FOUND     Файл не удалось открыть.
+// @return FILE_READ          Файл не удалось прочитать или декодировать.
+// @return SUCCESS            Превью загружено.
+ImageProcStatus ipl_load_embedded_thumbnail(const char* file_name, Image* image, const ImageFormat file_format)
+{
+    free_image_data(image);
+
+    if (!file_name || !image || (file_format != PNG && file_format != JPEG && file_format != UNKNOWN)) return INVALID_ARGUMENT;
+    if (file_format == UNKNOWN) return UNSUPPORTED_FORMAT;
+
+    FILE* file = fopen(file_name, "rb");
+    if (!file) return FILE_NOT_FOUND;
+
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+    if (size <= 0 || size > INT_MAX || fseek(file, 0, SEEK_SET) != 0)
+    {
+        fclose(file);
+        return FILE_READ;
+    }
+
+    // Сначала читается только начало файла: если превью EXIF целиком в нем, остальной файл не нужен
+    size_t head = (size_t)size < THUMBNAIL_HEAD_SIZE ? (size_t)size : THUMBNAIL_HEAD_SIZE;
+    stbi_uc* contents = (stbi_uc*)malloc(head);
+    stbi_uc* pixels = NULL;
+    int width = 0, height = 0, channels = 0;
+    size_t offset, length;
+    if (contents && fread(contents, 1, head, file) == head)
+    {
+        if (exif_find_thumbnail(contents, head, &offset, &length))
+            pixels = decode_from_memory(contents + offset, (int)length, &width, &height, &channels);
+        if (!pixels && head < (size_t)size)
+        {
+            stbi_uc* grown = (stbi_uc*)realloc(contents, (size_t)size);
+            if (grown)
+            {
+                contents = grown;
+                if (fread(contents + head, 1, (size_t)size - head, file) == (size_t)size - head) head = (size_t)size;
+            }
+        }
+        if (!pixels && head == (size_t)size) pixels = decode_thumbnail(contents, (int)size, &width, &height, &channels);
+    }
+    free(contents);
+    fclose(file);
+
+    return finish_roi_image(pixels, width, height, channels, image, file_format);
+}
+
+// @brief Аналог ipl_load_embedded_thumbnail для содержимого файла в памяти.
+//
+// @param data        [in]  Содержимое файла.
+// @param size        [in]  Размер содержимого в байтах.
+// @param image       [out] Превью.
+// @param file_format [in]  Ожидаемый формат (PNG или JPEG).
+//
+// @return Статусы ipl_load_embedded_thumbnail; INVALID_ARGUMENT также для пустых данных.
+ImageProcStatus ipl_load_embedded_thumbnail_from_memory(const unsigned char* data, const size_t size, Image* image, const ImageFormat file_format)
+{
+    free_image_data(image);
+
+    if (!data || size == 0 || size > INT_MAX || !image || (file_format != PNG && file_format != JPEG && file_format != UNKNOWN)) return INVALID_ARGUMENT;
+    if (file_format == UNKNOWN) return UNSUPPORTED_FORMAT;
+
+    int width = 0, height = 0, channels = 0;
+    stbi_uc* pixels = decode_thumbnail(data, (int)size, &width, &height, &channels);
+    return finish_roi_image(pixels, width, height, channels, image, file_format);
+}
+
+// @brief Общая часть ipl_encode_image и ipl_encode_image_indexed (colors = 0 - PNG без квантования).
+static ImageProcStatus encode_image(const Image* image, const ImageFormat file_format, const int colors, const int dither, unsigned char** data, size_t* size)
+{
+    if (!image || !image->data || !data || !size || (file_format != PNG && file_format != JPEG && file_format != UNKNOWN)) return INVALID_ARGUMENT;
+    if (file_format == UNKNOWN) return UNSUPPORTED_FORMAT;
+
+    MemoryWriteContext op_ctx = { NULL, 0, 0, 0 };
+    int stb_res;
+    if (file_format == PNG)
+    {
+        stb_res = write_png(image, colors, dither, write_to_memory_contextual, &op_ctx);
+    }
+    else
+    {
+        stb_res = stbi_write_jpg_to_func(write_to_memory_contextual, &op_ctx, image->width, image->height, image->channels,
+                                         image->data, 100);
+    }
+
+    if (op_ctx.io_error || stb_res == 0)
+    {
+        free(op_ctx.data);
+        return op_ctx.io_error ? OUT_OF_MEMORY : INTERNAL;
+    }
+
+    *data = op_ctx.data;
+    *size = op_ctx.size;
+    return SUCCESS;
+}
+
+// @brief Кодирует изображение в память в формате файла (как ipl_save_image, но без записи в файл).
+//        В отличие от ipl_save_image, изображение не освобождается.
+//
+// @param image       [in]  Изображение.
+// @param file_format [in]  Формат (PNG или JPEG).
+// @param data        [out] Закодированные данные (освобождаются free).
+// @param size        [out] Размер данных в байтах.
+//
+// @return INVALID_ARGUMENT   Указатели равны NULL.
+// @return UNSUPPORTED_FORMAT Формат UNKNOWN.
+// @return OUT_OF_MEMORY      Не удалось выделить буфер.
 // @return INTERNAL           Внутренняя ошибка в stbi_write.
-//                            Может возникать если формат изображения image не совпадает с форматом файла.
-// @return SUCCESS            Изображение успешно сохранено в файл, память освобождена.
+// @return SUCCESS            Изображение закодировано.
+ImageProcStatus ipl_encode_image(const Image* image, const ImageFormat file_format, unsigned char** data, size_t* size)
+{
+    return encode_image(image, file_format, 0, 0, data, size);
+}
+
+// @brief Кодирует изображение в память в PNG с палитрой (как ipl_save_image_indexed, но без записи в файл).
 //
-// @note В случае любой ошибки (кроме INVALID_ARGUMENT и UNSUPPORTED_FORMAT) потенциально поврежденный файл будет удален 
-ImageProcStatus ipl_save_image(const char* file_name, Image* image, const ImageFormat file_format)
+// @param image  [in]  Изображение (1, 3 или 4 канала).
+// @param colors [in]  Наибольшее число записей палитры, от 2 до 256.
+// @param dither [in]  1 - диффузия ошибки при квантовании, 0 - ближайший цвет.
+// @param data   [out] Закодированные данные (освобождаются free).
+// @param size   [out] Размер данных в байтах.
+//
+// @return INVALID_ARGUMENT Указатели равны NULL, colors вне диапазона.
+// @return OUT_OF_MEMORY    Не удалось выделить буфер.
+// @return INTERNAL         Ошибка кодирования.
+// @return SUCCESS          Изображение закодировано.
+ImageProcStatus ipl_encode_image_indexed(const Image* image, const int colors, const int dither, unsigned char** data, size_t* size)
+{
+    if (colors < 2 || colors > 256) return INVALID_ARGUMENT;
+    return encode_image(image, PNG, colors, dither, data, size);
+}
+
+// @brief Общая часть ipl_save_image и ipl_save_image_indexed (colors = 0 - PNG без квантования).
+static ImageProcStatus save_image(const char* file_name, Image* image, const ImageFormat file_format, const int colors, const int dither)
 {
     if (!file_name || !image || !image->data || (file_format != PNG && file_format != JPEG && file_format != UNKNOWN)) return INVALID_ARGUMENT;
 
@@ -181,15 +555,7 @@ ImageProcStatus ipl_save_image(const char* file_name, Image* image, const ImageF
 
     if (file_format == PNG)
     {
-        stb_res = stbi_write_png_to_func(
-            write_to_file_contextual, 
-            &op_ctx, 
-            image->width, 
-            image->height, 
-            image->channels, 
-            image->data, 
-            image->width * image->channels // Шаг строки в байтах
-        );                                               // Указывает на количество байт между началом одной строки пиксельных данных и началом следующей строки в памяти
+        stb_res = write_png(image, colors, dither, write_to_file_contextual, &op_ctx);
     }
     ////////////////////////////////////////////////////////////////////////////////////
     // В stb JPEG имеет 3 канала, возможные некорректные записи в файл при GRAYSCALE. //
@@ -234,4 +600,51 @@ ImageProcStatus ipl_save_image(const char* file_name, Image* image, const ImageF
     free_image_data(image);
 
     return SUCCESS;
+}
+
+// @brief Сохраняет изображение из структуры Image в файл.
+//        Далее свобождает память структуры.
+//        В случае ошибок записи также удаляет поврежденный файл.
+//
+// @param file_name   [in] Строковое значение пути к файлу в который нужно сохранить изображение.
+// @param image       [in] Указатель на структуру изоражения сохраняемого в файл.
+// @param file_format [in] Формат файла.
+//                         При несовпадении формата изображения и формата файла возвращается ошибка.
+//
+// @return INVALID_ARGUMENT   Указатели на file_name, image равны NULL.
+//                            Указатель на image->data равен NULL.
+//                            Формат изображения не соответствует форматам определенным в структуре.
+// @return UNSUPPORTED_FORMAT Формат изображения не поддерживается (UNKNOWN).
+// @return FILE_NOT_FOUND     fopen вернул нулевой указатель.
+// @return FILE_WRITE         Ошибка при записи данных в файл.
+//                            Функция write_to_file_contextual передаваемая в stbi_write записала не все байты.
+// @return INTERNAL           Внутренняя ошибка в stbi_write.
+//                            Может возникать если формат изображения image не совпадает с форматом файла.
+// @return SUCCESS            Изображение успешно сохранено в файл, память освобождена.
+//
+// @note В случае любой ошибки (кроме INVALID_ARGUMENT и UNSUPPORTED_FORMAT) потенциально поврежденный файл будет удален 
+ImageProcStatus ipl_save_image(const char* file_name, Image* image, const ImageFormat file_format)
+{
+    return save_image(file_name, image, file_format, 0, 0);
+}
+
+// @brief Сохраняет изображение в PNG с палитрой не больше colors записей и освобождает память структуры.
+//        Если в изображении не больше colors цветов, палитра точная, иначе цвета квантуются медианным сечением
+//        (с диффузией ошибки при dither). Серое изображение остается серым и квантуется к 2, 4 или 16 уровням.
+//        Индексы упаковываются по 1, 2 или 4 бита, если хватает записей палитры.
+//
+// @param file_name [in] Путь к файлу.
+// @param image     [in] Изображение (1, 3 или 4 канала).
+// @param colors    [in] Наибольшее число записей палитры, от 2 до 256.
+// @param dither    [in] 1 - диффузия ошибки Флойда-Стейнберга, 0 - ближайший цвет палитры.
+//
+// @return INVALID_ARGUMENT Указатели равны NULL, colors вне диапазона.
+// @return FILE_NOT_FOUND   fopen вернул нулевой указатель.
+// @return FILE_WRITE       Ошибка при записи данных в файл.
+// @return INTERNAL         Ошибка кодирования (в том числе нехватка памяти).
+// @return SUCCESS          Изображение сохранено, память освобождена.
+ImageProcStatus ipl_save_image_indexed(const char* file_name, Image* image, const int colors, const int dither)
+{
+    if (colors < 2 || colors > 256) return INVALID_ARGUMENT;
+    return save_image(file_name, image, PNG, colors, dither);
 }
\ No newline at end of file
@@ -0,0 +1,524 @@
+#ifndef JPEG_DECODER_H
+#define JPEG_DECODER_H
+
+// Декодер baseline JPEG поверх внутренних функций stb_image (заголовки, таблицы Хаффмана, передискретизация).
+// Включается только в input_output.c после реализации stb_image.
+//
+// Декодирование разделено на этапы:
+//   1. Энтропийное декодирование (Хаффман) в коэффициенты после деквантования. Если в файле есть маркеры
+//      перезапуска, сегменты между ними декодируются параллельно; иначе декодирование последовательное,
+//      но полосами строк MCU, и пока декодируется следующая полоса, предыдущая уже обрабатывается этапом 2.
+//   2. Обратное DCT (ядро idct_row из таблицы SIMD, AVX2 - два блока за раз) параллельно по строкам MCU.
+//   3. Передискретизация цветности и преобразование YCbCr -> RGB (ядро ycbcr_to_rgb) параллельно по полосам строк.
+// Арифметика всех этапов совпадает с stb_image, поэтому результат побитово совпадает с stbi_load.
+//
+// Progressive JPEG и файлы, компоненты которых закодированы в разных сканах, возвращают DECODE_FALLBACK:
+// их декодирует stb_image.
+
+#include <string.h>
+#include <omp.h>
+#include "context.h"
+
+// Результат декодирования
+#define DECODE_FAILED   0  // Ошибка декодирования (причина в stbi_failure_reason)
+#define DECODE_DONE     1  // Изображение декодировано
+#define DECODE_FALLBACK 2  // Файл не поддерживается этим декодером
+
+// Высота полосы (в строках MCU) при последовательном энтропийном декодировании
+#define JPEG_BAND_ROWS 8
+// Высота полосы (в строках пикселей) при передискретизации и преобразовании цвета
+#define JPEG_CONVERT_ROWS 32
+
+// @brief Создает декодер stb_image для контекста.
+static stbi__jpeg* jpeg_create(stbi__context* s)
+{
+    stbi__jpeg* z = (stbi__jpeg*)stbi__malloc(sizeof(stbi__jpeg));
+    if (!z)
+    {
+        stbi__err("outofmem", "Out of memory");
+        return NULL;
+    }
+    memset(z, 0, sizeof(stbi__jpeg));
+    z->s = s;
+    stbi__setup_jpeg(z);
+    s->img_n = 0; // Для безопасного stbi__cleanup_jpeg до разбора заголовка
+    return z;
+}
+
+// @brief Освобождает декодер вместе с плоскостями компонент.
+static void jpeg_destroy(stbi__jpeg* z)
+{
+    if (!z) return;
+    stbi__cleanup_jpeg(z);
+    STBI_FREE(z);
+}
+
+// @brief Разбирает заголовок кадра и вычисляет геометрию MCU (как stbi__process_frame_header,
+//        но без выделения плоскостей). Единственная компонента кодируется без чередования блоками 8x8
+//        независимо от заявленной дискретизации, поэтому ее MCU считается блоком 8x8.
+static int jpeg_read_frame(stbi__jpeg* z)
+{
+    stbi__context* s = z->s;
+    for (int m = 0; m < 4; m++)
+    {
+        z->img_comp[m].raw_data = NULL;
+        z->img_comp[m].raw_coeff = NULL;
+        z->img_comp[m].linebuf = NULL;
+    }
+    z->restart_interval = 0;
+
+    if (!stbi__decode_jpeg_header(z, STBI__SCAN_header)) return DECODE_FAILED;
+    if (z->progressive) return DECODE_FALLBACK;
+
+    int h_max = 1, v_max = 1;
+    if (s->img_n == 1)
+    {
+        z->img_comp[0].h = z->img_comp[0].v = 1;
+    }
+    for (int i = 0; i < s->img_n; i++)
+    {
+        if (z->img_comp[i].h > h_max) h_max = z->img_comp[i].h;
+        if (z->img_comp[i].v > v_max) v_max = z->img_comp[i].v;
+    }
+    for (int i = 0; i < s->img_n; i++)
+    {
+        if (h_max % z->img_comp[i].h != 0) return stbi__err("bad H", "Corrupt JPEG");
+        if (v_max % z->img_comp[i].v != 0) return stbi__err("bad V", "Corrupt JPEG");
+    }
+    z->img_h_max = h_max;
+    z->img_v_max = v_max;
+    z->img_mcu_w = h_max * 8;
+    z->img_mcu_h = v_max * 8;
+    z->img_mcu_x = (s->img_x + z->img_mcu_w - 1) / z->img_mcu_w;
+    z->img_mcu_y = (s->img_y + z->img_mcu_h - 1) / z->img_mcu_h;
+    return DECODE_DONE;
+}
+
+// @brief Выделяет плоскости компонент для окна MCU [mx0, mx1) x [my0, my1) и задает размеры изображения
+//        равными размерам окна: дальнейшая обработка видит окно как самостоятельное изображение.
+static int jpeg_alloc_planes(stbi__jpeg* z, const int mx0, const int my0, const int mx1, const int my1)
+{
+    stbi__context* s = z->s;
+    for (int i = 0; i < s->img_n; i++)
+    {
+        z->img_comp[i].w2 = (mx1 - mx0) * z->img_comp[i].h * 8;
+        z->img_comp[i].h2 = (my1 - my0) * z->img_comp[i].v * 8;
+        z->img_comp[i].raw_data = stbi__malloc_mad2(z->img_comp[i].w2, z->img_comp[i].h2, 15);
+        if (!z->img_comp[i].raw_data) return stbi__err("outofmem", "Out of memory");
+        z->img_comp[i].data = (stbi_uc*)(((size_t)z->img_comp[i].raw_data + 15) & ~15);
+    }
+    return 1;
+}
+
+// @brief Задает размеры окна [x0, x1) x [y0, y1) пикселей (границы x0, y0 - на границе MCU) как размеры изображения.
+static void jpeg_set_window(stbi__jpeg* z, const size_t x0, const size_t y0, const size_t x1, const size_t y1)
+{
+    stbi__context* s = z->s;
+    s->img_x = (stbi__uint32)(x1 - x0);
+    s->img_y = (stbi__uint32)(y1 - y0);
+    for (int i = 0; i < s->img_n; i++)
+    {
+        z->img_comp[i].x = (s->img_x * z->img_comp[i].h + z->img_h_max - 1) / z->img_h_max;
+        z->img_comp[i].y = (s->img_y * z->img_comp[i].v + z->img_v_max - 1) / z->img_v_max;
+    }
+}
+
+// @brief Обрабатывает маркеры до начала скана и разбирает его заголовок.
+//        Поддерживается только скан, содержащий все компоненты.
+static int jpeg_read_scan(stbi__jpeg* z)
+{
+    int m = stbi__get_marker(z);
+    while (!stbi__SOS(m))
+    {
+        if (stbi__EOI(m)) return stbi__err("no SOS", "Corrupt JPEG");
+        if (!stbi__process_marker(z, m)) return DECODE_FAILED;
+        m = stbi__get_marker(z);
+    }
+    if (!stbi__process_scan_header(z)) return DECODE_FAILED;
+    return z->scan_n == z->s->img_n ? DECODE_DONE : DECODE_FALLBACK;
+}
+
+// @brief Количество блоков 8x8 в MCU.
+static size_t jpeg_blocks_per_mcu(const stbi__jpeg* z)
+{
+    size_t blocks = 0;
+    for (int k = 0; k < z->scan_n; k++) blocks += (size_t)z->img_comp[z->order[k]].h * z->img_comp[z->order[k]].v;
+    return blocks;
+}
+
+// @brief Декодирует блоки следующего MCU в coefficients: компоненты в порядке скана, блоки компоненты построчно.
+static int jpeg_decode_mcu(stbi__jpeg* z, short* coefficients)
+{
+    for (int k = 0; k < z->scan_n; k++)
+    {
+        const int n = z->order[k];
+        const int ha = z->img_comp[n].ha;
+        const int blocks = z->img_comp[n].h * z->img_comp[n].v;
+        for (int b = 0; b < blocks; b++, coefficients += 64)
+        {
+            if (!stbi__jpeg_decode_block(z, coefficients, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+        }
+    }
+    return 1;
+}
+
+// @brief Отсчитывает интервал перезапуска после MCU (как stbi__parse_entropy_coded_data).
+//
+// @return 0, если вместо маркера перезапуска встретились другие данные: как и stb_image,
+//         декодер не считает это ошибкой, а оставшиеся MCU не декодируются.
+static int jpeg_next_mcu(stbi__jpeg* z)
+{
+    if (--z->todo > 0) return 1;
+    if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
+    if (!STBI__RESTART(z->marker)) return 0;
+    stbi__jpeg_reset(z);
+    return 1;
+}
+
+// @brief Обратное DCT блоков MCU (в порядке jpeg_decode_mcu) в плоскости компонент. MCU (mx, my) - в координатах окна плоскостей.
+static void jpeg_idct_mcu(const stbi__jpeg* z, const short* coefficients, const int mx, const int my, const IdctRowFn idct_row)
+{
+    for (int k = 0; k < z->scan_n; k++)
+    {
+        const int n = z->order[k];
+        const int h = z->img_comp[n].h;
+        const int w2 = z->img_comp[n].w2;
+        for (int y = 0; y < z->img_comp[n].v; y++, coefficients += 64 * h)
+        {
+            idct_row(coefficients, z->img_comp[n].data + (size_t)w2 * ((my * z->img_comp[n].v + y) * 8) + mx * h * 8, w2, (size_t)h);
+        }
+    }
+}
+
+// @brief Последовательно декодирует строки MCU [row0, row1) в coefficients. После остановки по отсутствующему
+//        маркеру перезапуска (stopped) коэффициенты оставшихся MCU заполняются нулями.
+static int jpeg_decode_rows(stbi__jpeg* z, const int row0, const int row1, short* coefficients, int* stopped)
+{
+    const size_t mcu_size = jpeg_blocks_per_mcu(z) * 64;
+    for (int j = row0; j < row1; j++)
+    {
+        for (int i = 0; i < z->img_mcu_x; i++, coefficients += mcu_size)
+        {
+            if (*stopped)
+            {
+                memset(coefficients, 0, mcu_size * sizeof(short));
+                continue;
+            }
+            if (!jpeg_decode_mcu(z, coefficients)) return 0;
+            if (!jpeg_next_mcu(z)) *stopped = 1;
+        }
+    }
+    return 1;
+}
+
+// @brief Энтропийное декодирование без маркеров перезапуска: одна задача последовательно декодирует полосы
+//        строк MCU в два чередующихся буфера, а задачи обратного DCT обрабатывают строки уже декодированных полос.
+//        Зависимости задач: декодирование полосы ждет предыдущую полосу (состояние декодера z) и окончания
+//        обратного DCT полосы, ранее занимавшей тот же буфер.
+static int jpeg_entropy_pipelined(stbi__jpeg* z, const IdctRowFn idct_row, const int parallel)
+{
+    const size_t row_size = (size_t)z->img_mcu_x * jpeg_blocks_per_mcu(z) * 64;
+    const size_t band_size = row_size * JPEG_BAND_ROWS;
+    short* buffers = (short*)stbi__malloc(2 * band_size * sizeof(short));
+    if (!buffers) return stbi__err("outofmem", "Out of memory");
+
+    const int bands = (z->img_mcu_y + JPEG_BAND_ROWS - 1) / JPEG_BAND_ROWS;
+    int failed = 0, stopped = 0;
+    stbi__jpeg_reset(z);
+
+    #pragma omp parallel if (parallel)
+    #pragma omp single
+    for (int band = 0; band < bands; band++)
+    {
+        const int row0 = band * JPEG_BAND_ROWS;
+        const int row1 = row0 + JPEG_BAND_ROWS < z->img_mcu_y ? row0 + JPEG_BAND_ROWS : z->img_mcu_y;
+        short* buffer = buffers + (band & 1) * band_size;
+
+        #pragma omp task depend(inout: z[0]) depend(out: buffer[0]) shared(failed, stopped)
+        {
+            if (!failed && !jpeg_decode_rows(z, row0, row1, buffer, &stopped)) failed = 1;
+        }
+
+        for (int row = row0; row < row1; row++)
+        {
+            #pragma omp task depend(in: buffer[0]) shared(failed)
+            {
+                const short* coefficients = buffer + (size_t)(row - row0) * row_size;
+                const size_t mcu_size = row_size / z->img_mcu_x;
+                for (int i = 0; i < z->img_mcu_x && !failed; i++) jpeg_idct_mcu(z, coefficients + i * mcu_size, i, row, idct_row);
+            }
+        }
+    }
+
+    STBI_FREE(buffers);
+    return failed ? stbi__err("bad huffman code", "Corrupt JPEG") : DECODE_DONE;
+}
+
+// @brief Энтропийное декодирование сегментов между маркерами перезапуска параллельно: каждый сегмент начинается
+//        со сброшенного предсказания DC, поэтому декодируется независимо копией декодера. Требует данных в памяти.
+//
+// @return DECODE_FALLBACK, если маркеров перезапуска меньше, чем должно быть (поврежденный или обрезанный файл):
+//         такой поток декодируется последовательно, как в stb_image.
+static int jpeg_entropy_segments(stbi__jpeg* z, const IdctRowFn idct_row)
+{
+    stbi__context* s = z->s;
+    const size_t total = (size_t)z->img_mcu_x * z->img_mcu_y;
+    const size_t interval = (size_t)z->restart_interval;
+    const size_t count = (total + interval - 1) / interval;
+    if (s->read_from_callbacks || count < 2) return DECODE_FALLBACK;
+
+    const stbi_uc** bounds = (const stbi_uc**)stbi__malloc((2 * count) * sizeof(stbi_uc*));
+    if (!bounds) return stbi__err("outofmem", "Out of memory");
+
+    // Поиск маркеров RSTn: 0xFF 0x00 - байт данных, 0xFF 0xFF - заполнение, любой другой маркер завершает скан
+    const stbi_uc* p = s->img_buffer;
+    const stbi_uc* end = s->img_buffer_end;
+    size_t found = 0;
+    bounds[0] = p;
+    while (p + 1 < end)
+    {
+        p = (const stbi_uc*)memchr(p, 0xff, (size_t)(end - p));
+        if (!p || p + 1 >= end) break;
+        if (p[1] == 0x00) p += 2;
+        else if (p[1] == 0xff) p += 1;
+        else if (STBI__RESTART(p[1]) && found + 1 < count)
+        {
+            bounds[2 * found + 1] = p;
+            bounds[2 * (++found)] = p + 2;
+            p += 2;
+        }
+        else break;
+    }
+    bounds[2 * found + 1] = p && p < end ? p : end;
+    if (found + 1 != count)
+    {
+        STBI_FREE(bounds);
+        return DECODE_FALLBACK;
+    }
+
+    const size_t mcu_size = jpeg_blocks_per_mcu(z) * 64;
+    int failed = 0;
+
+    #pragma omp parallel
+    {
+        stbi__jpeg* decoder = (stbi__jpeg*)stbi__malloc(sizeof(stbi__jpeg));
+        short* coefficients = (short*)stbi__malloc_mad2((int)interval, (int)(mcu_size * sizeof(short)), 0);
+        stbi__context segment;
+        if (decoder) memcpy(decoder, z, sizeof(stbi__jpeg));
+
+        #pragma omp for schedule(dynamic)
+        for (ptrdiff_t k = 0; k < (ptrdiff_t)count; k++)
+        {
+            int stop;
+            #pragma omp atomic read
+            stop = failed;
+            if (stop) continue;
+            if (!decoder || !coefficients)
+            {
+                #pragma omp atomic write
+                failed = 1;
+                continue;
+            }
+
+            stbi__start_mem(&segment, bounds[2 * k], (int)(bounds[2 * k + 1] - bounds[2 * k]));
+            decoder->s = &segment;
+            stbi__jpeg_reset(decoder);
+
+            const size_t m0 = (size_t)k * interval;
+            const size_t m1 = m0 + interval < total ? m0 + interval : total;
+            for (size_t m = m0; m < m1; m++)
+            {
+                if (!jpeg_decode_mcu(decoder, coefficients + (m - m0) * mcu_size))
+                {
+                    #pragma omp atomic write
+                    failed = 1;
+                    break;
+                }
+            }
+            if (failed) continue;
+            for (size_t m = m0; m < m1; m++)
+            {
+                jpeg_idct_mcu(z, coefficients + (m - m0) * mcu_size, (int)(m % z->img_mcu_x), (int)(m / z->img_mcu_x), idct_row);
+            }
+        }
+
+        STBI_FREE(decoder);
+        STBI_FREE(coefficients);
+    }
+
+    STBI_FREE(bounds);
+    return failed ? stbi__err("bad huffman code", "Corrupt JPEG") : DECODE_DONE;
+}
+
+// @brief Настраивает передискретизацию компонент до полного разрешения (как load_jpeg_image). Указатели строк
+//        не задаются: их выставляет jpeg_convert_rows для своей полосы.
+static void jpeg_setup_resample(stbi__jpeg* z, stbi__resample* res)
+{
+    for (int k = 0; k < z->s->img_n; k++)
+    {
+        stbi__resample* r = &res[k];
+        r->hs = z->img_h_max / z->img_comp[k].h;
+        r->vs = z->img_v_max / z->img_comp[k].v;
+        r->ystep = r->vs >> 1;
+        r->w_lores = (z->s->img_x + r->hs - 1) / r->hs;
+        r->ypos = 0;
+        r->line0 = r->line1 = z->img_comp[k].data;
+
+        if (r->hs == 1 && r->vs == 1) r->resample = resample_row_1;
+        else if (r->hs == 1 && r->vs == 2) r->resample = stbi__resample_row_v_2;
+        else if (r->hs == 2 && r->vs == 1) r->resample = stbi__resample_row_h_2;
+        else if (r->hs == 2 && r->vs == 2) r->resample = z->resample_row_hv_2_kernel;
+        else r->resample = stbi__resample_row_generic;
+    }
+}
+
+// @brief Передискретизирует и преобразует в RGB (n = 3) или серый (n = 1) строки [row0, row1) и столбцы [col0, col1)
+//        (вторая половина load_jpeg_image). Состояние передискретизации для row0 вычисляется проходом по строкам выше
+//        без передискретизации, поэтому полосы обрабатываются независимо.
+//
+// @param linebuf [in] Рабочий буфер img_n * (img_x + 3) байт.
+static void jpeg_convert_rows(stbi__jpeg* z, const stbi__resample* templ, const int n, const size_t row0, const size_t row1,
+                              const size_t col0, const size_t col1, stbi_uc* output, const size_t stride, stbi_uc* linebuf)
+{
+    const int img_n = z->s->img_n;
+    const int is_rgb = img_n == 3 && (z->rgb == 3 || (z->app14_color_transform == 0 && !z->jfif));
+    const YCbCrToRgbFn ycbcr_to_rgb = ipl_get_context()->kernels.ycbcr_to_rgb;
+    const size_t count = col1 - col0;
+    stbi__resample res[4];
+    stbi_uc* coutput[4] = { NULL, NULL, NULL, NULL };
+    memcpy(res, templ, img_n * sizeof(stbi__resample));
+
+    for (size_t j = 0; j < row1; j++)
+    {
+        for (int k = 0; k < img_n; k++)
+        {
+            stbi__resample* r = &res[k];
+            if (j >= row0)
+            {
+                int y_bot = r->ystep >= (r->vs >> 1);
+                coutput[k] = r->resample(linebuf + k * (z->s->img_x + 3), y_bot ? r->line1 : r->line0, y_bot ? r->line0 : r->line1, r->w_lores, r->hs);
+            }
+            if (++r->ystep >= r->vs)
+            {
+                r->ystep = 0;
+                r->line0 = r->line1;
+                if (++r->ypos < z->img_comp[k].y) r->line1 += z->img_comp[k].w2;
+            }
+        }
+        if (j < row0) continue;
+
+        stbi_uc* out = output + (j - row0) * stride;
+        if (n == 1)
+        {
+            memcpy(out, coutput[0] + col0, count);
+        }
+        else if (is_rgb)
+        {
+            for (size_t i = col0; i < col1; i++, out += 3)
+            {
+                out[0] = coutput[0][i];
+                out[1] = coutput[1][i];
+                out[2] = coutput[2][i];
+            }
+        }
+        else if (img_n == 4 && z->app14_color_transform == 0) // CMYK
+        {
+            for (size_t i = col0; i < col1; i++, out += 3)
+            {
+                stbi_uc m = coutput[3][i];
+                out[0] = stbi__blinn_8x8(coutput[0][i], m);
+                out[1] = stbi__blinn_8x8(coutput[1][i], m);
+                out[2] = stbi__blinn_8x8(coutput[2][i], m);
+            }
+        }
+        else
+        {
+            ycbcr_to_rgb(out, coutput[0] + col0, coutput[1] + col0, coutput[2] + col0, count);
+            if (img_n == 4 && z->app14_color_transform == 2) // YCCK
+            {
+                for (size_t i = col0; i < col1; i++, out += 3)
+                {
+                    stbi_uc m = coutput[3][i];
+                    out[0] = stbi__blinn_8x8(255 - out[0], m);
+                    out[1] = stbi__blinn_8x8(255 - out[1], m);
+                    out[2] = stbi__blinn_8x8(255 - out[2], m);
+                }
+            }
+        }
+    }
+}
+
+// @brief Декодирует изображение baseline JPEG (см. описание файла).
+static int jpeg_decode_image(stbi__jpeg* z, stbi_uc** pixels, int* width, int* height, int* channels)
+{
+    stbi__context* s = z->s;
+    int result = jpeg_read_frame(z);
+    if (result != DECODE_DONE) return result;
+    if (!stbi__mad3sizes_valid(s->img_x, s->img_y, s->img_n, 0)) return stbi__err("too large", "Image too large to decode");
+    if (!jpeg_alloc_planes(z, 0, 0, z->img_mcu_x, z->img_mcu_y)) return DECODE_FAILED;
+    jpeg_set_window(z, 0, 0, s->img_x, s->img_y);
+
+    result = jpeg_read_scan(z);
+    if (result != DECODE_DONE) return result;
+
+    const LibraryContext* context = ipl_get_context();
+    const int parallel = (size_t)s->img_x * s->img_y >= context->profile.parallel_min_pixels;
+    result = z->restart_interval && parallel ? jpeg_entropy_segments(z, context->kernels.idct_row) : DECODE_FALLBACK;
+    if (result == DECODE_FALLBACK) result = jpeg_entropy_pipelined(z, context->kernels.idct_row, parallel);
+    if (result != DECODE_DONE) return result;
+
+    // Преобразование цвета stb_image записывает байт после последнего пикселя (как и в load_jpeg_image)
+    const int n = s->img_n >= 3 ? 3 : 1;
+    stbi_uc* output = (stbi_uc*)stbi__malloc_mad3(n, s->img_x, s->img_y, 1);
+    if (!output) return stbi__err("outofmem", "Out of memory");
+
+    stbi__resample res[4];
+    jpeg_setup_resample(z, res);
+    const ptrdiff_t bands = (ptrdiff_t)((s->img_y + JPEG_CONVERT_ROWS - 1) / JPEG_CONVERT_ROWS);
+    const size_t stride = (size_t)n * s->img_x;
+    int failed = 0;
+
+    #pragma omp parallel if (parallel)
+    {
+        stbi_uc* linebuf = (stbi_uc*)stbi__malloc_mad2(s->img_n, s->img_x + 3, 0);
+
+        #pragma omp for schedule(static)
+        for (ptrdiff_t band = 0; band < bands; band++)
+        {
+            if (!linebuf)
+            {
+                #pragma omp atomic write
+                failed = 1;
+                continue;
+            }
+            size_t row0 = (size_t)band * JPEG_CONVERT_ROWS;
+            size_t row1 = row0 + JPEG_CONVERT_ROWS < s->img_y ? row0 + JPEG_CONVERT_ROWS : s->img_y;
+            jpeg_convert_rows(z, res, n, row0, row1, 0, s->img_x, output + row0 * stride, stride, linebuf);
+        }
+
+        STBI_FREE(linebuf);
+    }
+    if (failed)
+    {
+        STBI_FREE(output);
+        return stbi__err("outofmem", "Out of memory");
+    }
+
+    *pixels = output;
+    *width = (int)s->img_x;
+    *height = (int)s->img_y;
+    *channels = n;
+    return DECODE_DONE;
+}
+
+// @brief Декодирует JPEG из контекста stb_image параллельным декодером.
+static int jpeg_decode(stbi__context* s, stbi_uc** pixels, int* width, int* height, int* channels)
+{
+    stbi__jpeg* z = jpeg_create(s);
+    if (!z) return DECODE_FAILED;
+    int result = jpeg_decode_image(z, pixels, width, height, channels);
+    jpeg_destroy(z);
+    return result;
+}
+
+#endif
@@ -0,0 +1,154 @@
+#include "descriptors.h"
+#include "context.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <omp.h>
+
+#define LBP_BAND_ROWS 64 // Строк в полосе одного потока, если гистограммы не нужны
+
+// @brief Рабочие буферы одного потока.
+typedef struct
+{
+    unsigned char* rows;  // 3 строки яркости по (width + 2) байтов: крайние пиксели повторены слева и справа
+    unsigned char* raw;   // width: метки строки, если codes не задан
+    uint32_t* counts;     // cells_x * IPL_LBP_BINS: количество меток в ячейках текущей строки ячеек
+} LbpBuffers;
+
+// @brief Строка яркости y (крайние строки повторяются) в padded[1 .. width], крайние пиксели - в padded[0] и padded[width + 1].
+static void lbp_gray_row(const Image* image, ptrdiff_t y, unsigned char* padded)
+{
+    size_t width = image->width;
+    if (y < 0) y = 0;
+    else if (y >= (ptrdiff_t)image->height) y = (ptrdiff_t)image->height - 1;
+
+    const unsigned char* src = image->data + (size_t)y * width * image->channels;
+    if (image->channels == 1) memcpy(padded + 1, src, width);
+    else convert_to_one_channel(src, padded + 1, width, 1, image->channels);
+    padded[0] = padded[1];
+    padded[width + 1] = padded[width];
+}
+
+// @brief Метки строк [row_begin, row_end) в codes (если не NULL) и, если counts не NULL, их количество в ячейках.
+//        Строки яркости хранятся в кольце из 3-х строк, поэтому каждая строка переводится в яркость один раз.
+static void lbp_band(const Image* image, const size_t row_begin, const size_t row_end,
+                     unsigned char* codes, const size_t cell_size, const size_t cells_x, LbpBuffers* buf, uint32_t* counts)
+{
+    size_t width = image->width;
+    size_t ld = width + 2;
+    LbpRowFn lbp_row = ipl_get_context()->kernels.lbp_row;
+
+    // Слот кольца строки y: (y + 1) % 3, строка -1 тоже получает слот
+    lbp_gray_row(image, (ptrdiff_t)row_begin - 1, buf->rows + (row_begin % 3) * ld);
+    lbp_gray_row(image, (ptrdiff_t)row_begin, buf->rows + ((row_begin + 1) % 3) * ld);
+
+    for (size_t y = row_begin; y < row_end; y++)
+    {
+        lbp_gray_row(image, (ptrdiff_t)y + 1, buf->rows + ((y + 2) % 3) * ld);
+        const unsigned char* above = buf->rows + (y % 3) * ld + 1;
+        const unsigned char* row = buf->rows + ((y + 1) % 3) * ld + 1;
+        const unsigned char* below = buf->rows + ((y + 2) % 3) * ld + 1;
+
+        unsigned char* out = codes ? codes + y * width : buf->raw;
+        lbp_row(above, row, below, out, width);
+
+        if (!counts) continue;
+        for (size_t cx = 0; cx < cells_x; cx++)
+        {
+            uint32_t* cell = counts + cx * IPL_LBP_BINS;
+            for (size_t x = cx * cell_size; x < (cx + 1) * cell_size; x++) cell[out[x]]++;
+        }
+    }
+}
+
+// @brief Размер массива гистограмм ipl_lbp (количество float).
+//
+// @param width     [in] Ширина изображения в пикселях.
+// @param height    [in] Высота изображения в пикселях.
+// @param cell_size [in] Сторона ячейки в пикселях.
+// @return cells_x * cells_y * IPL_LBP_BINS или 0, если cell_size < 1 или в изображение не помещается ни одна ячейка.
+size_t ipl_lbp_histogram_size(const size_t width, const size_t height, const int cell_size)
+{
+    if (cell_size < 1) return 0;
+    return (width / (size_t)cell_size) * (height / (size_t)cell_size) * IPL_LBP_BINS;
+}
+
+// @brief Вычисляет равномерный LBP (8 соседей, радиус 1) по яркости изображения. Код пикселя - 8 бит сравнений
+//        соседей с центром (сосед не меньше центра), равномерные коды переводятся в метки 0..57, остальные -
+//        в метку 58 (IPL_LBP_BINS - 1), порядок меток описан у LbpRowFn. Сравнения и перевод в метки выполняются
+//        векторно (ядро lbp_row таблицы SIMD: 32 пикселя на инструкцию AVX2), крайние строки и столбцы
+//        изображения повторяются. Вместе с метками можно сразу
+//        получить нормированные гистограммы меток ячеек cell_size x cell_size (неполные ячейки справа и снизу
+//        отбрасываются), не проходя изображение меток второй раз. Полосы строк обрабатываются параллельно.
+//
+// @param image      [in]  Изображение из 1, 3 или 4 каналов.
+// @param codes      [out] Метки пикселей (width * height байтов) или NULL, если нужны только гистограммы.
+// @param cell_size  [in]  Сторона ячейки в пикселях (используется только с histograms).
+// @param histograms [out] Гистограммы ячеек по строкам ячеек, по IPL_LBP_BINS значений с суммой 1
+//                         (ipl_lbp_histogram_size значений), или NULL.
+//
+// @return INVALID_ARGUMENT Невалидный аргумент.
+//                          Если `image` или `image->data` равен NULL, оба выхода равны NULL
+//                          или для гистограмм в изображение не помещается ни одна ячейка.
+// @return OUT_OF_MEMORY    Не удалось выделить память для буферов потоков.
+// @return SUCCESS          Метки и гистограммы вычислены.
+ImageProcStatus ipl_lbp(const Image* image, unsigned char* codes, const int cell_size, float* histograms)
+{
+    if (!image || !image->data || image->width == 0 || image->height == 0) return INVALID_ARGUMENT;
+    if (image->channels != 1 && image->channels != 3 && image->channels != 4) return INVALID_ARGUMENT;
+    if (!codes && !histograms) return INVALID_ARGUMENT;
+    if (histograms && ipl_lbp_histogram_size(image->width, image->height, cell_size) == 0) return INVALID_ARGUMENT;
+
+    size_t width = image->width;
+    size_t height = image->height;
+    size_t cs = histograms ? (size_t)cell_size : 0;
+    size_t cells_x = histograms ? width / cs : 0;
+    size_t cells_y = histograms ? height / cs : 0;
+
+    // С гистограммами полоса - строка ячеек; строки ниже последней целой ячейки нужны только для меток
+    size_t band_rows = histograms ? cs : LBP_BAND_ROWS;
+    size_t bands = histograms && !codes ? cells_y : (height + band_rows - 1) / band_rows;
+
+    int parallel = width * height >= ipl_get_context()->profile.parallel_min_pixels;
+    int failed = 0;
+
+    #pragma omp parallel if (parallel)
+    {
+        LbpBuffers buf;
+        buf.rows = (unsigned char*)malloc(3 * (width + 2));
+        buf.raw = (unsigned char*)malloc(width);
+        buf.counts = histograms ? (uint32_t*)malloc(cells_x * IPL_LBP_BINS * sizeof(uint32_t)) : NULL;
+        int ok = buf.rows && buf.raw && (!histograms || buf.counts);
+        if (!ok)
+        {
+            #pragma omp atomic write
+            failed = 1;
+        }
+
+        #pragma omp for schedule(dynamic)
+        for (ptrdiff_t b = 0; b < (ptrdiff_t)bands; b++)
+        {
+            if (!ok) continue;
+            size_t row_begin = (size_t)b * band_rows;
+            size_t row_end = row_begin + band_rows < height ? row_begin + band_rows : height;
+            int binned = histograms && (size_t)b < cells_y;
+
+            if (binned) memset(buf.counts, 0, cells_x * IPL_LBP_BINS * sizeof(uint32_t));
+            lbp_band(image, row_begin, row_end, codes, cs, cells_x, &buf, binned ? buf.counts : NULL);
+
+            if (binned)
+            {
+                float* out = histograms + (size_t)b * cells_x * IPL_LBP_BINS;
+                float inv_area = 1.0f / (float)(cs * cs);
+                for (size_t k = 0; k < cells_x * IPL_LBP_BINS; k++) out[k] = (float)buf.counts[k] * inv_area;
+            }
+        }
+
+        free(buf.rows);
+        free(buf.raw);
+        free(buf.counts);
+    }
+
+    return failed ? OUT_OF_MEMORY : SUCCESS;
+}
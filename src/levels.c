@@ -0,0 +1,180 @@
+#include "color.h"
+#include "context.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <omp.h>
+
+#define LEVELS_SAMPLES (1 << 18) // Примерное количество пикселей выборки статистики: точнее для 8-битных процентилей не нужно
+
+// @brief Шаг сетки выборки по строкам и столбцам: на больших изображениях статистика собирается
+//        примерно по LEVELS_SAMPLES пикселям, пропущенные строки не читаются из памяти вовсе.
+static size_t levels_sample_step(const size_t width, const size_t height)
+{
+    size_t step = (size_t)sqrt((double)width * (double)height / LEVELS_SAMPLES);
+    return step < 1 ? 1 : step;
+}
+
+// @brief Гистограммы цветовых каналов (без альфа-канала) по сетке выборки за один параллельный проход:
+//        каждый поток считает в свои гистограммы, затем они складываются.
+//
+// @return Количество пикселей выборки.
+static uint64_t levels_histogram(const Image* image, uint64_t histogram[3][256])
+{
+    size_t width = image->width;
+    int chan = image->channels;
+    int color = chan == 4 ? 3 : chan;
+    size_t step = levels_sample_step(width, image->height);
+    size_t rows = (image->height + step - 1) / step;
+    size_t cols = (width + step - 1) / step;
+    int parallel = rows * cols >= ipl_get_context()->profile.parallel_min_pixels;
+
+    memset(histogram, 0, 3 * 256 * sizeof(uint64_t));
+
+    #pragma omp parallel if (parallel)
+    {
+        uint32_t local[3][256];
+        memset(local, 0, sizeof(local));
+
+        #pragma omp for schedule(static)
+        for (ptrdiff_t i = 0; i < (ptrdiff_t)rows; i++)
+        {
+            const unsigned char* row = image->data + (size_t)i * step * width * chan;
+            if (color == 1)
+            {
+                for (size_t x = 0; x < width; x += step) local[0][row[x]]++;
+                continue;
+            }
+            for (size_t x = 0; x < width; x += step)
+            {
+                const unsigned char* p = row + x * chan;
+                local[0][p[0]]++;
+                local[1][p[1]]++;
+                local[2][p[2]]++;
+            }
+        }
+
+        for (int c = 0; c < color; c++)
+            for (int v = 0; v < 256; v++)
+            {
+                if (!local[c][v]) continue;
+                #pragma omp atomic
+                histogram[c][v] += local[c][v];
+            }
+    }
+    return (uint64_t)rows * cols;
+}
+
+// @brief Заменяет каждый цветовой канал по его таблице (альфа-канал не меняется); строки обрабатываются параллельно.
+static void levels_apply(Image* image, const unsigned char lut[3][256])
+{
+    size_t width = image->width;
+    int chan = image->channels;
+    int parallel = width * image->height >= ipl_get_context()->profile.parallel_min_pixels;
+
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t y = 0; y < (ptrdiff_t)image->height; y++)
+    {
+        unsigned char* p = image->data + (size_t)y * width * chan;
+        if (chan == 1)
+        {
+            for (size_t x = 0; x < width; x++) p[x] = lut[0][p[x]];
+            continue;
+        }
+        for (size_t x = 0; x < width; x++, p += chan)
+        {
+            p[0] = lut[0][p[0]];
+            p[1] = lut[1][p[1]];
+            p[2] = lut[2][p[2]];
+        }
+    }
+}
+
+// @brief Автоматические уровни: каждый цветовой канал растягивается так, что его процентили clip и 1 - clip
+//        становятся 0 и 255. Процентили берутся из гистограмм, собранных за один параллельный проход
+//        (на больших изображениях - по разреженной сетке), затем все каналы заменяются по таблицам
+//        из 256 записей за второй проход. Канал без разброса значений не меняется.
+//
+// @param image [in, out] Изображение из 1, 3 или 4 каналов (альфа-канал не меняется).
+// @param clip  [in]      Доля значений, отсекаемых с каждой стороны, 0 <= clip < 0.5 (например, 0.005).
+//
+// @return INVALID_ARGUMENT Невалидный аргумент.
+//                          Если `image` или `image->data` равен NULL, изображение пустое,
+//                          в нем 2 канала или clip вне диапазона.
+// @return SUCCESS          Уровни изменены.
+ImageProcStatus ipl_auto_levels(Image* image, const float clip)
+{
+    if (!image || !image->data || image->width == 0 || image->height == 0) return INVALID_ARGUMENT;
+    if (image->channels != 1 && image->channels != 3 && image->channels != 4) return INVALID_ARGUMENT;
+    if (!(clip >= 0.0f && clip < 0.5f)) return INVALID_ARGUMENT;
+
+    uint64_t histogram[3][256];
+    uint64_t total = levels_histogram(image, histogram);
+    uint64_t skip = (uint64_t)(clip * (double)total);
+    int color = image->channels == 4 ? 3 : image->channels;
+    unsigned char lut[3][256];
+
+    for (int c = 0; c < color; c++)
+    {
+        // Наименьшее и наибольшее значения, за которыми остается больше skip значений выборки
+        int lo = 0, hi = 255;
+        uint64_t sum = 0;
+        while (lo < 255 && (sum += histogram[c][lo]) <= skip) lo++;
+        sum = 0;
+        while (hi > 0 && (sum += histogram[c][hi]) <= skip) hi--;
+
+        for (int v = 0; v < 256; v++)
+        {
+            if (hi <= lo) lut[c][v] = (unsigned char)v;
+            else if (v <= lo) lut[c][v] = 0;
+            else if (v >= hi) lut[c][v] = 255;
+            else lut[c][v] = (unsigned char)(((v - lo) * 510 + (hi - lo)) / (2 * (hi - lo)));
+        }
+    }
+
+    levels_apply(image, lut);
+    return SUCCESS;
+}
+
+// @brief Баланс белого по модели серого мира: каждый цветовой канал умножается так, чтобы его среднее
+//        стало средним трех каналов. Средние берутся из гистограмм одного параллельного прохода
+//        (как в ipl_auto_levels), затем каналы заменяются по таблицам из 256 записей (с насыщением).
+//
+// @param image [in, out] Изображение из 3 или 4 каналов (альфа-канал не меняется).
+//
+// @return INVALID_ARGUMENT Невалидный аргумент.
+//                          Если `image` или `image->data` равен NULL, изображение пустое или в нем не 3 и не 4 канала.
+// @return SUCCESS          Баланс белого изменен (черное изображение не меняется).
+ImageProcStatus ipl_auto_white_balance(Image* image)
+{
+    if (!image || !image->data || image->width == 0 || image->height == 0) return INVALID_ARGUMENT;
+    if (image->channels != 3 && image->channels != 4) return INVALID_ARGUMENT;
+
+    uint64_t histogram[3][256];
+    uint64_t total = levels_histogram(image, histogram);
+
+    double mean[3], gray = 0.0;
+    for (int c = 0; c < 3; c++)
+    {
+        uint64_t sum = 0;
+        for (int v = 0; v < 256; v++) sum += histogram[c][v] * (uint64_t)v;
+        mean[c] = (double)sum / (double)total;
+        gray += mean[c] / 3.0;
+    }
+
+    unsigned char lut[3][256];
+    for (int c = 0; c < 3; c++)
+    {
+        double gain = mean[c] > 0.0 ? gray / mean[c] : 1.0;
+        for (int v = 0; v < 256; v++)
+        {
+            double scaled = v * gain + 0.5;
+            lut[c][v] = (unsigned char)(scaled >= 255.0 ? 255 : (int)scaled);
+        }
+    }
+
+    levels_apply(image, lut);
+    return SUCCESS;
+}
@@ -2,19 +2,23 @@
 #include <stdio.h>
 #include "input_output.h"
 #include "imageproc.h"
+#include "manifest.h"
+#include "context.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <conio.h>
 
 #define NAMELEN 128
+#define MAX_MANIFESTS 64
 
 typedef enum {
     UNSPECIFIED = 0,
     GAUSS,
     EDGE_DETECTION,
     MEDIAN,
-    GRAY
+    GRAY,
+    AUTOTUNE
 } Tool;
 
 int F_HELP = 0;
@@ -26,6 +30,9 @@ ImageFormat FORMAT_OUT = UNKNOWN;
 float PARAMETERS[4] = {5,0,0,0};
 char FILENAME_IN[NAMELEN];
 char FILENAME_OUT[NAMELEN];
+char FILENAME_MANIFESTS[MAX_MANIFESTS][NAMELEN];
+int MANIFEST_COUNT = 0;
+char FILENAME_PROFILE[NAMELEN];
 int PCNT = 0;
 
 int main(int argc, char const *argv[])
@@ -33,6 +40,8 @@ int main(int argc, char const *argv[])
     if (argc == 1)
     {
         printf("Usage:\n./imgproc gauss|median|edge_detection|grayscale \"path/to/image.jpg|png\" [radius/sigma] [-o \"output/result.jpg|png\"]");
+        printf("\n./imgproc \"path/to/manifest.json\" [\"path/to/manifest2.json\" ...]");
+        printf("\n./imgproc autotune [\"path/to/profile.txt\"]");
         getch();
         return 1;
     }
@@ -68,6 +77,18 @@ int main(int argc, char const *argv[])
                 FORMAT_IN = PNG;
             }
         }
+        else if (strstr(argv[p], ".txt") != NULL)
+        {
+            strcpy_s(FILENAME_PROFILE, NAMELEN, argv[p]);
+        }
+        else if (strstr(argv[p], ".json") != NULL)
+        {
+            if (MANIFEST_COUNT < MAX_MANIFESTS)
+            {
+                strcpy_s(FILENAME_MANIFESTS[MANIFEST_COUNT], NAMELEN, argv[p]);
+                MANIFEST_COUNT++;
+            }
+        }
         else if (argv[p][0] >= '0' && argv[p][0] <= '9')
         {
             if (PCNT < 4) sscanf(argv[p], "%f", &PARAMETERS[PCNT++]);
@@ -76,10 +97,31 @@ int main(int argc, char const *argv[])
         else if (TOOL == UNSPECIFIED && strcmp(argv[p], "median") == 0) TOOL = MEDIAN;
         else if (TOOL == UNSPECIFIED && strcmp(argv[p], "edge_detection") == 0) TOOL = EDGE_DETECTION;
         else if (TOOL == UNSPECIFIED && strcmp(argv[p], "grayscale") == 0) TOOL = GRAY;
+        else if (TOOL == UNSPECIFIED && strcmp(argv[p], "autotune") == 0) TOOL = AUTOTUNE;
         else if (strcmp(argv[p], "-o") == 0) F_OUTPUT = 1;
         else if (strcmp(argv[p], "-h") == 0) F_HELP = 1;
     }
 
+    if (TOOL == AUTOTUNE)
+    {
+        ImageProcStatus status = ipl_autotune(FILENAME_PROFILE[0] != '\0' ? FILENAME_PROFILE : DEFAULT_PROFILE_PATH);
+        printf("Autotune status = %d\n", status);
+        return status == SUCCESS ? 0 : -1;
+    }
+
+    // Профиль машины (если указан) загружается при создании контекста библиотеки
+    ipl_context_init(FILENAME_PROFILE[0] != '\0' ? FILENAME_PROFILE : NULL);
+
+    if (MANIFEST_COUNT > 0)
+    {
+        // Манифесты исполняются пакетом: входы читаются заранее, декодированные изображения разделяются между ними
+        const char* manifests[MAX_MANIFESTS];
+        for (int m = 0; m < MANIFEST_COUNT; m++) manifests[m] = FILENAME_MANIFESTS[m];
+
+        ImageProcStatus status = ipl_run_manifests(manifests, MANIFEST_COUNT);
+        printf("Batch status = %d\n", status);
+        return status == SUCCESS ? 0 : -1;
+    }
 
     if (FORMAT_IN == UNKNOWN)
     {
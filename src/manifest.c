@@ -0,0 +1,754 @@
+#include "manifest.h"
+#include "input_output.h"
+#include "pipeline.h"
+#include "context.h"
+#include "cache.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ----------------------------
+// ---- МИНИМАЛЬНЫЙ JSON ----
+// ----------------------------
+
+typedef struct
+{
+    const char* pos; // Текущая позиция в тексте
+    int depth;       // Глубина вложенности (защита от переполнения стека)
+} JsonParser;
+
+#define JSON_MAX_DEPTH 64
+
+static int json_parse_value(JsonParser* parser, JsonValue* out);
+
+static void json_skip_spaces(JsonParser* parser)
+{
+    while (*parser->pos && isspace((unsigned char)*parser->pos)) parser->pos++;
+}
+
+// @brief Освобождает содержимое значения (но не саму структуру).
+static void json_clear(JsonValue* value)
+{
+    for (int i = 0; i < value->count; i++)
+    {
+        json_clear(&value->items[i]);
+        if (value->keys) free(value->keys[i]);
+    }
+    free(value->items);
+    free(value->keys);
+    free(value->string);
+    memset(value, 0, sizeof(JsonValue));
+}
+
+// @brief Дописывает кодовую точку Юникода в UTF-8.
+static char* utf8_append(char* dst, unsigned int code)
+{
+    if (code < 0x80) {
+        *dst++ = (char)code;
+    } else if (code < 0x800) {
+        *dst++ = (char)(0xC0 | (code >> 6));
+        *dst++ = (char)(0x80 | (code & 0x3F));
+    } else {
+        *dst++ = (char)(0xE0 | (code >> 12));
+        *dst++ = (char)(0x80 | ((code >> 6) & 0x3F));
+        *dst++ = (char)(0x80 | (code & 0x3F));
+    }
+    return dst;
+}
+
+static char* json_parse_string(JsonParser* parser)
+{
+    const char* start = ++parser->pos; // пропускаем открывающую кавычку
+
+    // Первый проход: поиск конца строки (результат не длиннее исходника)
+    while (*parser->pos && *parser->pos != '"')
+    {
+        if (*parser->pos == '\\' && parser->pos[1]) parser->pos++;
+        parser->pos++;
+    }
+    if (*parser->pos != '"') return NULL;
+
+    char* result = (char*)malloc((size_t)(parser->pos - start) + 1);
+    if (!result) return NULL;
+
+    char* dst = result;
+    for (const char* src = start; src < parser->pos; src++)
+    {
+        if (*src != '\\') { *dst++ = *src; continue; }
+
+        src++;
+        switch (*src)
+        {
+        case 'n': *dst++ = '\n'; break;
+        case 't': *dst++ = '\t'; break;
+        case 'r': *dst++ = '\r'; break;
+        case 'b': *dst++ = '\b'; break;
+        case 'f': *dst++ = '\f'; break;
+        case 'u':
+        {
+            unsigned int code = 0;
+            int k;
+            for (k = 1; k <= 4 && isxdigit((unsigned char)src[k]); k++)
+            {
+                char c = (char)tolower((unsigned char)src[k]);
+                code = code * 16 + (unsigned int)(c <= '9' ? c - '0' : c - 'a' + 10);
+            }
+            if (k != 5) { free(result); return NULL; }
+            dst = utf8_append(dst, code);
+            src += 4;
+            break;
+        }
+        default: *dst++ = *src; break; // \" \\ \/
+        }
+    }
+    *dst = '\0';
+
+    parser->pos++; // закрывающая кавычка
+    return result;
+}
+
+// @brief Разбирает массив или объект (is_object = 1).
+static int json_parse_container(JsonParser* parser, JsonValue* out, const int is_object)
+{
+    char close = is_object ? '}' : ']';
+    int capacity = 0;
+
+    out->type = is_object ? JSON_OBJECT : JSON_ARRAY;
+    parser->pos++;
+    json_skip_spaces(parser);
+    if (*parser->pos == close) { parser->pos++; return 1; }
+
+    for (;;)
+    {
+        if (out->count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 4;
+            JsonValue* items = (JsonValue*)realloc(out->items, capacity * sizeof(JsonValue));
+            if (!items) return 0;
+            out->items = items;
+            if (is_object)
+            {
+                char** keys = (char**)realloc(out->keys, capacity * sizeof(char*));
+                if (!keys) return 0;
+                out->keys = keys;
+            }
+        }
+
+        JsonValue* item = &out->items[out->count];
+        memset(item, 0, sizeof(JsonValue));
+        if (is_object)
+        {
+            json_skip_spaces(parser);
+            if (*parser->pos != '"') return 0;
+            out->keys[out->count] = json_parse_string(parser);
+            if (!out->keys[out->count]) return 0;
+            json_skip_spaces(parser);
+            if (*parser->pos != ':') { out->count++; return 0; }
+            parser->pos++;
+        }
+        out->count++;
+
+        if (!json_parse_value(parser, item)) return 0;
+
+        json_skip_spaces(parser);
+        if (*parser->pos == ',') { parser->pos++; continue; }
+        if (*parser->pos == close) { parser->pos++; return 1; }
+        return 0;
+    }
+}
+
+static int json_parse_value(JsonParser* parser, JsonValue* out)
+{
+    json_skip_spaces(parser);
+    const char* p = parser->pos;
+
+    if (*p == '{' || *p == '[')
+    {
+        if (++parser->depth > JSON_MAX_DEPTH) return 0;
+        int ok = json_parse_container(parser, out, *p == '{');
+        parser->depth--;
+        return ok;
+    }
+    if (*p == '"')
+    {
+        out->type = JSON_STRING;
+        out->string = json_parse_string(parser);
+        return out->string != NULL;
+    }
+    if (strncmp(p, "true", 4) == 0 || strncmp(p, "false", 5) == 0)
+    {
+        out->type = JSON_BOOL;
+        out->number = (*p == 't');
+        parser->pos += (*p == 't') ? 4 : 5;
+        return 1;
+    }
+    if (strncmp(p, "null", 4) == 0)
+    {
+        out->type = JSON_NULL;
+        parser->pos += 4;
+        return 1;
+    }
+
+    char* end;
+    out->type = JSON_NUMBER;
+    out->number = strtod(p, &end);
+    if (end == p) return 0;
+    parser->pos = end;
+    return 1;
+}
+
+// @brief Разбирает текст JSON.
+//
+// @param text [in] Строка с JSON, завершающаяся нулем.
+// @return Указатель на дерево значений (освобождается json_free) или NULL при синтаксической ошибке.
+JsonValue* json_parse(const char* text)
+{
+    if (!text) return NULL;
+
+    JsonValue* root = (JsonValue*)calloc(1, sizeof(JsonValue));
+    if (!root) return NULL;
+
+    JsonParser parser = {text, 0};
+    int ok = json_parse_value(&parser, root);
+    json_skip_spaces(&parser);
+    if (!ok || *parser.pos != '\0')
+    {
+        json_free(root);
+        return NULL;
+    }
+
+    return root;
+}
+
+// @brief Освобождает дерево значений, созданное json_parse.
+void json_free(JsonValue* value)
+{
+    if (value) {
+        json_clear(value);
+        free(value);
+    }
+}
+
+// @brief Возвращает значение поля объекта или NULL, если поля нет (или value не объект).
+const JsonValue* json_get(const JsonValue* object, const char* key)
+{
+    if (!object || object->type != JSON_OBJECT) return NULL;
+    for (int i = 0; i < object->count; i++)
+    {
+        if (strcmp(object->keys[i], key) == 0) return &object->items[i];
+    }
+    return NULL;
+}
+
+
+// ----------------------------------
+// ---- ИСПОЛНЕНИЕ МАНИФЕСТА ----
+// ----------------------------------
+
+// @brief Контекст сохранения результатов, передаваемый в callback конвейера.
+typedef struct
+{
+    const char** paths;       // Пути для сохранения результатов
+    ImageFormat* formats;     // Форматы файлов
+    ImageProcStatus* status;  // Статусы сохранения
+    BatchIO* io;              // Асинхронная запись закодированных файлов (NULL - ipl_save_image)
+} ManifestOutputs;
+
+// @brief Определяет формат по расширению файла (как это делает CLI).
+static ImageFormat format_from_path(const char* path)
+{
+    if (strstr(path, ".jpg") != NULL || strstr(path, ".jpeg") != NULL) return JPEG;
+    if (strstr(path, ".png") != NULL) return PNG;
+    return UNKNOWN;
+}
+
+// @brief Сохраняет готовый результат. Вызывается из рабочего потока конвейера,
+//        поэтому кодирование перекрывается с вычислением остальных ветвей.
+static void save_output(void* context, int output_index, Image* result)
+{
+    ManifestOutputs* outputs = (ManifestOutputs*)context;
+    if (outputs->io)
+    {
+        // Файл кодируется в память, а запись уходит в очередь и не задерживает рабочий поток
+        unsigned char* data = NULL;
+        size_t size = 0;
+        ImageProcStatus status = ipl_encode_image(result, outputs->formats[output_index], &data, &size);
+        free_image_data(result);
+        if (status == SUCCESS) status = ipl_batch_io_write(outputs->io, outputs->paths[output_index], data, size);
+        outputs->status[output_index] = status;
+    }
+    else
+    {
+        outputs->status[output_index] = ipl_save_image(outputs->paths[output_index], result, outputs->formats[output_index]);
+    }
+    printf("Saved %s, status = %d\n", outputs->paths[output_index], outputs->status[output_index]);
+}
+
+// @brief Читает файл целиком в строку, завершающуюся нулем.
+static char* read_text_file(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char* text = size >= 0 ? (char*)malloc((size_t)size + 1) : NULL;
+    if (text && fread(text, 1, (size_t)size, file) != (size_t)size)
+    {
+        free(text);
+        text = NULL;
+    }
+    if (text) text[size] = '\0';
+
+    fclose(file);
+    return text;
+}
+
+// @brief Добавляет в конвейер узел манифеста.
+//
+// @return Индекс узла конвейера или -1, если операция неизвестна или параметр некорректен.
+static int add_manifest_node(Pipeline* pipeline, const char* op, const int input, const float param)
+{
+    if (strcmp(op, "gauss") == 0)          return ipl_pipeline_gaussian(pipeline, input, param);
+    if (strcmp(op, "median") == 0)         return ipl_pipeline_median(pipeline, input, (int)param);
+    if (strcmp(op, "edge_detection") == 0) return ipl_pipeline_sobel(pipeline, input);
+    if (strcmp(op, "grayscale") == 0)      return ipl_pipeline_grayscale(pipeline, input);
+    if (strcmp(op, "threshold") == 0)      return ipl_pipeline_threshold(pipeline, input, (unsigned char)param);
+    return -1;
+}
+
+// @brief Строит конвейер по списку узлов манифеста.
+//        Узлы могут быть перечислены в любом порядке: узел добавляется, когда его вход уже построен.
+//
+// @param ids [out] Индексы узлов конвейера для каждого узла манифеста.
+// @return SUCCESS или INVALID_ARGUMENT (неизвестная операция, вход или цикл).
+static ImageProcStatus build_manifest_pipeline(Pipeline* pipeline, const JsonValue* nodes, int* ids)
+{
+    int built = 0;
+    for (int i = 0; i < nodes->count; i++) ids[i] = -1;
+
+    while (built < nodes->count)
+    {
+        int progress = 0;
+        for (int i = 0; i < nodes->count; i++)
+        {
+            if (ids[i] >= 0) continue;
+
+            const JsonValue* op = json_get(&nodes->items[i], "op");
+            const JsonValue* input = json_get(&nodes->items[i], "input");
+            const JsonValue* param = json_get(&nodes->items[i], "param");
+            if (!op || op->type != JSON_STRING) return INVALID_ARGUMENT;
+
+            // Вход: "source" (по умолчанию) или id другого узла
+            int input_id = PIPELINE_SOURCE;
+            if (input && input->type == JSON_STRING && strcmp(input->string, "source") != 0)
+            {
+                input_id = -1;
+                for (int k = 0; k < nodes->count; k++)
+                {
+                    const JsonValue* id = json_get(&nodes->items[k], "id");
+                    if (id && id->type == JSON_STRING && strcmp(id->string, input->string) == 0) input_id = ids[k];
+                }
+                if (input_id < 0) continue; // вход еще не построен
+            }
+
+            ids[i] = add_manifest_node(pipeline, op->string, input_id, param && param->type == JSON_NUMBER ? (float)param->number : 5.0f);
+            if (ids[i] < 0)
+            {
+                fprintf(stderr, "Invalid manifest node: %s\n", op->string);
+                return INVALID_ARGUMENT;
+            }
+            built++;
+            progress = 1;
+        }
+        if (!progress)
+        {
+            fprintf(stderr, "Manifest references an unknown node or contains a cycle.\n");
+            return INVALID_ARGUMENT;
+        }
+    }
+
+    return SUCCESS;
+}
+
+// @brief Каноническая строка операций выхода манифеста для ключа кэша результатов: цепочка операций
+//        от выхода до источника с параметрами в том виде, в котором их получает конвейер, настройки профиля,
+//        от которых зависит результат, и формат файла. Идентификаторы узлов в строку не входят,
+//        поэтому одинаковые цепочки из разных манифестов дают одинаковые ключи.
+//
+// @return 1, если строка построена; 0, если выход некорректен (такой выход не кэшируется).
+static int manifest_signature(const JsonValue* nodes, const char* node_name, const ImageFormat format, char* out, const size_t size)
+{
+    const TuningProfile* profile = &ipl_get_context()->profile;
+    int node_count = nodes ? nodes->count : 0;
+    const char* current = node_name;
+    size_t length = 0;
+    int written;
+
+    // Каждый узел встречается в цепочке не больше одного раза, иначе в графе цикл
+    for (int step = 0; strcmp(current, "source") != 0; step++)
+    {
+        const JsonValue* node = NULL;
+        for (int k = 0; k < node_count && !node; k++)
+        {
+            const JsonValue* id = json_get(&nodes->items[k], "id");
+            if (id && id->type == JSON_STRING && strcmp(id->string, current) == 0) node = &nodes->items[k];
+        }
+        if (!node || step >= node_count) return 0;
+
+        const JsonValue* op = json_get(node, "op");
+        const JsonValue* input = json_get(node, "input");
+        const JsonValue* param = json_get(node, "param");
+        if (!op || op->type != JSON_STRING) return 0;
+        float value = param && param->type == JSON_NUMBER ? (float)param->number : 5.0f;
+
+        if (strcmp(op->string, "gauss") == 0)
+        {
+            // Рекурсивный фильтр в конвейере совпадает с фильтром кадра приближенно, результат зависит от тайлов
+            int iir = value >= profile->gaussian_iir_sigma && value >= 0.5f;
+            if (iir)
+                written = snprintf(out + length, size - length, "gauss(%.9g,%s,%dx%d)<", value,
+                                   profile->half_intermediates ? "iir-half" : "iir", profile->tile_width, profile->tile_height);
+            else
+                written = snprintf(out + length, size - length, "gauss(%.9g,fir)<", value);
+        }
+        else if (strcmp(op->string, "median") == 0)
+            written = snprintf(out + length, size - length, "median(%d)<", (int)value);
+        else if (strcmp(op->string, "threshold") == 0)
+            written = snprintf(out + length, size - length, "threshold(%d)<", (unsigned char)value);
+        else if (strcmp(op->string, "edge_detection") == 0 || strcmp(op->string, "grayscale") == 0)
+            written = snprintf(out + length, size - length, "%s<", op->string);
+        else
+            return 0;
+
+        if (written < 0 || (size_t)written >= size - length) return 0;
+        length += (size_t)written;
+        current = input && input->type == JSON_STRING ? input->string : "source";
+    }
+
+    written = snprintf(out + length, size - length, "source;format=%d", (int)format);
+    return written >= 0 && (size_t)written < size - length;
+}
+
+// @brief Ищет выходы манифеста в кэше результатов и записывает найденные в их файлы.
+//
+// @param keys   [out] Ключи выходов.
+// @param states [out] Для каждого выхода: 1 - записан из кэша, 0 - нужно вычислить и добавить в кэш,
+//                     -1 - нужно вычислить без кэширования (вход не читается или выход некорректен).
+//
+// @return Количество выходов, записанных из кэша.
+static int restore_cached_outputs(ResultCache* cache, const char* input_path, const JsonValue* nodes,
+                                  const JsonValue* outputs, CacheKey* keys, int* states)
+{
+    uint64_t input_hash;
+    int input_hashed = ipl_hash_file(input_path, &input_hash) == SUCCESS;
+    int restored = 0;
+    char signature[4096];
+
+    for (int o = 0; o < outputs->count; o++)
+    {
+        const JsonValue* node = json_get(&outputs->items[o], "node");
+        const JsonValue* path = json_get(&outputs->items[o], "path");
+        states[o] = -1;
+        if (!input_hashed || !node || node->type != JSON_STRING || !path || path->type != JSON_STRING ||
+            format_from_path(path->string) == UNKNOWN ||
+            !manifest_signature(nodes, node->string, format_from_path(path->string), signature, sizeof(signature))) continue;
+
+        keys[o] = ipl_cache_key(input_hash, signature);
+        states[o] = 0;
+
+        CacheHit hit;
+        if (ipl_cache_lookup(cache, keys[o], &hit) != SUCCESS) continue;
+
+        FILE* file = fopen(path->string, "wb");
+        if (file)
+        {
+            int written = fwrite(hit.data, 1, hit.size, file) == hit.size;
+            if ((fclose(file) == 0) && written)
+            {
+                states[o] = 1;
+                restored++;
+                printf("Restored %s from cache\n", path->string);
+            }
+        }
+        ipl_cache_release(&hit);
+    }
+
+    return restored;
+}
+
+// @brief Исполняет JSON-манифест: один раз декодирует входное изображение и строит по нему
+//        граф операций с несколькими выходами. Общие префиксы вычисляются один раз,
+//        независимые ветви - параллельно, а каждый результат кодируется сразу после готовности.
+//
+//        Формат манифеста:
+//        {
+//          "input": "image.jpeg",
+//          "nodes": [ {"id": "blur", "op": "gauss", "input": "source", "param": 1.5}, ... ],
+//          "outputs": [ {"node": "blur", "path": "blur.jpg"}, {"node": "source", "path": "copy.png"} ]
+//        }
+//        Операции: gauss, median, edge_detection, grayscale, threshold (параметр как в CLI).
+//        Формат выходного файла определяется по расширению пути.
+//        Если передан кэш результатов (cache.h), выходы ищутся в нем; когда найдены все,
+//        входное изображение не декодируется.
+//
+// @param manifest_path [in] Путь к файлу манифеста.
+// @param images        [in] Кэш декодированных изображений, разделяемый заданиями (NULL - изображение декодируется).
+//                           Если у кэша задан пакетный ввод-вывод (images->io), результаты записываются асинхронно,
+//                           а ошибки записи возвращает ipl_batch_io_flush.
+// @param result_cache  [in] Кэш результатов, открытый вызывающим на весь пакет (NULL - кэш не используется).
+//
+// @return INVALID_ARGUMENT   Синтаксическая ошибка или некорректное описание графа.
+// @return FILE_NOT_FOUND     Не найден манифест или входное изображение.
+// @return UNSUPPORTED_FORMAT Неизвестный формат входного или выходного файла.
+// @return OUT_OF_MEMORY      Не удалось выделить память.
+// @return SUCCESS            Все результаты вычислены и сохранены.
+//         Иначе возвращается первый ненулевой статус загрузки, вычисления или сохранения.
+ImageProcStatus ipl_run_manifest_with_cache(const char* manifest_path, ImageCache* images, ResultCache* result_cache)
+{
+    char* text = read_text_file(manifest_path);
+    if (!text) return FILE_NOT_FOUND;
+
+    JsonValue* root = json_parse(text);
+    free(text);
+    if (!root) return INVALID_ARGUMENT;
+
+    const JsonValue* input = json_get(root, "input");
+    const JsonValue* nodes = json_get(root, "nodes");
+    const JsonValue* outputs = json_get(root, "outputs");
+    if (!input || input->type != JSON_STRING || !outputs || outputs->type != JSON_ARRAY || outputs->count == 0 ||
+        (nodes && nodes->type != JSON_ARRAY))
+    {
+        json_free(root);
+        return INVALID_ARGUMENT;
+    }
+
+    ImageFormat input_format = format_from_path(input->string);
+    if (input_format == UNKNOWN)
+    {
+        json_free(root);
+        return UNSUPPORTED_FORMAT;
+    }
+
+    // Кэш результатов: выходы, уже вычисленные для тех же входных байтов и операций,
+    // записываются из кэша без декодирования и вычисления
+    int output_count = outputs->count;
+    ResultCache* cache = result_cache;
+    CacheKey* keys = NULL;
+    int* cache_states = NULL;
+    int restored = 0;
+    if (cache)
+    {
+        keys = (CacheKey*)malloc(output_count * sizeof(CacheKey));
+        cache_states = (int*)malloc(output_count * sizeof(int));
+        if (keys && cache_states)
+        {
+            restored = restore_cached_outputs(cache, input->string, nodes, outputs, keys, cache_states);
+        }
+        else
+        {
+            cache = NULL;
+        }
+    }
+    if (restored == output_count)
+    {
+        free(cache_states);
+        free(keys);
+        json_free(root);
+        return SUCCESS;
+    }
+
+    // Изображение берется из кэша декодированных изображений (разделяется с другими заданиями) или декодируется
+    Image loaded;
+    loaded.data = NULL;
+    const Image* image = &loaded;
+    ImageProcStatus status = images ? ipl_image_cache_acquire(images, input->string, input_format, &image)
+                                    : ipl_load_image(input->string, &loaded, input_format);
+    if (status != SUCCESS)
+    {
+        free(cache_states);
+        free(keys);
+        json_free(root);
+        return status;
+    }
+
+    int node_count = nodes ? nodes->count : 0;
+    Pipeline* pipeline = ipl_pipeline_create(image);
+    int* ids = (int*)malloc((node_count + 1) * sizeof(int));
+    int* output_ids = (int*)malloc(output_count * sizeof(int));
+    Image* results = (Image*)calloc(output_count, sizeof(Image));
+    const char** paths = (const char**)malloc(output_count * sizeof(char*));
+    ImageFormat* formats = (ImageFormat*)malloc(output_count * sizeof(ImageFormat));
+    ImageProcStatus* save_status = (ImageProcStatus*)malloc(output_count * sizeof(ImageProcStatus));
+
+    if (!pipeline || !ids || !output_ids || !results || !paths || !formats || !save_status)
+        status = OUT_OF_MEMORY;
+
+    if (status == SUCCESS && nodes)
+        status = build_manifest_pipeline(pipeline, nodes, ids);
+
+    // Сопоставление выходов узлам конвейера (выходы, записанные из кэша, пропускаются)
+    int pending = 0;
+    for (int o = 0; o < output_count && status == SUCCESS; o++)
+    {
+        if (cache && cache_states[o] == 1) continue;
+
+        const JsonValue* node = json_get(&outputs->items[o], "node");
+        const JsonValue* path = json_get(&outputs->items[o], "path");
+        if (!node || node->type != JSON_STRING || !path || path->type != JSON_STRING)
+        {
+            status = INVALID_ARGUMENT;
+            break;
+        }
+
+        int p = pending++;
+        output_ids[p] = strcmp(node->string, "source") == 0 ? PIPELINE_SOURCE : -1;
+        for (int k = 0; k < node_count && output_ids[p] < 0; k++)
+        {
+            const JsonValue* id = json_get(&nodes->items[k], "id");
+            if (id && id->type == JSON_STRING && strcmp(id->string, node->string) == 0) output_ids[p] = ids[k];
+        }
+
+        paths[p] = path->string;
+        formats[p] = format_from_path(path->string);
+        save_status[p] = SUCCESS;
+        if (cache)
+        {
+            keys[p] = keys[o];
+            cache_states[p] = cache_states[o];
+        }
+        if (output_ids[p] < 0) status = INVALID_ARGUMENT;
+        else if (formats[p] == UNKNOWN) status = UNSUPPORTED_FORMAT;
+    }
+
+    if (status == SUCCESS)
+    {
+        ManifestOutputs context = {paths, formats, save_status, images ? images->io : NULL};
+        status = ipl_pipeline_execute_with_callback(pipeline, output_ids, results, pending, save_output, &context);
+
+        for (int p = 0; p < pending && status == SUCCESS; p++)
+        {
+            if (save_status[p] != SUCCESS) status = save_status[p];
+        }
+    }
+
+    // Сохраненные файлы добавляются в кэш (ошибка кэша не влияет на результат манифеста).
+    // Асинхронные записи должны завершиться до того, как файлы будут прочитаны
+    if (status == SUCCESS && cache && images && images->io) status = ipl_batch_io_flush(images->io);
+    for (int p = 0; p < pending && status == SUCCESS && cache; p++)
+    {
+        if (cache_states[p] == 0) ipl_cache_insert_file(cache, keys[p], paths[p]);
+    }
+
+    if (results)
+    {
+        for (int o = 0; o < output_count; o++)
+        {
+            if (results[o].data) free_image_data(&results[o]);
+        }
+    }
+    free(save_status);
+    free(formats);
+    free(paths);
+    free(results);
+    free(output_ids);
+    free(ids);
+    ipl_pipeline_free(pipeline);
+    if (images) ipl_image_cache_release(images, image);
+    else free_image_data(&loaded);
+    free(cache_states);
+    free(keys);
+    json_free(root);
+
+    return status;
+}
+
+// @brief Исполняет JSON-манифест без кэша декодированных изображений (см. ipl_run_manifest_with_cache).
+//        Кэш результатов открывается по переменным окружения (ipl_cache_open_default) только на этот манифест.
+ImageProcStatus ipl_run_manifest(const char* manifest_path)
+{
+    ResultCache* result_cache = ipl_cache_open_default();
+    ImageProcStatus status = ipl_run_manifest_with_cache(manifest_path, NULL, result_cache);
+    ipl_cache_close(result_cache);
+    return status;
+}
+
+// @brief Читает из манифеста путь к входному изображению (для чтения заранее).
+//
+// @return Копия пути (освобождается free) или NULL, если манифест не читается.
+static char* manifest_input_path(const char* manifest_path)
+{
+    char* text = read_text_file(manifest_path);
+    JsonValue* root = text ? json_parse(text) : NULL;
+    free(text);
+
+    const JsonValue* input = json_get(root, "input");
+    char* path = NULL;
+    if (input && input->type == JSON_STRING)
+    {
+        path = (char*)malloc(strlen(input->string) + 1);
+        if (path) strcpy(path, input->string);
+    }
+
+    json_free(root);
+    return path;
+}
+
+// @brief Исполняет пакет манифестов по очереди. Входные изображения следующих заданий читаются заранее
+//        (пакетный ввод-вывод: io_uring или пул потоков), пока выполняются текущие, декодированные изображения
+//        разделяются заданиями через кэш, а результаты записываются асинхронно.
+//        Кэш результатов (IPL_CACHE_DIR) открывается один раз на весь пакет: каталог сканируется при открытии,
+//        а не для каждого манифеста.
+//
+// @param manifest_paths [in] Пути к манифестам.
+// @param count          [in] Количество манифестов.
+//
+// @return Первый ненулевой статус манифеста или записи результатов, иначе SUCCESS.
+ImageProcStatus ipl_run_manifests(const char* const* manifest_paths, const int count)
+{
+    if (!manifest_paths || count <= 0) return INVALID_ARGUMENT;
+
+    ResultCache* result_cache = ipl_cache_open_default();
+    ImageCache* images = ipl_image_cache_create_default();
+    BatchIO* io = images ? ipl_batch_io_create_default() : NULL;
+    char** inputs = io ? (char**)calloc((size_t)count, sizeof(char*)) : NULL;
+    if (images) images->io = inputs ? io : NULL;
+
+    if (inputs)
+    {
+        for (int m = 0; m < count; m++) inputs[m] = manifest_input_path(manifest_paths[m]);
+    }
+
+    ImageProcStatus result = SUCCESS;
+    int next = 0; // Следующее задание, вход которого еще не поставлен на чтение
+    for (int m = 0; m < count; m++)
+    {
+        // В очереди не больше depth входов вперед. Повторный вход не читается: он уже в кэше изображений
+        for (; inputs && next < count && next < m + ipl_batch_io_depth(io); next++)
+        {
+            int repeated = !inputs[next];
+            for (int k = 0; k < next && !repeated; k++) repeated = inputs[k] && strcmp(inputs[k], inputs[next]) == 0;
+            if (!repeated) ipl_batch_io_prefetch(io, inputs[next]);
+        }
+
+        ImageProcStatus status = ipl_run_manifest_with_cache(manifest_paths[m], images, result_cache);
+        printf("Manifest %s status = %d\n", manifest_paths[m], status);
+        if (status != SUCCESS && result == SUCCESS) result = status;
+
+        // Вход не понадобился (например, все выходы нашлись в кэше результатов)
+        if (inputs && inputs[m]) ipl_batch_io_discard(io, inputs[m]);
+    }
+
+    ImageProcStatus written = ipl_batch_io_flush(io);
+    if (written != SUCCESS && result == SUCCESS) result = written;
+
+    for (int m = 0; inputs && m < count; m++) free(inputs[m]);
+    free(inputs);
+    ipl_batch_io_free(io);
+    ipl_image_cache_free(images);
+    ipl_cache_close(result_cache);
+
+    return result;
+}
@@ -0,0 +1,109 @@
+// Шаблон ядер медианного фильтра, специализированных по количеству каналов на этапе компиляции.
+// Файл включается в imageproc_A.c несколько раз с разными значениями CHANNELS (1, 3, 4),
+// поэтому у него нет защиты от повторного включения.
+
+#ifndef CHANNELS
+#error "CHANNELS must be defined before including median_kernels.h"
+#endif
+
+#ifndef SPECIALIZED
+// Имя специализации функции: SPECIALIZED(name, 3) -> name_c3
+#define SPECIALIZED_(name, channels) name##_c##channels
+#define SPECIALIZED(name, channels) SPECIALIZED_(name, channels)
+#endif
+
+// @brief Медиана сортировкой окна (см. median_sort_rows) для CHANNELS каналов.
+static void SPECIALIZED(median_sort_rows, CHANNELS)(const unsigned char *padded, size_t ldp, unsigned char *output, size_t ldo,
+                                                    size_t width, size_t rows, int radius, int parallel)
+{
+    int win_size = radius * 2 + 1;
+    int win_area = win_size * win_size;
+
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t i = 0; i < (ptrdiff_t)rows; i++)
+    {
+        unsigned char window[(2 * MEDIAN_SORT_LIMIT + 1) * (2 * MEDIAN_SORT_LIMIT + 1)];
+        const unsigned char *src_row = padded + (size_t)i * ldp;
+        unsigned char *out_row = output + (size_t)i * ldo;
+
+        for (size_t j = 0; j < width; j++)
+        {
+            for (int c = 0; c < CHANNELS; c++)
+            {
+                int n = 0;
+                for (int y = 0; y < win_size; y++)
+                {
+                    // Соседи по горизонтали адресуются малыми (32-битными) смещениями от указателя на строку окна
+                    const unsigned char *src = src_row + y * ldp + j * CHANNELS + c;
+                    for (int x = 0; x < win_size; x++)
+                        window[n++] = src[x * CHANNELS];
+                }
+
+                if (radius == 1)
+                {
+                    out_row[j * CHANNELS + c] = median9(window);
+                    continue;
+                }
+
+                for (int a = 1; a < win_area; a++)
+                {
+                    unsigned char v = window[a];
+                    int b = a - 1;
+                    while (b >= 0 && window[b] > v) { window[b + 1] = window[b]; b--; }
+                    window[b + 1] = v;
+                }
+                out_row[j * CHANNELS + c] = window[win_area / 2];
+            }
+        }
+    }
+}
+
+// @brief Медиана скользящей гистограммой (см. median_histogram_rows) для CHANNELS каналов.
+//        Гистограммы всех каналов обновляются за один проход по столбцу окна.
+static void SPECIALIZED(median_histogram_rows, CHANNELS)(const unsigned char *padded, size_t ldp, unsigned char *output, size_t ldo,
+                                                         size_t width, size_t rows, int radius, int parallel)
+{
+    int win_size = radius * 2 + 1;
+    int half = win_size * win_size / 2;
+
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t i = 0; i < (ptrdiff_t)rows; i++)
+    {
+        int hist[CHANNELS][256];
+        const unsigned char *src_row = padded + (size_t)i * ldp;
+        unsigned char *out_row = output + (size_t)i * ldo;
+
+        // Окно первого пикселя строки
+        memset(hist, 0, sizeof(hist));
+        for (int y = 0; y < win_size; y++)
+        {
+            const unsigned char *src = src_row + y * ldp;
+            for (int x = 0; x < win_size * CHANNELS; x += CHANNELS)
+                for (int c = 0; c < CHANNELS; c++)
+                    hist[c][src[x + c]]++;
+        }
+
+        for (size_t j = 0; ; j++)
+        {
+            for (int c = 0; c < CHANNELS; c++)
+            {
+                int cnt = 0, v = 0;
+                while ((cnt += hist[c][v]) <= half) v++;
+                out_row[j * CHANNELS + c] = (unsigned char)v;
+            }
+            if (j == width - 1) break;
+
+            // Сдвиг окна на один пиксель вправо: столбец j уходит, столбец j + win_size приходит
+            const unsigned char *col_out = src_row + j * CHANNELS;
+            const unsigned char *col_in = col_out + win_size * CHANNELS;
+            for (int y = 0; y < win_size; y++)
+            {
+                for (int c = 0; c < CHANNELS; c++)
+                {
+                    hist[c][col_out[y * ldp + c]]--;
+                    hist[c][col_in[y * ldp + c]]++;
+                }
+            }
+        }
+    }
+}
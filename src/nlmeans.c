@@ -0,0 +1,421 @@
+#include "nlmeans.h"
+#include "context.h"
+#include "buffer.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <omp.h>
+
+#define NLMEANS_BLOCK_ROWS 32   // Строк в блоке одного потока
+#define NLMEANS_BLOCK_COLS 128  // Столбцов в блоке: накопители блока остаются в L2
+#define NLMEANS_LUT_SIZE 1024   // Записей в таблице весов
+#define NLMEANS_CUTOFF 8.0f     // Веса с показателем больше отбрасываются (exp(-8) ~ 3e-4)
+
+// @brief Параметры фильтра, общие для всех блоков. Холсты хранятся по плоскостям (канал за каналом),
+//        чтобы все циклы по строке шли по байтам подряд и векторизовались при любом числе каналов.
+typedef struct
+{
+    const unsigned char* dist;  // Дополненный холст, по которому считаются расстояния патчей
+    int dist_chan;              // Количество плоскостей dist
+    const unsigned char* value; // Дополненный холст исходного изображения (усредняемые значения)
+    size_t ld;                  // Ширина строки холстов: width + 2 * pad
+    size_t plane;               // Размер плоскости холстов: ld * (height + 2 * pad)
+    size_t width;
+    size_t height;
+    size_t pad;                 // Дополнение с каждой стороны: patch_radius + search_radius
+    int patch_radius;
+    int search_radius;
+    float scale;                // Множитель суммы квадратов разностей патча до индекса таблицы весов
+    int32_t ssd_limit;          // Сумма, с которой индекс достигает последней (нулевой) записи таблицы
+    const float* lut;           // NLMEANS_LUT_SIZE весов, последняя запись нулевая
+} NlmeansParams;
+
+// @brief Рабочие буферы одного потока.
+typedef struct
+{
+    uint32_t* rows;     // Кольцо из 2r + 1 строк квадратов разностей, по (cols + 2r) значений
+    uint32_t* columns;  // Суммы квадратов разностей по столбцам патча, cols + 2r значений
+    int32_t* index;     // Суммы квадратов разностей патчей строки, затем индексы таблицы весов, cols значений
+    float* w;           // Веса строки, cols значений
+    float* sum;         // channels x rows x cols
+    float* weight;      // rows x cols
+    float* weight_max;  // rows x cols
+} NlmeansBuffers;
+
+// @brief Дополненная копия изображения по плоскостям каналов: края дублируют крайние пиксели
+//        (как в ipl_median_filter).
+//
+// @return Буфер из chan плоскостей (height + 2 * pad) x (width + 2 * pad) или NULL при ошибке выделения памяти.
+static unsigned char* nlmeans_pad(const unsigned char* source, const size_t width, const size_t height, const int chan, const size_t pad)
+{
+    size_t ld = width + pad * 2;
+    size_t h_pad = height + pad * 2;
+    size_t plane = ld * h_pad;
+
+    unsigned char* padded = ipl_buffer_alloc(plane * chan);
+    if (!padded) return NULL;
+
+    int parallel = width * height >= ipl_get_context()->profile.parallel_min_pixels;
+
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t i = 0; i < (ptrdiff_t)h_pad; i++)
+    {
+        ptrdiff_t i_src = i - (ptrdiff_t)pad;
+        if (i_src < 0) i_src = 0;
+        else if (i_src >= (ptrdiff_t)height) i_src = (ptrdiff_t)height - 1;
+
+        const unsigned char* src = source + (size_t)i_src * width * chan;
+        for (int c = 0; c < chan; c++)
+        {
+            unsigned char* dst = padded + c * plane + (size_t)i * ld;
+            memset(dst, src[c], pad);
+            memset(dst + pad + width, src[(width - 1) * chan + c], pad);
+            for (size_t x = 0; x < width; x++) dst[pad + x] = src[x * chan + c];
+        }
+    }
+    return padded;
+}
+
+// @brief Квадраты разностей строки холста dist и ее сдвига на shift байтов, суммированные по плоскостям.
+//
+// @param a     [in]  Начало строки области в первой плоскости dist.
+// @param count [in]  Количество пикселей.
+static inline __attribute__((always_inline)) void nlmeans_diff_row(const unsigned char* a, const ptrdiff_t shift, const size_t plane,
+                                                                   uint32_t* output, const size_t count, const int chan)
+{
+    for (int c = 0; c < chan; c++)
+    {
+        const unsigned char* pa = a + c * plane;
+        const unsigned char* pb = pa + shift;
+        if (c == 0)
+        {
+            #pragma omp simd
+            for (size_t x = 0; x < count; x++)
+            {
+                int t = (int)pa[x] - (int)pb[x];
+                output[x] = (uint32_t)(t * t);
+            }
+        }
+        else
+        {
+            #pragma omp simd
+            for (size_t x = 0; x < count; x++)
+            {
+                int t = (int)pa[x] - (int)pb[x];
+                output[x] += (uint32_t)(t * t);
+            }
+        }
+    }
+}
+
+// @brief Фильтрует блок [y0, y0 + rows) x [x0, x0 + cols) и записывает результат в output.
+//        Для каждого смещения окна поиска суммы квадратов разностей патчей всего блока получаются
+//        как в интегральном изображении (Darbon и др.): суммы по столбцам патча обновляются
+//        скользящим окном по строкам, суммы патчей - скользящим окном по столбцам. Поэтому
+//        стоимость не зависит от размера патча.
+static inline __attribute__((always_inline)) void nlmeans_block(const NlmeansParams* p, NlmeansBuffers* buf, unsigned char* output,
+                                                                const size_t x0, const size_t y0, const size_t cols, const size_t rows,
+                                                                const int chan, const int dist_chan)
+{
+    int pr = p->patch_radius;
+    int sr = p->search_radius;
+    size_t side = 2 * (size_t)pr + 1;
+    size_t area_cols = cols + side - 1;
+
+    memset(buf->sum, 0, chan * rows * cols * sizeof(float));
+    memset(buf->weight, 0, rows * cols * sizeof(float));
+    memset(buf->weight_max, 0, rows * cols * sizeof(float));
+
+    for (ptrdiff_t dy = -sr; dy <= sr; dy++)
+    {
+        for (ptrdiff_t dx = -sr; dx <= sr; dx++)
+        {
+            if (dx == 0 && dy == 0) continue; // Собственный вес пикселя назначается после обхода окна
+
+            // Патчи блока занимают строки и столбцы холста, начиная с y0 - pr + pad = y0 + sr (x0 + sr)
+            const unsigned char* area = p->dist + (y0 + (size_t)sr) * p->ld + x0 + (size_t)sr;
+            ptrdiff_t shift = dy * (ptrdiff_t)p->ld + dx;
+            uint32_t* columns = buf->columns;
+
+            memset(columns, 0, area_cols * sizeof(uint32_t));
+            for (size_t r = 0; r + 1 < side; r++)
+            {
+                uint32_t* d = buf->rows + r * area_cols;
+                nlmeans_diff_row(area + r * p->ld, shift, p->plane, d, area_cols, dist_chan);
+                #pragma omp simd
+                for (size_t x = 0; x < area_cols; x++) columns[x] += d[x];
+            }
+
+            for (size_t y = 0; y < rows; y++)
+            {
+                // Строка y + 2r входит в суммы столбцов, строка y - 1 (на ее месте в кольце) выходит
+                uint32_t* d = buf->rows + ((y + side - 1) % side) * area_cols;
+                if (y > 0)
+                {
+                    #pragma omp simd
+                    for (size_t x = 0; x < area_cols; x++) columns[x] -= d[x];
+                }
+                nlmeans_diff_row(area + (y + side - 1) * p->ld, shift, p->plane, d, area_cols, dist_chan);
+                #pragma omp simd
+                for (size_t x = 0; x < area_cols; x++) columns[x] += d[x];
+
+                // Суммы патчей меньше 2^31 (см. IPL_NLMEANS_MAX_PATCH_RADIUS), поэтому индекс таблицы
+                // считается в int32 и цикл векторизуется
+                int32_t* index = buf->index;
+                uint32_t s = 0;
+                for (size_t k = 0; k + 1 < side; k++) s += columns[k];
+                for (size_t x = 0; x < cols; x++)
+                {
+                    s += columns[x + side - 1];
+                    index[x] = (int32_t)s;
+                    s -= columns[x];
+                }
+
+                int32_t limit = p->ssd_limit;
+                float scale = p->scale;
+                #pragma omp simd
+                for (size_t x = 0; x < cols; x++)
+                {
+                    int32_t ssd = index[x] < limit ? index[x] : limit;
+                    int32_t i = (int32_t)((float)ssd * scale);
+                    index[x] = i < NLMEANS_LUT_SIZE - 1 ? i : NLMEANS_LUT_SIZE - 1;
+                }
+
+                float* w = buf->w;
+                for (size_t x = 0; x < cols; x++) w[x] = p->lut[index[x]];
+
+                float* weight = buf->weight + y * cols;
+                float* weight_max = buf->weight_max + y * cols;
+                #pragma omp simd
+                for (size_t x = 0; x < cols; x++)
+                {
+                    weight[x] += w[x];
+                    weight_max[x] = w[x] > weight_max[x] ? w[x] : weight_max[x];
+                }
+
+                for (int c = 0; c < chan; c++)
+                {
+                    const unsigned char* src = p->value + c * p->plane + (y0 + y + p->pad + dy) * p->ld + x0 + p->pad + dx;
+                    float* sum = buf->sum + (c * rows + y) * cols;
+                    #pragma omp simd
+                    for (size_t x = 0; x < cols; x++) sum[x] += w[x] * (float)src[x];
+                }
+            }
+        }
+    }
+
+    // Пиксель похож на себя сильнее всех, но полный вес 1 почти отменял бы фильтрацию,
+    // поэтому он получает наибольший вес среди соседей
+    for (size_t y = 0; y < rows; y++)
+    {
+        const float* weight = buf->weight + y * cols;
+        const float* weight_max = buf->weight_max + y * cols;
+        unsigned char* dst = output + ((y0 + y) * p->width + x0) * chan;
+
+        for (int c = 0; c < chan; c++)
+        {
+            const unsigned char* src = p->value + c * p->plane + (y0 + y + p->pad) * p->ld + x0 + p->pad;
+            const float* sum = buf->sum + (c * rows + y) * cols;
+            for (size_t x = 0; x < cols; x++)
+            {
+                float self = weight_max[x] > 0.0f ? weight_max[x] : 1.0f;
+                dst[x * chan + c] = to_uchar((sum[x] + self * src[x]) / (weight[x] + self));
+            }
+        }
+    }
+}
+
+// Специализации блока по количеству каналов значений и расстояний
+static void nlmeans_block_c1(const NlmeansParams* p, NlmeansBuffers* buf, unsigned char* output, const size_t x0, const size_t y0, const size_t cols, const size_t rows)
+{
+    nlmeans_block(p, buf, output, x0, y0, cols, rows, 1, 1);
+}
+static void nlmeans_block_c3(const NlmeansParams* p, NlmeansBuffers* buf, unsigned char* output, const size_t x0, const size_t y0, const size_t cols, const size_t rows)
+{
+    nlmeans_block(p, buf, output, x0, y0, cols, rows, 3, 3);
+}
+static void nlmeans_block_c4(const NlmeansParams* p, NlmeansBuffers* buf, unsigned char* output, const size_t x0, const size_t y0, const size_t cols, const size_t rows)
+{
+    nlmeans_block(p, buf, output, x0, y0, cols, rows, 4, 4);
+}
+static void nlmeans_block_c3_luma(const NlmeansParams* p, NlmeansBuffers* buf, unsigned char* output, const size_t x0, const size_t y0, const size_t cols, const size_t rows)
+{
+    nlmeans_block(p, buf, output, x0, y0, cols, rows, 3, 1);
+}
+static void nlmeans_block_c4_luma(const NlmeansParams* p, NlmeansBuffers* buf, unsigned char* output, const size_t x0, const size_t y0, const size_t cols, const size_t rows)
+{
+    nlmeans_block(p, buf, output, x0, y0, cols, rows, 4, 1);
+}
+
+// @brief Общая часть ipl_nlmeans и ipl_nlmeans_luma.
+//
+// @param luma [in] Ненулевое значение: расстояния патчей считаются по яркости, веса применяются ко всем каналам.
+static ImageProcStatus nlmeans(Image* image, const float h, const int patch_radius, const int search_radius, const int luma)
+{
+    if (!image || !image->data || image->width == 0 || image->height == 0) return INVALID_ARGUMENT;
+    if (!(h > 0.0f) || patch_radius < 0 || patch_radius > IPL_NLMEANS_MAX_PATCH_RADIUS || search_radius < 0) return INVALID_ARGUMENT;
+
+    int chan = image->channels;
+    void (*block)(const NlmeansParams*, NlmeansBuffers*, unsigned char*, const size_t, const size_t, const size_t, const size_t);
+    switch (chan)
+    {
+    case 1: block = nlmeans_block_c1; break;
+    case 3: block = luma ? nlmeans_block_c3_luma : nlmeans_block_c3; break;
+    case 4: block = luma ? nlmeans_block_c4_luma : nlmeans_block_c4; break;
+    default: return INVALID_ARGUMENT;
+    }
+
+    if (search_radius == 0) return SUCCESS; // Окно поиска из одного пикселя не меняет изображение
+
+    size_t width = image->width;
+    size_t height = image->height;
+    size_t pad = (size_t)patch_radius + (size_t)search_radius;
+
+    NlmeansParams params;
+    params.width = width;
+    params.height = height;
+    params.pad = pad;
+    params.patch_radius = patch_radius;
+    params.search_radius = search_radius;
+
+    params.ld = width + pad * 2;
+    params.plane = params.ld * (height + pad * 2);
+
+    params.value = nlmeans_pad(image->data, width, height, chan, pad);
+    if (!params.value) return OUT_OF_MEMORY;
+
+    unsigned char* luma_padded = NULL;
+    if (luma && chan != 1)
+    {
+        unsigned char* gray = ipl_buffer_alloc(width * height);
+        if (gray)
+        {
+            convert_to_one_channel(image->data, gray, width, height, chan);
+            luma_padded = nlmeans_pad(gray, width, height, 1, pad);
+            free(gray);
+        }
+        if (!luma_padded)
+        {
+            free((void*)params.value);
+            return OUT_OF_MEMORY;
+        }
+        params.dist = luma_padded;
+        params.dist_chan = 1;
+    }
+    else
+    {
+        params.dist = params.value;
+        params.dist_chan = chan;
+    }
+
+    // Вес exp(-d / h^2), где d - средний квадрат разности по пикселям и каналам патча
+    float lut[NLMEANS_LUT_SIZE];
+    float step = NLMEANS_CUTOFF / (NLMEANS_LUT_SIZE - 1);
+    for (int i = 0; i < NLMEANS_LUT_SIZE - 1; i++) lut[i] = expf(-(float)i * step);
+    lut[NLMEANS_LUT_SIZE - 1] = 0.0f;
+    params.lut = lut;
+
+    float patch_area = (float)((2 * patch_radius + 1) * (2 * patch_radius + 1) * params.dist_chan);
+    params.scale = 1.0f / (patch_area * h * h * step);
+    // При очень малом h все несовпадающие патчи получают нулевой вес; ограничение scale
+    // сохраняет это и не дает индексу выйти за int
+    if (params.scale > (float)NLMEANS_LUT_SIZE) params.scale = (float)NLMEANS_LUT_SIZE;
+    double limit = ceil((NLMEANS_LUT_SIZE - 1) / (double)params.scale);
+    params.ssd_limit = limit < (double)INT32_MAX ? (int32_t)limit : INT32_MAX;
+
+    size_t blocks_x = (width + NLMEANS_BLOCK_COLS - 1) / NLMEANS_BLOCK_COLS;
+    size_t blocks_y = (height + NLMEANS_BLOCK_ROWS - 1) / NLMEANS_BLOCK_ROWS;
+    size_t side = 2 * (size_t)patch_radius + 1;
+    size_t area_cols = NLMEANS_BLOCK_COLS + side - 1;
+    size_t block_size = (size_t)NLMEANS_BLOCK_ROWS * NLMEANS_BLOCK_COLS;
+
+    int parallel = width * height >= ipl_get_context()->profile.parallel_min_pixels;
+    int failed = 0;
+
+    // Блоки независимы: читают только дополненные копии и пишут каждый свой участок изображения
+    #pragma omp parallel if (parallel)
+    {
+        NlmeansBuffers buf;
+        buf.rows = (uint32_t*)malloc(side * area_cols * sizeof(uint32_t));
+        buf.columns = (uint32_t*)malloc(area_cols * sizeof(uint32_t));
+        buf.index = (int32_t*)malloc(NLMEANS_BLOCK_COLS * sizeof(int32_t));
+        buf.w = (float*)malloc(NLMEANS_BLOCK_COLS * sizeof(float));
+        buf.sum = (float*)malloc(block_size * chan * sizeof(float));
+        buf.weight = (float*)malloc(block_size * sizeof(float));
+        buf.weight_max = (float*)malloc(block_size * sizeof(float));
+        int ok = buf.rows && buf.columns && buf.index && buf.w && buf.sum && buf.weight && buf.weight_max;
+        if (!ok)
+        {
+            #pragma omp atomic write
+            failed = 1;
+        }
+
+        #pragma omp for schedule(dynamic)
+        for (ptrdiff_t b = 0; b < (ptrdiff_t)(blocks_x * blocks_y); b++)
+        {
+            if (!ok) continue;
+            size_t x0 = ((size_t)b % blocks_x) * NLMEANS_BLOCK_COLS;
+            size_t y0 = ((size_t)b / blocks_x) * NLMEANS_BLOCK_ROWS;
+            size_t cols = width - x0 < NLMEANS_BLOCK_COLS ? width - x0 : NLMEANS_BLOCK_COLS;
+            size_t rows = height - y0 < NLMEANS_BLOCK_ROWS ? height - y0 : NLMEANS_BLOCK_ROWS;
+            block(&params, &buf, image->data, x0, y0, cols, rows);
+        }
+
+        free(buf.rows);
+        free(buf.columns);
+        free(buf.index);
+        free(buf.w);
+        free(buf.sum);
+        free(buf.weight);
+        free(buf.weight_max);
+    }
+
+    free(luma_padded);
+    free((void*)params.value);
+
+    // Блоки потоков без буферов не обработаны, а остальные уже записаны: изображение не испорчено,
+    // но отфильтровано лишь частично
+    return failed ? OUT_OF_MEMORY : SUCCESS;
+}
+
+// @brief Подавляет шум методом нелокальных средних (non-local means). Каждый пиксель заменяется
+//        средним пикселей окна поиска с весами exp(-d / h^2), где d - средний квадрат разности
+//        патчей вокруг пикселей. Сумма квадратов разностей патча для каждого смещения окна
+//        берется из интегрального изображения (Darbon и др.), поэтому время работы не зависит
+//        от радиуса патча и растет только с площадью окна поиска.
+//        Расстояние считается по всем каналам изображения (см. ipl_nlmeans_luma).
+//
+// @param image         [in, out] Изображение из 1, 3 или 4 каналов. Фильтруется на месте.
+// @param h             [in]      Сила фильтра в единицах яркости (обычно близка к СКО шума, 5..20).
+// @param patch_radius  [in]      Радиус патча (0..IPL_NLMEANS_MAX_PATCH_RADIUS), обычно 1..3.
+// @param search_radius [in]      Радиус окна поиска, обычно 5..10. При 0 изображение не меняется.
+//
+// @return INVALID_ARGUMENT Невалидный аргумент.
+//                          Если `image` или `image->data` равен NULL, изображение пустое,
+//                          `h` не положительное или радиусы вне допустимых значений.
+// @return OUT_OF_MEMORY    Не удалось выделить память для дополненной копии или буферов потоков.
+// @return SUCCESS          Фильтр успешно применен.
+ImageProcStatus ipl_nlmeans(Image* image, const float h, const int patch_radius, const int search_radius)
+{
+    return nlmeans(image, h, patch_radius, search_radius, 0);
+}
+
+// @brief Нелокальные средние (см. ipl_nlmeans) с расстоянием патчей только по яркости.
+//        Веса, найденные по яркости, применяются ко всем каналам: цвет усредняется вместе
+//        с яркостью, а расчет расстояний дешевле в 3-4 раза. Для одноканальных изображений
+//        совпадает с ipl_nlmeans.
+//
+// @param image         [in, out] Изображение из 1, 3 или 4 каналов. Фильтруется на месте.
+// @param h             [in]      Сила фильтра в единицах яркости.
+// @param patch_radius  [in]      Радиус патча (0..IPL_NLMEANS_MAX_PATCH_RADIUS).
+// @param search_radius [in]      Радиус окна поиска. При 0 изображение не меняется.
+//
+// @return INVALID_ARGUMENT Невалидный аргумент (см. ipl_nlmeans).
+// @return OUT_OF_MEMORY    Не удалось выделить память.
+// @return SUCCESS          Фильтр успешно применен.
+ImageProcStatus ipl_nlmeans_luma(Image* image, const float h, const int patch_radius, const int search_radius)
+{
+    return nlmeans(image, h, patch_radius, search_radius, 1);
+}
@@ -0,0 +1,803 @@
+#include "pipeline.h"
+#include "context.h"
+#include "buffer.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <omp.h>
+
+// @brief Стадия исполнения: [точечные операции] -> [трафарет] -> [точечные операции].
+//        Стадия читает материализованный буфер base и пишет материализованный буфер target.
+//        Промежуточные результаты внутри стадии существуют только в пределах тайла или строки.
+typedef struct
+{
+    int target;     // Узел, результат которого материализуется стадией
+    int base;       // Материализованный узел, из которого читает стадия
+    int stencil;    // Трафаретный узел стадии или -1 для чисто точечной стадии
+    int* pre;       // Точечные операции перед трафаретом (или все операции точечной стадии)
+    int pre_count;
+    int* post;      // Точечные операции после трафарета
+    int post_count;
+    size_t tile_width;  // Размер выходного тайла (без учета ореола), из профиля контекста
+    size_t tile_height;
+    int use_iir;        // Гауссов трафарет считается рекурсивным фильтром (как в ipl_gaussian_filter)
+} PipelineStage;
+
+static int is_point_op(const PipelineOp op)
+{
+    return op == PIPELINE_OP_GRAYSCALE || op == PIPELINE_OP_THRESHOLD;
+}
+
+static ptrdiff_t clamp_index(ptrdiff_t val, ptrdiff_t min_val, ptrdiff_t max_val)
+{
+    if (val < min_val) return min_val;
+    if (val > max_val) return max_val;
+    return val;
+}
+
+// @brief Добавляет узел в граф. Возвращает индекс узла или -1 при ошибке.
+static int add_node(Pipeline* pipeline, const PipelineOp op, const int input, const float param, const int channels)
+{
+    if (pipeline->count == pipeline->capacity)
+    {
+        int capacity = pipeline->capacity ? pipeline->capacity * 2 : 8;
+        PipelineNode* nodes = (PipelineNode*)realloc(pipeline->nodes, capacity * sizeof(PipelineNode));
+        if (!nodes) return -1;
+        pipeline->nodes = nodes;
+        pipeline->capacity = capacity;
+    }
+
+    PipelineNode* node = &pipeline->nodes[pipeline->count];
+    node->op = op;
+    node->input = input;
+    node->param = param;
+    node->channels = channels;
+
+    return pipeline->count++;
+}
+
+static int valid_input(const Pipeline* pipeline, const int input)
+{
+    return pipeline && input >= 0 && input < pipeline->count;
+}
+
+// @brief Создает конвейер над исходным изображением. Узел источника имеет индекс PIPELINE_SOURCE.
+//
+// @param source [in] Исходное изображение. Данные не копируются и должны оставаться валидными до execute.
+// @return Указатель на конвейер или NULL при ошибке.
+Pipeline* ipl_pipeline_create(const Image* source)
+{
+    if (!source || !source->data) return NULL;
+
+    Pipeline* pipeline = (Pipeline*)calloc(1, sizeof(Pipeline));
+    if (!pipeline) return NULL;
+
+    pipeline->source = source;
+    if (add_node(pipeline, PIPELINE_OP_SOURCE, -1, 0.0f, source->channels) != PIPELINE_SOURCE)
+    {
+        ipl_pipeline_free(pipeline);
+        return NULL;
+    }
+
+    return pipeline;
+}
+
+// @brief Освобождает конвейер (исходное изображение не затрагивается).
+void ipl_pipeline_free(Pipeline* pipeline)
+{
+    if (pipeline) {
+        free(pipeline->nodes);
+        free(pipeline);
+    }
+}
+
+// @brief Добавляет узел преобразования в оттенки серого. Возвращает индекс узла или -1.
+int ipl_pipeline_grayscale(Pipeline* pipeline, const int input)
+{
+    if (!valid_input(pipeline, input)) return -1;
+    return add_node(pipeline, PIPELINE_OP_GRAYSCALE, input, 0.0f, 1);
+}
+
+// @brief Добавляет узел пороговой бинаризации (см. ipl_threshold). Возвращает индекс узла или -1.
+int ipl_pipeline_threshold(Pipeline* pipeline, const int input, const unsigned char level)
+{
+    if (!valid_input(pipeline, input)) return -1;
+    return add_node(pipeline, PIPELINE_OP_THRESHOLD, input, (float)level, pipeline->nodes[input].channels);
+}
+
+// @brief Добавляет узел гауссова фильтра (см. ipl_gaussian_filter). Возвращает индекс узла или -1.
+//        При sigma <= 1e-6 фильтр не меняет изображение, поэтому возвращается сам входной узел.
+int ipl_pipeline_gaussian(Pipeline* pipeline, const int input, const float sigma)
+{
+    if (!valid_input(pipeline, input) || sigma < 0.0f) return -1;
+    if (sigma <= 1e-6f) return input;
+    return add_node(pipeline, PIPELINE_OP_GAUSSIAN, input, sigma, pipeline->nodes[input].channels);
+}
+
+// @brief Добавляет узел медианного фильтра (см. ipl_median_filter). Возвращает индекс узла или -1.
+//        Радиус 0 не меняет изображение, поэтому возвращается сам входной узел.
+int ipl_pipeline_median(Pipeline* pipeline, const int input, const int radius)
+{
+    if (!valid_input(pipeline, input) || radius < 0) return -1;
+    if (radius == 0) return input;
+    return add_node(pipeline, PIPELINE_OP_MEDIAN, input, (float)radius, pipeline->nodes[input].channels);
+}
+
+// @brief Добавляет узел детекции границ Собеля (см. ipl_sobel_edge_detection). Возвращает индекс узла или -1.
+int ipl_pipeline_sobel(Pipeline* pipeline, const int input)
+{
+    if (!valid_input(pipeline, input)) return -1;
+    return add_node(pipeline, PIPELINE_OP_SOBEL, input, 0.0f, 1);
+}
+
+// @brief Радиус ореола трафаретной операции. Для гауссова фильтра - ipl_gaussian_halo, как у фильтров
+//        по областям и инкрементальных обновлений: радиус ядра прямой свертки или 4 * sigma для рекурсивного
+//        фильтра. Рекурсивный фильтр имеет бесконечный отклик, поэтому его стадии совпадают с ipl_gaussian_filter
+//        всего кадра только приближенно (прямая свертка совпадает побитово).
+static int stencil_radius(const PipelineNode* node)
+{
+    switch (node->op)
+    {
+    case PIPELINE_OP_GAUSSIAN: return (int)ipl_gaussian_halo(node->param);
+    case PIPELINE_OP_MEDIAN:   return (int)node->param;
+    case PIPELINE_OP_SOBEL:    return 1;
+    default:                   return 0;
+    }
+}
+
+// @brief Суммарный ореол узла: насколько далеко от измененного пикселя источника может измениться результат узла.
+static size_t node_halo(const Pipeline* pipeline, int node)
+{
+    size_t halo = 0;
+    for (; node != PIPELINE_SOURCE; node = pipeline->nodes[node].input)
+        halo += (size_t)stencil_radius(&pipeline->nodes[node]);
+    return halo;
+}
+
+// @brief Применяет цепочку точечных операций к последовательности пикселей на месте.
+//        Точечные операции не увеличивают число каналов, поэтому буфера входа всегда достаточно.
+//
+// @return Количество каналов результата.
+static int apply_point_ops(const Pipeline* pipeline, const int* ops, const int count, unsigned char* data, const size_t pixels, int channels)
+{
+    for (int k = 0; k < count; k++)
+    {
+        const PipelineNode* node = &pipeline->nodes[ops[k]];
+        if (node->op == PIPELINE_OP_GRAYSCALE && channels > 1)
+        {
+            convert_to_one_channel(data, data, pixels, 1, channels);
+            channels = 1;
+        }
+        else if (node->op == PIPELINE_OP_THRESHOLD)
+        {
+            threshold_row(data, data, pixels * channels, (unsigned char)node->param);
+        }
+    }
+    return channels;
+}
+
+// @brief Копирует отрезок строки [x0, x0 + count) с отражением координат за границами (clamp to edge).
+static void gather_row(const unsigned char* src_row, unsigned char* dst, const size_t width, const int channels, const ptrdiff_t x0, const size_t count)
+{
+    ptrdiff_t x = x0;
+    ptrdiff_t end = x0 + (ptrdiff_t)count;
+
+    // Левая граница
+    for (; x < 0 && x < end; x++, dst += channels)
+        memcpy(dst, src_row, channels);
+
+    // Внутренняя часть копируется одним блоком
+    ptrdiff_t inner_end = end < (ptrdiff_t)width ? end : (ptrdiff_t)width;
+    if (inner_end > x)
+    {
+        size_t bytes = (size_t)(inner_end - x) * channels;
+        memcpy(dst, src_row + (size_t)x * channels, bytes);
+        dst += bytes;
+        x = inner_end;
+    }
+
+    // Правая граница
+    for (; x < end; x++, dst += channels)
+        memcpy(dst, src_row + (width - 1) * channels, channels);
+}
+
+// @brief Медианный фильтр по тайлу с ореолом radius (тайл играет роль дополненного холста).
+static void median_tile(unsigned char* tile, unsigned char* out, const int channels, const size_t halo_width, const size_t tile_width, const size_t tile_height, const int radius)
+{
+    size_t ldp = halo_width * channels;
+    size_t ldo = tile_width * channels;
+
+    // Для маленьких окон сортировка окна быстрее гистограммы (как в ipl_median_filter)
+    if (radius <= ipl_get_context()->profile.median_sort_max_radius && radius <= MEDIAN_SORT_LIMIT)
+        median_sort_rows(tile, ldp, out, ldo, channels, tile_width, tile_height, radius);
+    else
+        median_histogram_rows(tile, ldp, out, ldo, channels, tile_width, tile_height, radius);
+}
+
+// @brief Исполняет точечную стадию построчно (блоки строк распределяются задачами OpenMP).
+static ImageProcStatus run_point_stage(const Pipeline* pipeline, const PipelineStage* stage, const unsigned char* base, unsigned char* dest)
+{
+    size_t width = pipeline->source->width;
+    size_t height = pipeline->source->height;
+    int base_ch = pipeline->nodes[stage->base].channels;
+    int out_ch = pipeline->nodes[stage->target].channels;
+    size_t block = stage->tile_height;
+    ptrdiff_t blocks = (ptrdiff_t)((height + block - 1) / block);
+    int failed = 0;
+
+    #pragma omp taskloop grainsize(1) shared(failed)
+    for (ptrdiff_t b = 0; b < blocks; b++)
+    {
+        unsigned char* row = (unsigned char*)malloc(width * base_ch);
+        if (!row) {
+            #pragma omp atomic write
+            failed = 1;
+            continue;
+        }
+
+        size_t y0 = (size_t)b * block;
+        size_t y1 = y0 + block < height ? y0 + block : height;
+        for (size_t i = y0; i < y1; i++)
+        {
+            memcpy(row, base + i * width * base_ch, width * base_ch);
+            apply_point_ops(pipeline, stage->pre, stage->pre_count, row, width, base_ch);
+            memcpy(dest + i * width * out_ch, row, width * out_ch);
+        }
+
+        free(row);
+    }
+
+    return failed ? OUT_OF_MEMORY : SUCCESS;
+}
+
+// @brief Обрабатывает один тайл трафаретной стадии.
+//        Тайл загружается из base вместе с ореолом (с отражением на границах изображения),
+//        к нему применяются предшествующие точечные операции, затем трафарет,
+//        затем последующие точечные операции, и внутренняя часть тайла записывается в dest.
+//
+// @param scratch [in] Рабочий буфер: для рекурсивного гауссова фильтра буфер gaussian_iir_buffer_size,
+//                     затем строка (halo_w * base_ch) и три тайла (halo_w * halo_h * in_ch).
+//
+// @return OUT_OF_MEMORY Оператору Собеля не хватило памяти под буфер строк.
+// @return SUCCESS       Тайл записан в dest.
+static ImageProcStatus process_tile(const Pipeline* pipeline, const PipelineStage* stage, const Kernel* kernel, const unsigned char* base, unsigned char* dest,
+                         const size_t x0, const size_t y0, unsigned char* scratch)
+{
+    const PipelineNode* stencil = &pipeline->nodes[stage->stencil];
+    size_t width = pipeline->source->width;
+    size_t height = pipeline->source->height;
+    int base_ch = pipeline->nodes[stage->base].channels;
+    int in_ch = pipeline->nodes[stencil->input].channels;
+    int st_ch = stencil->channels;
+    int out_ch = pipeline->nodes[stage->target].channels;
+    int radius = stencil_radius(stencil);
+
+    size_t tw = width - x0 < stage->tile_width ? width - x0 : stage->tile_width;
+    size_t th = height - y0 < stage->tile_height ? height - y0 : stage->tile_height;
+    size_t hw = tw + 2 * (size_t)radius;
+    size_t hh = th + 2 * (size_t)radius;
+    size_t halo_w = stage->tile_width + 2 * (size_t)radius;
+    size_t tile_bytes = halo_w * (stage->tile_height + 2 * (size_t)radius) * in_ch;
+
+    void* iir_buffer = scratch; // используется только рекурсивным фильтром
+    unsigned char* row = stage->use_iir ? scratch + gaussian_iir_buffer_size(in_ch, halo_w, stage->tile_height + 2 * (size_t)radius, stencil->param) : scratch;
+    unsigned char* tile = row + halo_w * base_ch;
+    unsigned char* tmp = tile + tile_bytes;
+    unsigned char* out = tmp + tile_bytes;
+
+    // Загрузка тайла с ореолом и слитыми точечными операциями
+    for (size_t i = 0; i < hh; i++)
+    {
+        ptrdiff_t sy = clamp_index((ptrdiff_t)(y0 + i) - radius, 0, (ptrdiff_t)height - 1);
+        gather_row(base + (size_t)sy * width * base_ch, row, width, base_ch, (ptrdiff_t)x0 - radius, hw);
+        apply_point_ops(pipeline, stage->pre, stage->pre_count, row, hw, base_ch);
+        memcpy(tile + i * hw * in_ch, row, hw * in_ch);
+    }
+
+    // Трафарет. result указывает на левый верхний пиксель внутренней части тайла.
+    const unsigned char* result = out;
+    size_t result_stride = hw;
+    ImageProcStatus status = SUCCESS;
+    switch (stencil->op)
+    {
+    case PIPELINE_OP_GAUSSIAN:
+        if (stage->use_iir)
+        {
+            gaussian_iir_filter(tile, iir_buffer, in_ch, hw, hh, stencil->param);
+            result = tile + ((size_t)radius * hw + radius) * st_ch;
+            break;
+        }
+        horizontal_convolution(tile, tmp, in_ch, hw, hh, kernel);
+        vertical_convolution(tmp, out, in_ch, hw, hh, kernel);
+        result = out + ((size_t)radius * hw + radius) * st_ch;
+        break;
+
+    case PIPELINE_OP_MEDIAN:
+        median_tile(tile, out, in_ch, hw, tw, th, radius);
+        result_stride = tw;
+        break;
+
+    case PIPELINE_OP_SOBEL:
+        status = compute_sobel_magnitude_channels(tile, out, hw, hh, in_ch);
+        if (status != SUCCESS) return status;
+        result = out + hw + 1;
+        break;
+
+    default:
+        break;
+    }
+
+    // Запись внутренней части тайла со слитыми последующими точечными операциями
+    for (size_t i = 0; i < th; i++)
+    {
+        size_t y = y0 + i;
+        // ipl_sobel_edge_detection оставляет первую и последнюю строки нулевыми
+        if (stencil->op == PIPELINE_OP_SOBEL && (y == 0 || y == height - 1))
+            memset(row, 0, tw * st_ch);
+        else
+            memcpy(row, result + i * result_stride * st_ch, tw * st_ch);
+
+        apply_point_ops(pipeline, stage->post, stage->post_count, row, tw, st_ch);
+        memcpy(dest + (y * width + x0) * out_ch, row, tw * out_ch);
+    }
+
+    return status;
+}
+
+// @brief Исполняет трафаретную стадию по тайлам с перекрывающимися ореолами.
+//        Тайлы распределяются задачами OpenMP, поэтому независимые стадии могут исполняться одновременно.
+static ImageProcStatus run_stencil_stage(const Pipeline* pipeline, const PipelineStage* stage, const unsigned char* base, unsigned char* dest)
+{
+    const PipelineNode* stencil = &pipeline->nodes[stage->stencil];
+    size_t width = pipeline->source->width;
+    size_t height = pipeline->source->height;
+    int base_ch = pipeline->nodes[stage->base].channels;
+    int in_ch = pipeline->nodes[stencil->input].channels;
+    size_t radius = (size_t)stencil_radius(stencil);
+
+    Kernel* kernel = NULL;
+    if (stencil->op == PIPELINE_OP_GAUSSIAN && !stage->use_iir)
+    {
+        kernel = generate_gaussian_kernel(stencil->param);
+        if (!kernel) return OUT_OF_MEMORY;
+    }
+
+    // base_ch >= in_ch >= каналов трафарета: точечные операции и трафареты не добавляют каналов
+    size_t halo_w = stage->tile_width + 2 * radius;
+    size_t halo_h = stage->tile_height + 2 * radius;
+    size_t scratch_bytes = halo_w * base_ch + 3 * halo_w * halo_h * in_ch;
+    if (stage->use_iir) scratch_bytes += gaussian_iir_buffer_size(in_ch, halo_w, halo_h, stencil->param);
+
+    size_t tiles_x = (width + stage->tile_width - 1) / stage->tile_width;
+    size_t tiles_y = (height + stage->tile_height - 1) / stage->tile_height;
+    ptrdiff_t tile_count = (ptrdiff_t)(tiles_x * tiles_y);
+    int failed = 0;
+
+    #pragma omp taskloop grainsize(1) shared(failed)
+    for (ptrdiff_t t = 0; t < tile_count; t++)
+    {
+        unsigned char* scratch = (unsigned char*)malloc(scratch_bytes);
+        if (!scratch) {
+            #pragma omp atomic write
+            failed = 1;
+            continue;
+        }
+
+        size_t x0 = ((size_t)t % tiles_x) * stage->tile_width;
+        size_t y0 = ((size_t)t / tiles_x) * stage->tile_height;
+        if (process_tile(pipeline, stage, kernel, base, dest, x0, y0, scratch) != SUCCESS)
+        {
+            #pragma omp atomic write
+            failed = 1;
+        }
+
+        free(scratch);
+    }
+
+    free_kernel(kernel);
+
+    return failed ? OUT_OF_MEMORY : SUCCESS;
+}
+
+// @brief Строит стадию, материализующую узел target.
+//        Точечные узлы после трафарета сливаются в post, перед трафаретом - в pre.
+//        Массивы stage->pre и stage->post должны вмещать по pipeline->count элементов.
+static void build_stage(const Pipeline* pipeline, const int* materialized, const int target, PipelineStage* stage)
+{
+    int* chain = stage->post; // Пока трафарет не встречен, операции считаются последующими
+    int* chain_count = &stage->post_count;
+    int node = target;
+
+    stage->target = target;
+    stage->stencil = -1;
+    stage->pre_count = 0;
+    stage->post_count = 0;
+
+    // Обход назад по единственному входу узлов до ближайшего материализованного узла
+    while (node == target || !materialized[node])
+    {
+        const PipelineNode* n = &pipeline->nodes[node];
+        if (is_point_op(n->op))
+        {
+            chain[(*chain_count)++] = node;
+        }
+        else
+        {
+            stage->stencil = node;
+            chain = stage->pre;
+            chain_count = &stage->pre_count;
+        }
+        node = n->input;
+    }
+    stage->base = node;
+
+    // Если трафарета нет, все точечные операции относятся к цепочке pre
+    if (stage->stencil < 0)
+    {
+        int* tmp = stage->pre; stage->pre = stage->post; stage->post = tmp;
+        stage->pre_count = stage->post_count;
+        stage->post_count = 0;
+    }
+
+    // Цепочки собраны в обратном порядке, разворачиваем в порядок исполнения
+    int* parts[2] = {stage->pre, stage->post};
+    int counts[2] = {stage->pre_count, stage->post_count};
+    for (int k = 0; k < 2; k++)
+    {
+        for (int i = 0; i < counts[k] / 2; i++)
+        {
+            int tmp = parts[k][i];
+            parts[k][i] = parts[k][counts[k] - 1 - i];
+            parts[k][counts[k] - 1 - i] = tmp;
+        }
+    }
+}
+
+// @brief Вычисляет указанные узлы конвейера (см. ipl_pipeline_execute_with_callback).
+ImageProcStatus ipl_pipeline_execute(Pipeline* pipeline, const int* outputs, Image* results, const int count)
+{
+    return ipl_pipeline_execute_with_callback(pipeline, outputs, results, count, NULL, NULL);
+}
+
+// @brief Заполняет результаты, соответствующие материализованному узлу node.
+//        Первый запрос узла получает сам буфер, повторные - его копии.
+//        После заполнения для каждого результата вызывается callback (если задан).
+static ImageProcStatus publish_outputs(const Pipeline* pipeline, const int* outputs, Image* results, const int count, const int node,
+                                       unsigned char* data, PipelineOutputCallback callback, void* context)
+{
+    size_t bytes = pipeline->source->width * pipeline->source->height * pipeline->nodes[node].channels;
+    int first = -1;
+
+    for (int o = 0; o < count; o++)
+    {
+        if (outputs[o] != node) continue;
+
+        results[o].format = pipeline->source->format;
+        results[o].width = pipeline->source->width;
+        results[o].height = pipeline->source->height;
+        results[o].channels = pipeline->nodes[node].channels;
+
+        if (first < 0 && node != PIPELINE_SOURCE)
+        {
+            first = o; // буфер отдается последним, после снятия копий
+            continue;
+        }
+        results[o].data = (unsigned char*)ipl_buffer_alloc(bytes);
+        if (!results[o].data)
+        {
+            // Буфер стадии остается у результата first и освобождается вместе с остальными результатами
+            if (first >= 0) results[first].data = data;
+            return OUT_OF_MEMORY;
+        }
+        memcpy(results[o].data, data, bytes);
+    }
+    if (first >= 0) results[first].data = data;
+
+    if (callback)
+    {
+        for (int o = 0; o < count; o++)
+        {
+            if (outputs[o] == node) callback(context, o, &results[o]);
+        }
+    }
+
+    return SUCCESS;
+}
+
+// @brief Вычисляет указанные узлы конвейера.
+//        Исполнитель материализует только источник, запрошенные узлы и трафаретные узлы,
+//        результат которых нужен нескольким потребителям или другому трафарету.
+//        Точечные операции сливаются с соседними трафаретами, трафареты исполняются по тайлам,
+//        а промежуточные буферы освобождаются сразу после последнего чтения.
+//        Стадии являются задачами OpenMP с зависимостями по буферам, поэтому независимые ветви
+//        графа вычисляются параллельно, а общие префиксы - один раз.
+//
+// @param pipeline [in]  Указатель на конвейер.
+// @param outputs  [in]  Массив индексов узлов, результаты которых нужно получить.
+// @param results  [out] Массив из count изображений для результатов.
+//                       Память под results[i].data выделяется функцией и освобождается free_image_data.
+// @param count    [in]  Количество запрошенных узлов.
+// @param callback [in]  Функция, вызываемая сразу после готовности каждого результата (может быть NULL).
+//                       Вызывается из рабочего потока, пока остальные стадии продолжают вычисляться.
+//                       Может забрать results[i].data (например, сохранить и освободить через ipl_save_image).
+//                       Если функция возвращает ошибку, все results[i].data, не забранные callback
+//                       (в том числе уже переданные ему), освобождаются и обнуляются.
+// @param context  [in]  Пользовательский контекст для callback.
+//
+// @return INVALID_ARGUMENT Некорректный конвейер или индекс узла.
+// @return OUT_OF_MEMORY    Не удалось выделить память.
+// @return SUCCESS          Все запрошенные узлы вычислены.
+ImageProcStatus ipl_pipeline_execute_with_callback(Pipeline* pipeline, const int* outputs, Image* results, const int count,
+                                                   PipelineOutputCallback callback, void* context)
+{
+    if (!pipeline || !outputs || !results || count <= 0) return INVALID_ARGUMENT;
+    for (int o = 0; o < count; o++)
+    {
+        if (!valid_input(pipeline, outputs[o])) return INVALID_ARGUMENT;
+    }
+
+    int n = pipeline->count;
+    size_t pixels = pipeline->source->width * pipeline->source->height;
+    ImageProcStatus status = SUCCESS;
+
+    // Служебные массивы: needed, users, consumer, output_of, materialized, readers
+    int* info = (int*)calloc((size_t)n * 6, sizeof(int));
+    unsigned char** buffers = (unsigned char**)calloc(n, sizeof(unsigned char*));
+    char* deps = (char*)calloc(n, sizeof(char)); // адреса для зависимостей задач
+    PipelineStage* stages = (PipelineStage*)calloc(n, sizeof(PipelineStage));
+    int* stage_ops = (int*)malloc((size_t)n * n * 2 * sizeof(int));
+    if (!info || !buffers || !deps || !stages || !stage_ops)
+    {
+        free(info);
+        free(buffers);
+        free(deps);
+        free(stages);
+        free(stage_ops);
+        return OUT_OF_MEMORY;
+    }
+    int* needed = info;
+    int* users = info + n;
+    int* consumer = info + 2 * n;
+    int* output_of = info + 3 * n;      // 1, если узел запрошен
+    int* materialized = info + 4 * n;
+    int* readers = info + 5 * n;
+
+    for (int o = 0; o < count; o++)
+    {
+        needed[outputs[o]] = 1;
+        output_of[outputs[o]] = 1;
+        results[o].data = NULL;
+    }
+    for (int i = n - 1; i > 0; i--)
+    {
+        if (!needed[i]) continue;
+        int in = pipeline->nodes[i].input;
+        needed[in] = 1;
+        users[in]++;
+        consumer[in] = i;
+    }
+
+    // Выбор материализуемых узлов
+    for (int i = 0; i < n; i++)
+    {
+        if (!needed[i]) continue;
+        if (i == PIPELINE_SOURCE || output_of[i]) { materialized[i] = 1; continue; }
+        if (is_point_op(pipeline->nodes[i].op)) continue;
+
+        // Трафарет не материализуется, если его единственный потребитель - цепочка точечных
+        // операций, заканчивающаяся запрошенным узлом (она сливается с ним как post)
+        int k = i;
+        int fusable = 0;
+        while (users[k] == 1)
+        {
+            k = consumer[k];
+            if (!is_point_op(pipeline->nodes[k].op)) break;
+            if (output_of[k]) { fusable = 1; break; }
+        }
+        materialized[i] = !fusable;
+    }
+
+    // Планирование стадий (узлы уже в топологическом порядке)
+    const TuningProfile* profile = &ipl_get_context()->profile;
+    for (int i = 1; i < n; i++)
+    {
+        if (!needed[i] || !materialized[i]) continue;
+        stages[i].pre = stage_ops + (size_t)i * n * 2;
+        stages[i].post = stages[i].pre + n;
+        build_stage(pipeline, materialized, i, &stages[i]);
+        stages[i].tile_width = (size_t)profile->tile_width;
+        stages[i].tile_height = (size_t)profile->tile_height;
+        stages[i].use_iir = stages[i].stencil >= 0 && pipeline->nodes[stages[i].stencil].op == PIPELINE_OP_GAUSSIAN &&
+                            pipeline->nodes[stages[i].stencil].param >= profile->gaussian_iir_sigma &&
+                            pipeline->nodes[stages[i].stencil].param >= 0.5f;
+        readers[stages[i].base]++;
+    }
+
+    buffers[PIPELINE_SOURCE] = pipeline->source->data;
+
+    #pragma omp parallel
+    #pragma omp single
+    {
+        if (output_of[PIPELINE_SOURCE])
+            status = publish_outputs(pipeline, outputs, results, count, PIPELINE_SOURCE, buffers[PIPELINE_SOURCE], callback, context);
+
+        for (int i = 1; i < n; i++)
+        {
+            if (!needed[i] || !materialized[i]) continue;
+
+            PipelineStage* stage = &stages[i];
+            #pragma omp task firstprivate(i, stage) shared(status, buffers, readers, output_of, results) depend(in: deps[stage->base]) depend(out: deps[i])
+            {
+                ImageProcStatus stage_status;
+                #pragma omp atomic read
+                stage_status = status;
+
+                if (stage_status == SUCCESS)
+                {
+                    buffers[i] = (unsigned char*)ipl_buffer_alloc(pixels * pipeline->nodes[i].channels);
+                    if (!buffers[i])
+                        stage_status = OUT_OF_MEMORY;
+                    else if (stage->stencil < 0)
+                        stage_status = run_point_stage(pipeline, stage, buffers[stage->base], buffers[i]);
+                    else
+                        stage_status = run_stencil_stage(pipeline, stage, buffers[stage->base], buffers[i]);
+                }
+
+                // Промежуточный буфер больше никому не нужен
+                int base = stage->base;
+                int left;
+                #pragma omp atomic capture
+                left = --readers[base];
+                if (left == 0 && base != PIPELINE_SOURCE && !output_of[base])
+                {
+                    free(buffers[base]);
+                    buffers[base] = NULL;
+                }
+
+                if (stage_status == SUCCESS && output_of[i])
+                {
+                    unsigned char* data = buffers[i];
+                    // Буфер запрошенного узла может еще читаться другими стадиями,
+                    // поэтому при наличии читателей результат получает копию
+                    if (readers[i] > 0)
+                    {
+                        data = (unsigned char*)ipl_buffer_alloc(pixels * pipeline->nodes[i].channels);
+                        if (data) memcpy(data, buffers[i], pixels * pipeline->nodes[i].channels);
+                        else stage_status = OUT_OF_MEMORY;
+                    }
+                    else
+                    {
+                        buffers[i] = NULL;
+                    }
+                    if (data) stage_status = publish_outputs(pipeline, outputs, results, count, i, data, callback, context);
+                }
+
+                if (stage_status != SUCCESS)
+                {
+                    #pragma omp atomic write
+                    status = stage_status;
+                }
+            }
+        }
+    }
+
+    if (status != SUCCESS)
+    {
+        for (int o = 0; o < count; o++)
+        {
+            free(results[o].data);
+            results[o].data = NULL;
+        }
+    }
+
+    for (int i = 1; i < n; i++)
+    {
+        free(buffers[i]);
+    }
+    free(stage_ops);
+    free(stages);
+    free(deps);
+    free(buffers);
+    free(info);
+
+    return status;
+}
+
+// @brief Инкрементально обновляет результаты конвейера после изменения источника внутри прямоугольников dirty
+//        (например, после мазка кисти в редакторе). Изменения распространяются по цепочке операций:
+//        результат узла может измениться не дальше суммы радиусов трафаретов на пути от источника к нему.
+//        Для каждой объединенной области изменений конвейер исполняется на вырезке источника с таким же
+//        ореолом вокруг нее, и в results копируется только сама область. Поэтому стоимость пропорциональна
+//        размеру изменений, а промежуточные результаты между вызовами хранить не нужно.
+//
+// @param pipeline    [in]      Конвейер. Его источник уже содержит изменения.
+// @param dirty       [in]      Измененные прямоугольники источника.
+// @param dirty_count [in]      Количество прямоугольников.
+// @param outputs     [in]      Индексы узлов, результаты которых нужно обновить.
+// @param results     [in, out] Результаты узлов outputs для источника до изменения (ipl_pipeline_execute),
+//                              обновляются на месте.
+// @param count       [in]      Количество узлов.
+//
+// @return INVALID_ARGUMENT Некорректный конвейер, индекс узла или результат не соответствует узлу.
+// @return OUT_OF_MEMORY    Не удалось выделить память.
+// @return SUCCESS          Результаты обновлены.
+ImageProcStatus ipl_pipeline_update(Pipeline* pipeline, const Rect* dirty, const int dirty_count, const int* outputs, Image* results, const int count)
+{
+    if (!pipeline || !outputs || !results || count <= 0 || dirty_count < 0 || (!dirty && dirty_count > 0)) return INVALID_ARGUMENT;
+
+    const Image* source = pipeline->source;
+    size_t halo = 0;
+    for (int o = 0; o < count; o++)
+    {
+        if (!valid_input(pipeline, outputs[o]) || !results[o].data) return INVALID_ARGUMENT;
+        if (results[o].width != source->width || results[o].height != source->height ||
+            (int)results[o].channels != pipeline->nodes[outputs[o]].channels) return INVALID_ARGUMENT;
+
+        size_t node = node_halo(pipeline, outputs[o]);
+        if (node > halo) halo = node;
+    }
+
+    // Области, в которых могут измениться результаты (с ореолом самого глубокого узла)
+    Rect* regions = (Rect*)malloc((dirty_count > 0 ? dirty_count : 1) * sizeof(Rect));
+    Image* partial = (Image*)malloc(count * sizeof(Image));
+    if (!regions || !partial)
+    {
+        free(regions);
+        free(partial);
+        return OUT_OF_MEMORY;
+    }
+    int region_count = ipl_grow_rects(dirty, dirty_count, halo, source->width, source->height, regions);
+
+    ImageProcStatus status = SUCCESS;
+    for (int r = 0; r < region_count && status == SUCCESS; r++)
+    {
+        const Rect* region = &regions[r];
+
+        // Вырезка источника с ореолом: внутри области результат по вырезке совпадает с результатом по всему источнику
+        Rect crop;
+        ipl_grow_rects(region, 1, halo, source->width, source->height, &crop);
+
+        Image view = *source;
+        view.width = crop.width;
+        view.height = crop.height;
+        view.data = (unsigned char*)ipl_buffer_alloc(crop.width * crop.height * source->channels);
+        if (!view.data)
+        {
+            status = OUT_OF_MEMORY;
+            break;
+        }
+        for (size_t y = 0; y < crop.height; y++)
+        {
+            memcpy(view.data + y * crop.width * source->channels,
+                   source->data + ((crop.y + y) * source->width + crop.x) * source->channels,
+                   crop.width * source->channels);
+        }
+
+        Pipeline local = *pipeline;
+        local.source = &view;
+        status = ipl_pipeline_execute(&local, outputs, partial, count);
+
+        if (status == SUCCESS)
+        {
+            for (int o = 0; o < count; o++)
+            {
+                size_t ch = partial[o].channels;
+                for (size_t y = region->y; y < region->y + region->height; y++)
+                {
+                    memcpy(results[o].data + (y * source->width + region->x) * ch,
+                           partial[o].data + ((y - crop.y) * crop.width + region->x - crop.x) * ch,
+                           region->width * ch);
+                }
+                free(partial[o].data);
+            }
+        }
+
+        free(view.data);
+    }
+
+    free(partial);
+    free(regions);
+
+    return status;
+}
@@ -0,0 +1,568 @@
+#ifndef PNG_DECODER_H
+#define PNG_DECODER_H
+
+// Декодер PNG глубиной 8 бит без чересстрочности поверх функций чтения чанков stb_image.
+// Включается только в input_output.c после реализации stb_image.
+//
+// Распаковка zlib (RFC 1950/1951) табличная: коды Хаффмана декодируются по первичной таблице на PNG_LITLEN_BITS
+// (PNG_DIST_BITS для расстояний) бит с подтаблицами для длинных кодов, биты читаются в 64-битный буфер по 8 байт,
+// и после одного пополнения буфера декодируется до трех литералов или пара длина-расстояние целиком.
+// Повторы копируются по 8 байт. Строки восстанавливаются ядром png_unfilter из таблицы SIMD.
+//
+// Результат совпадает с stbi_load. Остальные файлы (16 бит, глубина меньше 8 бит, чересстрочные, серый с альфой
+// или прозрачным цветом, CgBI) и любые ошибки разбора возвращают DECODE_FALLBACK: их декодирует (или отклоняет
+// с той же ошибкой) stb_image.
+
+#include <stdint.h>
+#include <string.h>
+#include "buffer.h"
+#include "context.h"
+#include "jpeg_decoder.h"
+
+#define PNG_LITLEN_BITS 10  // Бит первичной таблицы литералов и длин
+#define PNG_DIST_BITS   8   // Бит первичной таблицы расстояний
+#define PNG_MAX_BITS    15  // Максимальная длина кода DEFLATE
+#define PNG_COPY_SLACK  8   // Запас в конце буфера распаковки для копирования повторов по 8 байт
+
+// Запись таблицы декодирования: биты 0-7 - длина кода, 8-12 - число дополнительных бит, 13-15 - флаги,
+// 16-31 - литерал, основание длины или расстояния, либо смещение подтаблицы.
+// Запись без флагов с нулевым основанием - недопустимый код.
+#define PNG_ENTRY_SUBTABLE 0x2000u
+#define PNG_ENTRY_END      0x4000u
+#define PNG_ENTRY_LITERAL  0x8000u
+
+// Размер таблицы: первичная часть и подтаблицы на 2^(15 - bits) записей для каждого символа с длинным кодом
+#define PNG_TABLE_SIZE(bits, symbols) ((1 << (bits)) + (symbols) * (1 << (PNG_MAX_BITS - (bits))))
+
+static const unsigned short PNG_LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const unsigned char PNG_LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const unsigned short PNG_DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const unsigned char PNG_DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const unsigned char PNG_CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+// @brief Состояние распаковки. Выход распаковывается целиком в буфер известного размера.
+typedef struct
+{
+    const stbi_uc* in;
+    const stbi_uc* in_end;
+    uint64_t bits;         // Буфер бит (младшие - следующие в потоке)
+    int count;             // Число действительных бит в буфере
+    int overrun;           // Число нулевых байт, добавленных после конца входа
+    stbi_uc* out_begin;
+    stbi_uc* out;
+    stbi_uc* out_end;      // За концом есть PNG_COPY_SLACK байт запаса
+    uint32_t litlen[PNG_TABLE_SIZE(PNG_LITLEN_BITS, 288)];
+    uint32_t dist[PNG_TABLE_SIZE(PNG_DIST_BITS, 32)];
+} PngInflate;
+
+// @brief 8 байт потока в порядке little-endian.
+static inline uint64_t png_load64(const stbi_uc* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+// Пополнение буфера до 56 и более бит: 8 байт одним чтением (уже загруженные байты перезаписываются теми же значениями),
+// у конца входа - по байту, после конца - нулями
+#define PNG_REFILL(in, in_end, bits, count, overrun)      \
+    do                                                    \
+    {                                                     \
+        if ((in_end) - (in) >= 8)                         \
+        {                                                 \
+            (bits) |= png_load64(in) << (count);          \
+            (in) += (63 - (count)) >> 3;                  \
+            (count) |= 56;                                \
+        }                                                 \
+        else                                              \
+        {                                                 \
+            while ((count) <= 56)                         \
+            {                                             \
+                if ((in) < (in_end)) (bits) |= (uint64_t)*(in)++ << (count); \
+                else (overrun)++;                         \
+                (count) += 8;                             \
+            }                                             \
+        }                                                 \
+    } while (0)
+
+// @brief Извлекает n (не больше 32) бит потока.
+static inline unsigned png_take(PngInflate* f, const int n)
+{
+    if (f->count < n) PNG_REFILL(f->in, f->in_end, f->bits, f->count, f->overrun);
+    unsigned v = (unsigned)(f->bits & ((1ull << n) - 1));
+    f->bits >>= n;
+    f->count -= n;
+    return v;
+}
+
+// @brief Запись таблицы для следующих бит потока.
+static inline uint32_t png_lookup(const uint32_t* table, const uint64_t bits, const int primary)
+{
+    uint32_t entry = table[bits & ((1u << primary) - 1)];
+    if (entry & PNG_ENTRY_SUBTABLE) entry = table[(entry >> 16) + ((bits >> primary) & ((1u << (PNG_MAX_BITS - primary)) - 1))];
+    return entry;
+}
+
+// @brief Строит таблицу декодирования канонического кода Хаффмана (RFC 1951, 3.2.2) по длинам кодов.
+//
+// @param symbols [in] Запись каждого символа без длины кода.
+//
+// @return 0, если набор длин переполнен (такой поток отклоняет и stb_image).
+static int png_build_table(uint32_t* table, const int primary, const stbi_uc* lengths, const int count, const uint32_t* symbols)
+{
+    int counts[PNG_MAX_BITS + 1] = { 0 }, next[PNG_MAX_BITS + 1];
+    for (int s = 0; s < count; s++) counts[lengths[s]]++;
+
+    int left = 1;
+    next[1] = 0;
+    for (int len = 1; len <= PNG_MAX_BITS; len++)
+    {
+        left = (left << 1) - counts[len];
+        if (left < 0) return 0;
+        if (len > 1) next[len] = (next[len - 1] + counts[len - 1]) << 1;
+    }
+
+    const int sub_bits = PNG_MAX_BITS - primary;
+    uint32_t used = 1u << primary;
+    memset(table, 0, used * sizeof(uint32_t));
+    for (int s = 0; s < count; s++)
+    {
+        const int len = lengths[s];
+        if (!len) continue;
+
+        // Коды DEFLATE записываются начиная со старшего бита, а буфер читается с младшего
+        unsigned code = (unsigned)next[len]++, reversed = 0;
+        for (int k = 0; k < len; k++, code >>= 1) reversed = (reversed << 1) | (code & 1);
+
+        const uint32_t entry = symbols[s] | (uint32_t)len;
+        if (len <= primary)
+        {
+            for (unsigned r = reversed; r < (1u << primary); r += 1u << len) table[r] = entry;
+            continue;
+        }
+
+        uint32_t* prefix = &table[reversed & ((1u << primary) - 1)];
+        if (!(*prefix & PNG_ENTRY_SUBTABLE))
+        {
+            *prefix = (used << 16) | PNG_ENTRY_SUBTABLE | (uint32_t)primary;
+            memset(table + used, 0, (1u << sub_bits) * sizeof(uint32_t));
+            used += 1u << sub_bits;
+        }
+        uint32_t* sub = table + (*prefix >> 16);
+        for (unsigned r = reversed >> primary; r < (1u << sub_bits); r += 1u << (len - primary)) sub[r] = entry;
+    }
+    return 1;
+}
+
+// @brief Строит таблицы литералов/длин и расстояний по длинам кодов.
+static int png_build_tables(PngInflate* f, const stbi_uc* litlen_lengths, const int litlen_count, const stbi_uc* dist_lengths, const int dist_count)
+{
+    uint32_t symbols[288];
+    for (int s = 0; s < 288; s++)
+    {
+        if (s < 256) symbols[s] = ((uint32_t)s << 16) | PNG_ENTRY_LITERAL;
+        else if (s == 256) symbols[s] = PNG_ENTRY_END;
+        else if (s < 286) symbols[s] = ((uint32_t)PNG_LENGTH_BASE[s - 257] << 16) | ((uint32_t)PNG_LENGTH_EXTRA[s - 257] << 8);
+        else symbols[s] = 0;
+    }
+    if (!png_build_table(f->litlen, PNG_LITLEN_BITS, litlen_lengths, litlen_count, symbols)) return 0;
+
+    for (int s = 0; s < 32; s++)
+    {
+        symbols[s] = s < 30 ? ((uint32_t)PNG_DIST_BASE[s] << 16) | ((uint32_t)PNG_DIST_EXTRA[s] << 8) : 0;
+    }
+    return png_build_table(f->dist, PNG_DIST_BITS, dist_lengths, dist_count, symbols);
+}
+
+// @brief Читает описание динамических кодов Хаффмана (RFC 1951, 3.2.7) и строит таблицы.
+static int png_read_dynamic_tables(PngInflate* f)
+{
+    const int hlit = (int)png_take(f, 5) + 257;
+    const int hdist = (int)png_take(f, 5) + 1;
+    const int hclen = (int)png_take(f, 4) + 4;
+
+    stbi_uc code_lengths[19] = { 0 };
+    for (int i = 0; i < hclen; i++) code_lengths[PNG_CODE_LENGTH_ORDER[i]] = (stbi_uc)png_take(f, 3);
+
+    uint32_t table[1 << 7], symbols[19];
+    for (int s = 0; s < 19; s++) symbols[s] = (uint32_t)s << 16;
+    if (!png_build_table(table, 7, code_lengths, 19, symbols)) return 0;
+
+    stbi_uc lengths[288 + 32];
+    int n = 0;
+    while (n < hlit + hdist)
+    {
+        if (f->count < 16) PNG_REFILL(f->in, f->in_end, f->bits, f->count, f->overrun);
+        const uint32_t entry = table[f->bits & 127];
+        if (!(entry & 0xff)) return 0;
+        f->bits >>= entry & 0xff;
+        f->count -= (int)(entry & 0xff);
+
+        const int symbol = (int)(entry >> 16);
+        if (symbol < 16)
+        {
+            lengths[n++] = (stbi_uc)symbol;
+            continue;
+        }
+        int repeat;
+        stbi_uc value = 0;
+        if (symbol == 16)
+        {
+            if (n == 0) return 0;
+            value = lengths[n - 1];
+            repeat = 3 + (int)png_take(f, 2);
+        }
+        else if (symbol == 17) repeat = 3 + (int)png_take(f, 3);
+        else repeat = 11 + (int)png_take(f, 7);
+        if (n + repeat > hlit + hdist) return 0;
+        memset(lengths + n, value, (size_t)repeat);
+        n += repeat;
+    }
+    return png_build_tables(f, lengths, hlit, lengths + hlit, hdist);
+}
+
+// @brief Распаковывает блок, сжатый кодами Хаффмана из таблиц f. Состояние чтения хранится в локальных
+//        переменных: запись байтов выхода иначе заставляет компилятор перечитывать поля структуры.
+static int png_inflate_huffman(PngInflate* f)
+{
+    const stbi_uc* in = f->in;
+    const stbi_uc* const in_end = f->in_end;
+    uint64_t bits = f->bits;
+    int count = f->count, overrun = f->overrun;
+    stbi_uc* out = f->out;
+    stbi_uc* const out_begin = f->out_begin;
+    stbi_uc* const out_end = f->out_end;
+    const uint32_t* const litlen = f->litlen;
+    const uint32_t* const dist = f->dist;
+
+    for (;;)
+    {
+        if (overrun > 16) return 0; // Поток оборвался
+        PNG_REFILL(in, in_end, bits, count, overrun);
+        uint32_t entry = png_lookup(litlen, bits, PNG_LITLEN_BITS);
+
+        // После пополнения в буфере не меньше 56 бит: до трех литералов по 15 бит без пополнения
+        int literals = 0;
+        while ((entry & PNG_ENTRY_LITERAL) && literals < 3)
+        {
+            if (out == out_end) return 0;
+            *out++ = (stbi_uc)(entry >> 16);
+            bits >>= entry & 0xff;
+            count -= (int)(entry & 0xff);
+            entry = png_lookup(litlen, bits, PNG_LITLEN_BITS);
+            literals++;
+        }
+        if (entry & PNG_ENTRY_LITERAL) continue; // Запись могла быть прочитана по неполному буферу
+
+        if (entry & PNG_ENTRY_END)
+        {
+            bits >>= entry & 0xff;
+            count -= (int)(entry & 0xff);
+            break;
+        }
+
+        // Длина с дополнительными битами и расстояние с дополнительными битами - до 48 бит.
+        // Пополнение не меняет младших бит, поэтому запись длины остается верной
+        if (count < 48) PNG_REFILL(in, in_end, bits, count, overrun);
+        size_t length = entry >> 16;
+        if (!length) return 0;
+        bits >>= entry & 0xff;
+        count -= (int)(entry & 0xff);
+        int extra = (int)((entry >> 8) & 0x1f);
+        length += (size_t)(bits & ((1u << extra) - 1));
+        bits >>= extra;
+        count -= extra;
+
+        entry = png_lookup(dist, bits, PNG_DIST_BITS);
+        size_t distance = entry >> 16;
+        if (!distance) return 0;
+        bits >>= entry & 0xff;
+        count -= (int)(entry & 0xff);
+        extra = (int)((entry >> 8) & 0x1f);
+        distance += (size_t)(bits & ((1u << extra) - 1));
+        bits >>= extra;
+        count -= extra;
+
+        if (distance > (size_t)(out - out_begin) || length > (size_t)(out_end - out)) return 0;
+        const stbi_uc* src = out - distance;
+        if (distance >= 8)
+        {
+            // Каждые 8 байт источника уже записаны; запись за out_end попадает в запас буфера
+            stbi_uc* end = out + length;
+            do
+            {
+                memcpy(out, src, 8);
+                out += 8;
+                src += 8;
+            } while (out < end);
+            out = end;
+        }
+        else if (distance == 1)
+        {
+            memset(out, *src, length);
+            out += length;
+        }
+        else
+        {
+            for (size_t k = 0; k < length; k++) out[k] = src[k];
+            out += length;
+        }
+    }
+
+    f->in = in;
+    f->bits = bits;
+    f->count = count;
+    f->overrun = overrun;
+    f->out = out;
+    return 1;
+}
+
+// @brief Копирует несжатый блок.
+static int png_inflate_stored(PngInflate* f)
+{
+    // Выравнивание на байт и возврат целых байтов буфера во вход
+    f->bits >>= f->count & 7;
+    f->count -= f->count & 7;
+    const int buffered = (f->count >> 3) - f->overrun;
+    if (buffered < 0) return 0;
+    f->in -= buffered;
+    f->bits = 0;
+    f->count = 0;
+    f->overrun = 0;
+
+    if (f->in_end - f->in < 4) return 0;
+    const size_t len = (size_t)f->in[0] | ((size_t)f->in[1] << 8);
+    const size_t nlen = (size_t)f->in[2] | ((size_t)f->in[3] << 8);
+    if (len != (nlen ^ 0xffff)) return 0;
+    f->in += 4;
+    if ((size_t)(f->in_end - f->in) < len || (size_t)(f->out_end - f->out) < len) return 0;
+    memcpy(f->out, f->in, len);
+    f->in += len;
+    f->out += len;
+    return 1;
+}
+
+// @brief Распаковывает поток zlib в f->out.
+//
+// @return 1, если поток распакован и не читал данных за концом входа.
+static int png_inflate(PngInflate* f)
+{
+    if (f->in_end - f->in < 2) return 0;
+    const int cmf = f->in[0], flg = f->in[1];
+    if ((cmf * 256 + flg) % 31 != 0 || (flg & 32) || (cmf & 15) != 8) return 0;
+    f->in += 2;
+
+    int final;
+    do
+    {
+        final = (int)png_take(f, 1);
+        const int type = (int)png_take(f, 2);
+        if (type == 0)
+        {
+            if (!png_inflate_stored(f)) return 0;
+            continue;
+        }
+        if (type == 1)
+        {
+            stbi_uc lengths[288 + 32];
+            memset(lengths, 8, 144);
+            memset(lengths + 144, 9, 112);
+            memset(lengths + 256, 7, 24);
+            memset(lengths + 280, 8, 8);
+            memset(lengths + 288, 5, 32);
+            if (!png_build_tables(f, lengths, 288, lengths + 288, 32)) return 0;
+        }
+        else if (type != 2 || !png_read_dynamic_tables(f)) return 0;
+        if (!png_inflate_huffman(f)) return 0;
+    } while (!final);
+
+    return f->count >= 8 * f->overrun;
+}
+
+// @brief Декодирует PNG из контекста stb_image (см. описание файла).
+static int png_decode(stbi__context* s, stbi_uc** pixels, int* width, int* height, int* channels)
+{
+    stbi_uc palette[1024];
+    stbi_uc trns[3] = { 0, 0, 0 };
+    int color = -1, has_trns = 0, pal_n = 0;
+    stbi__uint32 pal_len = 0, idat_len = 0, idat_cap = 0;
+    stbi_uc* idat = NULL;
+    int result = DECODE_FALLBACK;
+    memset(palette, 0, sizeof(palette));
+
+    if (!stbi__check_png_header(s)) return DECODE_FALLBACK;
+
+    // Разбор чанков; все, что отличается от простого случая, передается stb_image
+    for (;;)
+    {
+        stbi__pngchunk c = stbi__get_chunk_header(s);
+        if (color < 0 && c.type != STBI__PNG_TYPE('I', 'H', 'D', 'R')) goto done;
+
+        if (c.type == STBI__PNG_TYPE('I', 'H', 'D', 'R'))
+        {
+            if (color >= 0 || c.length != 13) goto done;
+            s->img_x = stbi__get32be(s);
+            s->img_y = stbi__get32be(s);
+            const int depth = stbi__get8(s);
+            color = stbi__get8(s);
+            const int compression = stbi__get8(s), filter = stbi__get8(s), interlace = stbi__get8(s);
+            if (depth != 8 || compression || filter || interlace) goto done;
+            if (color != 0 && color != 2 && color != 3 && color != 6) goto done;
+            if (!s->img_x || !s->img_y || s->img_x > STBI_MAX_DIMENSIONS || s->img_y > STBI_MAX_DIMENSIONS) goto done;
+            s->img_n = color == 2 ? 3 : color == 6 ? 4 : 1;
+            if ((1 << 30) / s->img_x / 4 < s->img_y) goto done;
+            if (color == 3) pal_n = 3;
+        }
+        else if (c.type == STBI__PNG_TYPE('P', 'L', 'T', 'E'))
+        {
+            if (c.length > 256 * 3 || c.length % 3) goto done;
+            pal_len = c.length / 3;
+            for (stbi__uint32 i = 0; i < pal_len; i++)
+            {
+                palette[4 * i + 0] = stbi__get8(s);
+                palette[4 * i + 1] = stbi__get8(s);
+                palette[4 * i + 2] = stbi__get8(s);
+                palette[4 * i + 3] = 255;
+            }
+        }
+        else if (c.type == STBI__PNG_TYPE('t', 'R', 'N', 'S'))
+        {
+            if (idat) goto done;
+            if (color == 3)
+            {
+                if (pal_len == 0 || c.length > pal_len) goto done;
+                pal_n = 4;
+                for (stbi__uint32 i = 0; i < c.length; i++) palette[4 * i + 3] = stbi__get8(s);
+            }
+            else
+            {
+                if (color != 2 || c.length != 6) goto done; // Серый с прозрачным цветом дает 2 канала
+                has_trns = 1;
+                for (int k = 0; k < 3; k++) trns[k] = (stbi_uc)(stbi__get16be(s) & 255);
+            }
+        }
+        else if (c.type == STBI__PNG_TYPE('I', 'D', 'A', 'T'))
+        {
+            if (color == 3 && !pal_len) goto done;
+            if (c.length > (1u << 30) || idat_len + c.length < idat_len) goto done;
+            if (idat_len + c.length > idat_cap)
+            {
+                stbi__uint32 cap = idat_cap ? idat_cap : (c.length > 4096 ? c.length : 4096);
+                while (idat_len + c.length > cap) cap *= 2;
+                stbi_uc* p = (stbi_uc*)STBI_REALLOC(idat, cap);
+                if (!p) goto done;
+                idat = p;
+                idat_cap = cap;
+            }
+            if (!stbi__getn(s, idat + idat_len, (int)c.length)) goto done;
+            idat_len += c.length;
+        }
+        else if (c.type == STBI__PNG_TYPE('I', 'E', 'N', 'D'))
+        {
+            break;
+        }
+        else
+        {
+            // Критические чанки (в том числе CgBI) обрабатывает stb_image
+            if (!(c.type & (1u << 29)) || c.type == STBI__PNG_TYPE('C', 'g', 'B', 'I')) goto done;
+            stbi__skip(s, (int)c.length);
+        }
+        stbi__get32be(s); // CRC
+    }
+    if (!idat) goto done;
+
+    {
+        const size_t w = s->img_x, h = s->img_y;
+        const int img_n = s->img_n;
+        const int out_n = pal_n ? pal_n : img_n + has_trns;
+        const size_t stride = w * img_n;
+        const size_t raw_len = h * (stride + 1);
+
+        PngInflate* f = (PngInflate*)STBI_MALLOC(sizeof(PngInflate));
+        // Размеры ограничены при разборе IHDR (меньше 2^30 байт); большие буферы выделяются большими страницами
+        stbi_uc* raw = (stbi_uc*)ipl_buffer_alloc(raw_len + PNG_COPY_SLACK);
+        stbi_uc* output = (stbi_uc*)ipl_buffer_alloc(w * h * out_n);
+        stbi_uc* rows = (stbi_uc*)STBI_MALLOC(3 * stride); // Нулевая строка и две строки для палитры и прозрачного цвета
+        if (f && raw && output && rows)
+        {
+            f->in = idat;
+            f->in_end = idat + idat_len;
+            f->bits = 0;
+            f->count = 0;
+            f->overrun = 0;
+            f->out_begin = f->out = raw;
+            f->out_end = raw + raw_len;
+            // Лишние данные после изображения stb_image допускает, поэтому поток должен закончиться ровно на конце
+            if (png_inflate(f) && f->out == f->out_end)
+            {
+                const PngUnfilterFn unfilter = ipl_get_context()->kernels.png_unfilter;
+                const int direct = out_n == img_n;
+                stbi_uc* zero = rows;
+                memset(zero, 0, stride);
+                const stbi_uc* prior = zero;
+                result = DECODE_DONE;
+                for (size_t y = 0; y < h; y++)
+                {
+                    const stbi_uc* line = raw + y * (stride + 1);
+                    if (line[0] > PNG_FILTER_PAETH)
+                    {
+                        result = DECODE_FALLBACK;
+                        break;
+                    }
+                    stbi_uc* cur = direct ? output + y * stride : rows + (1 + (y & 1)) * stride;
+                    unfilter(line[0], line + 1, prior, cur, stride, img_n);
+                    prior = cur;
+                    if (direct) continue;
+
+                    stbi_uc* out = output + y * w * out_n;
+                    if (pal_n == 4)
+                    {
+                        for (size_t i = 0; i < w; i++, out += 4) memcpy(out, palette + 4 * cur[i], 4);
+                    }
+                    else if (pal_n == 3)
+                    {
+                        for (size_t i = 0; i < w; i++, out += 3) memcpy(out, palette + 4 * cur[i], 3);
+                    }
+                    else
+                    {
+                        for (size_t i = 0; i < w; i++, cur += 3, out += 4)
+                        {
+                            out[0] = cur[0];
+                            out[1] = cur[1];
+                            out[2] = cur[2];
+                            out[3] = (cur[0] == trns[0] && cur[1] == trns[1] && cur[2] == trns[2]) ? 0 : 255;
+                        }
+                    }
+                }
+            }
+        }
+        STBI_FREE(f);
+        STBI_FREE(raw);
+        STBI_FREE(rows);
+        if (result == DECODE_DONE)
+        {
+            *pixels = output;
+            *width = (int)w;
+            *height = (int)h;
+            *channels = out_n;
+        }
+        else
+        {
+            STBI_FREE(output);
+        }
+    }
+
+done:
+    STBI_FREE(idat);
+    return result;
+}
+
+#endif
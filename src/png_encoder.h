@@ -0,0 +1,576 @@
+#ifndef PNG_ENCODER_H
+#define PNG_ENCODER_H
+
+// Запись PNG с палитрой (color type 3) и серых PNG глубиной 1, 2 или 4 бит поверх сжатия zlib и CRC stb_image_write.
+// Включается только в input_output.c после реализации stb_image_write.
+//
+// Точный режим (colors = 0) используется при каждой записи PNG: изображение с не более чем 256 цветами
+// (уникальные цвета собираются в хэш-таблицу с открытой адресацией на 1024 ячейки, проход прерывается на 257-м цвете)
+// записывается с палитрой, а серое изображение, уровни которого лежат на сетке 1, 2 или 4 бит (маски, карты границ), -
+// серым PNG меньшей глубины. Декодирование дает те же пиксели и то же число каналов (у RGBA всегда есть tRNS).
+//
+// Режим квантования (colors = 2..256): если цветов больше colors, палитра строится медианным сечением гистограммы
+// (5 бит на канал RGB и 3 бита альфы), пиксели отображаются через таблицу ячеек гистограммы, при dither - с диффузией
+// ошибки Флойда-Стейнберга по змейке. Серые изображения остаются серыми и квантуются к сетке 1, 2 или 4 бит.
+//
+// Индексы упаковываются по 1, 2 или 4 бита, если хватает записей палитры, строки пишутся без фильтра (фильтры
+// PNG для индексов бесполезны), поэтому сжимать приходится в 3-32 раза меньше данных, чем у truecolor PNG.
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "context.h"
+
+// Результат png_encode_indexed
+#define ENCODE_FAILED   0 // Не хватило памяти
+#define ENCODE_DONE     1
+#define ENCODE_FALLBACK 2 // Изображение записывается обычным PNG (stb_image_write)
+
+#define PNG_EXACT_HASH_BITS 10 // Хэш-таблица точной палитры: 1024 ячейки на не более чем 256 цветов
+#define PNG_HIST_BITS       5  // Бит на канал RGB в гистограмме квантования
+#define PNG_HIST_ALPHA_BITS 3  // Бит альфа-канала в гистограмме квантования
+
+// @brief Индексированное изображение, подготовленное к записи.
+typedef struct
+{
+    unsigned char* indices;         // Индекс палитры (или уровень серого) на пиксель
+    unsigned char palette[256 * 4]; // Записи палитры RGBA
+    int colors;                     // Число записей палитры (0 - серое изображение без палитры)
+    int depth;                      // Бит на пиксель: 1, 2, 4 или 8
+    int transparent;                // Длина tRNS: записи с альфой меньше 255 идут первыми
+} PngIndexed;
+
+// @brief Ячейка гистограммы квантования.
+typedef struct
+{
+    uint64_t sum[4];       // Суммы каналов пикселей ячейки
+    uint32_t count;
+    uint32_t bin;          // Номер ячейки
+    unsigned char mean[4]; // Средний цвет
+} PngColorBin;
+
+// @brief Параллелепипед медианного сечения: ячейки [begin, end) массива непустых ячеек.
+typedef struct
+{
+    size_t begin;
+    size_t end;
+    uint64_t count;
+    int channel; // Канал с наибольшим размахом
+    int range;
+} PngBox;
+
+// @brief Цвет пикселя как 32-битный ключ (RGB дополняется непрозрачной альфой).
+static inline uint32_t png_pixel_key(const unsigned char* p, const int n)
+{
+    uint32_t key = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+    return key | (n == 4 ? (uint32_t)p[3] << 24 : 0xff000000u);
+}
+
+// @brief Номер ячейки гистограммы квантования для цвета (у серого - сам уровень).
+static inline uint32_t png_bin_key(const int* c, const int n)
+{
+    if (n == 1) return (uint32_t)c[0];
+    uint32_t key = ((uint32_t)(c[0] >> (8 - PNG_HIST_BITS)) << (2 * PNG_HIST_BITS)) |
+                   ((uint32_t)(c[1] >> (8 - PNG_HIST_BITS)) << PNG_HIST_BITS) | (uint32_t)(c[2] >> (8 - PNG_HIST_BITS));
+    if (n == 4) key |= (uint32_t)(c[3] >> (8 - PNG_HIST_ALPHA_BITS)) << (3 * PNG_HIST_BITS);
+    return key;
+}
+
+// @brief Ближайшая запись палитры к центру ячейки (для ячеек, которых нет в гистограмме, при диффузии ошибки).
+static int png_nearest_entry(const PngIndexed* ix, const uint32_t bin, const int n)
+{
+    const int shift = 8 - PNG_HIST_BITS, alpha_shift = 8 - PNG_HIST_ALPHA_BITS;
+    const int mask = (1 << PNG_HIST_BITS) - 1;
+    int center[4];
+    center[0] = (((int)bin >> (2 * PNG_HIST_BITS) & mask) << shift) + (1 << shift) / 2;
+    center[1] = (((int)bin >> PNG_HIST_BITS & mask) << shift) + (1 << shift) / 2;
+    center[2] = (((int)bin & mask) << shift) + (1 << shift) / 2;
+    center[3] = n == 4 ? ((int)(bin >> (3 * PNG_HIST_BITS)) << alpha_shift) + (1 << alpha_shift) / 2 : 255;
+
+    int best = 0, best_distance = INT_MAX;
+    for (int k = 0; k < ix->colors; k++)
+    {
+        int distance = 0;
+        for (int ch = 0; ch < 4; ch++)
+        {
+            const int d = center[ch] - ix->palette[4 * k + ch];
+            distance += d * d;
+        }
+        if (distance < best_distance)
+        {
+            best_distance = distance;
+            best = k;
+        }
+    }
+    return best;
+}
+
+// @brief Собирает точную палитру, если в изображении не больше limit цветов.
+//
+// @return 1 - палитра собрана и ix->indices заполнен, 0 - цветов больше limit.
+static int png_exact_palette(const Image* image, const int limit, PngIndexed* ix)
+{
+    const size_t mask = ((size_t)1 << PNG_EXACT_HASH_BITS) - 1;
+    uint32_t keys[1 << PNG_EXACT_HASH_BITS];
+    unsigned short slots[1 << PNG_EXACT_HASH_BITS]; // Индекс палитры + 1, 0 - пустая ячейка
+    memset(slots, 0, sizeof(slots));
+
+    const size_t count = image->width * image->height;
+    const int n = image->channels;
+    const unsigned char* p = image->data;
+    uint32_t last_key = 0;
+    int last_index = -1, colors = 0;
+    for (size_t i = 0; i < count; i++, p += n)
+    {
+        const uint32_t key = png_pixel_key(p, n);
+        if (key != last_key || last_index < 0) // Соседние пиксели часто совпадают
+        {
+            size_t h = (size_t)((key * 0x9E3779B1u) >> (32 - PNG_EXACT_HASH_BITS));
+            while (slots[h] && keys[h] != key) h = (h + 1) & mask;
+            if (!slots[h])
+            {
+                if (colors == limit) return 0;
+                keys[h] = key;
+                memcpy(ix->palette + 4 * colors, p, 3);
+                ix->palette[4 * colors + 3] = n == 4 ? p[3] : 255;
+                slots[h] = (unsigned short)++colors;
+            }
+            last_key = key;
+            last_index = slots[h] - 1;
+        }
+        ix->indices[i] = (unsigned char)last_index;
+    }
+
+    ix->colors = colors;
+    return 1;
+}
+
+// @brief Наименьшая глубина серого PNG (1, 2 или 4 бит), на сетке которой лежат все уровни, или 8.
+static int png_gray_depth(const Image* image)
+{
+    unsigned char present[256] = { 0 };
+    const size_t count = image->width * image->height;
+    for (size_t i = 0; i < count; i++) present[image->data[i]] = 1;
+
+    for (int depth = 1; depth < 8; depth *= 2)
+    {
+        const int step = 255 / ((1 << depth) - 1);
+        int fits = 1;
+        for (int v = 0; v < 256 && fits; v++) fits = !present[v] || v % step == 0;
+        if (fits) return depth;
+    }
+    return 8;
+}
+
+// @brief Измеряет размах каналов ячеек параллелепипеда.
+static void png_measure_box(const PngColorBin* bins, PngBox* box, const int n)
+{
+    int low[4] = { 255, 255, 255, 255 }, high[4] = { 0, 0, 0, 0 };
+    box->count = 0;
+    for (size_t i = box->begin; i < box->end; i++)
+    {
+        box->count += bins[i].count;
+        for (int ch = 0; ch < n; ch++)
+        {
+            if (bins[i].mean[ch] < low[ch]) low[ch] = bins[i].mean[ch];
+            if (bins[i].mean[ch] > high[ch]) high[ch] = bins[i].mean[ch];
+        }
+    }
+    box->channel = 0;
+    box->range = high[0] - low[0];
+    for (int ch = 1; ch < n; ch++)
+    {
+        if (high[ch] - low[ch] > box->range)
+        {
+            box->range = high[ch] - low[ch];
+            box->channel = ch;
+        }
+    }
+}
+
+#define PNG_COMPARE_CHANNEL(ch)                                                              \
+    static int png_compare_bins_##ch(const void* a, const void* b)                           \
+    {                                                                                        \
+        return (int)((const PngColorBin*)a)->mean[ch] - (int)((const PngColorBin*)b)->mean[ch]; \
+    }
+PNG_COMPARE_CHANNEL(0)
+PNG_COMPARE_CHANNEL(1)
+PNG_COMPARE_CHANNEL(2)
+PNG_COMPARE_CHANNEL(3)
+#undef PNG_COMPARE_CHANNEL
+
+// @brief Строит палитру медианным сечением гистограммы и заполняет таблицу ячейка -> индекс для ячеек гистограммы.
+//
+// @param lookup [out] Таблица на 2^(3 * PNG_HIST_BITS [+ PNG_HIST_ALPHA_BITS]) ячеек, -1 для пустых.
+//
+// @return 0, если не хватило памяти.
+static int png_median_cut(const Image* image, const int colors, PngIndexed* ix, short* lookup, const size_t bin_count)
+{
+    PngColorBin* bins = (PngColorBin*)calloc(bin_count, sizeof(PngColorBin));
+    PngBox* boxes = (PngBox*)malloc((size_t)colors * sizeof(PngBox));
+    if (!bins || !boxes)
+    {
+        free(bins);
+        free(boxes);
+        return 0;
+    }
+
+    const size_t count = image->width * image->height;
+    const int n = image->channels;
+    const unsigned char* p = image->data;
+    for (size_t i = 0; i < count; i++, p += n)
+    {
+        const int c[4] = { p[0], p[1], p[2], n == 4 ? p[3] : 255 };
+        PngColorBin* bin = &bins[png_bin_key(c, n)];
+        bin->count++;
+        for (int ch = 0; ch < 4; ch++) bin->sum[ch] += (uint64_t)c[ch];
+    }
+
+    // Непустые ячейки сдвигаются в начало массива
+    size_t used = 0;
+    for (size_t b = 0; b < bin_count; b++)
+    {
+        if (!bins[b].count) continue;
+        bins[used] = bins[b];
+        bins[used].bin = (uint32_t)b;
+        for (int ch = 0; ch < 4; ch++) bins[used].mean[ch] = (unsigned char)((bins[used].sum[ch] + bins[used].count / 2) / bins[used].count);
+        used++;
+    }
+
+    int (*const compare[4])(const void*, const void*) = { png_compare_bins_0, png_compare_bins_1, png_compare_bins_2, png_compare_bins_3 };
+    int box_count = 1;
+    boxes[0].begin = 0;
+    boxes[0].end = used;
+    png_measure_box(bins, &boxes[0], n);
+    while (box_count < colors)
+    {
+        // Делится параллелепипед с наибольшим произведением размаха на число пикселей
+        int split = -1;
+        uint64_t best = 0;
+        for (int k = 0; k < box_count; k++)
+        {
+            const uint64_t score = (uint64_t)boxes[k].range * boxes[k].count;
+            if (boxes[k].end - boxes[k].begin > 1 && score > best)
+            {
+                best = score;
+                split = k;
+            }
+        }
+        if (split < 0) break;
+
+        PngBox* box = &boxes[split];
+        qsort(bins + box->begin, box->end - box->begin, sizeof(PngColorBin), compare[box->channel]);
+        size_t median = box->begin;
+        uint64_t below = 0;
+        while (median < box->end - 1 && 2 * (below + bins[median].count) <= box->count) below += bins[median++].count;
+        if (median == box->begin) median++;
+
+        boxes[box_count].begin = median;
+        boxes[box_count].end = box->end;
+        box->end = median;
+        png_measure_box(bins, box, n);
+        png_measure_box(bins, &boxes[box_count], n);
+        box_count++;
+    }
+
+    // Запись палитры - средний цвет пикселей параллелепипеда
+    for (int k = 0; k < box_count; k++)
+    {
+        uint64_t sum[4] = { 0, 0, 0, 0 };
+        for (size_t i = boxes[k].begin; i < boxes[k].end; i++)
+        {
+            for (int ch = 0; ch < 4; ch++) sum[ch] += bins[i].sum[ch];
+            lookup[bins[i].bin] = (short)k;
+        }
+        for (int ch = 0; ch < 4; ch++) ix->palette[4 * k + ch] = (unsigned char)((sum[ch] + boxes[k].count / 2) / boxes[k].count);
+    }
+    ix->colors = box_count;
+
+    free(bins);
+    free(boxes);
+    return 1;
+}
+
+// @brief Отображает пиксели в индексы через таблицу ячеек, при dither - с диффузией ошибки Флойда-Стейнберга по змейке.
+//        Для серого изображения таблица отображает уровень в уровень сетки, а ix->palette хранит уровни сетки.
+//
+// @return 0, если не хватило памяти.
+static int png_map_pixels(const Image* image, PngIndexed* ix, short* lookup, const int dither)
+{
+    const size_t w = image->width, h = image->height;
+    const int n = image->channels;
+
+    if (!dither)
+    {
+        // Без диффузии встречаются только ячейки гистограммы (у серого таблица заполнена целиком)
+        #pragma omp parallel for if (w * h >= ipl_get_context()->profile.parallel_min_pixels)
+        for (ptrdiff_t y = 0; y < (ptrdiff_t)h; y++)
+        {
+            const unsigned char* p = image->data + (size_t)y * w * n;
+            unsigned char* out = ix->indices + (size_t)y * w;
+            for (size_t x = 0; x < w; x++, p += n)
+            {
+                const int c[4] = { p[0], n > 1 ? p[1] : 0, n > 1 ? p[2] : 0, n == 4 ? p[3] : 255 };
+                out[x] = (unsigned char)lookup[png_bin_key(c, n)];
+            }
+        }
+        return 1;
+    }
+
+    // Ошибки текущей и следующей строки с полем в один пиксель с каждой стороны, в 1/16 уровня
+    int* errors = (int*)calloc(2 * (w + 2) * 4, sizeof(int));
+    if (!errors) return 0;
+    int* current = errors;
+    int* next = errors + (w + 2) * 4;
+
+    for (size_t y = 0; y < h; y++)
+    {
+        const int forward = !(y & 1);
+        const ptrdiff_t dir = forward ? 1 : -1;
+        memset(next, 0, (w + 2) * 4 * sizeof(int));
+        for (size_t i = 0; i < w; i++)
+        {
+            const size_t x = forward ? i : w - 1 - i;
+            const unsigned char* p = image->data + (y * w + x) * n;
+            int* e = current + (x + 1) * 4;
+            int c[4] = { 0, 0, 0, 255 };
+            for (int ch = 0; ch < n; ch++)
+            {
+                const int v = p[ch] + (e[ch] + (e[ch] >= 0 ? 8 : -8)) / 16;
+                c[ch] = v < 0 ? 0 : v > 255 ? 255 : v;
+            }
+
+            const uint32_t bin = png_bin_key(c, n);
+            if (lookup[bin] < 0) lookup[bin] = (short)png_nearest_entry(ix, bin, n);
+            const int index = lookup[bin];
+            ix->indices[y * w + x] = (unsigned char)index;
+
+            for (int ch = 0; ch < n; ch++)
+            {
+                const int error = c[ch] - ix->palette[4 * index + (n == 1 ? 0 : ch)];
+                e[ch + 4 * dir] += error * 7;
+                next[(x + 1 - dir) * 4 + ch] += error * 3;
+                next[(x + 1) * 4 + ch] += error * 5;
+                next[(x + 1 + dir) * 4 + ch] += error;
+            }
+        }
+        int* swap = current;
+        current = next;
+        next = swap;
+    }
+
+    free(errors);
+    return 1;
+}
+
+// @brief Переставляет записи палитры так, чтобы полупрозрачные шли первыми (tRNS покрывает только их).
+//
+// @param remap [out] Старый индекс -> новый индекс.
+static void png_order_palette(PngIndexed* ix, unsigned char* remap)
+{
+    unsigned char palette[256 * 4];
+    int next = 0;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int k = 0; k < ix->colors; k++)
+        {
+            if ((ix->palette[4 * k + 3] < 255) != !pass) continue;
+            memcpy(palette + 4 * next, ix->palette + 4 * k, 4);
+            remap[k] = (unsigned char)next++;
+        }
+        if (!pass) ix->transparent = next;
+    }
+    memcpy(ix->palette, palette, 4 * (size_t)ix->colors);
+}
+
+// @brief Длина несжатых данных PNG: строки упакованных индексов глубины depth с байтом фильтра.
+static inline size_t png_raw_length(const size_t w, const size_t h, const int depth)
+{
+    return h * ((w * depth + 7) / 8 + 1);
+}
+
+// @brief Упаковывает индексы в строки PNG (фильтр None), сжимает и записывает чанки.
+//        Длина несжатых данных не больше INT_MAX / 2 (проверяется в png_encode_indexed).
+//
+// @param alpha [in] Записывать tRNS даже без полупрозрачных записей (чтобы RGBA декодировался в 4 канала).
+//
+// @return Файл PNG (освобождается free) или NULL, если не хватило памяти.
+static unsigned char* png_write_indexed(const PngIndexed* ix, const size_t w, const size_t h, const unsigned char* remap, const int alpha, int* length)
+{
+    const size_t row_bytes = (w * ix->depth + 7) / 8;
+    const size_t raw_len = png_raw_length(w, h, ix->depth);
+    unsigned char* raw = (unsigned char*)malloc(raw_len);
+    if (!raw) return NULL;
+
+    const int depth = ix->depth;
+    #pragma omp parallel for if (w * h >= ipl_get_context()->profile.parallel_min_pixels)
+    for (ptrdiff_t y = 0; y < (ptrdiff_t)h; y++)
+    {
+        unsigned char* row = raw + (size_t)y * (row_bytes + 1);
+        const unsigned char* index = ix->indices + (size_t)y * w;
+        row[0] = 0;
+        row++;
+        if (depth == 8)
+        {
+            for (size_t x = 0; x < w; x++) row[x] = remap[index[x]];
+            continue;
+        }
+        // Пиксели упаковываются от старших бит байта к младшим
+        memset(row, 0, row_bytes);
+        const int per_byte = 8 / depth;
+        for (size_t x = 0; x < w; x++)
+            row[x / per_byte] |= (unsigned char)(remap[index[x]] << (8 - depth * (int)(x % per_byte + 1)));
+    }
+
+    int zlen;
+    unsigned char* zlib = stbi_zlib_compress(raw, (int)raw_len, &zlen, stbi_write_png_compression_level);
+    free(raw);
+    if (!zlib) return NULL;
+
+    const int plte_len = 3 * ix->colors;
+    const int trns_len = ix->colors && (alpha || ix->transparent) ? (ix->transparent ? ix->transparent : 1) : 0;
+    const int total = 8 + 12 + 13 + (plte_len ? 12 + plte_len : 0) + (trns_len ? 12 + trns_len : 0) + 12 + zlen + 12;
+    unsigned char* out = (unsigned char*)malloc((size_t)total);
+    if (!out)
+    {
+        free(zlib);
+        return NULL;
+    }
+
+    static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    unsigned char* o = out;
+    memcpy(o, signature, 8);
+    o += 8;
+    stbiw__wp32(o, 13);
+    stbiw__wptag(o, "IHDR");
+    stbiw__wp32(o, (unsigned)w);
+    stbiw__wp32(o, (unsigned)h);
+    *o++ = (unsigned char)depth;
+    *o++ = ix->colors ? 3 : 0;
+    *o++ = 0;
+    *o++ = 0;
+    *o++ = 0;
+    stbiw__wpcrc(&o, 13);
+
+    if (plte_len)
+    {
+        stbiw__wp32(o, plte_len);
+        stbiw__wptag(o, "PLTE");
+        for (int k = 0; k < ix->colors; k++)
+        {
+            memcpy(o, ix->palette + 4 * k, 3);
+            o += 3;
+        }
+        stbiw__wpcrc(&o, plte_len);
+    }
+    if (trns_len)
+    {
+        stbiw__wp32(o, trns_len);
+        stbiw__wptag(o, "tRNS");
+        for (int k = 0; k < trns_len; k++) *o++ = ix->palette[4 * k + 3];
+        stbiw__wpcrc(&o, trns_len);
+    }
+
+    stbiw__wp32(o, zlen);
+    stbiw__wptag(o, "IDAT");
+    memcpy(o, zlib, (size_t)zlen);
+    o += zlen;
+    free(zlib);
+    stbiw__wpcrc(&o, zlen);
+
+    stbiw__wp32(o, 0);
+    stbiw__wptag(o, "IEND");
+    stbiw__wpcrc(&o, 0);
+
+    *length = total;
+    return out;
+}
+
+// @brief Кодирует изображение в PNG с палитрой или серый PNG малой глубины (см. описание файла).
+//
+// @param colors [in]  0 - только без потерь, 2..256 - не больше colors записей палитры (с квантованием).
+// @param dither [in]  Диффузия ошибки при квантовании.
+// @param png    [out] Файл PNG (освобождается free).
+//
+// @return ENCODE_DONE, ENCODE_FALLBACK (изображение записывается обычным PNG) или ENCODE_FAILED.
+static int png_encode_indexed(const Image* image, const int colors, const int dither, unsigned char** png, int* length)
+{
+    const int n = image->channels;
+    const size_t w = image->width, h = image->height;
+    if ((n != 1 && n != 3 && n != 4) || !w || !h || w > INT_MAX / 8 || h > INT_MAX / w) return ENCODE_FALLBACK;
+
+    PngIndexed ix;
+    memset(&ix, 0, sizeof(ix));
+    unsigned char remap[256];
+    for (int k = 0; k < 256; k++) remap[k] = (unsigned char)k;
+
+    int levels = 0; // Уровней сетки серого
+    if (n == 1)
+    {
+        const int exact = png_gray_depth(image);
+        int depth = exact;
+        if (colors) while (depth > 1 && (1 << depth) > colors) depth /= 2;
+        if (depth == 8) return ENCODE_FALLBACK;
+        ix.depth = depth;
+        if (depth < exact) levels = 1 << depth;
+    }
+
+    ix.indices = (unsigned char*)malloc(w * h);
+    if (!ix.indices) return ENCODE_FAILED;
+
+    short* lookup = NULL;
+    int result = ENCODE_DONE;
+    if (n == 1)
+    {
+        // Уровень -> уровень сетки: точно (exact) или ближайший уровень (квантование)
+        const int grid = levels ? levels : 1 << ix.depth;
+        const int step = 255 / (grid - 1);
+        short gray[256];
+        for (int v = 0; v < 256; v++) gray[v] = (short)((v + step / 2) / step);
+        for (int k = 0; k < grid; k++) ix.palette[4 * k] = (unsigned char)(k * step);
+        ix.colors = grid; // Для png_map_pixels; серый PNG пишется без палитры
+        if (!png_map_pixels(image, &ix, gray, dither && levels)) result = ENCODE_FAILED;
+        ix.colors = 0;
+    }
+    else if (!png_exact_palette(image, colors ? colors : 256, &ix))
+    {
+        if (!colors)
+        {
+            result = ENCODE_FALLBACK;
+        }
+        else
+        {
+            // Квантование: медианное сечение и отображение через таблицу ячеек
+            const size_t bin_count = (size_t)1 << (3 * PNG_HIST_BITS + (n == 4 ? PNG_HIST_ALPHA_BITS : 0));
+            lookup = (short*)malloc(bin_count * sizeof(short));
+            if (!lookup) result = ENCODE_FAILED;
+            else
+            {
+                memset(lookup, 0xff, bin_count * sizeof(short)); // -1: ячейки нет в гистограмме
+                if (!png_median_cut(image, colors, &ix, lookup, bin_count) || !png_map_pixels(image, &ix, lookup, dither)) result = ENCODE_FAILED;
+            }
+        }
+    }
+
+    if (result == ENCODE_DONE && n != 1)
+    {
+        ix.depth = ix.colors <= 2 ? 1 : ix.colors <= 4 ? 2 : ix.colors <= 16 ? 4 : 8;
+        png_order_palette(&ix, remap);
+    }
+    // stbi_zlib_compress принимает длину int: слишком большое изображение пишется обычным PNG, а не считается ошибкой
+    if (result == ENCODE_DONE && png_raw_length(w, h, ix.depth) > INT_MAX / 2) result = ENCODE_FALLBACK;
+    if (result == ENCODE_DONE)
+    {
+        *png = png_write_indexed(&ix, w, h, remap, n == 4, length);
+        if (!*png) result = ENCODE_FAILED;
+    }
+
+    free(lookup);
+    free(ix.indices);
+    return result;
+}
+
+#endif
@@ -0,0 +1,672 @@
+#include "region.h"
+#include "context.h"
+#include "buffer.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <omp.h>
+
+// @brief Часть маски, обрабатываемая одним вызовом фильтра: связная компонента покрытых тайлов.
+typedef struct
+{
+    size_t x0, y0, x1, y1; // Ограничивающий прямоугольник покрытых пикселей [x0, x1) x [y0, y1)
+    unsigned char* result; // Отфильтрованный прямоугольник изображения с началом в (rx, ry)
+    size_t rx, ry;
+    size_t ld;             // Байтовая ширина строки result
+} RegionPart;
+
+// @brief Фильтр части маски: заполняет result, rx, ry и ld для прямоугольника части.
+typedef ImageProcStatus (*RegionFilterFn)(const Image* image, RegionPart* part, const float param);
+
+// @brief Первый ненулевой байт строки маски, начиная с x (или width). Нулевые участки маски обычно
+//        длинные, поэтому они пропускаются по 8 байтов.
+static size_t skip_zeros(const unsigned char* row, size_t x, const size_t width)
+{
+    for (; x + 8 <= width; x += 8)
+    {
+        uint64_t word;
+        memcpy(&word, row + x, sizeof(word));
+        if (word != 0) break;
+    }
+    while (x < width && row[x] == 0) x++;
+    return x;
+}
+
+// @brief Первый нулевой байт строки маски, начиная с x (или width).
+static size_t skip_ones(const unsigned char* row, size_t x, const size_t width)
+{
+    while (x < width && row[x] != 0) x++;
+    return x;
+}
+
+// @brief Строит отрезки по бинарной маске (ненулевой байт - пиксель покрыт).
+//        Строки независимы: сначала считается количество отрезков каждой строки, затем они заполняются.
+//
+// @param set    [out] Отрезки маски (освобождаются ipl_spans_free, в том числе при ошибке).
+// @param mask   [in]  Маска width * height байтов.
+// @param width  [in]  Ширина маски.
+// @param height [in]  Высота маски.
+//
+// @return INVALID_ARGUMENT Указатели равны NULL.
+// @return OUT_OF_MEMORY    Не удалось выделить память.
+// @return SUCCESS          Отрезки построены.
+ImageProcStatus ipl_spans_from_mask(SpanSet* set, const unsigned char* mask, const size_t width, const size_t height)
+{
+    if (!set) return INVALID_ARGUMENT;
+    memset(set, 0, sizeof(*set));
+    if (!mask) return INVALID_ARGUMENT;
+
+    set->width = width;
+    set->height = height;
+    set->row_offsets = (size_t*)malloc((height + 1) * sizeof(size_t));
+    if (!set->row_offsets) return OUT_OF_MEMORY;
+
+    int parallel = width * height >= ipl_get_context()->profile.parallel_min_pixels;
+
+    // Количество отрезков строки - количество переходов 0 -> 1
+    set->row_offsets[0] = 0;
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t y = 0; y < (ptrdiff_t)height; y++)
+    {
+        const unsigned char* row = mask + (size_t)y * width;
+        size_t n = 0;
+        for (size_t x = skip_zeros(row, 0, width); x < width; x = skip_zeros(row, skip_ones(row, x, width), width))
+            n++;
+        set->row_offsets[y + 1] = n;
+    }
+    for (size_t y = 0; y < height; y++) set->row_offsets[y + 1] += set->row_offsets[y];
+    set->count = set->row_offsets[height];
+
+    set->spans = (Span*)malloc((set->count > 0 ? set->count : 1) * sizeof(Span));
+    if (!set->spans)
+    {
+        ipl_spans_free(set);
+        return OUT_OF_MEMORY;
+    }
+
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t y = 0; y < (ptrdiff_t)height; y++)
+    {
+        const unsigned char* row = mask + (size_t)y * width;
+        Span* out = set->spans + set->row_offsets[y];
+        for (size_t x = skip_zeros(row, 0, width); x < width; x = skip_zeros(row, x, width))
+        {
+            out->begin = x;
+            x = skip_ones(row, x, width);
+            out->end = x;
+            out++;
+        }
+    }
+
+    return SUCCESS;
+}
+
+// @brief Сравнение прямоугольников по верхней строке для qsort.
+static int compare_rect_y(const void* a, const void* b)
+{
+    size_t ya = ((const Rect*)a)->y, yb = ((const Rect*)b)->y;
+    return ya < yb ? -1 : ya > yb;
+}
+
+// @brief Проход по строкам сверху вниз с активным списком прямоугольников, пересекающих строку.
+//        Прямоугольник входит в список, когда проход доходит до его верхней строки, и выходит после нижней,
+//        поэтому строки, которых не касается ни один прямоугольник, ничего не стоят. Список упорядочен
+//        по x, и отрезки строки получаются слиянием соседних (пересекающихся или соприкасающихся) элементов.
+//
+// @param sorted       [in]  Обрезанные по изображению непустые прямоугольники, упорядоченные по y.
+// @param active       [in]  Рабочий массив на count прямоугольников.
+// @param row_offsets  [out] Смещения отрезков строк (height + 1 элементов, row_offsets[0] = 0).
+// @param spans        [out] Отрезки или NULL, если нужно только их количество.
+static void sweep_rects(const Rect* sorted, const size_t count, const size_t height, Rect* active,
+                        size_t* row_offsets, Span* spans)
+{
+    size_t next = 0, active_count = 0, total = 0;
+    for (size_t y = 0; y < height; y++)
+    {
+        // Удаление закончившихся прямоугольников с сохранением порядка
+        size_t kept = 0;
+        for (size_t i = 0; i < active_count; i++)
+            if (y - active[i].y < active[i].height) active[kept++] = active[i];
+        active_count = kept;
+
+        // Добавление начавшихся вставкой по x
+        for (; next < count && sorted[next].y == y; next++)
+        {
+            size_t i = active_count++;
+            while (i > 0 && active[i - 1].x > sorted[next].x) { active[i] = active[i - 1]; i--; }
+            active[i] = sorted[next];
+        }
+
+        for (size_t i = 0; i < active_count; i++)
+        {
+            size_t begin = active[i].x, end = active[i].x + active[i].width;
+            while (i + 1 < active_count && active[i + 1].x <= end)
+            {
+                i++;
+                if (active[i].x + active[i].width > end) end = active[i].x + active[i].width;
+            }
+            if (spans) spans[total] = (Span){ begin, end };
+            total++;
+        }
+        row_offsets[y + 1] = total;
+    }
+}
+
+// @brief Строит отрезки по списку прямоугольников (части за границами изображения отбрасываются).
+//        Маска на весь кадр не создается: прямоугольники один раз сортируются по y, и каждая строка
+//        проходит только пересекающие ее, поэтому стоимость - O(count * log(count)) плюс количество пар
+//        (строка, прямоугольник).
+//
+// @param set    [out] Отрезки (освобождаются ipl_spans_free, в том числе при ошибке).
+// @param rects  [in]  Прямоугольники (могут пересекаться).
+// @param count  [in]  Количество прямоугольников.
+// @param width  [in]  Ширина изображения.
+// @param height [in]  Высота изображения.
+//
+// @return INVALID_ARGUMENT set равен NULL, rects равен NULL при count > 0 или count < 0.
+// @return OUT_OF_MEMORY    Не удалось выделить память.
+// @return SUCCESS          Отрезки построены.
+ImageProcStatus ipl_spans_from_rects(SpanSet* set, const Rect* rects, const int count, const size_t width, const size_t height)
+{
+    if (!set) return INVALID_ARGUMENT;
+    memset(set, 0, sizeof(*set));
+    if (count < 0 || (!rects && count > 0)) return INVALID_ARGUMENT;
+
+    set->width = width;
+    set->height = height;
+    set->row_offsets = (size_t*)calloc(height + 1, sizeof(size_t));
+    Rect* sorted = (Rect*)malloc((count > 0 ? (size_t)count : 1) * 2 * sizeof(Rect));
+    if (!set->row_offsets || !sorted)
+    {
+        free(sorted);
+        ipl_spans_free(set);
+        return OUT_OF_MEMORY;
+    }
+    Rect* active = sorted + (count > 0 ? count : 1);
+
+    // Обрезка по изображению; пустые и лежащие за границами прямоугольники отбрасываются
+    size_t n = 0;
+    for (int r = 0; r < count; r++)
+    {
+        Rect rect = rects[r];
+        if (rect.x >= width || rect.y >= height || rect.width == 0 || rect.height == 0) continue;
+        if (rect.width > width - rect.x) rect.width = width - rect.x;
+        if (rect.height > height - rect.y) rect.height = height - rect.y;
+        sorted[n++] = rect;
+    }
+    qsort(sorted, n, sizeof(Rect), compare_rect_y);
+
+    if (n > 0) sweep_rects(sorted, n, height, active, set->row_offsets, NULL);
+    set->count = set->row_offsets[height];
+
+    set->spans = (Span*)malloc((set->count > 0 ? set->count : 1) * sizeof(Span));
+    if (!set->spans)
+    {
+        free(sorted);
+        ipl_spans_free(set);
+        return OUT_OF_MEMORY;
+    }
+    if (n > 0) sweep_rects(sorted, n, height, active, set->row_offsets, set->spans);
+
+    free(sorted);
+    return SUCCESS;
+}
+
+// @brief Освобождает отрезки маски (повторный вызов безопасен).
+void ipl_spans_free(SpanSet* set)
+{
+    if (!set) return;
+    free(set->row_offsets);
+    free(set->spans);
+    set->row_offsets = NULL;
+    set->spans = NULL;
+    set->count = 0;
+}
+
+// @brief Применяет фильтр только к пикселям маски.
+//        Покрытые отрезками тайлы IPL_REGION_TILE x IPL_REGION_TILE объединяются в связные компоненты,
+//        и каждая компонента фильтруется отдельно по своему ограничивающему прямоугольнику с ореолом
+//        (halo) из соседних пикселей. Поэтому стоимость пропорциональна площади маски, а не кадра:
+//        несколько лиц на большом снимке - несколько небольших окон.
+//        Все части сначала фильтруются по исходному изображению, и только затем результат
+//        копируется в target по отрезкам маски, поэтому ореол одной части не видит результат другой.
+//        Пиксели target вне маски не изменяются; target может совпадать с source.
+static ImageProcStatus filter_regions(const Image* source, Image* target, const SpanSet* spans, RegionFilterFn filter, const float param)
+{
+    if (spans->width != source->width || spans->height != source->height || !spans->row_offsets) return INVALID_ARGUMENT;
+    if (spans->count == 0) return SUCCESS;
+
+    const size_t width = source->width;
+    const size_t height = source->height;
+    const size_t channels = source->channels;
+    const size_t tile = IPL_REGION_TILE;
+    const size_t grid_w = (width + tile - 1) / tile;
+    const size_t grid_h = (height + tile - 1) / tile;
+
+    // Метки тайлов: 0 - не покрыт, -1 - покрыт, > 0 - номер компоненты
+    int* labels = (int*)calloc(grid_w * grid_h, sizeof(int));
+    size_t* stack = (size_t*)malloc(grid_w * grid_h * sizeof(size_t));
+    if (!labels || !stack)
+    {
+        free(labels);
+        free(stack);
+        return OUT_OF_MEMORY;
+    }
+
+    for (size_t y = 0; y < height; y++)
+    {
+        int* tile_row = labels + (y / tile) * grid_w;
+        for (size_t s = spans->row_offsets[y]; s < spans->row_offsets[y + 1]; s++)
+            for (size_t tx = spans->spans[s].begin / tile; tx <= (spans->spans[s].end - 1) / tile; tx++)
+                tile_row[tx] = -1;
+    }
+
+    // Связные компоненты покрытых тайлов (4-связность)
+    RegionPart* parts = NULL;
+    int part_count = 0;
+    ImageProcStatus status = SUCCESS;
+    for (size_t t = 0; t < grid_w * grid_h && status == SUCCESS; t++)
+    {
+        if (labels[t] != -1) continue;
+
+        RegionPart* grown = (RegionPart*)realloc(parts, (part_count + 1) * sizeof(RegionPart));
+        if (!grown)
+        {
+            status = OUT_OF_MEMORY;
+            break;
+        }
+        parts = grown;
+        parts[part_count] = (RegionPart){ width, height, 0, 0, NULL, 0, 0, 0 };
+        int label = ++part_count;
+
+        size_t top = 0;
+        stack[top++] = t;
+        labels[t] = label;
+        while (top > 0)
+        {
+            size_t cur = stack[--top];
+            size_t tx = cur % grid_w, ty = cur / grid_w;
+            if (tx > 0 && labels[cur - 1] == -1)               { labels[cur - 1] = label; stack[top++] = cur - 1; }
+            if (tx + 1 < grid_w && labels[cur + 1] == -1)      { labels[cur + 1] = label; stack[top++] = cur + 1; }
+            if (ty > 0 && labels[cur - grid_w] == -1)          { labels[cur - grid_w] = label; stack[top++] = cur - grid_w; }
+            if (ty + 1 < grid_h && labels[cur + grid_w] == -1) { labels[cur + grid_w] = label; stack[top++] = cur + grid_w; }
+        }
+    }
+    free(stack);
+
+    // Точные границы компонент. Тайлы одного отрезка соседние, поэтому отрезок целиком принадлежит одной компоненте.
+    size_t covered = 0;
+    for (size_t y = 0; y < height && status == SUCCESS; y++)
+    {
+        const int* tile_row = labels + (y / tile) * grid_w;
+        for (size_t s = spans->row_offsets[y]; s < spans->row_offsets[y + 1]; s++)
+        {
+            const Span* span = &spans->spans[s];
+            RegionPart* part = &parts[tile_row[span->begin / tile] - 1];
+            if (span->begin < part->x0) part->x0 = span->begin;
+            if (span->end > part->x1) part->x1 = span->end;
+            if (y < part->y0) part->y0 = y;
+            if (y + 1 > part->y1) part->y1 = y + 1;
+            covered += span->end - span->begin;
+        }
+    }
+
+    // Небольшие части фильтруются параллельно друг другу, большие - по одной, но с параллельными фильтрами внутри
+    size_t parallel_min_pixels = ipl_get_context()->profile.parallel_min_pixels;
+    size_t largest = 0;
+    for (int p = 0; p < part_count; p++)
+    {
+        size_t area = (parts[p].x1 - parts[p].x0) * (parts[p].y1 - parts[p].y0);
+        if (area > largest) largest = area;
+    }
+
+    if (status == SUCCESS)
+    {
+        #pragma omp parallel for schedule(dynamic) if (part_count > 1 && largest < parallel_min_pixels)
+        for (int p = 0; p < part_count; p++)
+        {
+            ImageProcStatus part_status = filter(source, &parts[p], param);
+            if (part_status != SUCCESS)
+            {
+                #pragma omp atomic write
+                status = part_status;
+            }
+        }
+    }
+
+    // Копирование результата по отрезкам маски
+    if (status == SUCCESS)
+    {
+        #pragma omp parallel for if (covered >= parallel_min_pixels)
+        for (ptrdiff_t y = 0; y < (ptrdiff_t)height; y++)
+        {
+            const int* tile_row = labels + ((size_t)y / tile) * grid_w;
+            for (size_t s = spans->row_offsets[y]; s < spans->row_offsets[y + 1]; s++)
+            {
+                const Span* span = &spans->spans[s];
+                const RegionPart* part = &parts[tile_row[span->begin / tile] - 1];
+                memcpy(target->data + ((size_t)y * width + span->begin) * channels,
+                       part->result + ((size_t)y - part->ry) * part->ld + (span->begin - part->rx) * channels,
+                       (span->end - span->begin) * channels);
+            }
+        }
+    }
+
+    for (int p = 0; p < part_count; p++) free(parts[p].result);
+    free(parts);
+    free(labels);
+
+    return status;
+}
+
+// @brief Радиус влияния гауссова фильтра (как он выбирается в ipl_gaussian_filter): радиус ядра прямой свертки
+//        или 4 * sigma для рекурсивного фильтра, отклик которого за этим радиусом пренебрежимо мал.
+size_t ipl_gaussian_halo(const float sigma)
+{
+    const TuningProfile* profile = &ipl_get_context()->profile;
+    if (sigma >= profile->gaussian_iir_sigma && sigma >= 0.5f) return (size_t)ceilf(4.0f * sigma);
+    return (size_t)ceilf(3.0f * sigma);
+}
+
+// @brief Гауссов фильтр части маски: окно из прямоугольника части с ореолом копируется
+//        и размывается ipl_gaussian_filter. Для прямой свертки ореол равен радиусу ядра, и внутри
+//        прямоугольника результат побитово совпадает с размытием всего кадра. Для рекурсивного фильтра
+//        (большие sigma) результат совпадает с размытием кадра приближенно.
+static ImageProcStatus gaussian_region(const Image* image, RegionPart* part, const float sigma)
+{
+    size_t halo = ipl_gaussian_halo(sigma);
+    size_t channels = image->channels;
+
+    size_t x0 = part->x0 > halo ? part->x0 - halo : 0;
+    size_t y0 = part->y0 > halo ? part->y0 - halo : 0;
+    size_t x1 = image->width - part->x1 > halo ? part->x1 + halo : image->width;
+    size_t y1 = image->height - part->y1 > halo ? part->y1 + halo : image->height;
+
+    Image window = *image;
+    window.width = x1 - x0;
+    window.height = y1 - y0;
+    window.data = (unsigned char*)ipl_buffer_alloc(window.width * window.height * channels);
+    if (!window.data) return OUT_OF_MEMORY;
+
+    size_t row_len = window.width * channels;
+    for (size_t y = y0; y < y1; y++)
+        memcpy(window.data + (y - y0) * row_len, image->data + (y * image->width + x0) * channels, row_len);
+
+    ImageProcStatus status = ipl_gaussian_filter(&window, sigma);
+    if (status != SUCCESS)
+    {
+        free(window.data);
+        return status;
+    }
+
+    part->result = window.data;
+    part->rx = x0;
+    part->ry = y0;
+    part->ld = row_len;
+    return SUCCESS;
+}
+
+// @brief Медианный фильтр части маски: дополненный холст строится из пикселей вокруг прямоугольника
+//        части (за границами изображения повторяются крайние пиксели, как в ipl_median_filter),
+//        поэтому результат побитово совпадает с фильтрацией всего кадра.
+static ImageProcStatus median_region(const Image* image, RegionPart* part, const float param)
+{
+    const int radius = (int)param;
+    const size_t channels = image->channels;
+    const size_t width = part->x1 - part->x0;
+    const size_t height = part->y1 - part->y0;
+    const size_t ldp = (width + 2 * (size_t)radius) * channels;
+    const size_t h_pad = height + 2 * (size_t)radius;
+
+    // Столбцы холста: слева и справа могут выходить за изображение
+    size_t left = part->x0 < (size_t)radius ? (size_t)radius - part->x0 : 0;
+    size_t src_x0 = part->x0 + left - radius;
+    size_t src_x1 = image->width - part->x1 > (size_t)radius ? part->x1 + radius : image->width;
+    size_t right = width + 2 * (size_t)radius - left - (src_x1 - src_x0);
+
+    unsigned char* padded = (unsigned char*)ipl_buffer_alloc(ldp * h_pad);
+    unsigned char* output = (unsigned char*)ipl_buffer_alloc(width * height * channels);
+    if (!padded || !output)
+    {
+        free(padded);
+        free(output);
+        return OUT_OF_MEMORY;
+    }
+
+    #pragma omp parallel for if (ldp * h_pad >= ipl_get_context()->profile.parallel_min_pixels)
+    for (ptrdiff_t i = 0; i < (ptrdiff_t)h_pad; i++)
+    {
+        ptrdiff_t y = (ptrdiff_t)part->y0 + i - radius;
+        if (y < 0) y = 0;
+        else if (y >= (ptrdiff_t)image->height) y = (ptrdiff_t)image->height - 1;
+
+        const unsigned char* src = image->data + (size_t)y * image->width * channels;
+        unsigned char* dst = padded + (size_t)i * ldp;
+        for (size_t j = 0; j < left; j++)
+            memcpy(dst + j * channels, src, channels);
+        memcpy(dst + left * channels, src + src_x0 * channels, (src_x1 - src_x0) * channels);
+        for (size_t j = 0; j < right; j++)
+            memcpy(dst + (left + src_x1 - src_x0 + j) * channels, src + (image->width - 1) * channels, channels);
+    }
+
+    if (radius <= ipl_get_context()->profile.median_sort_max_radius && radius <= MEDIAN_SORT_LIMIT)
+        median_sort_rows(padded, ldp, output, width * channels, channels, width, height, radius);
+    else
+        median_histogram_rows(padded, ldp, output, width * channels, channels, width, height, radius);
+
+    free(padded);
+
+    part->result = output;
+    part->rx = part->x0;
+    part->ry = part->y0;
+    part->ld = width * channels;
+    return SUCCESS;
+}
+
+// @brief Гауссов фильтр (см. ipl_gaussian_filter), примененный только к пикселям маски.
+//        Остальные пиксели не изменяются, а стоимость пропорциональна площади маски с ореолом.
+//
+// @param image [in, out] Изображение.
+// @param sigma [in]      Стандартное отклонение (как в ipl_gaussian_filter).
+// @param spans [in]      Маска в виде отрезков (размеры совпадают с изображением).
+//
+// @return INVALID_ARGUMENT Указатели равны NULL, sigma отрицательна или размеры маски не совпадают с изображением.
+// @return OUT_OF_MEMORY    Не удалось выделить память.
+// @return SUCCESS          Фильтр применен.
+ImageProcStatus ipl_gaussian_filter_spans(Image* image, const float sigma, const SpanSet* spans)
+{
+    if (!image || !image->data || !spans || sigma < 0.0f) return INVALID_ARGUMENT;
+    if (sigma <= 1e-6f) return SUCCESS;
+
+    return filter_regions(image, image, spans, gaussian_region, sigma);
+}
+
+// @brief Гауссов фильтр пикселей бинарной маски (width * height байтов, ненулевой байт - пиксель размывается).
+ImageProcStatus ipl_gaussian_filter_masked(Image* image, const float sigma, const unsigned char* mask)
+{
+    if (!image || !image->data || !mask) return INVALID_ARGUMENT;
+
+    SpanSet spans;
+    ImageProcStatus status = ipl_spans_from_mask(&spans, mask, image->width, image->height);
+    if (status == SUCCESS) status = ipl_gaussian_filter_spans(image, sigma, &spans);
+    ipl_spans_free(&spans);
+
+    return status;
+}
+
+// @brief Гауссов фильтр пикселей внутри прямоугольников (например, лиц или номеров при обезличивании).
+ImageProcStatus ipl_gaussian_filter_rects(Image* image, const float sigma, const Rect* rects, const int count)
+{
+    if (!image || !image->data) return INVALID_ARGUMENT;
+
+    SpanSet spans;
+    ImageProcStatus status = ipl_spans_from_rects(&spans, rects, count, image->width, image->height);
+    if (status == SUCCESS) status = ipl_gaussian_filter_spans(image, sigma, &spans);
+    ipl_spans_free(&spans);
+
+    return status;
+}
+
+// @brief Медианный фильтр (см. ipl_median_filter), примененный только к пикселям маски.
+//        Результат на пикселях маски побитово совпадает с фильтрацией всего кадра.
+//
+// @param image  [in, out] Изображение.
+// @param radius [in]      Радиус фильтра (0 - изображение не изменяется).
+// @param spans  [in]      Маска в виде отрезков (размеры совпадают с изображением).
+//
+// @return INVALID_ARGUMENT Указатели равны NULL, радиус отрицателен или размеры маски не совпадают с изображением.
+// @return OUT_OF_MEMORY    Не удалось выделить память.
+// @return SUCCESS          Фильтр применен.
+ImageProcStatus ipl_median_filter_spans(Image* image, const int radius, const SpanSet* spans)
+{
+    if (!image || !image->data || !spans || radius < 0) return INVALID_ARGUMENT;
+    if (radius == 0) return SUCCESS;
+
+    return filter_regions(image, image, spans, median_region, (float)radius);
+}
+
+// @brief Медианный фильтр пикселей бинарной маски (width * height байтов).
+ImageProcStatus ipl_median_filter_masked(Image* image, const int radius, const unsigned char* mask)
+{
+    if (!image || !image->data || !mask) return INVALID_ARGUMENT;
+
+    SpanSet spans;
+    ImageProcStatus status = ipl_spans_from_mask(&spans, mask, image->width, image->height);
+    if (status == SUCCESS) status = ipl_median_filter_spans(image, radius, &spans);
+    ipl_spans_free(&spans);
+
+    return status;
+}
+
+// @brief Медианный фильтр пикселей внутри прямоугольников.
+ImageProcStatus ipl_median_filter_rects(Image* image, const int radius, const Rect* rects, const int count)
+{
+    if (!image || !image->data) return INVALID_ARGUMENT;
+
+    SpanSet spans;
+    ImageProcStatus status = ipl_spans_from_rects(&spans, rects, count, image->width, image->height);
+    if (status == SUCCESS) status = ipl_median_filter_spans(image, radius, &spans);
+    ipl_spans_free(&spans);
+
+    return status;
+}
+
+// @brief Расширяет прямоугольники на halo пикселей (с обрезкой по изображению) и заменяет пересекающиеся
+//        их ограничивающим прямоугольником. Пустые и лежащие за изображением прямоугольники отбрасываются.
+//
+// @param rects  [in]  Прямоугольники.
+// @param count  [in]  Количество прямоугольников.
+// @param halo   [in]  Ширина расширения в пикселях.
+// @param width  [in]  Ширина изображения.
+// @param height [in]  Высота изображения.
+// @param out    [out] Результат, не больше count прямоугольников (может совпадать с rects).
+//
+// @return Количество прямоугольников в out.
+int ipl_grow_rects(const Rect* rects, const int count, const size_t halo, const size_t width, const size_t height, Rect* out)
+{
+    int n = 0;
+    for (int r = 0; r < count; r++)
+    {
+        Rect rect = rects[r];
+        if (rect.x >= width || rect.y >= height || rect.width == 0 || rect.height == 0) continue;
+
+        size_t x1 = rect.width < width - rect.x ? rect.x + rect.width : width;
+        size_t y1 = rect.height < height - rect.y ? rect.y + rect.height : height;
+        size_t x0 = rect.x > halo ? rect.x - halo : 0;
+        size_t y0 = rect.y > halo ? rect.y - halo : 0;
+        x1 = width - x1 > halo ? x1 + halo : width;
+        y1 = height - y1 > halo ? y1 + halo : height;
+        out[n++] = (Rect){ x0, y0, x1 - x0, y1 - y0 };
+    }
+
+    // Объединение, пока есть пересекающиеся пары (прямоугольников обычно немного)
+    for (int merged = 1; merged;)
+    {
+        merged = 0;
+        for (int i = 0; i < n && !merged; i++)
+        {
+            for (int j = i + 1; j < n; j++)
+            {
+                Rect* a = &out[i];
+                const Rect* b = &out[j];
+                if (a->x >= b->x + b->width || b->x >= a->x + a->width || a->y >= b->y + b->height || b->y >= a->y + a->height) continue;
+
+                size_t x0 = a->x < b->x ? a->x : b->x;
+                size_t y0 = a->y < b->y ? a->y : b->y;
+                size_t x1 = a->x + a->width > b->x + b->width ? a->x + a->width : b->x + b->width;
+                size_t y1 = a->y + a->height > b->y + b->height ? a->y + a->height : b->y + b->height;
+                *a = (Rect){ x0, y0, x1 - x0, y1 - y0 };
+                out[j] = out[--n];
+                merged = 1;
+                break;
+            }
+        }
+    }
+
+    return n;
+}
+
+// @brief Общая часть инкрементальных фильтров: прямоугольники dirty расширяются на радиус влияния фильтра,
+//        и только в них output пересчитывается по input.
+static ImageProcStatus update_regions(const Image* input, Image* output, const Rect* dirty, const int count, const size_t halo,
+                                      RegionFilterFn filter, const float param, Rect* output_dirty, int* output_count)
+{
+    if (!input || !input->data || !output || !output->data || count < 0 || (!dirty && count > 0)) return INVALID_ARGUMENT;
+    if (input->width != output->width || input->height != output->height || input->channels != output->channels) return INVALID_ARGUMENT;
+
+    Rect* grown = (Rect*)malloc((count > 0 ? count : 1) * sizeof(Rect));
+    if (!grown) return OUT_OF_MEMORY;
+    int grown_count = ipl_grow_rects(dirty, count, halo, input->width, input->height, grown);
+
+    SpanSet spans;
+    ImageProcStatus status = ipl_spans_from_rects(&spans, grown, grown_count, input->width, input->height);
+    if (status == SUCCESS) status = filter_regions(input, output, &spans, filter, param);
+    ipl_spans_free(&spans);
+
+    if (status == SUCCESS)
+    {
+        if (output_dirty) memcpy(output_dirty, grown, grown_count * sizeof(Rect));
+        if (output_count) *output_count = grown_count;
+    }
+    free(grown);
+
+    return status;
+}
+
+// @brief Инкрементальный гауссов фильтр для интерактивного редактирования. После изменения input внутри
+//        прямоугольников dirty пересчитывается только та часть output (результата ipl_gaussian_filter для input
+//        до изменения), на которую изменения могли повлиять: dirty, расширенные на радиус влияния фильтра.
+//        Эти прямоугольники возвращаются в output_dirty, чтобы передать их следующей операции цепочки,
+//        поэтому задержка после мазка кисти пропорциональна размеру мазка, а не изображения.
+//
+// @param input        [in]      Изображение после изменения.
+// @param output       [in, out] Результат фильтра для изображения до изменения (обновляется на месте).
+// @param sigma        [in]      Стандартное отклонение, с которым был получен output.
+// @param dirty        [in]      Измененные прямоугольники input.
+// @param count        [in]      Количество прямоугольников.
+// @param output_dirty [out]     Измененные прямоугольники output, не больше count (может быть NULL).
+// @param output_count [out]     Количество прямоугольников в output_dirty (может быть NULL).
+//
+// @return INVALID_ARGUMENT Указатели равны NULL, sigma отрицательна или размеры input и output не совпадают.
+// @return OUT_OF_MEMORY    Не удалось выделить память.
+// @return SUCCESS          Результат обновлен.
+ImageProcStatus ipl_gaussian_filter_update(const Image* input, Image* output, const float sigma, const Rect* dirty, const int count,
+                                           Rect* output_dirty, int* output_count)
+{
+    if (sigma < 0.0f) return INVALID_ARGUMENT;
+
+    size_t halo = sigma <= 1e-6f ? 0 : ipl_gaussian_halo(sigma);
+    return update_regions(input, output, dirty, count, halo, gaussian_region, sigma, output_dirty, output_count);
+}
+
+// @brief Инкрементальный медианный фильтр (см. ipl_gaussian_filter_update). Радиус влияния равен радиусу фильтра,
+//        и обновленный output побитово совпадает с ipl_median_filter для нового input.
+ImageProcStatus ipl_median_filter_update(const Image* input, Image* output, const int radius, const Rect* dirty, const int count,
+                                         Rect* output_dirty, int* output_count)
+{
+    if (radius < 0) return INVALID_ARGUMENT;
+
+    return update_regions(input, output, dirty, count, (size_t)radius, median_region, (float)radius, output_dirty, output_count);
+}
@@ -0,0 +1,626 @@
+#ifndef ROI_DECODERS_H
+#define ROI_DECODERS_H
+
+// Декодирование области интереса (ROI) изображений PNG и JPEG без декодирования всего файла.
+// Использует внутренние функции stb_image, поэтому включается только в input_output.c после реализации stb_image.
+//
+// PNG: поток zlib распаковывается окнами по ROI_INFLATE_OUTPUT байт (хранится только последние 32 КБ истории),
+//      строки восстанавливаются (unfilter) только до правой границы ROI, распаковка прекращается после последней строки ROI.
+// JPEG (baseline, все компоненты в одном скане): энтропийное декодирование выполняется до последней строки MCU ROI,
+//      обратное DCT, передискретизация и преобразование цвета - только для MCU ROI (с полем в один MCU
+//      для совпадения передискретизации цветности на границах с полным декодированием).
+//
+// Остальные случаи (чересстрочный PNG, глубина не 8 бит, progressive JPEG, компоненты в разных сканах)
+// возвращают DECODE_FALLBACK: вызывающий декодирует изображение полностью и вырезает ROI.
+
+#include <string.h>
+#include "region.h"
+#include "jpeg_decoder.h"
+
+#define ROI_INFLATE_WINDOW 32768                     // Окно истории DEFLATE
+#define ROI_INFLATE_OUTPUT (4 * ROI_INFLATE_WINDOW)  // Буфер распакованных данных
+#define ROI_INFLATE_INPUT  65536                     // Буфер сжатых данных IDAT
+
+// @brief Пересекает ROI с изображением.
+//
+// @return 0, если пересечение пусто.
+static int roi_clip(const Rect* roi, const size_t width, const size_t height, size_t* x0, size_t* y0, size_t* x1, size_t* y1)
+{
+    if (roi->x >= width || roi->y >= height || roi->width == 0 || roi->height == 0) return 0;
+
+    *x0 = roi->x;
+    *y0 = roi->y;
+    *x1 = roi->width > width - roi->x ? width : roi->x + roi->width;
+    *y1 = roi->height > height - roi->y ? height : roi->y + roi->height;
+    return 1;
+}
+
+// @brief Вырезает ROI из полностью декодированного изображения (путь DECODE_FALLBACK).
+//
+// @return Пиксели ROI (память stb_image) или NULL. Исходные пиксели освобождаются.
+static stbi_uc* roi_crop_pixels(stbi_uc* pixels, const int width, const int height, const int channels, const Rect* roi,
+                                int* out_width, int* out_height)
+{
+    size_t x0, y0, x1, y1;
+    if (!roi_clip(roi, (size_t)width, (size_t)height, &x0, &y0, &x1, &y1))
+    {
+        stbi_image_free(pixels);
+        return stbi__errpuc("empty roi", "ROI outside of image");
+    }
+
+    size_t row = (x1 - x0) * channels;
+    stbi_uc* cropped = (stbi_uc*)stbi__malloc_mad2((int)row, (int)(y1 - y0), 0);
+    if (cropped)
+    {
+        for (size_t y = y0; y < y1; y++)
+        {
+            memcpy(cropped + (y - y0) * row, pixels + (y * width + x0) * channels, row);
+        }
+        *out_width = (int)(x1 - x0);
+        *out_height = (int)(y1 - y0);
+    }
+    stbi_image_free(pixels);
+    return cropped;
+}
+
+// ----------------------------------------------------------------------------------------------------------------
+// PNG
+
+// @brief Чтение данных чанков IDAT частями: сжатый поток не собирается в памяти целиком.
+typedef struct
+{
+    stbi__context* s;
+    stbi__uint32 chunk_left; // Байт, оставшихся в текущем IDAT
+    int ended;               // Чанки IDAT закончились
+    stbi_uc input[ROI_INFLATE_INPUT];
+} PngIdatReader;
+
+// @brief Переносит непрочитанный остаток входа в начало буфера и дочитывает данные IDAT до заполнения буфера.
+static void png_idat_fill(PngIdatReader* reader, stbi__zbuf* z)
+{
+    size_t left = (size_t)(z->zbuffer_end - z->zbuffer);
+    memmove(reader->input, z->zbuffer, left);
+
+    while (left < ROI_INFLATE_INPUT && !reader->ended)
+    {
+        if (reader->chunk_left == 0)
+        {
+            stbi__get32be(reader->s); // CRC предыдущего чанка
+            stbi__pngchunk c = stbi__get_chunk_header(reader->s);
+            if (c.type != STBI__PNG_TYPE('I', 'D', 'A', 'T') || stbi__at_eof(reader->s)) reader->ended = 1;
+            reader->chunk_left = c.length;
+            continue;
+        }
+
+        size_t n = ROI_INFLATE_INPUT - left;
+        if (n > reader->chunk_left) n = reader->chunk_left;
+        if (!stbi__getn(reader->s, reader->input + left, (int)n))
+        {
+            reader->ended = 1;
+            break;
+        }
+        left += n;
+        reader->chunk_left -= (stbi__uint32)n;
+    }
+
+    z->zbuffer = reader->input;
+    z->zbuffer_end = reader->input + left;
+}
+
+// @brief Приемник распакованных данных. Возвращает 0, чтобы остановить распаковку.
+typedef int (*InflateSink)(void* context, const stbi_uc* data, size_t size);
+
+// @brief Потоковая распаковка zlib со скользящим окном (в отличие от stbi_zlib_decode, которая распаковывает весь поток).
+typedef struct
+{
+    stbi__zbuf z;
+    PngIdatReader* reader;
+    stbi_uc out[ROI_INFLATE_OUTPUT];
+    size_t pos;       // Позиция записи в out
+    size_t emitted;   // Данные out до этой позиции переданы приемнику
+    size_t total;     // Всего распаковано байт
+    InflateSink sink;
+    void* context;
+    int stopped;      // Приемник остановил распаковку
+} RoiInflate;
+
+// @brief Передает приемнику новые данные и сдвигает окно, оставляя 32 КБ истории для ссылок назад.
+static int roi_inflate_emit(RoiInflate* f)
+{
+    if (f->pos > f->emitted && !f->sink(f->context, f->out + f->emitted, f->pos - f->emitted))
+    {
+        f->stopped = 1;
+        return 0;
+    }
+
+    size_t keep = f->pos < ROI_INFLATE_WINDOW ? f->pos : ROI_INFLATE_WINDOW;
+    memmove(f->out, f->out + f->pos - keep, keep);
+    f->pos = f->emitted = keep;
+    return 1;
+}
+
+// @brief Распаковывает блок Хаффмана (аналог stbi__parse_huffman_block с ограниченным окном).
+static int roi_inflate_huffman(RoiInflate* f)
+{
+    stbi__zbuf* a = &f->z;
+    for (;;)
+    {
+        // Символ длины и расстояния занимает не больше 48 бит
+        if (a->zbuffer_end - a->zbuffer < 32) png_idat_fill(f->reader, a);
+
+        int z = stbi__zhuffman_decode(a, &a->z_length);
+        if (z < 256)
+        {
+            if (z < 0) return stbi__err("bad huffman code", "Corrupt PNG");
+            if (f->pos == ROI_INFLATE_OUTPUT && !roi_inflate_emit(f)) return 0;
+            f->out[f->pos++] = (stbi_uc)z;
+            f->total++;
+            continue;
+        }
+        if (z == 256)
+        {
+            if (a->hit_zeof_once && a->num_bits < 16) return stbi__err("unexpected end", "Corrupt PNG");
+            return 1;
+        }
+        if (z >= 286) return stbi__err("bad huffman code", "Corrupt PNG");
+
+        z -= 257;
+        int len = stbi__zlength_base[z];
+        if (stbi__zlength_extra[z]) len += stbi__zreceive(a, stbi__zlength_extra[z]);
+        z = stbi__zhuffman_decode(a, &a->z_distance);
+        if (z < 0 || z >= 30) return stbi__err("bad huffman code", "Corrupt PNG");
+        int dist = stbi__zdist_base[z];
+        if (stbi__zdist_extra[z]) dist += stbi__zreceive(a, stbi__zdist_extra[z]);
+        if ((size_t)dist > f->total) return stbi__err("bad dist", "Corrupt PNG");
+
+        // После сдвига окна в out остается не меньше 32 КБ истории, поэтому ссылка всегда внутри буфера
+        if (f->pos + len > ROI_INFLATE_OUTPUT && !roi_inflate_emit(f)) return 0;
+        stbi_uc* q = f->out + f->pos;
+        const stbi_uc* p = q - dist;
+        if (dist == 1) memset(q, *p, (size_t)len);
+        else for (int i = 0; i < len; i++) q[i] = p[i];
+        f->pos += len;
+        f->total += len;
+    }
+}
+
+// @brief Копирует несжатый блок (аналог stbi__parse_uncompressed_block).
+static int roi_inflate_stored(RoiInflate* f)
+{
+    stbi__zbuf* a = &f->z;
+    stbi_uc header[4];
+    int k = 0;
+
+    if (a->num_bits & 7) stbi__zreceive(a, a->num_bits & 7);
+    while (a->num_bits > 0)
+    {
+        header[k++] = (stbi_uc)(a->code_buffer & 255);
+        a->code_buffer >>= 8;
+        a->num_bits -= 8;
+    }
+    if (a->num_bits < 0) return stbi__err("zlib corrupt", "Corrupt PNG");
+    if (a->zbuffer_end - a->zbuffer < 4) png_idat_fill(f->reader, a);
+    while (k < 4) header[k++] = stbi__zget8(a);
+
+    size_t len = header[1] * 256 + header[0];
+    size_t nlen = header[3] * 256 + header[2];
+    if (nlen != (len ^ 0xffff)) return stbi__err("zlib corrupt", "Corrupt PNG");
+
+    while (len > 0)
+    {
+        if (a->zbuffer == a->zbuffer_end)
+        {
+            png_idat_fill(f->reader, a);
+            if (a->zbuffer == a->zbuffer_end) return stbi__err("read past buffer", "Corrupt PNG");
+        }
+        if (f->pos == ROI_INFLATE_OUTPUT && !roi_inflate_emit(f)) return 0;
+
+        size_t n = (size_t)(a->zbuffer_end - a->zbuffer);
+        if (n > len) n = len;
+        if (n > ROI_INFLATE_OUTPUT - f->pos) n = ROI_INFLATE_OUTPUT - f->pos;
+        memcpy(f->out + f->pos, a->zbuffer, n);
+        a->zbuffer += n;
+        f->pos += n;
+        f->total += n;
+        len -= n;
+    }
+    return 1;
+}
+
+// @brief Распаковывает поток zlib, передавая данные приемнику, пока поток не закончится или приемник не остановит его.
+//
+// @return 1, если поток распакован или остановлен приемником (f->stopped), 0 при ошибке.
+static int roi_inflate(RoiInflate* f)
+{
+    stbi__zbuf* a = &f->z;
+    png_idat_fill(f->reader, a);
+    if (!stbi__parse_zlib_header(a)) return 0;
+
+    a->num_bits = 0;
+    a->code_buffer = 0;
+    a->hit_zeof_once = 0;
+
+    int final;
+    do
+    {
+        // Заголовок динамических кодов Хаффмана занимает меньше 1 КБ
+        if (a->zbuffer_end - a->zbuffer < 1024) png_idat_fill(f->reader, a);
+
+        final = stbi__zreceive(a, 1);
+        int type = stbi__zreceive(a, 2);
+        int ok;
+        if (type == 0)
+        {
+            ok = roi_inflate_stored(f);
+        }
+        else if (type == 3)
+        {
+            return stbi__err("bad block type", "Corrupt PNG");
+        }
+        else
+        {
+            if (type == 1)
+            {
+                if (!stbi__zbuild_huffman(&a->z_length, stbi__zdefault_length, STBI__ZNSYMS)) return 0;
+                if (!stbi__zbuild_huffman(&a->z_distance, stbi__zdefault_distance, 32)) return 0;
+            }
+            else if (!stbi__compute_huffman_codes(a))
+            {
+                return 0;
+            }
+            ok = roi_inflate_huffman(f);
+        }
+        if (!ok) return f->stopped;
+    } while (!final);
+
+    return roi_inflate_emit(f) || f->stopped;
+}
+
+// @brief Сборка строк PNG из распакованного потока: восстановление фильтров до правой границы ROI
+//        и копирование столбцов ROI в выходное изображение.
+typedef struct
+{
+    size_t x0, y0, x1, y1;    // ROI
+    int img_n;                // Байт на пиксель в файле
+    int out_n;                // Каналов на выходе
+    size_t row_bytes;         // Байт на строку в потоке (с байтом фильтра)
+    size_t need;              // Байт строки, нужных для ROI (x1 * img_n)
+    stbi_uc* row;             // Текущая строка (байт фильтра + need байт)
+    stbi_uc* prior;           // Предыдущая восстановленная строка (need байт)
+    size_t filled;            // Получено байт текущей строки
+    size_t y;                 // Номер текущей строки
+    const stbi_uc* palette;   // RGBA палитры или NULL
+    int has_trns;             // Прозрачный цвет для RGB
+    stbi_uc trns[3];
+    stbi_uc* output;
+    int error;
+} PngRoiSink;
+
+// @brief Восстанавливает первые need байт строки по фильтру PNG.
+static int png_roi_unfilter(PngRoiSink* p)
+{
+    if (p->row[0] > PNG_FILTER_PAETH) return stbi__err("invalid filter", "Corrupt PNG");
+    ipl_get_context()->kernels.png_unfilter(p->row[0], p->row + 1, p->prior, p->row + 1, p->need, p->img_n);
+    return 1;
+}
+
+// @brief Копирует столбцы ROI восстановленной строки в выходное изображение, раскрывая палитру и прозрачный цвет.
+static void png_roi_store(PngRoiSink* p)
+{
+    const stbi_uc* in = p->row + 1 + p->x0 * p->img_n;
+    stbi_uc* out = p->output + (p->y - p->y0) * (p->x1 - p->x0) * p->out_n;
+    const size_t count = p->x1 - p->x0;
+
+    if (p->palette)
+    {
+        for (size_t i = 0; i < count; i++, out += p->out_n)
+        {
+            memcpy(out, p->palette + 4 * in[i], (size_t)p->out_n);
+        }
+    }
+    else if (p->has_trns)
+    {
+        for (size_t i = 0; i < count; i++, in += 3, out += 4)
+        {
+            out[0] = in[0];
+            out[1] = in[1];
+            out[2] = in[2];
+            out[3] = (in[0] == p->trns[0] && in[1] == p->trns[1] && in[2] == p->trns[2]) ? 0 : 255;
+        }
+    }
+    else
+    {
+        memcpy(out, in, count * p->img_n);
+    }
+}
+
+// @brief Приемник распакованных данных PNG: собирает строки, хранит из них только первые need байт.
+static int png_roi_sink(void* context, const stbi_uc* data, size_t size)
+{
+    PngRoiSink* p = (PngRoiSink*)context;
+    while (size > 0)
+    {
+        size_t take = p->row_bytes - p->filled;
+        if (take > size) take = size;
+        if (p->filled < 1 + p->need)
+        {
+            size_t copy = 1 + p->need - p->filled;
+            memcpy(p->row + p->filled, data, copy < take ? copy : take);
+        }
+        p->filled += take;
+        data += take;
+        size -= take;
+        if (p->filled < p->row_bytes) break;
+
+        if (!png_roi_unfilter(p))
+        {
+            p->error = 1;
+            return 0;
+        }
+        if (p->y >= p->y0) png_roi_store(p);
+        memcpy(p->prior, p->row + 1, p->need);
+
+        p->filled = 0;
+        if (++p->y == p->y1) return 0; // Строки ниже ROI не нужны
+    }
+    return 1;
+}
+
+// @brief Декодирует ROI из PNG глубиной 8 бит без чересстрочности.
+static int png_decode_roi(stbi__context* s, const Rect* roi, stbi_uc** pixels, int* out_width, int* out_height, int* channels)
+{
+    stbi_uc palette[1024] = { 0 };
+    stbi_uc trns[3] = { 0, 0, 0 };
+    stbi__uint32 width = 0, height = 0;
+    int color = -1, pal_len = 0, has_trns = 0;
+
+    if (!stbi__check_png_header(s)) return DECODE_FAILED;
+
+    for (;;)
+    {
+        stbi__pngchunk c = stbi__get_chunk_header(s);
+        if (stbi__at_eof(s)) return stbi__err("no IDAT", "Corrupt PNG");
+
+        if (c.type == STBI__PNG_TYPE('I', 'H', 'D', 'R'))
+        {
+            if (c.length != 13) return stbi__err("bad IHDR len", "Corrupt PNG");
+            width = stbi__get32be(s);
+            height = stbi__get32be(s);
+            int depth = stbi__get8(s);
+            color = stbi__get8(s);
+            int compression = stbi__get8(s);
+            int filter = stbi__get8(s);
+            int interlace = stbi__get8(s);
+            if (width == 0 || height == 0 || width > STBI_MAX_DIMENSIONS || height > STBI_MAX_DIMENSIONS) return stbi__err("bad dimensions", "Corrupt PNG");
+            if (color > 6 || color == 1 || color == 5 || compression || filter || interlace > 1) return stbi__err("bad IHDR", "Corrupt PNG");
+            if (depth != 8 || interlace) return DECODE_FALLBACK;
+        }
+        else if (c.type == STBI__PNG_TYPE('P', 'L', 'T', 'E'))
+        {
+            pal_len = (int)(c.length / 3);
+            if (c.length > 256 * 3 || pal_len * 3 != (int)c.length) return stbi__err("invalid PLTE", "Corrupt PNG");
+            for (int i = 0; i < pal_len; i++)
+            {
+                palette[i * 4 + 0] = stbi__get8(s);
+                palette[i * 4 + 1] = stbi__get8(s);
+                palette[i * 4 + 2] = stbi__get8(s);
+                palette[i * 4 + 3] = 255;
+            }
+        }
+        else if (c.type == STBI__PNG_TYPE('t', 'R', 'N', 'S'))
+        {
+            if (color == 3)
+            {
+                if (pal_len == 0 || (int)c.length > pal_len) return stbi__err("bad tRNS len", "Corrupt PNG");
+                for (stbi__uint32 i = 0; i < c.length; i++) palette[i * 4 + 3] = stbi__get8(s);
+            }
+            else if (color == 2 && c.length == 6)
+            {
+                for (int k = 0; k < 3; k++) trns[k] = (stbi_uc)(stbi__get16be(s) & 255);
+            }
+            else
+            {
+                return DECODE_FALLBACK; // Прозрачный цвет для серого изображения дает 2 канала
+            }
+            has_trns = 1;
+        }
+        else if (c.type == STBI__PNG_TYPE('I', 'D', 'A', 'T'))
+        {
+            if (color < 0) return stbi__err("no IHDR", "Corrupt PNG");
+            if (color == 3 && pal_len == 0) return stbi__err("no PLTE", "Corrupt PNG");
+
+            PngIdatReader* reader = (PngIdatReader*)stbi__malloc(sizeof(PngIdatReader));
+            RoiInflate* inflate = (RoiInflate*)stbi__malloc(sizeof(RoiInflate));
+            PngRoiSink sink;
+            memset(&sink, 0, sizeof(sink));
+            sink.img_n = color == 3 ? 1 : color == 4 ? 2 : color == 6 ? 4 : color == 2 ? 3 : 1;
+            sink.out_n = color == 3 ? (has_trns ? 4 : 3) : (has_trns ? 4 : sink.img_n);
+            if (sink.out_n == 2)
+            {
+                STBI_FREE(reader);
+                STBI_FREE(inflate);
+                return DECODE_FALLBACK;
+            }
+            if (!roi_clip(roi, width, height, &sink.x0, &sink.y0, &sink.x1, &sink.y1))
+            {
+                STBI_FREE(reader);
+                STBI_FREE(inflate);
+                return stbi__err("empty roi", "ROI outside of image");
+            }
+            sink.row_bytes = 1 + (size_t)width * sink.img_n;
+            sink.need = sink.x1 * sink.img_n;
+            sink.row = (stbi_uc*)stbi__malloc(1 + sink.need);
+            sink.prior = (stbi_uc*)stbi__malloc(sink.need);
+            sink.palette = color == 3 ? palette : NULL;
+            sink.has_trns = color == 2 && has_trns;
+            memcpy(sink.trns, trns, sizeof(trns));
+            sink.output = (stbi_uc*)stbi__malloc_mad3((int)(sink.x1 - sink.x0), (int)(sink.y1 - sink.y0), sink.out_n, 0);
+
+            int result = DECODE_FAILED;
+            if (!reader || !inflate || !sink.row || !sink.prior || !sink.output)
+            {
+                stbi__err("outofmem", "Out of memory");
+            }
+            else
+            {
+                memset(sink.prior, 0, sink.need);
+                memset(&inflate->z, 0, sizeof(inflate->z));
+                reader->s = s;
+                reader->chunk_left = c.length;
+                reader->ended = 0;
+                inflate->z.zbuffer = inflate->z.zbuffer_end = reader->input;
+                inflate->reader = reader;
+                inflate->pos = inflate->emitted = inflate->total = 0;
+                inflate->sink = png_roi_sink;
+                inflate->context = &sink;
+                inflate->stopped = 0;
+
+                if (roi_inflate(inflate) && !sink.error)
+                {
+                    if (sink.y < sink.y1) stbi__err("not enough pixels", "Corrupt PNG");
+                    else result = DECODE_DONE;
+                }
+            }
+
+            STBI_FREE(reader);
+            STBI_FREE(inflate);
+            STBI_FREE(sink.row);
+            STBI_FREE(sink.prior);
+            if (result != DECODE_DONE)
+            {
+                STBI_FREE(sink.output);
+                return result;
+            }
+            *pixels = sink.output;
+            *out_width = (int)(sink.x1 - sink.x0);
+            *out_height = (int)(sink.y1 - sink.y0);
+            *channels = sink.out_n;
+            return DECODE_DONE;
+        }
+        else if (c.type == STBI__PNG_TYPE('I', 'E', 'N', 'D'))
+        {
+            return stbi__err("no IDAT", "Corrupt PNG");
+        }
+        else if (c.type == STBI__PNG_TYPE('C', 'g', 'B', 'I'))
+        {
+            return DECODE_FALLBACK;
+        }
+        else
+        {
+            if ((c.type & (1 << 29)) == 0) return stbi__err("unknown critical chunk", "PNG not supported");
+            stbi__skip(s, (int)c.length);
+        }
+        stbi__get32be(s); // CRC
+    }
+}
+
+// ----------------------------------------------------------------------------------------------------------------
+// JPEG
+
+// @brief Энтропийное декодирование baseline-скана до последней строки MCU окна [mx0, mx1) x [my0, my1).
+//        Блоки вне окна декодируются только для продвижения по потоку и предсказания DC, без обратного DCT.
+static int jpeg_roi_entropy(stbi__jpeg* z, const int mx0, const int my0, const int mx1, const int my1)
+{
+    const IdctRowFn idct_row = ipl_get_context()->kernels.idct_row;
+    STBI_SIMD_ALIGN(short, coefficients[4 * 16 * 64]); // До 4 компонент по 4x4 блока
+    stbi__jpeg_reset(z);
+
+    for (int j = 0; j < my1; j++)
+    {
+        for (int i = 0; i < z->img_mcu_x; i++)
+        {
+            if (!jpeg_decode_mcu(z, coefficients)) return 0;
+            if (j >= my0 && i >= mx0 && i < mx1) jpeg_idct_mcu(z, coefficients, i - mx0, j - my0, idct_row);
+            if (!jpeg_next_mcu(z)) return 1;
+        }
+    }
+    return 1;
+}
+
+// @brief Передискретизирует и преобразует в RGB/серый декодированное окно, сохраняя только строки и столбцы ROI.
+//        Размеры окна заданы в z->s->img_x/img_y.
+static stbi_uc* jpeg_roi_convert(stbi__jpeg* z, const int n, const size_t cx0, const size_t cy0, const size_t cx1, const size_t cy1)
+{
+    const size_t count = cx1 - cx0;
+    stbi__resample res[4];
+    jpeg_setup_resample(z, res);
+
+    // Преобразование цвета stb_image записывает байт после последнего пикселя (как и в load_jpeg_image)
+    stbi_uc* linebuf = (stbi_uc*)stbi__malloc_mad2(z->s->img_n, z->s->img_x + 3, 0);
+    stbi_uc* output = (stbi_uc*)stbi__malloc_mad3(n, (int)count, (int)(cy1 - cy0), 1);
+    if (!linebuf || !output)
+    {
+        STBI_FREE(linebuf);
+        STBI_FREE(output);
+        return stbi__errpuc("outofmem", "Out of memory");
+    }
+
+    jpeg_convert_rows(z, res, n, cy0, cy1, cx0, cx1, output, n * count, linebuf);
+    STBI_FREE(linebuf);
+    return output;
+}
+
+// @brief Декодирует ROI из baseline JPEG, все компоненты которого закодированы в одном скане.
+static int jpeg_decode_roi_image(stbi__jpeg* z, const Rect* roi, stbi_uc** pixels, int* out_width, int* out_height, int* channels)
+{
+    stbi__context* s = z->s;
+    int result = jpeg_read_frame(z);
+    if (result != DECODE_DONE) return result;
+
+    size_t x0, y0, x1, y1;
+    if (!roi_clip(roi, s->img_x, s->img_y, &x0, &y0, &x1, &y1)) return stbi__err("empty roi", "ROI outside of image");
+
+    // Окно MCU, покрывающее ROI, с полем в один MCU: передискретизация цветности на внутренних границах окна
+    // не влияет на пиксели ROI
+    const int mx0 = (int)(x0 / z->img_mcu_w) > 0 ? (int)(x0 / z->img_mcu_w) - 1 : 0;
+    const int my0 = (int)(y0 / z->img_mcu_h) > 0 ? (int)(y0 / z->img_mcu_h) - 1 : 0;
+    int mx1 = (int)((x1 + z->img_mcu_w - 1) / z->img_mcu_w) + 1;
+    int my1 = (int)((y1 + z->img_mcu_h - 1) / z->img_mcu_h) + 1;
+    if (mx1 > z->img_mcu_x) mx1 = z->img_mcu_x;
+    if (my1 > z->img_mcu_y) my1 = z->img_mcu_y;
+
+    const size_t win_x0 = (size_t)mx0 * z->img_mcu_w;
+    const size_t win_y0 = (size_t)my0 * z->img_mcu_h;
+    size_t win_x1 = (size_t)mx1 * z->img_mcu_w;
+    size_t win_y1 = (size_t)my1 * z->img_mcu_h;
+    if (win_x1 > s->img_x) win_x1 = s->img_x;
+    if (win_y1 > s->img_y) win_y1 = s->img_y;
+
+    if (!jpeg_alloc_planes(z, mx0, my0, mx1, my1)) return DECODE_FAILED;
+    result = jpeg_read_scan(z);
+    if (result != DECODE_DONE) return result;
+    if (!jpeg_roi_entropy(z, mx0, my0, mx1, my1)) return DECODE_FAILED;
+
+    // Дальше окно обрабатывается как самостоятельное изображение
+    const int n = s->img_n >= 3 ? 3 : 1;
+    jpeg_set_window(z, win_x0, win_y0, win_x1, win_y1);
+
+    stbi_uc* output = jpeg_roi_convert(z, n, x0 - win_x0, y0 - win_y0, x1 - win_x0, y1 - win_y0);
+    if (!output) return DECODE_FAILED;
+
+    *pixels = output;
+    *out_width = (int)(x1 - x0);
+    *out_height = (int)(y1 - y0);
+    *channels = n;
+    return DECODE_DONE;
+}
+
+// @brief Декодирует ROI из JPEG (обертка, управляющая памятью декодера stb_image).
+static int jpeg_decode_roi(stbi__context* s, const Rect* roi, stbi_uc** pixels, int* out_width, int* out_height, int* channels)
+{
+    stbi__jpeg* z = jpeg_create(s);
+    if (!z) return DECODE_FAILED;
+    int result = jpeg_decode_roi_image(z, roi, pixels, out_width, out_height, channels);
+    jpeg_destroy(z);
+    return result;
+}
+
+// @brief Декодирует ROI изображения из контекста stb_image, выбирая декодер по сигнатуре файла.
+static int decode_roi(stbi__context* s, const Rect* roi, stbi_uc** pixels, int* out_width, int* out_height, int* channels)
+{
+    if (stbi__png_test(s)) return png_decode_roi(s, roi, pixels, out_width, out_height, channels);
+    if (stbi__jpeg_test(s)) return jpeg_decode_roi(s, roi, pixels, out_width, out_height, channels);
+    return DECODE_FALLBACK;
+}
+
+#endif
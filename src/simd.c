@@ -0,0 +1,2012 @@
+#include "simd.h"
+#include "imageproc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// Векторные реализации собираются атрибутом target, поэтому весь исполняемый файл компилируется
+// для базового x86-64 и запускается на любом процессоре, а нужная версия выбирается во время работы.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IPL_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// Длина отрезка (в отсчетах), для которого скалярная свертка накапливается в локальном буфере float
+#define SCALAR_CHUNK 1024
+
+
+// -----------------------------
+// ---- СКАЛЯРНЫЕ ВАРИАНТЫ ----
+// -----------------------------
+
+// @brief Свертка отрезка для произвольного радиуса: цикл по коэффициентам внешний,
+//        по отсчетам отрезка - внутренний (векторизуется компилятором для базового набора инструкций).
+static void convolve_segment_scalar(const unsigned char* const* taps, unsigned char* output, const size_t len, const float* weights, const int radius)
+{
+    float acc[SCALAR_CHUNK];
+
+    for (size_t x0 = 0; x0 < len; x0 += SCALAR_CHUNK)
+    {
+        size_t n = len - x0 < SCALAR_CHUNK ? len - x0 : SCALAR_CHUNK;
+        for (size_t x = 0; x < n; x++) acc[x] = 0.0f;
+        for (int k = 0; k <= 2 * radius; k++)
+        {
+            const unsigned char* src = taps[k] + x0;
+            const float weight = weights[k];
+            #pragma omp simd
+            for (size_t x = 0; x < n; x++)
+                acc[x] += (float)src[x] * weight;
+        }
+        for (size_t x = 0; x < n; x++)
+            output[x0 + x] = to_uchar(acc[x]);
+    }
+}
+
+// @brief Свертка отрезка для радиуса R, известного на этапе компиляции: цикл по коэффициентам полностью
+//        разворачивается, коэффициенты и указатели соседей загружаются один раз на отрезок, а сумма по каждому
+//        отсчету накапливается без промежуточной записи в память. Порядок сложения тот же, что у общего варианта.
+#define DEFINE_CONVOLVE_SEGMENT_SCALAR(R)                                                                                    \
+static void convolve_segment_scalar_r##R(const unsigned char* const* taps, unsigned char* output, const size_t len,        \
+                                         const float* weights, const int radius)                                           \
+{                                                                                                                           \
+    const unsigned char* src[2 * R + 1];                                                                                    \
+    float w[2 * R + 1];                                                                                                     \
+    float acc[SCALAR_CHUNK];                                                                                                \
+    (void)radius;                                                                                                           \
+    for (int k = 0; k < 2 * R + 1; k++) { src[k] = taps[k]; w[k] = weights[k]; }                                           \
+                                                                                                                            \
+    for (size_t x0 = 0; x0 < len; x0 += SCALAR_CHUNK)                                                                       \
+    {                                                                                                                       \
+        size_t n = len - x0 < SCALAR_CHUNK ? len - x0 : SCALAR_CHUNK;                                                       \
+        _Pragma("omp simd")                                                                                                 \
+        for (size_t x = 0; x < n; x++)                                                                                      \
+        {                                                                                                                   \
+            float sum = 0.0f;                                                                                               \
+            _Pragma("GCC unroll 17")                                                                                        \
+            for (int k = 0; k < 2 * R + 1; k++)                                                                             \
+                sum += (float)src[k][x0 + x] * w[k];                                                                        \
+            acc[x] = sum;                                                                                                   \
+        }                                                                                                                   \
+        for (size_t x = 0; x < n; x++)                                                                                      \
+            output[x0 + x] = to_uchar(acc[x]);                                                                              \
+    }                                                                                                                       \
+}
+
+DEFINE_CONVOLVE_SEGMENT_SCALAR(1)
+DEFINE_CONVOLVE_SEGMENT_SCALAR(2)
+DEFINE_CONVOLVE_SEGMENT_SCALAR(3)
+DEFINE_CONVOLVE_SEGMENT_SCALAR(4)
+DEFINE_CONVOLVE_SEGMENT_SCALAR(5)
+DEFINE_CONVOLVE_SEGMENT_SCALAR(6)
+DEFINE_CONVOLVE_SEGMENT_SCALAR(7)
+DEFINE_CONVOLVE_SEGMENT_SCALAR(8)
+
+// Варианты level для радиусов 1..8 в порядке convolve_segment_radius
+#define CONVOLVE_RADIUS_TABLE(level)                                                                      \
+    { NULL, convolve_segment_##level##_r1, convolve_segment_##level##_r2, convolve_segment_##level##_r3, \
+      convolve_segment_##level##_r4, convolve_segment_##level##_r5, convolve_segment_##level##_r6,       \
+      convolve_segment_##level##_r7, convolve_segment_##level##_r8 }
+
+static void threshold_row_scalar(const unsigned char* input_data, unsigned char* output_data, const size_t count, const unsigned char level)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        output_data[i] = input_data[i] >= level ? 255 : 0;
+    }
+}
+
+// @brief float -> IEEE half с округлением к ближайшему четному (как у F16C). Переполнение дает бесконечность.
+static unsigned short float_to_half_one(const float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t abs_bits = bits & 0x7fffffffu;
+
+    if (abs_bits >= 0x7f800000u) // бесконечность или NaN
+        return (unsigned short)(sign | 0x7c00u | (abs_bits > 0x7f800000u ? 0x200u | ((abs_bits >> 13) & 0x3ffu) : 0u));
+    if (abs_bits >= 0x477ff000u) // >= 65520 округляется до бесконечности
+        return (unsigned short)(sign | 0x7c00u);
+
+    uint32_t exponent = abs_bits >> 23;
+    if (exponent < 113) // денормализованное half или ноль (|value| < 2^-14)
+    {
+        if (exponent < 102) return (unsigned short)sign; // меньше половины младшего денормализованного
+        uint32_t mantissa = (abs_bits & 0x7fffffu) | 0x800000u;
+        uint32_t shift = 126 - exponent;
+        uint32_t result = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (result & 1u))) result++;
+        return (unsigned short)(sign | result);
+    }
+
+    uint32_t result = ((exponent - 112) << 10) | ((abs_bits >> 13) & 0x3ffu);
+    uint32_t rest = abs_bits & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (result & 1u))) result++; // перенос в порядок корректен
+    return (unsigned short)(sign | result);
+}
+
+// @brief IEEE half -> float (точно).
+static float half_to_float_one(const unsigned short value)
+{
+    uint32_t sign = (uint32_t)(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x3ffu;
+    uint32_t bits;
+
+    if (exponent == 0x1fu) bits = sign | 0x7f800000u | (mantissa ? 0x400000u | (mantissa << 13) : 0u); // бесконечность или NaN (тихий)
+    else if (exponent != 0) bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    else if (mantissa == 0) bits = sign;
+    else
+    {
+        // Денормализованное half: нормализуем мантиссу
+        exponent = 113;
+        while (!(mantissa & 0x400u)) { mantissa <<= 1; exponent--; }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static void float_to_half_scalar(const float* input_data, unsigned short* output_data, const size_t count)
+{
+    for (size_t i = 0; i < count; i++) output_data[i] = float_to_half_one(input_data[i]);
+}
+
+static void half_to_float_scalar(const unsigned short* input_data, float* output_data, const size_t count)
+{
+    for (size_t i = 0; i < count; i++) output_data[i] = half_to_float_one(input_data[i]);
+}
+
+// Целочисленное обратное DCT (jidctint, DCT_ISLOW) в арифметике SSE2-версии stb_image (stbi__idct_simd), которой
+// stb_image декодирует JPEG на x86-64: суммы входов проходов переполняются как 16-битные, результат первого прохода
+// насыщается до 16 бит. Все реализации idct_row дают побитово одинаковый результат с декодером stb_image.
+#define IDCT_F2F(x) ((int)(((x) * 4096 + 0.5)))
+
+static inline unsigned char idct_clamp(const int x)
+{
+    return (unsigned char)(x < 0 ? 0 : x > 255 ? 255 : x);
+}
+
+static inline short idct_saturate(const int x)
+{
+    return (short)(x < -32768 ? -32768 : x > 32767 ? 32767 : x);
+}
+
+// @brief Одномерный проход обратного DCT по 8 значениям s[0], s[step], ... (одна линия векторного прохода stb_image).
+//        Результат - 32-битные значения после сдвига, до упаковки в 16 бит.
+static inline void idct_pass_scalar(const short* s, const int step, const int bias, const int shift, int* out)
+{
+    const int c0 = IDCT_F2F(0.5411961f), c1 = IDCT_F2F(1.175875602f);
+    const int c2 = IDCT_F2F(-1.961570560f), c3 = IDCT_F2F(-0.390180644f);
+
+    // Четная часть
+    const int t2 = s[2 * step] * c0 + s[6 * step] * (c0 + IDCT_F2F(-1.847759065f));
+    const int t3 = s[2 * step] * (c0 + IDCT_F2F(0.765366865f)) + s[6 * step] * c0;
+    const int t0 = (short)(s[0] + s[4 * step]) * 4096;
+    const int t1 = (short)(s[0] - s[4 * step]) * 4096;
+    const int x0 = t0 + t3 + bias, x3 = t0 - t3 + bias;
+    const int x1 = t1 + t2 + bias, x2 = t1 - t2 + bias;
+
+    // Нечетная часть
+    const short sum17 = (short)(s[step] + s[7 * step]);
+    const short sum35 = (short)(s[3 * step] + s[5 * step]);
+    const int y0 = s[7 * step] * (c2 + IDCT_F2F(0.298631336f)) + s[3 * step] * c2;
+    const int y2 = s[7 * step] * c2 + s[3 * step] * (c2 + IDCT_F2F(3.072711026f));
+    const int y1 = s[5 * step] * (c3 + IDCT_F2F(2.053119869f)) + s[step] * c3;
+    const int y3 = s[5 * step] * c3 + s[step] * (c3 + IDCT_F2F(1.501321110f));
+    const int y4 = sum17 * (c1 + IDCT_F2F(-0.899976223f)) + sum35 * c1;
+    const int y5 = sum17 * c1 + sum35 * (c1 + IDCT_F2F(-2.562915447f));
+    const int x4 = y0 + y4, x5 = y1 + y5, x6 = y2 + y5, x7 = y3 + y4;
+
+    out[0] = (x0 + x7) >> shift;
+    out[7] = (x0 - x7) >> shift;
+    out[1] = (x1 + x6) >> shift;
+    out[6] = (x1 - x6) >> shift;
+    out[2] = (x2 + x5) >> shift;
+    out[5] = (x2 - x5) >> shift;
+    out[3] = (x3 + x4) >> shift;
+    out[4] = (x3 - x4) >> shift;
+}
+
+// @brief Обратное DCT одного блока 8x8: коэффициенты (после деквантования, в естественном порядке) -> пиксели.
+static void idct_block_scalar(const short* data, unsigned char* out, const int out_stride)
+{
+    short val[64];
+    int line[8];
+
+    // Столбцы: масштаб 1 << 12 констант убирается с сохранением 2 дополнительных бит точности
+    for (int i = 0; i < 8; i++)
+    {
+        idct_pass_scalar(data + i, 8, 512, 10, line);
+        for (int k = 0; k < 8; k++) val[8 * k + i] = idct_saturate(line[k]);
+    }
+
+    // Строки: всего убирается масштаб 1 << 17 с округлением, и значения сдвигаются из [-128, 127] в [0, 255]
+    for (int i = 0; i < 8; i++, out += out_stride)
+    {
+        idct_pass_scalar(val + 8 * i, 1, 65536 + (128 << 17), 17, line);
+        for (int k = 0; k < 8; k++) out[k] = idct_clamp(line[k]);
+    }
+}
+
+static void idct_row_scalar(const short* coefficients, unsigned char* output, const int stride, const size_t count)
+{
+    for (size_t k = 0; k < count; k++) idct_block_scalar(coefficients + 64 * k, output + 8 * k, stride);
+}
+
+// Преобразование YCbCr -> RGB пониженной точности из stb_image (одинаковый результат скалярной и векторных версий)
+#define YCC_FIXED(x) (((int)((x) * 4096.0f + 0.5f)) << 8)
+
+static void ycbcr_to_rgb_scalar(unsigned char* output, const unsigned char* y, const unsigned char* cb, const unsigned char* cr, const size_t count)
+{
+    for (size_t i = 0; i < count; i++, output += 3)
+    {
+        int y_fixed = (y[i] << 20) + (1 << 19);
+        int crv = cr[i] - 128;
+        int cbv = cb[i] - 128;
+        int r = y_fixed + crv * YCC_FIXED(1.40200f);
+        int g = y_fixed + (crv * -YCC_FIXED(0.71414f)) + (int)((cbv * -YCC_FIXED(0.34414f)) & 0xffff0000);
+        int b = y_fixed + cbv * YCC_FIXED(1.77200f);
+        r >>= 20;
+        g >>= 20;
+        b >>= 20;
+        output[0] = idct_clamp(r);
+        output[1] = idct_clamp(g);
+        output[2] = idct_clamp(b);
+    }
+}
+
+
+// @brief Предсказатель Paeth (RFC 2083, 6.6): из a (слева), b (сверху), c (сверху слева) выбирается ближайший к a + b - c.
+static inline int png_paeth(const int a, const int b, const int c)
+{
+    const int pa = abs(b - c);
+    const int pb = abs(a - c);
+    const int pc = abs(a + b - 2 * c);
+    if (pa <= pb && pa <= pc) return a;
+    return pb <= pc ? b : c;
+}
+
+static void png_unfilter_scalar(const int filter, const unsigned char* input, const unsigned char* prior, unsigned char* output, const size_t size, const int bpp)
+{
+    const size_t n = (size_t)bpp < size ? (size_t)bpp : size;
+    size_t i;
+    switch (filter)
+    {
+    case PNG_FILTER_SUB:
+        for (i = 0; i < n; i++) output[i] = input[i];
+        for (; i < size; i++) output[i] = (unsigned char)(input[i] + output[i - bpp]);
+        break;
+    case PNG_FILTER_UP:
+        for (i = 0; i < size; i++) output[i] = (unsigned char)(input[i] + prior[i]);
+        break;
+    case PNG_FILTER_AVG:
+        for (i = 0; i < n; i++) output[i] = (unsigned char)(input[i] + (prior[i] >> 1));
+        for (; i < size; i++) output[i] = (unsigned char)(input[i] + ((prior[i] + output[i - bpp]) >> 1));
+        break;
+    case PNG_FILTER_PAETH:
+        for (i = 0; i < n; i++) output[i] = (unsigned char)(input[i] + prior[i]);
+        for (; i < size; i++) output[i] = (unsigned char)(input[i] + png_paeth(output[i - bpp], prior[i], prior[i - bpp]));
+        break;
+    default:
+        if (output != input) memcpy(output, input, size);
+        break;
+    }
+}
+
+// @brief Метки равномерного LBP для 8-битных кодов (см. LbpRowFn).
+static const unsigned char lbp_uniform_labels[256] = {
+     0,  1,  2,  9,  3, 58, 10, 17,  4, 58, 58, 58, 11, 58, 18, 25,
+     5, 58, 58, 58, 58, 58, 58, 58, 12, 58, 58, 58, 19, 58, 26, 33,
+     6, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58,
+    13, 58, 58, 58, 58, 58, 58, 58, 20, 58, 58, 58, 27, 58, 34, 41,
+     7, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58,
+    58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58,
+    14, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58,
+    21, 58, 58, 58, 58, 58, 58, 58, 28, 58, 58, 58, 35, 58, 42, 49,
+     8, 16, 58, 24, 58, 58, 58, 32, 58, 58, 58, 58, 58, 58, 58, 40,
+    58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 48,
+    58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58,
+    58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 56,
+    15, 23, 58, 31, 58, 58, 58, 39, 58, 58, 58, 58, 58, 58, 58, 47,
+    58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 55,
+    22, 30, 58, 38, 58, 58, 58, 46, 58, 58, 58, 58, 58, 58, 58, 54,
+    29, 37, 58, 45, 58, 58, 58, 53, 36, 44, 58, 52, 43, 51, 50, 57,
+};
+
+static void lbp_row_scalar(const unsigned char* above, const unsigned char* row, const unsigned char* below, unsigned char* output, const size_t count)
+{
+    #pragma omp simd
+    for (size_t x = 0; x < count; x++)
+    {
+        unsigned char c = row[x];
+        output[x] = (unsigned char)((above[x - 1] >= c) | (above[x] >= c) << 1 | (above[x + 1] >= c) << 2 | (row[x + 1] >= c) << 3 |
+                                    (below[x + 1] >= c) << 4 | (below[x] >= c) << 5 | (below[x - 1] >= c) << 6 | (row[x - 1] >= c) << 7);
+    }
+    for (size_t x = 0; x < count; x++) output[x] = lbp_uniform_labels[output[x]];
+}
+
+// Тон при восстановлении RGB: 6 секторов по COLOR_SECTOR единиц (Q12)
+#define COLOR_SECTOR 4096
+#define COLOR_HUE8_SCALE (256.0f / 6.0f) // Единиц 8-битного тона на сектор
+
+// @brief Тон пикселя в [0, wrap), scale единиц на сектор (wrap = 6 * scale). Деление выполняется одной операцией
+//        float с корректным округлением, поэтому векторные версии повторяют результат побитово.
+static inline int color_hue_scalar(const int r, const int g, const int b, const int mx, const int delta, const float scale, const int wrap)
+{
+    int diff = r - g;
+    float offset = 4.0f;
+    if (mx == r)
+    {
+        diff = g - b;
+        offset = 0.0f;
+    }
+    else if (mx == g)
+    {
+        diff = b - r;
+        offset = 2.0f;
+    }
+    float h = ((float)diff / (float)(delta > 0 ? delta : 1) + offset) * scale;
+    if (h < 0.0f) h += (float)wrap;
+    int hue = (int)(h + 0.5f);
+    return hue >= wrap ? hue - wrap : hue;
+}
+
+// @brief round(255 * num / den) для 0 <= num <= den (насыщенность), den = 0 дает 0.
+static inline int color_ratio_scalar(const int num, const int den)
+{
+    return (int)((float)num * 255.0f / (float)(den > 0 ? den : 1) + 0.5f);
+}
+
+// @brief round(x / 255) без деления для 0 <= x <= 255 * 255.
+static inline int color_div255(const int x)
+{
+    return (x + 128 + ((x + 128) >> 8)) >> 8;
+}
+
+// @brief RGB по тону hue (Q12 секторов), наименьшей компоненте lo2 и размаху c2 в половинах уровня:
+//        светлота HSL и промежуточная компонента не теряют половину уровня до последнего округления.
+static inline void color_hue_to_rgb_scalar(const int hue, const int lo2, const int c2, unsigned char* output)
+{
+    int sector = hue >> 12;
+    int f = hue & (COLOR_SECTOR - 1);
+    if (sector & 1) f = COLOR_SECTOR - f; // Внутри нечетного сектора промежуточная компонента убывает
+
+    unsigned char hi = (unsigned char)((lo2 + c2 + 1) >> 1);
+    unsigned char lo = (unsigned char)((lo2 + 1) >> 1);
+    unsigned char mid = (unsigned char)((lo2 + ((c2 << 4) * f >> 16) + 1) >> 1);
+    switch (sector)
+    {
+    case 0:  output[0] = hi;  output[1] = mid; output[2] = lo;  break;
+    case 1:  output[0] = mid; output[1] = hi;  output[2] = lo;  break;
+    case 2:  output[0] = lo;  output[1] = hi;  output[2] = mid; break;
+    case 3:  output[0] = lo;  output[1] = mid; output[2] = hi;  break;
+    case 4:  output[0] = mid; output[1] = lo;  output[2] = hi;  break;
+    default: output[0] = hi;  output[1] = lo;  output[2] = mid; break;
+    }
+}
+
+static inline int color_max3(const int r, const int g, const int b)
+{
+    int m = r > g ? r : g;
+    return m > b ? m : b;
+}
+
+static inline int color_min3(const int r, const int g, const int b)
+{
+    int m = r < g ? r : g;
+    return m < b ? m : b;
+}
+
+static void rgb_to_hsv_scalar(const unsigned char* input, unsigned char* output, const size_t count, const int channels)
+{
+    for (size_t i = 0; i < count; i++, input += channels, output += channels)
+    {
+        int r = input[0], g = input[1], b = input[2];
+        int mx = color_max3(r, g, b);
+        int delta = mx - color_min3(r, g, b);
+        output[0] = (unsigned char)color_hue_scalar(r, g, b, mx, delta, COLOR_HUE8_SCALE, 256);
+        output[1] = (unsigned char)color_ratio_scalar(delta, mx);
+        output[2] = (unsigned char)mx;
+        if (channels == 4) output[3] = input[3];
+    }
+}
+
+static void hsv_to_rgb_scalar(const unsigned char* input, unsigned char* output, const size_t count, const int channels)
+{
+    for (size_t i = 0; i < count; i++, input += channels, output += channels)
+    {
+        int v = input[2];
+        int c = color_div255(v * input[1]);
+        int hue = input[0] * (6 * COLOR_SECTOR / 256);
+        if (channels == 4) output[3] = input[3];
+        color_hue_to_rgb_scalar(hue, 2 * (v - c), 2 * c, output);
+    }
+}
+
+static void rgb_to_hsl_scalar(const unsigned char* input, unsigned char* output, const size_t count, const int channels)
+{
+    for (size_t i = 0; i < count; i++, input += channels, output += channels)
+    {
+        int r = input[0], g = input[1], b = input[2];
+        int mx = color_max3(r, g, b);
+        int mn = color_min3(r, g, b);
+        int sum = mx + mn;
+        output[0] = (unsigned char)color_hue_scalar(r, g, b, mx, mx - mn, COLOR_HUE8_SCALE, 256);
+        output[1] = (unsigned char)color_ratio_scalar(mx - mn, sum <= 255 ? sum : 510 - sum);
+        output[2] = (unsigned char)((sum + 1) >> 1);
+        if (channels == 4) output[3] = input[3];
+    }
+}
+
+static void hsl_to_rgb_scalar(const unsigned char* input, unsigned char* output, const size_t count, const int channels)
+{
+    for (size_t i = 0; i < count; i++, input += channels, output += channels)
+    {
+        int l2 = 2 * input[2];
+        int c = color_div255((255 - abs(l2 - 255)) * input[1]);
+        int hue = input[0] * (6 * COLOR_SECTOR / 256);
+        if (channels == 4) output[3] = input[3];
+        color_hue_to_rgb_scalar(hue, l2 - c, 2 * c, output);
+    }
+}
+
+// @brief Тон и размах пересчитываются в Q12 секторов и половинах уровня, поэтому без изменений (0, 256, 0)
+//        пиксель восстанавливается точно. Размах ограничивается наибольшим для светлоты пикселя.
+static void hsl_adjust_scalar(const unsigned char* input, unsigned char* output, const size_t count, const int channels,
+                              const int hue_shift, const int saturation, const int lightness)
+{
+    int to_white = lightness > 0 ? lightness : 0;
+    int to_black = lightness < 0 ? -lightness : 0;
+    for (size_t i = 0; i < count; i++, input += channels, output += channels)
+    {
+        int r = input[0], g = input[1], b = input[2];
+        int mx = color_max3(r, g, b);
+        int mn = color_min3(r, g, b);
+        int sum = mx + mn;
+        int limit = sum <= 255 ? sum : 510 - sum;
+
+        int hue = color_hue_scalar(r, g, b, mx, mx - mn, (float)COLOR_SECTOR, 6 * COLOR_SECTOR) + hue_shift;
+        if (hue >= 6 * COLOR_SECTOR) hue -= 6 * COLOR_SECTOR;
+        int c = (int)(((unsigned)(mx - mn) << 8) * (unsigned)saturation >> 16);
+        if (c > limit) c = limit;
+
+        if (channels == 4) output[3] = input[3];
+        color_hue_to_rgb_scalar(hue, sum - c, 2 * c, output);
+        for (int k = 0; k < 3; k++)
+        {
+            int v = output[k];
+            output[k] = (unsigned char)(v + ((255 - v) * to_white >> 8) - (v * to_black >> 8));
+        }
+    }
+}
+
+// Константы f(t) CIELab: излом 6/29, смещение 4/29 и наклон 3 * (6/29)^2 линейного участка обратной функции
+#define LAB_KNEE (6.0f / 29.0f)
+#define LAB_OFFSET (4.0f / 29.0f)
+#define LAB_SLOPE (108.0f / 841.0f)
+
+// @brief Округление значения Lab / sRGB с насыщением до 0..255.
+static inline unsigned char lab_round_scalar(float v)
+{
+    v = v < 0.0f ? 0.0f : v > 255.0f ? 255.0f : v;
+    return (unsigned char)(int)(v + 0.5f);
+}
+
+// @brief f(t) CIELab: запись таблицы и линейная интерполяция до соседней (t ограничивается [0, 1]).
+static inline float lab_f_scalar(const LabTables* tables, const float t)
+{
+    float x = t * (float)LAB_CBRT_SIZE;
+    x = x < 0.0f ? 0.0f : x > (float)LAB_CBRT_SIZE ? (float)LAB_CBRT_SIZE : x;
+    int i = (int)x;
+    float frac = x - (float)i;
+    return tables->cbrt[i] + (tables->cbrt[i + 1] - tables->cbrt[i]) * frac;
+}
+
+static inline float lab_f_inverse_scalar(const float f)
+{
+    return f > LAB_KNEE ? f * f * f : (f - LAB_OFFSET) * LAB_SLOPE;
+}
+
+static void rgb_to_lab_scalar(const LabTables* tables, const unsigned char* input, unsigned char* output, const size_t count, const int channels)
+{
+    const float (*m)[3] = tables->to_xyz;
+    for (size_t i = 0; i < count; i++, input += channels, output += channels)
+    {
+        float r = tables->to_linear[input[0]];
+        float g = tables->to_linear[input[1]];
+        float b = tables->to_linear[input[2]];
+        float fx = lab_f_scalar(tables, m[0][0] * r + m[0][1] * g + m[0][2] * b);
+        float fy = lab_f_scalar(tables, m[1][0] * r + m[1][1] * g + m[1][2] * b);
+        float fz = lab_f_scalar(tables, m[2][0] * r + m[2][1] * g + m[2][2] * b);
+        if (channels == 4) output[3] = input[3];
+        output[0] = lab_round_scalar(fy * 295.8f - 40.8f); // 2.55 * (116 * fy - 16)
+        output[1] = lab_round_scalar((fx - fy) * 500.0f + 128.0f);
+        output[2] = lab_round_scalar((fy - fz) * 200.0f + 128.0f);
+    }
+}
+
+static void lab_to_rgb_scalar(const LabTables* tables, const unsigned char* input, unsigned char* output, const size_t count, const int channels)
+{
+    const float (*m)[3] = tables->to_rgb;
+    for (size_t i = 0; i < count; i++, input += channels, output += channels)
+    {
+        float fy = tables->f_light[input[0]];
+        float x = lab_f_inverse_scalar(fy + tables->f_a[input[1]]);
+        float y = lab_f_inverse_scalar(fy);
+        float z = lab_f_inverse_scalar(fy - tables->f_b[input[2]]);
+        if (channels == 4) output[3] = input[3];
+        for (int k = 0; k < 3; k++)
+        {
+            float v = m[k][0] * x + m[k][1] * y + m[k][2] * z;
+            v = v < 0.0f ? 0.0f : v > 1.0f ? 1.0f : v;
+            output[k] = tables->to_srgb[(int)(v * (float)LAB_ENCODE_SIZE + 0.5f)];
+        }
+    }
+}
+
+#ifdef IPL_SIMD_X86
+
+// ---------------
+// ---- SSE4.1 ----
+// ---------------
+
+// @brief Округление как в to_uchar для 4-х значений: отсечение [0, 255], затем
+//        отбрасывание дробной части и +1, если она не меньше 0.5.
+__attribute__((target("sse4.1")))
+static inline __m128i round_to_epi32_sse41(__m128 v)
+{
+    v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+    __m128i truncated = _mm_cvttps_epi32(v);
+    __m128 frac = _mm_sub_ps(v, _mm_cvtepi32_ps(truncated));
+    __m128i up = _mm_castps_si128(_mm_cmpge_ps(frac, _mm_set1_ps(0.5f)));
+    return _mm_sub_epi32(truncated, up); // up = -1 там, где нужно округлить вверх
+}
+
+__attribute__((target("sse4.1")))
+static void convolve_segment_sse41(const unsigned char* const* taps, unsigned char* output, const size_t len, const float* weights, const int radius)
+{
+    size_t x = 0;
+    for (; x + 16 <= len; x += 16)
+    {
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+        for (int k = 0; k <= 2 * radius; k++)
+        {
+            __m128 w = _mm_set1_ps(weights[k]);
+            __m128i px = _mm_loadu_si128((const __m128i*)(taps[k] + x));
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(px)), w));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(px, 4))), w));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(px, 8))), w));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(px, 12))), w));
+        }
+        __m128i lo = _mm_packus_epi32(round_to_epi32_sse41(acc0), round_to_epi32_sse41(acc1));
+        __m128i hi = _mm_packus_epi32(round_to_epi32_sse41(acc2), round_to_epi32_sse41(acc3));
+        _mm_storeu_si128((__m128i*)(output + x), _mm_packus_epi16(lo, hi));
+    }
+
+    for (; x < len; x++)
+    {
+        float sum = 0.0f;
+        for (int k = 0; k <= 2 * radius; k++)
+            sum += (float)taps[k][x] * weights[k];
+        output[x] = to_uchar(sum);
+    }
+}
+
+// @brief То же для радиуса R, известного при компиляции: указатели соседей и размноженные коэффициенты
+//        готовятся один раз на отрезок, байты расширяются сразу из памяти (pmovzx без отдельной загрузки
+//        и сдвигов), цикл по коэффициентам при R <= 3 развернут полностью. Полное развертывание при больших R
+//        медленнее цикла (замерено), поэтому там оно частичное.
+__attribute__((target("sse4.1"), always_inline))
+static inline void convolve_segment_fixed_sse41(const unsigned char* const* taps, unsigned char* output, const size_t len,
+                                                const float* weights, const int R)
+{
+    // Размноженные коэффициенты держатся в регистрах, пока их немного; при больших R регистров
+    // не хватает, и коэффициент размножается из памяти (отдельная загрузка без операций ALU)
+    const int hoist = 2 * R + 1 <= 5;
+    const unsigned char* src[2 * IPL_CONVOLVE_UNROLL_MAX + 1];
+    __m128 w[2 * IPL_CONVOLVE_UNROLL_MAX + 1];
+    for (int k = 0; k <= 2 * R; k++) { src[k] = taps[k]; w[k] = _mm_set1_ps(weights[k]); }
+
+    size_t x = 0;
+    for (; x + 16 <= len; x += 16)
+    {
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+        #pragma GCC unroll 7
+        for (int k = 0; k <= 2 * R; k++)
+        {
+            const unsigned char* p = src[k] + x;
+            __m128 wk = hoist ? w[k] : _mm_set1_ps(weights[k]);
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_loadu_si32(p))), wk));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_loadu_si32(p + 4))), wk));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_loadu_si32(p + 8))), wk));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_loadu_si32(p + 12))), wk));
+        }
+        __m128i lo = _mm_packus_epi32(round_to_epi32_sse41(acc0), round_to_epi32_sse41(acc1));
+        __m128i hi = _mm_packus_epi32(round_to_epi32_sse41(acc2), round_to_epi32_sse41(acc3));
+        _mm_storeu_si128((__m128i*)(output + x), _mm_packus_epi16(lo, hi));
+    }
+
+    for (; x < len; x++)
+    {
+        float sum = 0.0f;
+        for (int k = 0; k <= 2 * R; k++)
+            sum += (float)src[k][x] * weights[k];
+        output[x] = to_uchar(sum);
+    }
+}
+
+#define DEFINE_CONVOLVE_SEGMENT_SSE41(R)                                                                            \
+__attribute__((target("sse4.1")))                                                                                  \
+static void convolve_segment_sse41_r##R(const unsigned char* const* taps, unsigned char* output, const size_t len, \
+                                        const float* weights, const int radius)                                    \
+{                                                                                                                  \
+    (void)radius;                                                                                                  \
+    convolve_segment_fixed_sse41(taps, output, len, weights, R);                                                   \
+}
+
+DEFINE_CONVOLVE_SEGMENT_SSE41(1)
+DEFINE_CONVOLVE_SEGMENT_SSE41(2)
+DEFINE_CONVOLVE_SEGMENT_SSE41(3)
+DEFINE_CONVOLVE_SEGMENT_SSE41(4)
+DEFINE_CONVOLVE_SEGMENT_SSE41(5)
+DEFINE_CONVOLVE_SEGMENT_SSE41(6)
+DEFINE_CONVOLVE_SEGMENT_SSE41(7)
+DEFINE_CONVOLVE_SEGMENT_SSE41(8)
+
+// @brief x >= level  <=>  max(x, level) == x (беззнаковое сравнение байтов).
+__attribute__((target("sse4.1")))
+static void threshold_row_sse41(const unsigned char* input_data, unsigned char* output_data, const size_t count, const unsigned char level)
+{
+    __m128i lv = _mm_set1_epi8((char)level);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(input_data + i));
+        _mm_storeu_si128((__m128i*)(output_data + i), _mm_cmpeq_epi8(_mm_max_epu8(v, lv), v));
+    }
+    threshold_row_scalar(input_data + i, output_data + i, count - i, level);
+}
+
+// Константы обратного DCT для _mm_madd_epi16: четные элементы - x, нечетные - y
+#define IDCT_ROT0_0 IDCT_F2F(0.5411961f), IDCT_F2F(0.5411961f) + IDCT_F2F(-1.847759065f)
+#define IDCT_ROT0_1 IDCT_F2F(0.5411961f) + IDCT_F2F(0.765366865f), IDCT_F2F(0.5411961f)
+#define IDCT_ROT1_0 IDCT_F2F(1.175875602f) + IDCT_F2F(-0.899976223f), IDCT_F2F(1.175875602f)
+#define IDCT_ROT1_1 IDCT_F2F(1.175875602f), IDCT_F2F(1.175875602f) + IDCT_F2F(-2.562915447f)
+#define IDCT_ROT2_0 IDCT_F2F(-1.961570560f) + IDCT_F2F(0.298631336f), IDCT_F2F(-1.961570560f)
+#define IDCT_ROT2_1 IDCT_F2F(-1.961570560f), IDCT_F2F(-1.961570560f) + IDCT_F2F(3.072711026f)
+#define IDCT_ROT3_0 IDCT_F2F(-0.390180644f) + IDCT_F2F(2.053119869f), IDCT_F2F(-0.390180644f)
+#define IDCT_ROT3_1 IDCT_F2F(-0.390180644f), IDCT_F2F(-0.390180644f) + IDCT_F2F(1.501321110f)
+
+// Маски _mm_shuffle_epi8 для чередования 16 значений R, G, B в 48 байт RGB: [выходной вектор][канал]
+static const signed char RGB_INTERLEAVE[3][3][16] = {
+    { { 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5 },
+      { -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1 },
+      { -1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1 } },
+    { { -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1 },
+      { 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10 },
+      { -1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1 } },
+    { { -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1 },
+      { -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1 },
+      { 10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15 } }
+};
+
+// @brief Одномерное обратное DCT восьми векторов (строк или столбцов) с округлением bias и сдвигом shift
+//        (повторяет арифметику idct_block_scalar, включая насыщение до 16 бит после первого прохода).
+__attribute__((target("sse4.1")))
+static inline void idct_pass_sse41(__m128i* row, const __m128i bias, const int shift)
+{
+    const __m128i rot0_0 = _mm_setr_epi16(IDCT_ROT0_0, IDCT_ROT0_0, IDCT_ROT0_0, IDCT_ROT0_0);
+    const __m128i rot0_1 = _mm_setr_epi16(IDCT_ROT0_1, IDCT_ROT0_1, IDCT_ROT0_1, IDCT_ROT0_1);
+    const __m128i rot1_0 = _mm_setr_epi16(IDCT_ROT1_0, IDCT_ROT1_0, IDCT_ROT1_0, IDCT_ROT1_0);
+    const __m128i rot1_1 = _mm_setr_epi16(IDCT_ROT1_1, IDCT_ROT1_1, IDCT_ROT1_1, IDCT_ROT1_1);
+    const __m128i rot2_0 = _mm_setr_epi16(IDCT_ROT2_0, IDCT_ROT2_0, IDCT_ROT2_0, IDCT_ROT2_0);
+    const __m128i rot2_1 = _mm_setr_epi16(IDCT_ROT2_1, IDCT_ROT2_1, IDCT_ROT2_1, IDCT_ROT2_1);
+    const __m128i rot3_0 = _mm_setr_epi16(IDCT_ROT3_0, IDCT_ROT3_0, IDCT_ROT3_0, IDCT_ROT3_0);
+    const __m128i rot3_1 = _mm_setr_epi16(IDCT_ROT3_1, IDCT_ROT3_1, IDCT_ROT3_1, IDCT_ROT3_1);
+
+    // Четная часть
+    __m128i lo = _mm_unpacklo_epi16(row[2], row[6]);
+    __m128i hi = _mm_unpackhi_epi16(row[2], row[6]);
+    __m128i t2_l = _mm_madd_epi16(lo, rot0_0), t2_h = _mm_madd_epi16(hi, rot0_0);
+    __m128i t3_l = _mm_madd_epi16(lo, rot0_1), t3_h = _mm_madd_epi16(hi, rot0_1);
+    __m128i sum04 = _mm_add_epi16(row[0], row[4]);
+    __m128i dif04 = _mm_sub_epi16(row[0], row[4]);
+    __m128i t0_l = _mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), sum04), 4);
+    __m128i t0_h = _mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), sum04), 4);
+    __m128i t1_l = _mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), dif04), 4);
+    __m128i t1_h = _mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), dif04), 4);
+    __m128i x0_l = _mm_add_epi32(t0_l, t3_l), x0_h = _mm_add_epi32(t0_h, t3_h);
+    __m128i x3_l = _mm_sub_epi32(t0_l, t3_l), x3_h = _mm_sub_epi32(t0_h, t3_h);
+    __m128i x1_l = _mm_add_epi32(t1_l, t2_l), x1_h = _mm_add_epi32(t1_h, t2_h);
+    __m128i x2_l = _mm_sub_epi32(t1_l, t2_l), x2_h = _mm_sub_epi32(t1_h, t2_h);
+
+    // Нечетная часть
+    lo = _mm_unpacklo_epi16(row[7], row[3]);
+    hi = _mm_unpackhi_epi16(row[7], row[3]);
+    __m128i y0_l = _mm_madd_epi16(lo, rot2_0), y0_h = _mm_madd_epi16(hi, rot2_0);
+    __m128i y2_l = _mm_madd_epi16(lo, rot2_1), y2_h = _mm_madd_epi16(hi, rot2_1);
+    lo = _mm_unpacklo_epi16(row[5], row[1]);
+    hi = _mm_unpackhi_epi16(row[5], row[1]);
+    __m128i y1_l = _mm_madd_epi16(lo, rot3_0), y1_h = _mm_madd_epi16(hi, rot3_0);
+    __m128i y3_l = _mm_madd_epi16(lo, rot3_1), y3_h = _mm_madd_epi16(hi, rot3_1);
+    __m128i sum17 = _mm_add_epi16(row[1], row[7]);
+    __m128i sum35 = _mm_add_epi16(row[3], row[5]);
+    lo = _mm_unpacklo_epi16(sum17, sum35);
+    hi = _mm_unpackhi_epi16(sum17, sum35);
+    __m128i y4_l = _mm_madd_epi16(lo, rot1_0), y4_h = _mm_madd_epi16(hi, rot1_0);
+    __m128i y5_l = _mm_madd_epi16(lo, rot1_1), y5_h = _mm_madd_epi16(hi, rot1_1);
+    __m128i x4_l = _mm_add_epi32(y0_l, y4_l), x4_h = _mm_add_epi32(y0_h, y4_h);
+    __m128i x5_l = _mm_add_epi32(y1_l, y5_l), x5_h = _mm_add_epi32(y1_h, y5_h);
+    __m128i x6_l = _mm_add_epi32(y2_l, y5_l), x6_h = _mm_add_epi32(y2_h, y5_h);
+    __m128i x7_l = _mm_add_epi32(y3_l, y4_l), x7_h = _mm_add_epi32(y3_h, y4_h);
+
+    // Бабочки: (a + bias) +- b, сдвиг и упаковка с насыщением в 16 бит
+    const __m128i* even_l[4] = { &x0_l, &x1_l, &x2_l, &x3_l };
+    const __m128i* even_h[4] = { &x0_h, &x1_h, &x2_h, &x3_h };
+    const __m128i* odd_l[4] = { &x7_l, &x6_l, &x5_l, &x4_l };
+    const __m128i* odd_h[4] = { &x7_h, &x6_h, &x5_h, &x4_h };
+    for (int k = 0; k < 4; k++)
+    {
+        __m128i a_l = _mm_add_epi32(*even_l[k], bias), a_h = _mm_add_epi32(*even_h[k], bias);
+        __m128i sum_l = _mm_add_epi32(a_l, *odd_l[k]), sum_h = _mm_add_epi32(a_h, *odd_h[k]);
+        __m128i dif_l = _mm_sub_epi32(a_l, *odd_l[k]), dif_h = _mm_sub_epi32(a_h, *odd_h[k]);
+        row[k] = _mm_packs_epi32(_mm_srai_epi32(sum_l, shift), _mm_srai_epi32(sum_h, shift));
+        row[7 - k] = _mm_packs_epi32(_mm_srai_epi32(dif_l, shift), _mm_srai_epi32(dif_h, shift));
+    }
+}
+
+// @brief Транспонирование матрицы 8x8 из 16-битных значений (три прохода чередования).
+__attribute__((target("sse4.1")))
+static inline void transpose_epi16_sse41(__m128i* row)
+{
+    static const int pairs[3][4][2] = { { { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } },
+                                         { { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 } },
+                                         { { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 } } };
+    for (int pass = 0; pass < 3; pass++)
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            __m128i a = row[pairs[pass][k][0]], b = row[pairs[pass][k][1]];
+            row[pairs[pass][k][0]] = _mm_unpacklo_epi16(a, b);
+            row[pairs[pass][k][1]] = _mm_unpackhi_epi16(a, b);
+        }
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void idct_row_sse41(const short* coefficients, unsigned char* output, const int stride, const size_t count)
+{
+    for (size_t k = 0; k < count; k++, coefficients += 64, output += 8)
+    {
+        __m128i row[8];
+        for (int i = 0; i < 8; i++) row[i] = _mm_loadu_si128((const __m128i*)(coefficients + 8 * i));
+
+        idct_pass_sse41(row, _mm_set1_epi32(512), 10);
+        transpose_epi16_sse41(row);
+        idct_pass_sse41(row, _mm_set1_epi32(65536 + (128 << 17)), 17);
+        transpose_epi16_sse41(row);
+
+        // После второго прохода row[i] - i-й столбец; транспонированный обратно - i-я строка
+        for (int i = 0; i < 8; i += 2)
+        {
+            __m128i p = _mm_packus_epi16(row[i], row[i + 1]);
+            _mm_storel_epi64((__m128i*)(output + i * stride), p);
+            _mm_storel_epi64((__m128i*)(output + (i + 1) * stride), _mm_unpackhi_epi64(p, p));
+        }
+    }
+}
+
+// @brief Преобразование 8 пикселей YCbCr -> RGB в 16-битных значениях (арифметика stb_image для step == 4).
+__attribute__((target("sse4.1")))
+static inline void ycbcr_to_rgb_epi16_sse41(const __m128i y8, const __m128i cb8, const __m128i cr8, __m128i* r, __m128i* g, __m128i* b)
+{
+    const __m128i signflip = _mm_set1_epi8(-0x80);
+    const __m128i cr_const0 = _mm_set1_epi16((short)(1.40200f * 4096.0f + 0.5f));
+    const __m128i cr_const1 = _mm_set1_epi16(-(short)(0.71414f * 4096.0f + 0.5f));
+    const __m128i cb_const0 = _mm_set1_epi16(-(short)(0.34414f * 4096.0f + 0.5f));
+    const __m128i cb_const1 = _mm_set1_epi16((short)(1.77200f * 4096.0f + 0.5f));
+
+    // y << 8 | 128, (c - 128) << 8
+    __m128i yw = _mm_unpacklo_epi8(_mm_set1_epi8((char)128), y8);
+    __m128i crw = _mm_unpacklo_epi8(_mm_setzero_si128(), _mm_xor_si128(cr8, signflip));
+    __m128i cbw = _mm_unpacklo_epi8(_mm_setzero_si128(), _mm_xor_si128(cb8, signflip));
+
+    __m128i yws = _mm_srli_epi16(yw, 4);
+    *r = _mm_srai_epi16(_mm_add_epi16(_mm_mulhi_epi16(cr_const0, crw), yws), 4);
+    *g = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mulhi_epi16(cb_const0, cbw), yws), _mm_mulhi_epi16(crw, cr_const1)), 4);
+    *b = _mm_srai_epi16(_mm_add_epi16(yws, _mm_mulhi_epi16(cbw, cb_const1)), 4);
+}
+
+// @brief Чередует 16 значений R, G, B в 48 байт RGB.
+__attribute__((target("sse4.1")))
+static inline void store_rgb_sse41(unsigned char* output, const __m128i r, const __m128i g, const __m128i b)
+{
+    for (int v = 0; v < 3; v++)
+    {
+        __m128i out = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, _mm_loadu_si128((const __m128i*)RGB_INTERLEAVE[v][0])),
+                                                _mm_shuffle_epi8(g, _mm_loadu_si128((const __m128i*)RGB_INTERLEAVE[v][1]))),
+                                   _mm_shuffle_epi8(b, _mm_loadu_si128((const __m128i*)RGB_INTERLEAVE[v][2])));
+        _mm_storeu_si128((__m128i*)(output + 16 * v), out);
+    }
+}
+
+// Маски _mm_shuffle_epi8 для разбора 48 байт RGB на 16 значений R, G, B: [входной вектор][канал]
+static const signed char RGB_DEINTERLEAVE[3][3][16] = {
+    { { 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+      { 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+      { 2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 } },
+    { { -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1 },
+      { -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1 },
+      { -1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1 } },
+    { { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13 },
+      { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14 },
+      { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15 } }
+};
+
+// @brief Разбирает 16 пикселей RGB или RGBA (channels = 3 или 4) на каналы; для RGB альфа-канал нулевой.
+__attribute__((target("sse4.1")))
+static inline void load_pixels_sse41(const unsigned char* input, const int channels, __m128i* r, __m128i* g, __m128i* b, __m128i* a)
+{
+    if (channels == 3)
+    {
+        __m128i v[3];
+        __m128i* out[3] = { r, g, b };
+        for (int i = 0; i < 3; i++) v[i] = _mm_loadu_si128((const __m128i*)(input + 16 * i));
+        for (int k = 0; k < 3; k++)
+            *out[k] = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v[0], _mm_loadu_si128((const __m128i*)RGB_DEINTERLEAVE[0][k])),
+                                                _mm_shuffle_epi8(v[1], _mm_loadu_si128((const __m128i*)RGB_DEINTERLEAVE[1][k]))),
+                                   _mm_shuffle_epi8(v[2], _mm_loadu_si128((const __m128i*)RGB_DEINTERLEAVE[2][k])));
+        *a = _mm_setzero_si128();
+        return;
+    }
+
+    // Каналы 4-х пикселей каждого вектора группируются по 32 бита, затем транспонируется матрица 4x4
+    const __m128i group = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    __m128i t0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)input), group);
+    __m128i t1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(input + 16)), group);
+    __m128i t2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(input + 32)), group);
+    __m128i t3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(input + 48)), group);
+    __m128i rg_lo = _mm_unpacklo_epi32(t0, t1), ba_lo = _mm_unpackhi_epi32(t0, t1);
+    __m128i rg_hi = _mm_unpacklo_epi32(t2, t3), ba_hi = _mm_unpackhi_epi32(t2, t3);
+    *r = _mm_unpacklo_epi64(rg_lo, rg_hi);
+    *g = _mm_unpackhi_epi64(rg_lo, rg_hi);
+    *b = _mm_unpacklo_epi64(ba_lo, ba_hi);
+    *a = _mm_unpackhi_epi64(ba_lo, ba_hi);
+}
+
+// @brief Собирает 16 пикселей RGB или RGBA (channels = 3 или 4) из каналов.
+__attribute__((target("sse4.1")))
+static inline void store_pixels_sse41(unsigned char* output, const int channels, const __m128i r, const __m128i g, const __m128i b, const __m128i a)
+{
+    if (channels == 3)
+    {
+        store_rgb_sse41(output, r, g, b);
+        return;
+    }
+    __m128i rg_lo = _mm_unpacklo_epi8(r, g), rg_hi = _mm_unpackhi_epi8(r, g);
+    __m128i ba_lo = _mm_unpacklo_epi8(b, a), ba_hi = _mm_unpackhi_epi8(b, a);
+    _mm_storeu_si128((__m128i*)output, _mm_unpacklo_epi16(rg_lo, ba_lo));
+    _mm_storeu_si128((__m128i*)(output + 16), _mm_unpackhi_epi16(rg_lo, ba_lo));
+    _mm_storeu_si128((__m128i*)(output + 32), _mm_unpacklo_epi16(rg_hi, ba_hi));
+    _mm_storeu_si128((__m128i*)(output + 48), _mm_unpackhi_epi16(rg_hi, ba_hi));
+}
+
+__attribute__((target("sse4.1")))
+static void ycbcr_to_rgb_sse41(unsigned char* output, const unsigned char* y, const unsigned char* cb, const unsigned char* cr, const size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16, output += 48)
+    {
+        __m128i y8 = _mm_loadu_si128((const __m128i*)(y + i));
+        __m128i cb8 = _mm_loadu_si128((const __m128i*)(cb + i));
+        __m128i cr8 = _mm_loadu_si128((const __m128i*)(cr + i));
+        __m128i r0, g0, b0, r1, g1, b1;
+        ycbcr_to_rgb_epi16_sse41(y8, cb8, cr8, &r0, &g0, &b0);
+        ycbcr_to_rgb_epi16_sse41(_mm_unpackhi_epi64(y8, y8), _mm_unpackhi_epi64(cb8, cb8), _mm_unpackhi_epi64(cr8, cr8), &r1, &g1, &b1);
+        store_rgb_sse41(output, _mm_packus_epi16(r0, r1), _mm_packus_epi16(g0, g1), _mm_packus_epi16(b0, b1));
+    }
+    ycbcr_to_rgb_scalar(output, y + i, cb + i, cr + i, count - i);
+}
+
+
+// Восстановление фильтров PNG: Sub - префиксная сумма пикселей внутри регистра, Avg и Paeth зависят от только что
+// восстановленного соседа слева, поэтому обрабатываются по пикселю (3 или 4 байта) за шаг.
+__attribute__((target("sse4.1"), always_inline))
+static inline __m128i png_load_pixel_sse41(const unsigned char* p, const int bpp)
+{
+    // 3 байта собираются в регистре: memcpy через стек не дает перенаправить запись в чтение
+    int v;
+    if (bpp == 4) memcpy(&v, p, 4);
+    else v = p[0] | (p[1] << 8) | (p[2] << 16);
+    return _mm_cvtsi32_si128(v);
+}
+
+__attribute__((target("sse4.1"), always_inline))
+static inline void png_store_pixel_sse41(unsigned char* p, const __m128i v, const int bpp)
+{
+    int x = _mm_cvtsi128_si32(v);
+    if (bpp == 4)
+    {
+        memcpy(p, &x, 4);
+        return;
+    }
+    p[0] = (unsigned char)x;
+    p[1] = (unsigned char)(x >> 8);
+    p[2] = (unsigned char)(x >> 16);
+}
+
+// @brief Sub, Avg и Paeth для bpp = 3 или 4 (встраивается с постоянным bpp). Возвращает число обработанных байт.
+__attribute__((target("sse4.1"), always_inline))
+static inline size_t png_unfilter_pixels_sse41(const int filter, const unsigned char* input, const unsigned char* prior, unsigned char* output, const size_t size, const int bpp)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = zero; // Восстановленный пиксель слева
+    __m128i c = zero; // Пиксель предыдущей строки слева
+    size_t i = 0;
+
+    if (filter == PNG_FILTER_SUB)
+    {
+        // 4 пикселя за шаг (12 байт для bpp = 3): x += x << bpp; x += x << 2 * bpp; x += последний пиксель слева
+        const __m128i last3 = _mm_setr_epi8(9, 10, 11, 9, 10, 11, 9, 10, 11, 9, 10, 11, -1, -1, -1, -1);
+        for (; i + 16 <= size; i += 4 * (size_t)bpp)
+        {
+            __m128i x = _mm_loadu_si128((const __m128i*)(input + i));
+            if (bpp == 4)
+            {
+                x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+                x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+                x = _mm_add_epi8(x, a);
+                _mm_storeu_si128((__m128i*)(output + i), x);
+                a = _mm_shuffle_epi32(x, 0xFF);
+            }
+            else
+            {
+                x = _mm_add_epi8(x, _mm_slli_si128(x, 3));
+                x = _mm_add_epi8(x, _mm_slli_si128(x, 6));
+                x = _mm_add_epi8(x, a);
+                // Сохраняются ровно 12 байт: при output == input следующие байты входа еще не прочитаны
+                _mm_storel_epi64((__m128i*)(output + i), x);
+                png_store_pixel_sse41(output + i + 8, _mm_srli_si128(x, 8), 4);
+                a = _mm_shuffle_epi8(x, last3);
+            }
+        }
+        a = i ? png_load_pixel_sse41(output + i - bpp, bpp) : zero;
+        for (; i + bpp <= size; i += bpp)
+        {
+            a = _mm_add_epi8(a, png_load_pixel_sse41(input + i, bpp));
+            png_store_pixel_sse41(output + i, a, bpp);
+        }
+    }
+    else if (filter == PNG_FILTER_AVG)
+    {
+        // (a + b) >> 1 = avg_epu8(a, b) - ((a ^ b) & 1)
+        const __m128i one = _mm_set1_epi8(1);
+        for (; i + bpp <= size; i += bpp)
+        {
+            __m128i b = png_load_pixel_sse41(prior + i, bpp);
+            __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+            a = _mm_add_epi8(png_load_pixel_sse41(input + i, bpp), avg);
+            png_store_pixel_sse41(output + i, a, bpp);
+        }
+    }
+    else
+    {
+        // Paeth в 16-битных словах: pa = |b - c|, pb = |a - c|, pc = |a + b - 2c|; при равенстве a, затем b, затем c
+        for (; i + bpp <= size; i += bpp)
+        {
+            __m128i b = _mm_unpacklo_epi8(png_load_pixel_sse41(prior + i, bpp), zero);
+            __m128i pa = _mm_sub_epi16(b, c);
+            __m128i pb = _mm_sub_epi16(a, c);
+            __m128i pc = _mm_abs_epi16(_mm_add_epi16(pa, pb));
+            pa = _mm_abs_epi16(pa);
+            pb = _mm_abs_epi16(pb);
+            __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            __m128i nearest = _mm_blendv_epi8(c, b, _mm_cmpeq_epi16(smallest, pb));
+            nearest = _mm_blendv_epi8(nearest, a, _mm_cmpeq_epi16(smallest, pa));
+
+            __m128i x = _mm_add_epi8(png_load_pixel_sse41(input + i, bpp), _mm_packus_epi16(nearest, nearest));
+            png_store_pixel_sse41(output + i, x, bpp);
+            a = _mm_unpacklo_epi8(x, zero);
+            c = b;
+        }
+    }
+    return i;
+}
+
+__attribute__((target("sse4.1")))
+static void png_unfilter_sse41(const int filter, const unsigned char* input, const unsigned char* prior, unsigned char* output, const size_t size, const int bpp)
+{
+    size_t i = 0;
+    if (filter == PNG_FILTER_UP)
+    {
+        for (; i + 16 <= size; i += 16)
+        {
+            __m128i x = _mm_loadu_si128((const __m128i*)(input + i));
+            _mm_storeu_si128((__m128i*)(output + i), _mm_add_epi8(x, _mm_loadu_si128((const __m128i*)(prior + i))));
+        }
+        png_unfilter_scalar(filter, input + i, prior + i, output + i, size - i, bpp);
+        return;
+    }
+    if ((bpp != 3 && bpp != 4) || filter < PNG_FILTER_SUB || filter > PNG_FILTER_PAETH || size < (size_t)bpp)
+    {
+        png_unfilter_scalar(filter, input, prior, output, size, bpp);
+        return;
+    }
+
+    i = bpp == 4 ? png_unfilter_pixels_sse41(filter, input, prior, output, size, 4) : png_unfilter_pixels_sse41(filter, input, prior, output, size, 3);
+
+    // Неполный пиксель в конце (размер строки кратен bpp, поэтому только при обрезанном size)
+    for (; i < size; i++)
+    {
+        int left = output[i - bpp], up = prior[i], corner = prior[i - bpp];
+        int predicted = filter == PNG_FILTER_SUB ? left : filter == PNG_FILTER_AVG ? (left + up) >> 1 : png_paeth(left, up, corner);
+        output[i] = (unsigned char)(input[i] + predicted);
+    }
+}
+
+// @brief Бит соседа для 16 пикселей: n >= c  <=>  max(n, c) == n (как в threshold_row_sse41).
+__attribute__((target("sse4.1")))
+static inline __m128i lbp_bit_sse41(const unsigned char* neighbor, const __m128i center, const int bit)
+{
+    __m128i n = _mm_loadu_si128((const __m128i*)neighbor);
+    return _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(n, center), n), _mm_set1_epi8((char)(1 << bit)));
+}
+
+// @brief Метки равномерного LBP для 16 кодов без таблицы на 256 записей: количество единиц и номер бита
+//        берутся из таблиц на 16 записей по полубайтам (pshufb).
+__attribute__((target("sse4.1")))
+static inline __m128i lbp_uniform_label_sse41(const __m128i code)
+{
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i popcount = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i log2_lo = _mm_setr_epi8(0, 0, 1, 0, 2, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i log2_hi = _mm_setr_epi8(0, 4, 5, 0, 6, 0, 0, 0, 7, 0, 0, 0, 0, 0, 0, 0);
+
+    // Сдвиг байтов по кругу на 1 бит: сдвиги 16-битные, поэтому перенос между байтами маскируется
+    __m128i rotated = _mm_or_si128(_mm_add_epi8(code, code), _mm_and_si128(_mm_srli_epi16(code, 7), _mm_set1_epi8(1)));
+    __m128i transitions = _mm_xor_si128(code, rotated);
+    __m128i start = _mm_andnot_si128(rotated, code);
+
+    __m128i flips = _mm_add_epi8(_mm_shuffle_epi8(popcount, _mm_and_si128(transitions, nibble)),
+                                 _mm_shuffle_epi8(popcount, _mm_and_si128(_mm_srli_epi16(transitions, 4), nibble)));
+    __m128i ones = _mm_add_epi8(_mm_shuffle_epi8(popcount, _mm_and_si128(code, nibble)),
+                                _mm_shuffle_epi8(popcount, _mm_and_si128(_mm_srli_epi16(code, 4), nibble)));
+    // start - один бит (или 0), поэтому номер бита - максимум номеров по полубайтам
+    __m128i bit = _mm_max_epu8(_mm_shuffle_epi8(log2_lo, _mm_and_si128(start, nibble)),
+                               _mm_shuffle_epi8(log2_hi, _mm_and_si128(_mm_srli_epi16(start, 4), nibble)));
+
+    // 8 * ones - 7 + bit: для 255 (ones = 8, start = 0) это 57, для 0 результат заменяется нулем
+    __m128i label = _mm_add_epi8(_mm_sub_epi8(_mm_slli_epi16(ones, 3), _mm_set1_epi8(7)), bit);
+    label = _mm_andnot_si128(_mm_cmpeq_epi8(code, _mm_setzero_si128()), label);
+    __m128i uniform = _mm_cmpgt_epi8(_mm_set1_epi8(3), flips);
+    return _mm_blendv_epi8(_mm_set1_epi8(58), label, uniform);
+}
+
+__attribute__((target("sse4.1")))
+static void lbp_row_sse41(const unsigned char* above, const unsigned char* row, const unsigned char* below, unsigned char* output, const size_t count)
+{
+    size_t x = 0;
+    for (; x + 16 <= count; x += 16)
+    {
+        __m128i c = _mm_loadu_si128((const __m128i*)(row + x));
+        __m128i code = _mm_or_si128(_mm_or_si128(lbp_bit_sse41(above + x - 1, c, 0), lbp_bit_sse41(above + x, c, 1)),
+                                    _mm_or_si128(lbp_bit_sse41(above + x + 1, c, 2), lbp_bit_sse41(row + x + 1, c, 3)));
+        code = _mm_or_si128(code, _mm_or_si128(_mm_or_si128(lbp_bit_sse41(below + x + 1, c, 4), lbp_bit_sse41(below + x, c, 5)),
+                                               _mm_or_si128(lbp_bit_sse41(below + x - 1, c, 6), lbp_bit_sse41(row + x - 1, c, 7))));
+        _mm_storeu_si128((__m128i*)(output + x), lbp_uniform_label_sse41(code));
+    }
+    lbp_row_scalar(above + x, row + x, below + x, output + x, count - x);
+}
+
+// -------------
+// ---- AVX2 ----
+// -------------
+
+__attribute__((target("avx2")))
+static inline __m256i round_to_epi32_avx2(__m256 v)
+{
+    v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+    __m256i truncated = _mm256_cvttps_epi32(v);
+    __m256 frac = _mm256_sub_ps(v, _mm256_cvtepi32_ps(truncated));
+    __m256i up = _mm256_castps_si256(_mm256_cmp_ps(frac, _mm256_set1_ps(0.5f), _CMP_GE_OQ));
+    return _mm256_sub_epi32(truncated, up);
+}
+
+// @brief Упаковывает 8 значений int32 (0..255) в 8 значений uint16 в порядке следования.
+__attribute__((target("avx2")))
+static inline __m128i pack_epi32_avx2(__m256i v)
+{
+    return _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+}
+
+__attribute__((target("avx2")))
+static void convolve_segment_avx2(const unsigned char* const* taps, unsigned char* output, const size_t len, const float* weights, const int radius)
+{
+    size_t x = 0;
+    for (; x + 32 <= len; x += 32)
+    {
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps(), acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+        for (int k = 0; k <= 2 * radius; k++)
+        {
+            __m256 w = _mm256_set1_ps(weights[k]);
+            __m128i px0 = _mm_loadu_si128((const __m128i*)(taps[k] + x));
+            __m128i px1 = _mm_loadu_si128((const __m128i*)(taps[k] + x + 16));
+            acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(px0)), w));
+            acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(px0, 8))), w));
+            acc2 = _mm256_add_ps(acc2, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(px1)), w));
+            acc3 = _mm256_add_ps(acc3, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(px1, 8))), w));
+        }
+        __m128i lo = _mm_packus_epi16(pack_epi32_avx2(round_to_epi32_avx2(acc0)), pack_epi32_avx2(round_to_epi32_avx2(acc1)));
+        __m128i hi = _mm_packus_epi16(pack_epi32_avx2(round_to_epi32_avx2(acc2)), pack_epi32_avx2(round_to_epi32_avx2(acc3)));
+        _mm_storeu_si128((__m128i*)(output + x), lo);
+        _mm_storeu_si128((__m128i*)(output + x + 16), hi);
+    }
+
+    if (x < len)
+    {
+        const unsigned char* tail[2 * radius + 1];
+        for (int k = 0; k <= 2 * radius; k++) tail[k] = taps[k] + x;
+        convolve_segment_sse41(tail, output + x, len - x, weights, radius);
+    }
+}
+
+// @brief Свертка отрезка для радиуса R, известного при компиляции (как convolve_segment_fixed_sse41).
+__attribute__((target("avx2"), always_inline))
+static inline void convolve_segment_fixed_avx2(const unsigned char* const* taps, unsigned char* output, const size_t len,
+                                               const float* weights, const int R)
+{
+    const int hoist = 2 * R + 1 <= 5;
+    const unsigned char* src[2 * IPL_CONVOLVE_UNROLL_MAX + 1];
+    __m256 w[2 * IPL_CONVOLVE_UNROLL_MAX + 1];
+    for (int k = 0; k <= 2 * R; k++) { src[k] = taps[k]; w[k] = _mm256_set1_ps(weights[k]); }
+
+    size_t x = 0;
+    for (; x + 32 <= len; x += 32)
+    {
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps(), acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+        #pragma GCC unroll 7
+        for (int k = 0; k <= 2 * R; k++)
+        {
+            const unsigned char* p = src[k] + x;
+            __m256 wk = hoist ? w[k] : _mm256_set1_ps(weights[k]);
+            acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p))), wk));
+            acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(p + 8)))), wk));
+            acc2 = _mm256_add_ps(acc2, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(p + 16)))), wk));
+            acc3 = _mm256_add_ps(acc3, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(p + 24)))), wk));
+        }
+        __m128i lo = _mm_packus_epi16(pack_epi32_avx2(round_to_epi32_avx2(acc0)), pack_epi32_avx2(round_to_epi32_avx2(acc1)));
+        __m128i hi = _mm_packus_epi16(pack_epi32_avx2(round_to_epi32_avx2(acc2)), pack_epi32_avx2(round_to_epi32_avx2(acc3)));
+        _mm_storeu_si128((__m128i*)(output + x), lo);
+        _mm_storeu_si128((__m128i*)(output + x + 16), hi);
+    }
+
+    if (x < len)
+    {
+        for (int k = 0; k <= 2 * R; k++) src[k] += x;
+        convolve_segment_fixed_sse41(src, output + x, len - x, weights, R);
+    }
+}
+
+#define DEFINE_CONVOLVE_SEGMENT_AVX2(R)                                                                            \
+__attribute__((target("avx2")))                                                                                   \
+static void convolve_segment_avx2_r##R(const unsigned char* const* taps, unsigned char* output, const size_t len, \
+                                       const float* weights, const int radius)                                    \
+{                                                                                                                 \
+    (void)radius;                                                                                                 \
+    convolve_segment_fixed_avx2(taps, output, len, weights, R);                                                   \
+}
+
+DEFINE_CONVOLVE_SEGMENT_AVX2(1)
+DEFINE_CONVOLVE_SEGMENT_AVX2(2)
+DEFINE_CONVOLVE_SEGMENT_AVX2(3)
+DEFINE_CONVOLVE_SEGMENT_AVX2(4)
+DEFINE_CONVOLVE_SEGMENT_AVX2(5)
+DEFINE_CONVOLVE_SEGMENT_AVX2(6)
+DEFINE_CONVOLVE_SEGMENT_AVX2(7)
+DEFINE_CONVOLVE_SEGMENT_AVX2(8)
+
+__attribute__((target("avx2")))
+static void threshold_row_avx2(const unsigned char* input_data, unsigned char* output_data, const size_t count, const unsigned char level)
+{
+    __m256i lv = _mm256_set1_epi8((char)level);
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(input_data + i));
+        _mm256_storeu_si256((__m256i*)(output_data + i), _mm256_cmpeq_epi8(_mm256_max_epu8(v, lv), v));
+    }
+    threshold_row_sse41(input_data + i, output_data + i, count - i, level);
+}
+
+// @brief Одномерное обратное DCT (см. idct_pass_sse41) для двух блоков сразу: блок в каждой 128-битной половине.
+__attribute__((target("avx2")))
+static inline void idct_pass_avx2(__m256i* row, const __m256i bias, const int shift)
+{
+    const __m256i rot0_0 = _mm256_setr_epi16(IDCT_ROT0_0, IDCT_ROT0_0, IDCT_ROT0_0, IDCT_ROT0_0, IDCT_ROT0_0, IDCT_ROT0_0, IDCT_ROT0_0, IDCT_ROT0_0);
+    const __m256i rot0_1 = _mm256_setr_epi16(IDCT_ROT0_1, IDCT_ROT0_1, IDCT_ROT0_1, IDCT_ROT0_1, IDCT_ROT0_1, IDCT_ROT0_1, IDCT_ROT0_1, IDCT_ROT0_1);
+    const __m256i rot1_0 = _mm256_setr_epi16(IDCT_ROT1_0, IDCT_ROT1_0, IDCT_ROT1_0, IDCT_ROT1_0, IDCT_ROT1_0, IDCT_ROT1_0, IDCT_ROT1_0, IDCT_ROT1_0);
+    const __m256i rot1_1 = _mm256_setr_epi16(IDCT_ROT1_1, IDCT_ROT1_1, IDCT_ROT1_1, IDCT_ROT1_1, IDCT_ROT1_1, IDCT_ROT1_1, IDCT_ROT1_1, IDCT_ROT1_1);
+    const __m256i rot2_0 = _mm256_setr_epi16(IDCT_ROT2_0, IDCT_ROT2_0, IDCT_ROT2_0, IDCT_ROT2_0, IDCT_ROT2_0, IDCT_ROT2_0, IDCT_ROT2_0, IDCT_ROT2_0);
+    const __m256i rot2_1 = _mm256_setr_epi16(IDCT_ROT2_1, IDCT_ROT2_1, IDCT_ROT2_1, IDCT_ROT2_1, IDCT_ROT2_1, IDCT_ROT2_1, IDCT_ROT2_1, IDCT_ROT2_1);
+    const __m256i rot3_0 = _mm256_setr_epi16(IDCT_ROT3_0, IDCT_ROT3_0, IDCT_ROT3_0, IDCT_ROT3_0, IDCT_ROT3_0, IDCT_ROT3_0, IDCT_ROT3_0, IDCT_ROT3_0);
+    const __m256i rot3_1 = _mm256_setr_epi16(IDCT_ROT3_1, IDCT_ROT3_1, IDCT_ROT3_1, IDCT_ROT3_1, IDCT_ROT3_1, IDCT_ROT3_1, IDCT_ROT3_1, IDCT_ROT3_1);
+
+    // Четная часть
+    __m256i lo = _mm256_unpacklo_epi16(row[2], row[6]);
+    __m256i hi = _mm256_unpackhi_epi16(row[2], row[6]);
+    __m256i t2_l = _mm256_madd_epi16(lo, rot0_0), t2_h = _mm256_madd_epi16(hi, rot0_0);
+    __m256i t3_l = _mm256_madd_epi16(lo, rot0_1), t3_h = _mm256_madd_epi16(hi, rot0_1);
+    __m256i sum04 = _mm256_add_epi16(row[0], row[4]);
+    __m256i dif04 = _mm256_sub_epi16(row[0], row[4]);
+    __m256i t0_l = _mm256_srai_epi32(_mm256_unpacklo_epi16(_mm256_setzero_si256(), sum04), 4);
+    __m256i t0_h = _mm256_srai_epi32(_mm256_unpackhi_epi16(_mm256_setzero_si256(), sum04), 4);
+    __m256i t1_l = _mm256_srai_epi32(_mm256_unpacklo_epi16(_mm256_setzero_si256(), dif04), 4);
+    __m256i t1_h = _mm256_srai_epi32(_mm256_unpackhi_epi16(_mm256_setzero_si256(), dif04), 4);
+    __m256i x0_l = _mm256_add_epi32(t0_l, t3_l), x0_h = _mm256_add_epi32(t0_h, t3_h);
+    __m256i x3_l = _mm256_sub_epi32(t0_l, t3_l), x3_h = _mm256_sub_epi32(t0_h, t3_h);
+    __m256i x1_l = _mm256_add_epi32(t1_l, t2_l), x1_h = _mm256_add_epi32(t1_h, t2_h);
+    __m256i x2_l = _mm256_sub_epi32(t1_l, t2_l), x2_h = _mm256_sub_epi32(t1_h, t2_h);
+
+    // Нечетная часть
+    lo = _mm256_unpacklo_epi16(row[7], row[3]);
+    hi = _mm256_unpackhi_epi16(row[7], row[3]);
+    __m256i y0_l = _mm256_madd_epi16(lo, rot2_0), y0_h = _mm256_madd_epi16(hi, rot2_0);
+    __m256i y2_l = _mm256_madd_epi16(lo, rot2_1), y2_h = _mm256_madd_epi16(hi, rot2_1);
+    lo = _mm256_unpacklo_epi16(row[5], row[1]);
+    hi = _mm256_unpackhi_epi16(row[5], row[1]);
+    __m256i y1_l = _mm256_madd_epi16(lo, rot3_0), y1_h = _mm256_madd_epi16(hi, rot3_0);
+    __m256i y3_l = _mm256_madd_epi16(lo, rot3_1), y3_h = _mm256_madd_epi16(hi, rot3_1);
+    __m256i sum17 = _mm256_add_epi16(row[1], row[7]);
+    __m256i sum35 = _mm256_add_epi16(row[3], row[5]);
+    lo = _mm256_unpacklo_epi16(sum17, sum35);
+    hi = _mm256_unpackhi_epi16(sum17, sum35);
+    __m256i y4_l = _mm256_madd_epi16(lo, rot1_0), y4_h = _mm256_madd_epi16(hi, rot1_0);
+    __m256i y5_l = _mm256_madd_epi16(lo, rot1_1), y5_h = _mm256_madd_epi16(hi, rot1_1);
+    __m256i x4_l = _mm256_add_epi32(y0_l, y4_l), x4_h = _mm256_add_epi32(y0_h, y4_h);
+    __m256i x5_l = _mm256_add_epi32(y1_l, y5_l), x5_h = _mm256_add_epi32(y1_h, y5_h);
+    __m256i x6_l = _mm256_add_epi32(y2_l, y5_l), x6_h = _mm256_add_epi32(y2_h, y5_h);
+    __m256i x7_l = _mm256_add_epi32(y3_l, y4_l), x7_h = _mm256_add_epi32(y3_h, y4_h);
+
+    const __m256i* even_l[4] = { &x0_l, &x1_l, &x2_l, &x3_l };
+    const __m256i* even_h[4] = { &x0_h, &x1_h, &x2_h, &x3_h };
+    const __m256i* odd_l[4] = { &x7_l, &x6_l, &x5_l, &x4_l };
+    const __m256i* odd_h[4] = { &x7_h, &x6_h, &x5_h, &x4_h };
+    for (int k = 0; k < 4; k++)
+    {
+        __m256i a_l = _mm256_add_epi32(*even_l[k], bias), a_h = _mm256_add_epi32(*even_h[k], bias);
+        __m256i sum_l = _mm256_add_epi32(a_l, *odd_l[k]), sum_h = _mm256_add_epi32(a_h, *odd_h[k]);
+        __m256i dif_l = _mm256_sub_epi32(a_l, *odd_l[k]), dif_h = _mm256_sub_epi32(a_h, *odd_h[k]);
+        row[k] = _mm256_packs_epi32(_mm256_srai_epi32(sum_l, shift), _mm256_srai_epi32(sum_h, shift));
+        row[7 - k] = _mm256_packs_epi32(_mm256_srai_epi32(dif_l, shift), _mm256_srai_epi32(dif_h, shift));
+    }
+}
+
+// @brief Транспонирование двух матриц 8x8 (в половинах векторов) из 16-битных значений.
+__attribute__((target("avx2")))
+static inline void transpose_epi16_avx2(__m256i* row)
+{
+    static const int pairs[3][4][2] = { { { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } },
+                                         { { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 } },
+                                         { { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 } } };
+    for (int pass = 0; pass < 3; pass++)
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            __m256i a = row[pairs[pass][k][0]], b = row[pairs[pass][k][1]];
+            row[pairs[pass][k][0]] = _mm256_unpacklo_epi16(a, b);
+            row[pairs[pass][k][1]] = _mm256_unpackhi_epi16(a, b);
+        }
+    }
+}
+
+// @brief Обратное DCT блоков строки парами: инструкции AVX2 работают внутри 128-битных половин,
+//        поэтому соседние блоки обрабатываются той же последовательностью команд, что и в SSE-версии.
+__attribute__((target("avx2")))
+static void idct_row_avx2(const short* coefficients, unsigned char* output, const int stride, const size_t count)
+{
+    size_t k = 0;
+    for (; k + 2 <= count; k += 2, coefficients += 128, output += 16)
+    {
+        __m256i row[8];
+        for (int i = 0; i < 8; i++)
+        {
+            __m128i first = _mm_loadu_si128((const __m128i*)(coefficients + 8 * i));
+            __m128i second = _mm_loadu_si128((const __m128i*)(coefficients + 64 + 8 * i));
+            row[i] = _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+        }
+
+        idct_pass_avx2(row, _mm256_set1_epi32(512), 10);
+        transpose_epi16_avx2(row);
+        idct_pass_avx2(row, _mm256_set1_epi32(65536 + (128 << 17)), 17);
+        transpose_epi16_avx2(row);
+
+        for (int i = 0; i < 8; i += 2)
+        {
+            __m256i p = _mm256_packus_epi16(row[i], row[i + 1]);
+            __m128i first = _mm256_castsi256_si128(p);
+            __m128i second = _mm256_extracti128_si256(p, 1);
+            _mm_storel_epi64((__m128i*)(output + i * stride), first);
+            _mm_storel_epi64((__m128i*)(output + (i + 1) * stride), _mm_unpackhi_epi64(first, first));
+            _mm_storel_epi64((__m128i*)(output + 8 + i * stride), second);
+            _mm_storel_epi64((__m128i*)(output + 8 + (i + 1) * stride), _mm_unpackhi_epi64(second, second));
+        }
+    }
+    idct_row_sse41(coefficients, output, stride, count - k);
+}
+
+__attribute__((target("avx2")))
+static void ycbcr_to_rgb_avx2(unsigned char* output, const unsigned char* y, const unsigned char* cb, const unsigned char* cr, const size_t count)
+{
+    const __m256i bias = _mm256_set1_epi16(128);
+    const __m256i cr_const0 = _mm256_set1_epi16((short)(1.40200f * 4096.0f + 0.5f));
+    const __m256i cr_const1 = _mm256_set1_epi16(-(short)(0.71414f * 4096.0f + 0.5f));
+    const __m256i cb_const0 = _mm256_set1_epi16(-(short)(0.34414f * 4096.0f + 0.5f));
+    const __m256i cb_const1 = _mm256_set1_epi16((short)(1.77200f * 4096.0f + 0.5f));
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16, output += 48)
+    {
+        // y << 8 | 128, (c - 128) << 8 - как в SSE-версии
+        __m256i yw = _mm256_or_si256(_mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(y + i))), 8), bias);
+        __m256i crw = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(cr + i))), bias), 8);
+        __m256i cbw = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(cb + i))), bias), 8);
+
+        __m256i yws = _mm256_srli_epi16(yw, 4);
+        __m256i r = _mm256_srai_epi16(_mm256_add_epi16(_mm256_mulhi_epi16(cr_const0, crw), yws), 4);
+        __m256i g = _mm256_srai_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_mulhi_epi16(cb_const0, cbw), yws), _mm256_mulhi_epi16(crw, cr_const1)), 4);
+        __m256i b = _mm256_srai_epi16(_mm256_add_epi16(yws, _mm256_mulhi_epi16(cbw, cb_const1)), 4);
+
+        // Упаковка внутри половин и перестановка 64-битных частей: [R0..15 | G0..15], [B0..15 | ...]
+        __m256i rg = _mm256_permute4x64_epi64(_mm256_packus_epi16(r, g), 0xD8);
+        __m256i bb = _mm256_permute4x64_epi64(_mm256_packus_epi16(b, b), 0xD8);
+        store_rgb_sse41(output, _mm256_castsi256_si128(rg), _mm256_extracti128_si256(rg, 1), _mm256_castsi256_si128(bb));
+    }
+    ycbcr_to_rgb_sse41(output, y + i, cb + i, cr + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i lbp_bit_avx2(const unsigned char* neighbor, const __m256i center, const int bit)
+{
+    __m256i n = _mm256_loadu_si256((const __m256i*)neighbor);
+    return _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(n, center), n), _mm256_set1_epi8((char)(1 << bit)));
+}
+
+// @brief Метки для 32 кодов (см. lbp_uniform_label_sse41): pshufb работает внутри 128-битных половин,
+//        поэтому таблицы на 16 записей повторены в обеих.
+__attribute__((target("avx2")))
+static inline __m256i lbp_uniform_label_avx2(const __m256i code)
+{
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i popcount = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i log2_lo = _mm256_setr_epi8(0, 0, 1, 0, 2, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 2, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i log2_hi = _mm256_setr_epi8(0, 4, 5, 0, 6, 0, 0, 0, 7, 0, 0, 0, 0, 0, 0, 0, 0, 4, 5, 0, 6, 0, 0, 0, 7, 0, 0, 0, 0, 0, 0, 0);
+
+    __m256i rotated = _mm256_or_si256(_mm256_add_epi8(code, code), _mm256_and_si256(_mm256_srli_epi16(code, 7), _mm256_set1_epi8(1)));
+    __m256i transitions = _mm256_xor_si256(code, rotated);
+    __m256i start = _mm256_andnot_si256(rotated, code);
+
+    __m256i flips = _mm256_add_epi8(_mm256_shuffle_epi8(popcount, _mm256_and_si256(transitions, nibble)),
+                                    _mm256_shuffle_epi8(popcount, _mm256_and_si256(_mm256_srli_epi16(transitions, 4), nibble)));
+    __m256i ones = _mm256_add_epi8(_mm256_shuffle_epi8(popcount, _mm256_and_si256(code, nibble)),
+                                   _mm256_shuffle_epi8(popcount, _mm256_and_si256(_mm256_srli_epi16(code, 4), nibble)));
+    __m256i bit = _mm256_max_epu8(_mm256_shuffle_epi8(log2_lo, _mm256_and_si256(start, nibble)),
+                                  _mm256_shuffle_epi8(log2_hi, _mm256_and_si256(_mm256_srli_epi16(start, 4), nibble)));
+
+    __m256i label = _mm256_add_epi8(_mm256_sub_epi8(_mm256_slli_epi16(ones, 3), _mm256_set1_epi8(7)), bit);
+    label = _mm256_andnot_si256(_mm256_cmpeq_epi8(code, _mm256_setzero_si256()), label);
+    __m256i uniform = _mm256_cmpgt_epi8(_mm256_set1_epi8(3), flips);
+    return _mm256_blendv_epi8(_mm256_set1_epi8(58), label, uniform);
+}
+
+// @brief 32 пикселя за итерацию: по 8 сравнений байтов на регистр.
+__attribute__((target("avx2")))
+static void lbp_row_avx2(const unsigned char* above, const unsigned char* row, const unsigned char* below, unsigned char* output, const size_t count)
+{
+    size_t x = 0;
+    for (; x + 32 <= count; x += 32)
+    {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(row + x));
+        __m256i code = _mm256_or_si256(_mm256_or_si256(lbp_bit_avx2(above + x - 1, c, 0), lbp_bit_avx2(above + x, c, 1)),
+                                       _mm256_or_si256(lbp_bit_avx2(above + x + 1, c, 2), lbp_bit_avx2(row + x + 1, c, 3)));
+        code = _mm256_or_si256(code, _mm256_or_si256(_mm256_or_si256(lbp_bit_avx2(below + x + 1, c, 4), lbp_bit_avx2(below + x, c, 5)),
+                                                     _mm256_or_si256(lbp_bit_avx2(below + x - 1, c, 6), lbp_bit_avx2(row + x - 1, c, 7))));
+        _mm256_storeu_si256((__m256i*)(output + x), lbp_uniform_label_avx2(code));
+    }
+    lbp_row_sse41(above + x, row + x, below + x, output + x, count - x);
+}
+
+// @brief 16 значений float двух половин (по 8) в 16 значений int16 исходного порядка.
+__attribute__((target("avx2")))
+static inline __m256i color_pack_avx2(const __m256 lo, const __m256 hi)
+{
+    // packs работает внутри 128-битных половин: [0-3, 8-11 | 4-7, 12-15]
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(_mm256_cvttps_epi32(lo), _mm256_cvttps_epi32(hi)), 0xD8);
+}
+
+// @brief Половина (0 - младшая, 1 - старшая) 16 значений int16 как 8 float.
+#define COLOR_HALF_PS(x, half) _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32((half) ? _mm256_extracti128_si256((x), 1) : _mm256_castsi256_si128(x)))
+
+// @brief Тон 16 пикселей (см. color_hue_scalar), те же операции float в том же порядке.
+__attribute__((target("avx2")))
+static inline __m256i color_hue_avx2(const __m256i r, const __m256i g, const __m256i b, const __m256i mx, const __m256i delta,
+                                     const float scale, const int wrap)
+{
+    __m256i max_r = _mm256_cmpeq_epi16(mx, r);
+    __m256i max_g = _mm256_andnot_si256(max_r, _mm256_cmpeq_epi16(mx, g));
+    __m256i diff = _mm256_blendv_epi8(_mm256_blendv_epi8(_mm256_sub_epi16(r, g), _mm256_sub_epi16(b, r), max_g), _mm256_sub_epi16(g, b), max_r);
+    __m256i offset = _mm256_blendv_epi8(_mm256_blendv_epi8(_mm256_set1_epi16(4), _mm256_set1_epi16(2), max_g), _mm256_setzero_si256(), max_r);
+    __m256i den = _mm256_max_epi16(delta, _mm256_set1_epi16(1));
+
+    __m256 h[2];
+    for (int half = 0; half < 2; half++)
+    {
+        __m256 x = _mm256_add_ps(_mm256_div_ps(COLOR_HALF_PS(diff, half), COLOR_HALF_PS(den, half)), COLOR_HALF_PS(offset, half));
+        x = _mm256_mul_ps(x, _mm256_set1_ps(scale));
+        x = _mm256_add_ps(x, _mm256_and_ps(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ), _mm256_set1_ps((float)wrap)));
+        h[half] = _mm256_add_ps(x, _mm256_set1_ps(0.5f));
+    }
+    __m256i hue = color_pack_avx2(h[0], h[1]);
+    return _mm256_min_epu16(hue, _mm256_sub_epi16(hue, _mm256_set1_epi16((short)wrap))); // hue == wrap -> 0
+}
+
+// @brief Насыщенность 16 пикселей (см. color_ratio_scalar).
+__attribute__((target("avx2")))
+static inline __m256i color_ratio_avx2(const __m256i num, const __m256i den)
+{
+    __m256i d = _mm256_max_epi16(den, _mm256_set1_epi16(1));
+    __m256 q[2];
+    for (int half = 0; half < 2; half++)
+        q[half] = _mm256_add_ps(_mm256_div_ps(_mm256_mul_ps(COLOR_HALF_PS(num, half), _mm256_set1_ps(255.0f)), COLOR_HALF_PS(d, half)),
+                                _mm256_set1_ps(0.5f));
+    return color_pack_avx2(q[0], q[1]);
+}
+
+// @brief round(x / 255) для 16 значений 0..255 * 255 (см. color_div255).
+__attribute__((target("avx2")))
+static inline __m256i color_div255_avx2(const __m256i x)
+{
+    __m256i t = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+// @brief RGB 16 пикселей по тону, наименьшей компоненте и размаху в половинах уровня (см. color_hue_to_rgb_scalar).
+__attribute__((target("avx2")))
+static inline void color_hue_to_rgb_avx2(const __m256i hue, const __m256i lo2, const __m256i c2, __m256i* r, __m256i* g, __m256i* b)
+{
+    const __m256i one = _mm256_set1_epi16(1);
+    __m256i sector = _mm256_srli_epi16(hue, 12);
+    __m256i f = _mm256_and_si256(hue, _mm256_set1_epi16(COLOR_SECTOR - 1));
+    __m256i odd = _mm256_cmpeq_epi16(_mm256_and_si256(sector, one), one);
+    f = _mm256_blendv_epi8(f, _mm256_sub_epi16(_mm256_set1_epi16(COLOR_SECTOR), f), odd);
+
+    __m256i hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(lo2, c2), one), 1);
+    __m256i lo = _mm256_srli_epi16(_mm256_add_epi16(lo2, one), 1);
+    __m256i mid = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(lo2, _mm256_mulhi_epu16(_mm256_slli_epi16(c2, 4), f)), one), 1);
+
+    __m256i s[6];
+    for (int k = 0; k < 6; k++) s[k] = _mm256_cmpeq_epi16(sector, _mm256_set1_epi16((short)k));
+    *r = _mm256_blendv_epi8(_mm256_blendv_epi8(mid, hi, _mm256_or_si256(s[0], s[5])), lo, _mm256_or_si256(s[2], s[3]));
+    *g = _mm256_blendv_epi8(_mm256_blendv_epi8(mid, hi, _mm256_or_si256(s[1], s[2])), lo, _mm256_or_si256(s[4], s[5]));
+    *b = _mm256_blendv_epi8(_mm256_blendv_epi8(mid, hi, _mm256_or_si256(s[3], s[4])), lo, _mm256_or_si256(s[0], s[1]));
+}
+
+// @brief Разбирает 16 пикселей на каналы в 16-битных значениях; альфа-канал остается байтами.
+__attribute__((target("avx2")))
+static inline void color_load_avx2(const unsigned char* input, const int channels, __m256i* r, __m256i* g, __m256i* b, __m128i* a)
+{
+    __m128i r8, g8, b8;
+    load_pixels_sse41(input, channels, &r8, &g8, &b8, a);
+    *r = _mm256_cvtepu8_epi16(r8);
+    *g = _mm256_cvtepu8_epi16(g8);
+    *b = _mm256_cvtepu8_epi16(b8);
+}
+
+// @brief Собирает 16 пикселей из 16-битных значений каналов 0..255.
+__attribute__((target("avx2")))
+static inline void color_store_avx2(unsigned char* output, const int channels, const __m256i c0, const __m256i c1, const __m256i c2, const __m128i a)
+{
+    // Упаковка внутри половин и перестановка 64-битных частей: [C0 0..15 | C1 0..15], [C2 0..15 | ...]
+    __m256i c01 = _mm256_permute4x64_epi64(_mm256_packus_epi16(c0, c1), 0xD8);
+    __m256i c22 = _mm256_permute4x64_epi64(_mm256_packus_epi16(c2, c2), 0xD8);
+    store_pixels_sse41(output, channels, _mm256_castsi256_si128(c01), _mm256_extracti128_si256(c01, 1), _mm256_castsi256_si128(c22), a);
+}
+
+__attribute__((target("avx2")))
+static void rgb_to_hsv_avx2(const unsigned char* input, unsigned char* output, const size_t count, const int channels)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256i r, g, b;
+        __m128i a;
+        color_load_avx2(input + i * channels, channels, &r, &g, &b, &a);
+        __m256i mx = _mm256_max_epu16(_mm256_max_epu16(r, g), b);
+        __m256i delta = _mm256_sub_epi16(mx, _mm256_min_epu16(_mm256_min_epu16(r, g), b));
+        __m256i hue = color_hue_avx2(r, g, b, mx, delta, COLOR_HUE8_SCALE, 256);
+        color_store_avx2(output + i * channels, channels, hue, color_ratio_avx2(delta, mx), mx, a);
+    }
+    rgb_to_hsv_scalar(input + i * channels, output + i * channels, count - i, channels);
+}
+
+__attribute__((target("avx2")))
+static void hsv_to_rgb_avx2(const unsigned char* input, unsigned char* output, const size_t count, const int channels)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256i h, s, v, r, g, b;
+        __m128i a;
+        color_load_avx2(input + i * channels, channels, &h, &s, &v, &a);
+        __m256i c = color_div255_avx2(_mm256_mullo_epi16(v, s));
+        __m256i hue = _mm256_mullo_epi16(h, _mm256_set1_epi16(6 * COLOR_SECTOR / 256));
+        color_hue_to_rgb_avx2(hue, _mm256_slli_epi16(_mm256_sub_epi16(v, c), 1), _mm256_slli_epi16(c, 1), &r, &g, &b);
+        color_store_avx2(output + i * channels, channels, r, g, b, a);
+    }
+    hsv_to_rgb_scalar(input + i * channels, output + i * channels, count - i, channels);
+}
+
+__attribute__((target("avx2")))
+static void rgb_to_hsl_avx2(const unsigned char* input, unsigned char* output, const size_t count, const int channels)
+{
+    const __m256i full = _mm256_set1_epi16(510);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256i r, g, b;
+        __m128i a;
+        color_load_avx2(input + i * channels, channels, &r, &g, &b, &a);
+        __m256i mx = _mm256_max_epu16(_mm256_max_epu16(r, g), b);
+        __m256i mn = _mm256_min_epu16(_mm256_min_epu16(r, g), b);
+        __m256i delta = _mm256_sub_epi16(mx, mn);
+        __m256i sum = _mm256_add_epi16(mx, mn);
+        __m256i den = _mm256_min_epi16(sum, _mm256_sub_epi16(full, sum));
+        __m256i hue = color_hue_avx2(r, g, b, mx, delta, COLOR_HUE8_SCALE, 256);
+        __m256i light = _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(1)), 1);
+        color_store_avx2(output + i * channels, channels, hue, color_ratio_avx2(delta, den), light, a);
+    }
+    rgb_to_hsl_scalar(input + i * channels, output + i * channels, count - i, channels);
+}
+
+__attribute__((target("avx2")))
+static void hsl_to_rgb_avx2(const unsigned char* input, unsigned char* output, const size_t count, const int channels)
+{
+    const __m256i k255 = _mm256_set1_epi16(255);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256i h, s, l, r, g, b;
+        __m128i a;
+        color_load_avx2(input + i * channels, channels, &h, &s, &l, &a);
+        __m256i l2 = _mm256_slli_epi16(l, 1);
+        __m256i den = _mm256_sub_epi16(k255, _mm256_abs_epi16(_mm256_sub_epi16(l2, k255)));
+        __m256i c = color_div255_avx2(_mm256_mullo_epi16(den, s));
+        __m256i hue = _mm256_mullo_epi16(h, _mm256_set1_epi16(6 * COLOR_SECTOR / 256));
+        color_hue_to_rgb_avx2(hue, _mm256_sub_epi16(l2, c), _mm256_slli_epi16(c, 1), &r, &g, &b);
+        color_store_avx2(output + i * channels, channels, r, g, b, a);
+    }
+    hsl_to_rgb_scalar(input + i * channels, output + i * channels, count - i, channels);
+}
+
+// @brief Смешивание 16 значений с белым и черным (см. hsl_adjust_scalar).
+__attribute__((target("avx2")))
+static inline __m256i color_lightness_avx2(const __m256i v, const __m256i to_white, const __m256i to_black)
+{
+    __m256i up = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(_mm256_set1_epi16(255), v), to_white), 8);
+    __m256i down = _mm256_srli_epi16(_mm256_mullo_epi16(v, to_black), 8);
+    return _mm256_sub_epi16(_mm256_add_epi16(v, up), down);
+}
+
+// @brief Прямое и обратное преобразования и коррекция в регистрах: промежуточный HSL не записывается.
+__attribute__((target("avx2")))
+static void hsl_adjust_avx2(const unsigned char* input, unsigned char* output, const size_t count, const int channels,
+                            const int hue_shift, const int saturation, const int lightness)
+{
+    const __m256i full = _mm256_set1_epi16(510);
+    const __m256i wrap = _mm256_set1_epi16(6 * COLOR_SECTOR);
+    const __m256i shift = _mm256_set1_epi16((short)hue_shift);
+    const __m256i gain = _mm256_set1_epi16((short)saturation);
+    const __m256i to_white = _mm256_set1_epi16((short)(lightness > 0 ? lightness : 0));
+    const __m256i to_black = _mm256_set1_epi16((short)(lightness < 0 ? -lightness : 0));
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256i r, g, b;
+        __m128i a;
+        color_load_avx2(input + i * channels, channels, &r, &g, &b, &a);
+        __m256i mx = _mm256_max_epu16(_mm256_max_epu16(r, g), b);
+        __m256i mn = _mm256_min_epu16(_mm256_min_epu16(r, g), b);
+        __m256i delta = _mm256_sub_epi16(mx, mn);
+        __m256i sum = _mm256_add_epi16(mx, mn);
+        __m256i limit = _mm256_min_epi16(sum, _mm256_sub_epi16(full, sum));
+
+        __m256i hue = _mm256_add_epi16(color_hue_avx2(r, g, b, mx, delta, (float)COLOR_SECTOR, 6 * COLOR_SECTOR), shift);
+        hue = _mm256_min_epu16(hue, _mm256_sub_epi16(hue, wrap));
+        __m256i c = _mm256_min_epu16(_mm256_mulhi_epu16(_mm256_slli_epi16(delta, 8), gain), limit);
+
+        color_hue_to_rgb_avx2(hue, _mm256_sub_epi16(sum, c), _mm256_slli_epi16(c, 1), &r, &g, &b);
+        color_store_avx2(output + i * channels, channels, color_lightness_avx2(r, to_white, to_black),
+                         color_lightness_avx2(g, to_white, to_black), color_lightness_avx2(b, to_white, to_black), a);
+    }
+    hsl_adjust_scalar(input + i * channels, output + i * channels, count - i, channels, hue_shift, saturation, lightness);
+}
+
+// @brief Индексы 8 байтов (половина half из 16) как int32.
+#define LAB_HALF_EPI32(x, half) _mm256_cvtepu8_epi32((half) ? _mm_srli_si128((x), 8) : (x))
+
+// @brief Округление 8 значений с насыщением до 0..255 (см. lab_round_scalar).
+__attribute__((target("avx2")))
+static inline __m256 lab_round_avx2(const __m256 v)
+{
+    __m256 c = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+    return _mm256_add_ps(c, _mm256_set1_ps(0.5f));
+}
+
+// @brief f(t) CIELab для 8 значений (см. lab_f_scalar): обе соседние записи таблицы читаются gather.
+__attribute__((target("avx2")))
+static inline __m256 lab_f_avx2(const LabTables* tables, const __m256 t)
+{
+    __m256 x = _mm256_mul_ps(t, _mm256_set1_ps((float)LAB_CBRT_SIZE));
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_setzero_ps()), _mm256_set1_ps((float)LAB_CBRT_SIZE));
+    __m256i i = _mm256_cvttps_epi32(x);
+    __m256 frac = _mm256_sub_ps(x, _mm256_cvtepi32_ps(i));
+    __m256 c0 = _mm256_i32gather_ps(tables->cbrt, i, 4);
+    __m256 c1 = _mm256_i32gather_ps(tables->cbrt + 1, i, 4);
+    return _mm256_add_ps(c0, _mm256_mul_ps(_mm256_sub_ps(c1, c0), frac));
+}
+
+// @brief Строка матрицы 3x3 на вектор в порядке (m0 * x + m1 * y) + m2 * z, как в скалярной версии.
+__attribute__((target("avx2")))
+static inline __m256 lab_dot_avx2(const float* m, const __m256 x, const __m256 y, const __m256 z)
+{
+    return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[0]), x), _mm256_mul_ps(_mm256_set1_ps(m[1]), y)),
+                         _mm256_mul_ps(_mm256_set1_ps(m[2]), z));
+}
+
+// @brief Две половины по 8 значений float (после lab_round_avx2) в 16 значений int16 исходного порядка.
+#define LAB_PACK_AVX2(v) color_pack_avx2((v)[0], (v)[1])
+
+__attribute__((target("avx2")))
+static void rgb_to_lab_avx2(const LabTables* tables, const unsigned char* input, unsigned char* output, const size_t count, const int channels)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i r8, g8, b8, a8;
+        load_pixels_sse41(input + i * channels, channels, &r8, &g8, &b8, &a8);
+        __m256 light[2], green_red[2], blue_yellow[2];
+        for (int half = 0; half < 2; half++)
+        {
+            __m256 r = _mm256_i32gather_ps(tables->to_linear, LAB_HALF_EPI32(r8, half), 4);
+            __m256 g = _mm256_i32gather_ps(tables->to_linear, LAB_HALF_EPI32(g8, half), 4);
+            __m256 b = _mm256_i32gather_ps(tables->to_linear, LAB_HALF_EPI32(b8, half), 4);
+            __m256 fx = lab_f_avx2(tables, lab_dot_avx2(tables->to_xyz[0], r, g, b));
+            __m256 fy = lab_f_avx2(tables, lab_dot_avx2(tables->to_xyz[1], r, g, b));
+            __m256 fz = lab_f_avx2(tables, lab_dot_avx2(tables->to_xyz[2], r, g, b));
+            light[half] = lab_round_avx2(_mm256_sub_ps(_mm256_mul_ps(fy, _mm256_set1_ps(295.8f)), _mm256_set1_ps(40.8f)));
+            green_red[half] = lab_round_avx2(_mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(fx, fy), _mm256_set1_ps(500.0f)), _mm256_set1_ps(128.0f)));
+            blue_yellow[half] = lab_round_avx2(_mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(fy, fz), _mm256_set1_ps(200.0f)), _mm256_set1_ps(128.0f)));
+        }
+        color_store_avx2(output + i * channels, channels, LAB_PACK_AVX2(light), LAB_PACK_AVX2(green_red), LAB_PACK_AVX2(blue_yellow), a8);
+    }
+    rgb_to_lab_scalar(tables, input + i * channels, output + i * channels, count - i, channels);
+}
+
+// @brief Обратная к f(t) функция для 8 значений: обе ветви вычисляются, нужная выбирается маской.
+__attribute__((target("avx2")))
+static inline __m256 lab_f_inverse_avx2(const __m256 f)
+{
+    __m256 cube = _mm256_mul_ps(_mm256_mul_ps(f, f), f);
+    __m256 linear = _mm256_mul_ps(_mm256_sub_ps(f, _mm256_set1_ps(LAB_OFFSET)), _mm256_set1_ps(LAB_SLOPE));
+    return _mm256_blendv_ps(linear, cube, _mm256_cmp_ps(f, _mm256_set1_ps(LAB_KNEE), _CMP_GT_OQ));
+}
+
+__attribute__((target("avx2")))
+static void lab_to_rgb_avx2(const LabTables* tables, const unsigned char* input, unsigned char* output, const size_t count, const int channels)
+{
+    const __m256i byte = _mm256_set1_epi32(0xFF);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i l8, a8, b8, alpha;
+        load_pixels_sse41(input + i * channels, channels, &l8, &a8, &b8, &alpha);
+        __m256i rgb[3][2];
+        for (int half = 0; half < 2; half++)
+        {
+            __m256 fy = _mm256_i32gather_ps(tables->f_light, LAB_HALF_EPI32(l8, half), 4);
+            __m256 x = lab_f_inverse_avx2(_mm256_add_ps(fy, _mm256_i32gather_ps(tables->f_a, LAB_HALF_EPI32(a8, half), 4)));
+            __m256 z = lab_f_inverse_avx2(_mm256_sub_ps(fy, _mm256_i32gather_ps(tables->f_b, LAB_HALF_EPI32(b8, half), 4)));
+            __m256 y = lab_f_inverse_avx2(fy);
+            for (int k = 0; k < 3; k++)
+            {
+                __m256 v = lab_dot_avx2(tables->to_rgb[k], x, y, z);
+                v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+                __m256i index = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps((float)LAB_ENCODE_SIZE)), _mm256_set1_ps(0.5f)));
+                rgb[k][half] = _mm256_and_si256(_mm256_i32gather_epi32((const int*)tables->to_srgb, index, 1), byte);
+            }
+        }
+        // packs работает внутри 128-битных половин: [0-3, 8-11 | 4-7, 12-15]
+        __m256i r = _mm256_permute4x64_epi64(_mm256_packs_epi32(rgb[0][0], rgb[0][1]), 0xD8);
+        __m256i g = _mm256_permute4x64_epi64(_mm256_packs_epi32(rgb[1][0], rgb[1][1]), 0xD8);
+        __m256i b = _mm256_permute4x64_epi64(_mm256_packs_epi32(rgb[2][0], rgb[2][1]), 0xD8);
+        color_store_avx2(output + i * channels, channels, r, g, b, alpha);
+    }
+    lab_to_rgb_scalar(tables, input + i * channels, output + i * channels, count - i, channels);
+}
+
+// ----------------
+// ---- AVX-512 ----
+// ----------------
+
+// AVX-512F включает FMA, поэтому слияние умножения и сложения запрещено явно:
+// иначе результат отличался бы от скалярной реализации в последнем бите.
+
+__attribute__((target("avx512f,avx512bw"), optimize("fp-contract=off")))
+static inline __m128i round_to_epi8_avx512(__m512 v)
+{
+    v = _mm512_min_ps(_mm512_max_ps(v, _mm512_setzero_ps()), _mm512_set1_ps(255.0f));
+    __m512i truncated = _mm512_cvttps_epi32(v);
+    __m512 frac = _mm512_sub_ps(v, _mm512_cvtepi32_ps(truncated));
+    __mmask16 up = _mm512_cmp_ps_mask(frac, _mm512_set1_ps(0.5f), _CMP_GE_OQ);
+    truncated = _mm512_mask_add_epi32(truncated, up, truncated, _mm512_set1_epi32(1));
+    return _mm512_cvtepi32_epi8(truncated);
+}
+
+__attribute__((target("avx512f,avx512bw"), optimize("fp-contract=off")))
+static void convolve_segment_avx512(const unsigned char* const* taps, unsigned char* output, const size_t len, const float* weights, const int radius)
+{
+    size_t x = 0;
+    for (; x + 64 <= len; x += 64)
+    {
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps(), acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+        for (int k = 0; k <= 2 * radius; k++)
+        {
+            __m512 w = _mm512_set1_ps(weights[k]);
+            const unsigned char* src = taps[k] + x;
+            acc0 = _mm512_add_ps(acc0, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)src))), w));
+            acc1 = _mm512_add_ps(acc1, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(src + 16)))), w));
+            acc2 = _mm512_add_ps(acc2, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(src + 32)))), w));
+            acc3 = _mm512_add_ps(acc3, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(src + 48)))), w));
+        }
+        _mm_storeu_si128((__m128i*)(output + x), round_to_epi8_avx512(acc0));
+        _mm_storeu_si128((__m128i*)(output + x + 16), round_to_epi8_avx512(acc1));
+        _mm_storeu_si128((__m128i*)(output + x + 32), round_to_epi8_avx512(acc2));
+        _mm_storeu_si128((__m128i*)(output + x + 48), round_to_epi8_avx512(acc3));
+    }
+
+    if (x < len)
+    {
+        const unsigned char* tail[2 * radius + 1];
+        for (int k = 0; k <= 2 * radius; k++) tail[k] = taps[k] + x;
+        convolve_segment_avx2(tail, output + x, len - x, weights, radius);
+    }
+}
+
+// @brief Свертка отрезка для радиуса R, известного при компиляции (как convolve_segment_fixed_sse41):
+//        при 32 регистрах все коэффициенты остаются в регистрах.
+__attribute__((target("avx512f,avx512bw"), optimize("fp-contract=off"), always_inline))
+static inline void convolve_segment_fixed_avx512(const unsigned char* const* taps, unsigned char* output, const size_t len,
+                                                 const float* weights, const int R)
+{
+    const int hoist = 2 * R + 1 <= 9;
+    const unsigned char* src[2 * IPL_CONVOLVE_UNROLL_MAX + 1];
+    __m512 w[2 * IPL_CONVOLVE_UNROLL_MAX + 1];
+    for (int k = 0; k <= 2 * R; k++) { src[k] = taps[k]; w[k] = _mm512_set1_ps(weights[k]); }
+
+    size_t x = 0;
+    for (; x + 64 <= len; x += 64)
+    {
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps(), acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+        #pragma GCC unroll 7
+        for (int k = 0; k <= 2 * R; k++)
+        {
+            const unsigned char* p = src[k] + x;
+            __m512 wk = hoist ? w[k] : _mm512_set1_ps(weights[k]);
+            acc0 = _mm512_add_ps(acc0, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)p))), wk));
+            acc1 = _mm512_add_ps(acc1, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(p + 16)))), wk));
+            acc2 = _mm512_add_ps(acc2, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(p + 32)))), wk));
+            acc3 = _mm512_add_ps(acc3, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(p + 48)))), wk));
+        }
+        _mm_storeu_si128((__m128i*)(output + x), round_to_epi8_avx512(acc0));
+        _mm_storeu_si128((__m128i*)(output + x + 16), round_to_epi8_avx512(acc1));
+        _mm_storeu_si128((__m128i*)(output + x + 32), round_to_epi8_avx512(acc2));
+        _mm_storeu_si128((__m128i*)(output + x + 48), round_to_epi8_avx512(acc3));
+    }
+
+    if (x < len)
+    {
+        for (int k = 0; k <= 2 * R; k++) src[k] += x;
+        convolve_segment_avx2(src, output + x, len - x, weights, R);
+    }
+}
+
+#define DEFINE_CONVOLVE_SEGMENT_AVX512(R)                                                                            \
+__attribute__((target("avx512f,avx512bw"), optimize("fp-contract=off")))                                            \
+static void convolve_segment_avx512_r##R(const unsigned char* const* taps, unsigned char* output, const size_t len, \
+                                         const float* weights, const int radius)                                    \
+{                                                                                                                   \
+    (void)radius;                                                                                                   \
+    convolve_segment_fixed_avx512(taps, output, len, weights, R);                                                   \
+}
+
+DEFINE_CONVOLVE_SEGMENT_AVX512(1)
+DEFINE_CONVOLVE_SEGMENT_AVX512(2)
+DEFINE_CONVOLVE_SEGMENT_AVX512(3)
+DEFINE_CONVOLVE_SEGMENT_AVX512(4)
+DEFINE_CONVOLVE_SEGMENT_AVX512(5)
+DEFINE_CONVOLVE_SEGMENT_AVX512(6)
+DEFINE_CONVOLVE_SEGMENT_AVX512(7)
+DEFINE_CONVOLVE_SEGMENT_AVX512(8)
+
+__attribute__((target("avx512f,avx512bw"), optimize("fp-contract=off")))
+static void threshold_row_avx512(const unsigned char* input_data, unsigned char* output_data, const size_t count, const unsigned char level)
+{
+    __m512i lv = _mm512_set1_epi8((char)level);
+    size_t i = 0;
+    for (; i + 64 <= count; i += 64)
+    {
+        __m512i v = _mm512_loadu_si512((const void*)(input_data + i));
+        _mm512_storeu_si512((void*)(output_data + i), _mm512_movm_epi8(_mm512_cmpge_epu8_mask(v, lv)));
+    }
+    threshold_row_avx2(input_data + i, output_data + i, count - i, level);
+}
+
+
+
+// -------------
+// ---- F16C ----
+// -------------
+
+__attribute__((target("avx,f16c")))
+static void float_to_half_f16c(const float* input_data, unsigned short* output_data, const size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+        _mm_storeu_si128((__m128i*)(output_data + i), _mm256_cvtps_ph(_mm256_loadu_ps(input_data + i), _MM_FROUND_TO_NEAREST_INT));
+    float_to_half_scalar(input_data + i, output_data + i, count - i);
+}
+
+__attribute__((target("avx,f16c")))
+static void half_to_float_f16c(const unsigned short* input_data, float* output_data, const size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(output_data + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(input_data + i))));
+    half_to_float_scalar(input_data + i, output_data + i, count - i);
+}
+
+#endif // IPL_SIMD_X86
+
+
+// -------------------
+// ---- ДИСПЕТЧЕР ----
+// -------------------
+
+// @brief Определяет наибольший уровень SIMD, поддерживаемый процессором и операционной системой.
+SimdLevel ipl_detect_simd_level(void)
+{
+#ifdef IPL_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) return IPL_SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return IPL_SIMD_AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return IPL_SIMD_SSE41;
+#endif
+    return IPL_SIMD_SCALAR;
+}
+
+// @brief Разбирает имя уровня SIMD ("scalar", "sse4.1", "avx2", "avx512").
+//
+// @param name     [in] Имя уровня (может быть NULL).
+// @param fallback [in] Значение, возвращаемое для NULL или неизвестного имени.
+SimdLevel ipl_parse_simd_level(const char* name, const SimdLevel fallback)
+{
+    if (!name) return fallback;
+    if (strcmp(name, "scalar") == 0) return IPL_SIMD_SCALAR;
+    if (strcmp(name, "sse4.1") == 0 || strcmp(name, "sse41") == 0) return IPL_SIMD_SSE41;
+    if (strcmp(name, "avx2") == 0) return IPL_SIMD_AVX2;
+    if (strcmp(name, "avx512") == 0) return IPL_SIMD_AVX512;
+    return fallback;
+}
+
+// @brief Возвращает имя уровня SIMD (для вывода в журнал и автотюнера).
+const char* ipl_simd_level_name(const SimdLevel level)
+{
+    switch (level)
+    {
+    case IPL_SIMD_SSE41:  return "sse4.1";
+    case IPL_SIMD_AVX2:   return "avx2";
+    case IPL_SIMD_AVX512: return "avx512";
+    default:              return "scalar";
+    }
+}
+
+// @brief Заполняет таблицу ядер реализациями для уровня level.
+//        Уровень должен поддерживаться процессором (не выше ipl_detect_simd_level).
+void ipl_fill_kernel_table(const SimdLevel level, KernelTable* table)
+{
+    static const ConvolveSegmentFn radius_scalar[] = CONVOLVE_RADIUS_TABLE(scalar);
+    table->convolve_segment = convolve_segment_scalar;
+    memcpy(table->convolve_segment_radius, radius_scalar, sizeof(radius_scalar));
+    table->threshold_row = threshold_row_scalar;
+    table->float_to_half = float_to_half_scalar;
+    table->half_to_float = half_to_float_scalar;
+    table->idct_row = idct_row_scalar;
+    table->ycbcr_to_rgb = ycbcr_to_rgb_scalar;
+    table->png_unfilter = png_unfilter_scalar;
+    table->lbp_row = lbp_row_scalar;
+    table->rgb_to_hsv = rgb_to_hsv_scalar;
+    table->hsv_to_rgb = hsv_to_rgb_scalar;
+    table->rgb_to_hsl = rgb_to_hsl_scalar;
+    table->hsl_to_rgb = hsl_to_rgb_scalar;
+    table->hsl_adjust = hsl_adjust_scalar;
+    table->rgb_to_lab = rgb_to_lab_scalar;
+    table->lab_to_rgb = lab_to_rgb_scalar;
+
+#ifdef IPL_SIMD_X86
+    // F16C есть на всех процессорах с AVX2, но проверяется отдельно
+    if (level >= IPL_SIMD_AVX2 && __builtin_cpu_supports("f16c"))
+    {
+        table->float_to_half = float_to_half_f16c;
+        table->half_to_float = half_to_float_f16c;
+    }
+
+    static const ConvolveSegmentFn radius_sse41[] = CONVOLVE_RADIUS_TABLE(sse41);
+    static const ConvolveSegmentFn radius_avx2[] = CONVOLVE_RADIUS_TABLE(avx2);
+    static const ConvolveSegmentFn radius_avx512[] = CONVOLVE_RADIUS_TABLE(avx512);
+
+    switch (level)
+    {
+    case IPL_SIMD_AVX512:
+        table->convolve_segment = convolve_segment_avx512;
+        memcpy(table->convolve_segment_radius, radius_avx512, sizeof(radius_avx512));
+        table->threshold_row = threshold_row_avx512;
+        table->idct_row = idct_row_avx2;
+        table->ycbcr_to_rgb = ycbcr_to_rgb_avx2;
+        table->png_unfilter = png_unfilter_sse41;
+        table->lbp_row = lbp_row_avx2;
+        table->rgb_to_hsv = rgb_to_hsv_avx2;
+        table->hsv_to_rgb = hsv_to_rgb_avx2;
+        table->rgb_to_hsl = rgb_to_hsl_avx2;
+        table->hsl_to_rgb = hsl_to_rgb_avx2;
+        table->hsl_adjust = hsl_adjust_avx2;
+        table->rgb_to_lab = rgb_to_lab_avx2;
+        table->lab_to_rgb = lab_to_rgb_avx2;
+        break;
+    case IPL_SIMD_AVX2:
+        table->convolve_segment = convolve_segment_avx2;
+        memcpy(table->convolve_segment_radius, radius_avx2, sizeof(radius_avx2));
+        table->threshold_row = threshold_row_avx2;
+        table->idct_row = idct_row_avx2;
+        table->ycbcr_to_rgb = ycbcr_to_rgb_avx2;
+        table->png_unfilter = png_unfilter_sse41; // Зависимость от соседа слева: ширина регистра не помогает
+        table->lbp_row = lbp_row_avx2;
+        table->rgb_to_hsv = rgb_to_hsv_avx2;
+        table->hsv_to_rgb = hsv_to_rgb_avx2;
+        table->rgb_to_hsl = rgb_to_hsl_avx2;
+        table->hsl_to_rgb = hsl_to_rgb_avx2;
+        table->hsl_adjust = hsl_adjust_avx2;
+        table->rgb_to_lab = rgb_to_lab_avx2;
+        table->lab_to_rgb = lab_to_rgb_avx2;
+        break;
+    case IPL_SIMD_SSE41:
+        table->convolve_segment = convolve_segment_sse41;
+        memcpy(table->convolve_segment_radius, radius_sse41, sizeof(radius_sse41));
+        table->threshold_row = threshold_row_sse41;
+        table->idct_row = idct_row_sse41;
+        table->ycbcr_to_rgb = ycbcr_to_rgb_sse41;
+        table->png_unfilter = png_unfilter_sse41;
+        table->lbp_row = lbp_row_sse41;
+        break;
+    default:
+        break;
+    }
+#else
+    (void)level;
+#endif
+}
@@ -0,0 +1,287 @@
+#ifndef THUMBNAIL_H
+#define THUMBNAIL_H
+
+// Быстрое превью изображения (ipl_load_embedded_thumbnail). Включается только в input_output.c после реализации
+// stb_image и jpeg_decoder.h.
+//
+// Камеры записывают в сегмент APP1 (EXIF) уменьшенную копию снимка в JPEG (обычно 160x120): exif_find_thumbnail
+// находит ее по тегам JPEGInterchangeFormat / JPEGInterchangeFormatLength в IFD1 структуры TIFF, и декодируется
+// только она. Если превью нет, baseline JPEG декодируется в масштабе 1/8: от каждого блока 8x8 берется только
+// коэффициент DC (среднее блока), поэтому обратное DCT не выполняется, а передискретизация и преобразование цвета
+// обрабатывают в 64 раза меньше пикселей. Остальные изображения декодируются полностью и уменьшаются в 8 раз
+// усреднением блоков 8x8. Ориентация EXIF не применяется (как и в ipl_load_image).
+
+#include <stdint.h>
+#include <string.h>
+
+#define THUMBNAIL_SCALE     8            // Уменьшение при декодировании без встроенного превью
+#define THUMBNAIL_HEAD_SIZE (256 * 1024) // Начало файла, в котором ищется сегмент EXIF (APP1 не длиннее 64 КБ)
+
+// Теги TIFF
+#define EXIF_TAG_COMPRESSION   0x0103
+#define EXIF_TAG_JPEG_OFFSET   0x0201
+#define EXIF_TAG_JPEG_LENGTH   0x0202
+#define EXIF_COMPRESSION_JPEG  6
+
+// @brief Читает 16-битное число в порядке байт TIFF.
+static inline uint32_t exif_read16(const stbi_uc* p, const int big_endian)
+{
+    return big_endian ? ((uint32_t)p[0] << 8) | p[1] : ((uint32_t)p[1] << 8) | p[0];
+}
+
+// @brief Читает 32-битное число в порядке байт TIFF.
+static inline uint32_t exif_read32(const stbi_uc* p, const int big_endian)
+{
+    return big_endian ? (exif_read16(p, 1) << 16) | exif_read16(p + 2, 1) : (exif_read16(p + 2, 0) << 16) | exif_read16(p, 0);
+}
+
+// @brief Ищет превью JPEG в IFD1 блока TIFF из сегмента EXIF.
+//
+// @param tiff   [in]  Начало заголовка TIFF (смещения EXIF отсчитываются от него).
+// @param size   [in]  Размер блока TIFF.
+// @param offset [out] Смещение превью от начала блока.
+// @param length [out] Размер превью.
+//
+// @return 1, если превью JPEG найдено и целиком лежит в блоке.
+static int exif_parse_tiff(const stbi_uc* tiff, const size_t size, size_t* offset, size_t* length)
+{
+    if (size < 8) return 0;
+    int big_endian;
+    if (tiff[0] == 'I' && tiff[1] == 'I') big_endian = 0;
+    else if (tiff[0] == 'M' && tiff[1] == 'M') big_endian = 1;
+    else return 0;
+    if (exif_read16(tiff + 2, big_endian) != 42) return 0;
+
+    // IFD0 описывает сам снимок, за ним следует IFD1 - превью
+    size_t ifd = exif_read32(tiff + 4, big_endian);
+    if (ifd > size - 6) return 0;
+    size_t entries = exif_read16(tiff + ifd, big_endian);
+    if (entries > (size - ifd - 6) / 12) return 0;
+    ifd = exif_read32(tiff + ifd + 2 + 12 * entries, big_endian);
+    if (!ifd || ifd > size - 2) return 0;
+    entries = exif_read16(tiff + ifd, big_endian);
+    if (entries > (size - ifd - 2) / 12) return 0;
+
+    size_t start = 0, count = 0;
+    uint32_t compression = EXIF_COMPRESSION_JPEG;
+    for (size_t e = 0; e < entries; e++)
+    {
+        const stbi_uc* entry = tiff + ifd + 2 + 12 * e;
+        const uint32_t tag = exif_read16(entry, big_endian);
+        const uint32_t type = exif_read16(entry + 2, big_endian);
+        // Значение SHORT (тип 3) или LONG (тип 4) хранится в самой записи
+        const uint32_t value = type == 3 ? exif_read16(entry + 8, big_endian) : exif_read32(entry + 8, big_endian);
+        if (tag == EXIF_TAG_COMPRESSION) compression = value;
+        else if (tag == EXIF_TAG_JPEG_OFFSET) start = value;
+        else if (tag == EXIF_TAG_JPEG_LENGTH) count = value;
+    }
+
+    // Превью без сжатия (Compression = 1, полосы TIFF) встречается редко и не поддерживается
+    if (compression != EXIF_COMPRESSION_JPEG || count < 4 || start > size || count > size - start) return 0;
+    if (tiff[start] != 0xFF || tiff[start + 1] != 0xD8) return 0;
+    *offset = start;
+    *length = count;
+    return 1;
+}
+
+// @brief Ищет превью JPEG в сегменте APP1 (EXIF) среди маркеров до начала скана.
+//
+// @param data   [in]  Файл JPEG или его начало.
+// @param size   [in]  Размер данных.
+// @param offset [out] Смещение превью от начала data.
+// @param length [out] Размер превью.
+//
+// @return 1, если превью найдено целиком в data; 0, если его нет, файл не JPEG или сегмент обрезан.
+static int exif_find_thumbnail(const stbi_uc* data, const size_t size, size_t* offset, size_t* length)
+{
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) return 0;
+
+    size_t pos = 2;
+    while (pos + 4 <= size)
+    {
+        if (data[pos] != 0xFF) return 0;
+        const int marker = data[pos + 1];
+        if (marker == 0xFF) // Байт заполнения
+        {
+            pos++;
+            continue;
+        }
+        if (marker == 0xDA || marker == 0xD9) return 0; // Начало скана или конец изображения: EXIF не встретился
+
+        const size_t segment = ((size_t)data[pos + 2] << 8) | data[pos + 3]; // Длина вместе с полем длины
+        if (segment < 2 || pos + 2 + segment > size) return 0;
+        const stbi_uc* payload = data + pos + 4;
+        if (marker == 0xE1 && segment >= 2 + 6 + 8 && !memcmp(payload, "Exif\0\0", 6) &&
+            exif_parse_tiff(payload + 6, segment - 2 - 6, offset, length))
+        {
+            *offset += (size_t)(payload + 6 - data);
+            return 1;
+        }
+        pos += 2 + segment;
+    }
+    return 0;
+}
+
+// @brief Записывает средние значения блоков MCU (в порядке jpeg_decode_mcu) в плоскости компонент: байт на блок.
+//        Для блока из одного DC обратное DCT stb_image дает dc / 8 + 128.
+static void jpeg_dc_mcu(const stbi__jpeg* z, const short* coefficients, const int mx, const int my)
+{
+    for (int k = 0; k < z->scan_n; k++)
+    {
+        const int n = z->order[k];
+        const int h = z->img_comp[n].h;
+        for (int y = 0; y < z->img_comp[n].v; y++)
+        {
+            stbi_uc* out = z->img_comp[n].data + (size_t)z->img_comp[n].w2 * (my * z->img_comp[n].v + y) + mx * h;
+            for (int x = 0; x < h; x++, coefficients += 64) out[x] = stbi__clamp(((coefficients[0] + 4) >> 3) + 128);
+        }
+    }
+}
+
+// @brief Декодирует baseline JPEG в масштабе 1/8 по коэффициентам DC (см. описание файла).
+static int jpeg_decode_scaled_image(stbi__jpeg* z, stbi_uc** pixels, int* width, int* height, int* channels)
+{
+    stbi__context* s = z->s;
+    int result = jpeg_read_frame(z);
+    if (result != DECODE_DONE) return result;
+
+    // Плоскости компонент хранят по байту на блок 8x8, а размеры изображения уменьшаются в 8 раз:
+    // передискретизация цветности и преобразование цвета работают как для полного изображения
+    for (int i = 0; i < s->img_n; i++)
+    {
+        z->img_comp[i].w2 = z->img_mcu_x * z->img_comp[i].h;
+        z->img_comp[i].h2 = z->img_mcu_y * z->img_comp[i].v;
+        z->img_comp[i].raw_data = stbi__malloc_mad2(z->img_comp[i].w2, z->img_comp[i].h2, 0);
+        if (!z->img_comp[i].raw_data) return stbi__err("outofmem", "Out of memory");
+        z->img_comp[i].data = (stbi_uc*)z->img_comp[i].raw_data;
+    }
+    jpeg_set_window(z, 0, 0, (s->img_x + THUMBNAIL_SCALE - 1) / THUMBNAIL_SCALE, (s->img_y + THUMBNAIL_SCALE - 1) / THUMBNAIL_SCALE);
+
+    result = jpeg_read_scan(z);
+    if (result != DECODE_DONE) return result;
+
+    short* coefficients = (short*)stbi__malloc(jpeg_blocks_per_mcu(z) * 64 * sizeof(short));
+    if (!coefficients) return stbi__err("outofmem", "Out of memory");
+
+    // Энтропийное декодирование последовательное: оно и определяет время, а остальное в 64 раза дешевле
+    stbi__jpeg_reset(z);
+    int stopped = 0;
+    for (int my = 0; my < z->img_mcu_y; my++)
+    {
+        for (int mx = 0; mx < z->img_mcu_x; mx++)
+        {
+            if (stopped) memset(coefficients, 0, jpeg_blocks_per_mcu(z) * 64 * sizeof(short));
+            else if (!jpeg_decode_mcu(z, coefficients))
+            {
+                STBI_FREE(coefficients);
+                return stbi__err("bad huffman code", "Corrupt JPEG");
+            }
+            else if (!jpeg_next_mcu(z)) stopped = 1;
+            jpeg_dc_mcu(z, coefficients, mx, my);
+        }
+    }
+    STBI_FREE(coefficients);
+
+    const int n = s->img_n >= 3 ? 3 : 1;
+    stbi_uc* output = (stbi_uc*)stbi__malloc_mad3(n, s->img_x, s->img_y, 1);
+    stbi_uc* linebuf = (stbi_uc*)stbi__malloc_mad2(s->img_n, s->img_x + 3, 0);
+    if (!output || !linebuf)
+    {
+        STBI_FREE(output);
+        STBI_FREE(linebuf);
+        return stbi__err("outofmem", "Out of memory");
+    }
+
+    stbi__resample res[4];
+    jpeg_setup_resample(z, res);
+    jpeg_convert_rows(z, res, n, 0, s->img_y, 0, s->img_x, output, (size_t)n * s->img_x, linebuf);
+    STBI_FREE(linebuf);
+
+    *pixels = output;
+    *width = (int)s->img_x;
+    *height = (int)s->img_y;
+    *channels = n;
+    return DECODE_DONE;
+}
+
+// @brief Декодирует JPEG из контекста stb_image в масштабе 1/8. Progressive JPEG возвращает DECODE_FALLBACK.
+static int jpeg_decode_scaled(stbi__context* s, stbi_uc** pixels, int* width, int* height, int* channels)
+{
+    stbi__jpeg* z = jpeg_create(s);
+    if (!z) return DECODE_FAILED;
+    int result = jpeg_decode_scaled_image(z, pixels, width, height, channels);
+    jpeg_destroy(z);
+    return result;
+}
+
+// @brief Уменьшает декодированное изображение в THUMBNAIL_SCALE раз усреднением блоков (неполные блоки на краях
+//        усредняются по своим пикселям). Исходный буфер освобождается.
+//
+// @return Уменьшенное изображение или NULL, если не хватило памяти.
+static stbi_uc* thumbnail_reduce(stbi_uc* pixels, const int width, const int height, const int channels, int* out_width, int* out_height)
+{
+    const size_t w = (size_t)(width + THUMBNAIL_SCALE - 1) / THUMBNAIL_SCALE;
+    const size_t h = (size_t)(height + THUMBNAIL_SCALE - 1) / THUMBNAIL_SCALE;
+    stbi_uc* output = (stbi_uc*)STBI_MALLOC(w * h * channels);
+    if (!output)
+    {
+        STBI_FREE(pixels);
+        return NULL;
+    }
+
+    // Строки блока сначала складываются по столбцам (непрерывный проход, векторизуется), затем суммы
+    // столбцов складываются по блокам. Сумма 8 строк помещается в 16 бит
+    const size_t row = (size_t)width * channels;
+    int failed = 0;
+    #pragma omp parallel if ((size_t)width * height >= ipl_get_context()->profile.parallel_min_pixels)
+    {
+        unsigned short* columns = (unsigned short*)STBI_MALLOC(row * sizeof(unsigned short));
+
+        #pragma omp for
+        for (ptrdiff_t ty = 0; ty < (ptrdiff_t)h; ty++)
+        {
+            if (!columns)
+            {
+                #pragma omp atomic write
+                failed = 1;
+                continue;
+            }
+            const size_t y0 = (size_t)ty * THUMBNAIL_SCALE;
+            const size_t y1 = y0 + THUMBNAIL_SCALE < (size_t)height ? y0 + THUMBNAIL_SCALE : (size_t)height;
+            memset(columns, 0, row * sizeof(unsigned short));
+            for (size_t y = y0; y < y1; y++)
+            {
+                const stbi_uc* p = pixels + y * row;
+                for (size_t i = 0; i < row; i++) columns[i] = (unsigned short)(columns[i] + p[i]);
+            }
+
+            stbi_uc* out = output + (size_t)ty * w * channels;
+            for (size_t tx = 0; tx < w; tx++)
+            {
+                const size_t x0 = tx * THUMBNAIL_SCALE;
+                const size_t x1 = x0 + THUMBNAIL_SCALE < (size_t)width ? x0 + THUMBNAIL_SCALE : (size_t)width;
+                const unsigned count = (unsigned)((y1 - y0) * (x1 - x0));
+                for (int c = 0; c < channels; c++, out++)
+                {
+                    unsigned sum = 0;
+                    for (size_t x = x0; x < x1; x++) sum += columns[x * channels + c];
+                    *out = (stbi_uc)((sum + count / 2) / count);
+                }
+            }
+        }
+
+        STBI_FREE(columns);
+    }
+
+    if (failed)
+    {
+        STBI_FREE(output);
+        output = NULL;
+    }
+    STBI_FREE(pixels);
+    *out_width = (int)w;
+    *out_height = (int)h;
+    return output;
+}
+
+#endif
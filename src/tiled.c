@@ -0,0 +1,410 @@
+#include "tiled.h"
+#include "context.h"
+#include "buffer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <omp.h>
+
+// @brief Размеры тайла (tx, ty) в пикселях: крайние тайлы обрезаются по изображению.
+static void tile_extent(const TiledImage* image, const size_t tx, const size_t ty, size_t* tw, size_t* th)
+{
+    size_t x0 = tx * IPL_COW_TILE;
+    size_t y0 = ty * IPL_COW_TILE;
+    *tw = image->width - x0 < IPL_COW_TILE ? image->width - x0 : IPL_COW_TILE;
+    *th = image->height - y0 < IPL_COW_TILE ? image->height - y0 : IPL_COW_TILE;
+}
+
+static ImageTile* tile_alloc(const size_t bytes)
+{
+    ImageTile* tile = (ImageTile*)malloc(sizeof(ImageTile) + bytes);
+    if (!tile) return NULL;
+    tile->refcount = 1;
+    tile->bytes = bytes;
+    return tile;
+}
+
+static void tile_retain(ImageTile* tile)
+{
+    #pragma omp atomic update
+    tile->refcount++;
+}
+
+static void tile_release(ImageTile* tile)
+{
+    if (!tile) return;
+
+    int left;
+    #pragma omp atomic capture
+    left = --tile->refcount;
+    if (left == 0) free(tile);
+}
+
+// @brief Создает пустую структуру изображения (без тайлов) с размерами image.
+static TiledImage* tiled_alloc(const ImageFormat format, const size_t width, const size_t height, const ImageColorChannels channels)
+{
+    TiledImage* image = (TiledImage*)malloc(sizeof(TiledImage));
+    if (!image) return NULL;
+
+    image->format = format;
+    image->width = width;
+    image->height = height;
+    image->channels = channels;
+    image->tiles_x = (width + IPL_COW_TILE - 1) / IPL_COW_TILE;
+    image->tiles_y = (height + IPL_COW_TILE - 1) / IPL_COW_TILE;
+    image->tiles = (ImageTile**)calloc(image->tiles_x * image->tiles_y > 0 ? image->tiles_x * image->tiles_y : 1, sizeof(ImageTile*));
+    if (!image->tiles)
+    {
+        free(image);
+        return NULL;
+    }
+
+    return image;
+}
+
+// @brief Разбивает изображение на тайлы (данные копируются, image не изменяется).
+//
+// @param image [in] Исходное изображение.
+// @return Указатель на изображение из тайлов или NULL при ошибке (освобождается ipl_tiled_free).
+TiledImage* ipl_tiled_from_image(const Image* image)
+{
+    if (!image || !image->data) return NULL;
+
+    TiledImage* tiled = tiled_alloc(image->format, image->width, image->height, image->channels);
+    if (!tiled) return NULL;
+
+    const size_t channels = image->channels;
+    int parallel = image->width * image->height >= ipl_get_context()->profile.parallel_min_pixels;
+    int failed = 0;
+
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t t = 0; t < (ptrdiff_t)(tiled->tiles_x * tiled->tiles_y); t++)
+    {
+        size_t tx = (size_t)t % tiled->tiles_x, ty = (size_t)t / tiled->tiles_x;
+        size_t tw, th;
+        tile_extent(tiled, tx, ty, &tw, &th);
+
+        ImageTile* tile = tile_alloc(tw * th * channels);
+        if (!tile)
+        {
+            #pragma omp atomic write
+            failed = 1;
+            continue;
+        }
+        for (size_t i = 0; i < th; i++)
+        {
+            memcpy(tile->data + i * tw * channels,
+                   image->data + ((ty * IPL_COW_TILE + i) * image->width + tx * IPL_COW_TILE) * channels,
+                   tw * channels);
+        }
+        tiled->tiles[t] = tile;
+    }
+
+    if (failed)
+    {
+        ipl_tiled_free(tiled);
+        return NULL;
+    }
+    return tiled;
+}
+
+// @brief Создает новую версию изображения, разделяющую все тайлы с image.
+//        Тайлы копируются только при первой записи в них (ipl_tiled_tile_for_write), поэтому история
+//        отмены из многих версий с локальными правками занимает немногим больше одного кадра.
+//        Версии можно создавать и освобождать из разных потоков, но одну версию нельзя
+//        одновременно изменять и копировать.
+//
+// @param image [in] Исходная версия.
+// @return Новая версия или NULL при ошибке выделения памяти.
+TiledImage* ipl_tiled_clone(const TiledImage* image)
+{
+    if (!image) return NULL;
+
+    TiledImage* clone = tiled_alloc(image->format, image->width, image->height, image->channels);
+    if (!clone) return NULL;
+
+    size_t count = image->tiles_x * image->tiles_y;
+    for (size_t t = 0; t < count; t++)
+    {
+        tile_retain(image->tiles[t]);
+        clone->tiles[t] = image->tiles[t];
+    }
+
+    return clone;
+}
+
+// @brief Освобождает версию изображения. Тайл освобождается, когда на него не остается ссылок.
+void ipl_tiled_free(TiledImage* image)
+{
+    if (!image) return;
+
+    size_t count = image->tiles_x * image->tiles_y;
+    for (size_t t = 0; t < count; t++)
+    {
+        tile_release(image->tiles[t]);
+    }
+    free(image->tiles);
+    free(image);
+}
+
+// @brief Собирает изображение из тайлов в непрерывный буфер (например, для ipl_save_image).
+//
+// @param image  [in]  Изображение из тайлов.
+// @param output [out] Результат. Память под output->data выделяется функцией.
+//
+// @return INVALID_ARGUMENT Указатели равны NULL.
+// @return OUT_OF_MEMORY    Не удалось выделить память.
+// @return SUCCESS          Изображение собрано.
+ImageProcStatus ipl_tiled_to_image(const TiledImage* image, Image* output)
+{
+    if (!image || !output) return INVALID_ARGUMENT;
+
+    output->format = image->format;
+    output->width = image->width;
+    output->height = image->height;
+    output->channels = image->channels;
+    output->data = (unsigned char*)ipl_buffer_alloc(image->width * image->height * image->channels);
+    if (!output->data) return OUT_OF_MEMORY;
+
+    Rect all = { 0, 0, image->width, image->height };
+    return ipl_tiled_read(image, &all, output->data);
+}
+
+// @brief Данные тайла (tx, ty) для чтения: строки подряд с шагом (ширина тайла * channels).
+const unsigned char* ipl_tiled_tile(const TiledImage* image, const size_t tx, const size_t ty)
+{
+    if (!image || tx >= image->tiles_x || ty >= image->tiles_y) return NULL;
+    return image->tiles[ty * image->tiles_x + tx]->data;
+}
+
+// @brief Данные тайла (tx, ty) для записи. Если тайл разделяется с другими версиями,
+//        эта версия сначала получает собственную копию (копирование при записи).
+//
+// @return Указатель на данные тайла или NULL при ошибке.
+unsigned char* ipl_tiled_tile_for_write(TiledImage* image, const size_t tx, const size_t ty)
+{
+    if (!image || tx >= image->tiles_x || ty >= image->tiles_y) return NULL;
+
+    ImageTile** slot = &image->tiles[ty * image->tiles_x + tx];
+    int refs;
+    #pragma omp atomic read
+    refs = (*slot)->refcount;
+
+    // Единственная ссылка принадлежит этой версии, и новые ссылки могут появиться только через нее
+    if (refs > 1)
+    {
+        ImageTile* copy = tile_alloc((*slot)->bytes);
+        if (!copy) return NULL;
+        memcpy(copy->data, (*slot)->data, copy->bytes);
+        tile_release(*slot);
+        *slot = copy;
+    }
+
+    return (*slot)->data;
+}
+
+// @brief Копирует прямоугольник изображения в непрерывный буфер.
+//
+// @param image  [in]  Изображение из тайлов.
+// @param rect   [in]  Прямоугольник (целиком внутри изображения).
+// @param output [out] Буфер rect->width * rect->height * channels байтов.
+//
+// @return INVALID_ARGUMENT Указатели равны NULL или прямоугольник выходит за изображение.
+// @return SUCCESS          Данные скопированы.
+ImageProcStatus ipl_tiled_read(const TiledImage* image, const Rect* rect, unsigned char* output)
+{
+    if (!image || !rect || !output) return INVALID_ARGUMENT;
+    if (rect->x > image->width || rect->width > image->width - rect->x ||
+        rect->y > image->height || rect->height > image->height - rect->y) return INVALID_ARGUMENT;
+    if (rect->width == 0 || rect->height == 0) return SUCCESS;
+
+    const size_t channels = image->channels;
+    const size_t row_len = rect->width * channels;
+    int parallel = rect->width * rect->height >= ipl_get_context()->profile.parallel_min_pixels;
+
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t i = 0; i < (ptrdiff_t)rect->height; i++)
+    {
+        size_t y = rect->y + (size_t)i;
+        size_t ty = y / IPL_COW_TILE;
+        unsigned char* dst = output + (size_t)i * row_len;
+
+        for (size_t x = rect->x; x < rect->x + rect->width;)
+        {
+            size_t tx = x / IPL_COW_TILE;
+            size_t tw, th;
+            tile_extent(image, tx, ty, &tw, &th);
+            size_t x_end = (tx + 1) * IPL_COW_TILE < rect->x + rect->width ? (tx + 1) * IPL_COW_TILE : rect->x + rect->width;
+
+            const unsigned char* src = image->tiles[ty * image->tiles_x + tx]->data +
+                                       ((y - ty * IPL_COW_TILE) * tw + (x - tx * IPL_COW_TILE)) * channels;
+            memcpy(dst + (x - rect->x) * channels, src, (x_end - x) * channels);
+            x = x_end;
+        }
+    }
+
+    return SUCCESS;
+}
+
+// @brief Записывает прямоугольник из непрерывного буфера. Копии получают только тайлы,
+//        содержимое которых действительно меняется: совпадающие части остаются разделяемыми.
+//
+// @param image [in, out] Изображение из тайлов.
+// @param rect  [in]      Прямоугольник (целиком внутри изображения).
+// @param input [in]      Буфер rect->width * rect->height * channels байтов.
+//
+// @return INVALID_ARGUMENT Указатели равны NULL или прямоугольник выходит за изображение.
+// @return OUT_OF_MEMORY    Не удалось скопировать тайл.
+// @return SUCCESS          Данные записаны.
+ImageProcStatus ipl_tiled_write(TiledImage* image, const Rect* rect, const unsigned char* input)
+{
+    if (!image || !rect || !input) return INVALID_ARGUMENT;
+    if (rect->x > image->width || rect->width > image->width - rect->x ||
+        rect->y > image->height || rect->height > image->height - rect->y) return INVALID_ARGUMENT;
+    if (rect->width == 0 || rect->height == 0) return SUCCESS;
+
+    const size_t channels = image->channels;
+    const size_t row_len = rect->width * channels;
+    const size_t tx0 = rect->x / IPL_COW_TILE, tx1 = (rect->x + rect->width - 1) / IPL_COW_TILE;
+    const size_t ty0 = rect->y / IPL_COW_TILE, ty1 = (rect->y + rect->height - 1) / IPL_COW_TILE;
+    const size_t span_x = tx1 - tx0 + 1;
+    int parallel = rect->width * rect->height >= ipl_get_context()->profile.parallel_min_pixels;
+    int failed = 0;
+
+    // Тайлы независимы: каждый сравнивается и при необходимости копируется одним потоком
+    #pragma omp parallel for if (parallel)
+    for (ptrdiff_t t = 0; t < (ptrdiff_t)(span_x * (ty1 - ty0 + 1)); t++)
+    {
+        size_t tx = tx0 + (size_t)t % span_x, ty = ty0 + (size_t)t / span_x;
+        size_t tw, th;
+        tile_extent(image, tx, ty, &tw, &th);
+
+        // Пересечение прямоугольника с тайлом
+        size_t x0 = rect->x > tx * IPL_COW_TILE ? rect->x : tx * IPL_COW_TILE;
+        size_t y0 = rect->y > ty * IPL_COW_TILE ? rect->y : ty * IPL_COW_TILE;
+        size_t x1 = rect->x + rect->width < tx * IPL_COW_TILE + tw ? rect->x + rect->width : tx * IPL_COW_TILE + tw;
+        size_t y1 = rect->y + rect->height < ty * IPL_COW_TILE + th ? rect->y + rect->height : ty * IPL_COW_TILE + th;
+        size_t bytes = (x1 - x0) * channels;
+
+        const unsigned char* tile = image->tiles[ty * image->tiles_x + tx]->data;
+        size_t offset = (x0 - tx * IPL_COW_TILE) * channels;
+        size_t y = y0;
+        while (y < y1 && memcmp(tile + (y - ty * IPL_COW_TILE) * tw * channels + offset,
+                                input + (y - rect->y) * row_len + (x0 - rect->x) * channels, bytes) == 0) y++;
+        if (y == y1) continue; // Содержимое не меняется, тайл остается разделяемым
+
+        unsigned char* data = ipl_tiled_tile_for_write(image, tx, ty);
+        if (!data)
+        {
+            #pragma omp atomic write
+            failed = 1;
+            continue;
+        }
+        for (; y < y1; y++)
+        {
+            memcpy(data + (y - ty * IPL_COW_TILE) * tw * channels + offset,
+                   input + (y - rect->y) * row_len + (x0 - rect->x) * channels, bytes);
+        }
+    }
+
+    return failed ? OUT_OF_MEMORY : SUCCESS;
+}
+
+// @brief Объем тайлов, которыми владеет только эта версия (во сколько обходится ее хранение сверх остальных).
+size_t ipl_tiled_unique_bytes(const TiledImage* image)
+{
+    if (!image) return 0;
+
+    size_t bytes = 0;
+    size_t count = image->tiles_x * image->tiles_y;
+    for (size_t t = 0; t < count; t++)
+    {
+        int refs;
+        #pragma omp atomic read
+        refs = image->tiles[t]->refcount;
+        if (refs == 1) bytes += image->tiles[t]->bytes;
+    }
+    return bytes;
+}
+
+// @brief Фильтрует прямоугольники изображения из тайлов. Каждый прямоугольник читается вместе с ореолом halo
+//        в непрерывное окно, фильтруется только внутри себя (ipl_gaussian_filter_rects / ipl_median_filter_rects)
+//        и записывается обратно, поэтому новые тайлы выделяются только там, где пиксели изменились.
+//        Окна читаются из неизменяемой копии версии, чтобы ореол одного прямоугольника не видел результат другого.
+static ImageProcStatus tiled_filter_rects(TiledImage* image, const Rect* rects, const int count, const size_t halo,
+                                          const int median, const float param)
+{
+    if (!image || count < 0 || (!rects && count > 0)) return INVALID_ARGUMENT;
+
+    TiledImage* snapshot = ipl_tiled_clone(image);
+    if (!snapshot) return OUT_OF_MEMORY;
+
+    ImageProcStatus status = SUCCESS;
+    for (int r = 0; r < count && status == SUCCESS; r++)
+    {
+        // Прямоугольник, обрезанный по изображению, и окно с ореолом вокруг него
+        Rect region, window;
+        if (ipl_grow_rects(&rects[r], 1, 0, image->width, image->height, &region) == 0) continue;
+        ipl_grow_rects(&region, 1, halo, image->width, image->height, &window);
+
+        Image view;
+        view.format = image->format;
+        view.width = window.width;
+        view.height = window.height;
+        view.channels = image->channels;
+        view.data = (unsigned char*)ipl_buffer_alloc(window.width * window.height * image->channels);
+        if (!view.data)
+        {
+            status = OUT_OF_MEMORY;
+            break;
+        }
+
+        // Прямоугольник в координатах окна
+        Rect local = { region.x - window.x, region.y - window.y, region.width, region.height };
+        status = ipl_tiled_read(snapshot, &window, view.data);
+        if (status == SUCCESS)
+            status = median ? ipl_median_filter_rects(&view, (int)param, &local, 1) : ipl_gaussian_filter_rects(&view, param, &local, 1);
+        if (status == SUCCESS)
+        {
+            // Записывается только сам прямоугольник (строки сдвигаются в начало окна), ореол мог устареть
+            size_t row_len = region.width * image->channels;
+            for (size_t i = 0; i < region.height; i++)
+                memmove(view.data + i * row_len, view.data + ((local.y + i) * window.width + local.x) * image->channels, row_len);
+            status = ipl_tiled_write(image, &region, view.data);
+        }
+
+        free(view.data);
+    }
+
+    ipl_tiled_free(snapshot);
+
+    return status;
+}
+
+// @brief Гауссов фильтр прямоугольников изображения из тайлов (см. ipl_gaussian_filter_rects).
+//        Копируются только тайлы, пиксели которых изменились, остальные остаются общими с другими версиями.
+//
+// @param image [in, out] Версия изображения.
+// @param sigma [in]      Стандартное отклонение.
+// @param rects [in]      Прямоугольники.
+// @param count [in]      Количество прямоугольников.
+//
+// @return INVALID_ARGUMENT Некорректные аргументы.
+// @return OUT_OF_MEMORY    Не удалось выделить память.
+// @return SUCCESS          Фильтр применен.
+ImageProcStatus ipl_tiled_gaussian_filter_rects(TiledImage* image, const float sigma, const Rect* rects, const int count)
+{
+    if (sigma < 0.0f) return INVALID_ARGUMENT;
+    if (sigma <= 1e-6f) return image ? SUCCESS : INVALID_ARGUMENT;
+
+    return tiled_filter_rects(image, rects, count, ipl_gaussian_halo(sigma), 0, sigma);
+}
+
+// @brief Медианный фильтр прямоугольников изображения из тайлов (см. ipl_tiled_gaussian_filter_rects).
+ImageProcStatus ipl_tiled_median_filter_rects(TiledImage* image, const int radius, const Rect* rects, const int count)
+{
+    if (radius < 0) return INVALID_ARGUMENT;
+    if (radius == 0) return image ? SUCCESS : INVALID_ARGUMENT;
+
+    return tiled_filter_rects(image, rects, count, (size_t)radius, 1, (float)radius);
+}
@@ -0,0 +1,316 @@
+// Проверка адресации пикселей за пределами 4 ГБ (смещения строк и пикселей должны считаться в size_t).
+// Память под такие изображения не выделяется целиком:
+//  - для медианы строки берутся с шагом чуть больше 2^32 байтов в отображении MAP_NORESERVE,
+//    и реально затрагиваются только несколько страниц;
+//  - для свертки Гаусса и оператора Собеля изображение размером больше 4 ГБ собирается из повторяющегося
+//    окна memfd: все периоды отображаются на одни и те же физические страницы. Длина периода не делит 2^32,
+//    поэтому смещение, усеченное до 32 бит, попадает в другую фазу периода и дает неверный результат.
+//    Фильтры запускаются в одном потоке, чтобы последними записывались строки за границей 4 ГБ.
+// Если отобразить память не удалось (или система не Linux), проверка пропускается.
+//
+// Сборка: см. compile.bat. Код возврата 0 - проверка пройдена или пропущена, 1 - найдены расхождения.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "imageproc.h"
+#include "context.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define FOUR_GB ((size_t)1 << 32)
+#define PERIOD_BYTES ((size_t)3 << 20) // 3 МБ: кратно размеру страницы и ширине строки, но не делит 2^32
+#define IMAGE_WIDTH 1024               // Ширина строки (1024 * каналы) делит PERIOD_BYTES
+
+// @brief Отображение size байтов, в котором окно period байтов одного memfd повторяется подряд.
+typedef struct
+{
+    unsigned char* data;
+    size_t size;
+    int fd;
+} PeriodicMapping;
+
+// @brief Псевдослучайное заполнение (линейный конгруэнтный генератор), одинаковое при каждом запуске.
+static void fill_random(unsigned char* data, const size_t count, unsigned seed)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (unsigned char)(seed >> 16);
+    }
+}
+
+// @brief Создает периодическое отображение. size должен быть кратен period.
+//
+// @return 1 - отображение создано, 0 - не удалось (проверка пропускается).
+static int map_periodic(PeriodicMapping* mapping, const size_t period, const size_t size)
+{
+    mapping->size = size;
+    mapping->fd = memfd_create("ipl_large_image_check", 0);
+    if (mapping->fd < 0) return 0;
+    if (ftruncate(mapping->fd, (off_t)period) != 0)
+    {
+        close(mapping->fd);
+        return 0;
+    }
+
+    // Сначала резервируется адресное пространство, затем в него подряд отображается одно и то же окно
+    void* base = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        close(mapping->fd);
+        return 0;
+    }
+    mapping->data = (unsigned char*)base;
+
+    for (size_t offset = 0; offset < size; offset += period)
+    {
+        if (mmap(mapping->data + offset, period, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, mapping->fd, 0) == MAP_FAILED)
+        {
+            munmap(base, size);
+            close(mapping->fd);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void unmap_periodic(PeriodicMapping* mapping)
+{
+    munmap(mapping->data, mapping->size);
+    close(mapping->fd);
+}
+
+// @brief Медиана окна (2r+1) x (2r+1) перебором - эталон для ядер медианного фильтра.
+static unsigned char median_reference(const unsigned char* padded, const size_t ldp, const size_t y, const size_t x,
+                                      const int channels, const int c, const int radius)
+{
+    int hist[256] = { 0 };
+    for (int i = 0; i < 2 * radius + 1; i++)
+        for (int j = 0; j < 2 * radius + 1; j++)
+            hist[padded[(y + i) * ldp + (x + j) * channels + c]]++;
+    return get_median(hist, (2 * radius + 1) * (2 * radius + 1));
+}
+
+// @brief Медианные ядра и hist_set/hist_move на строках с шагом больше 2^32 байтов.
+//
+// @return Количество расхождений с эталоном или -1, если память не удалось отобразить.
+static long check_median(void)
+{
+    const size_t width = 40;
+    const size_t rows = 4;
+    long bad = 0;
+
+    for (int channels = 1; channels <= 4; channels += channels == 1 ? 2 : 1)
+    {
+        for (int radius = 1; radius <= 4; radius++)
+        {
+            size_t ldp = FOUR_GB + 77 * (size_t)channels;
+            size_t ldo = FOUR_GB + 13 * (size_t)channels;
+            size_t padded_bytes = (rows + 2 * radius) * ldp;
+            size_t output_bytes = rows * ldo;
+            unsigned char* padded = mmap(NULL, padded_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            unsigned char* output = mmap(NULL, output_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (padded == MAP_FAILED || output == MAP_FAILED)
+            {
+                if (padded != MAP_FAILED) munmap(padded, padded_bytes);
+                if (output != MAP_FAILED) munmap(output, output_bytes);
+                return -1;
+            }
+
+            for (size_t y = 0; y < rows + 2 * radius; y++)
+                fill_random(padded + y * ldp, (width + 2 * radius) * channels, (unsigned)(y * 31 + channels * 7 + radius));
+
+            for (int use_histogram = 0; use_histogram < 2; use_histogram++)
+            {
+                for (size_t y = 0; y < rows; y++) memset(output + y * ldo, 0, width * channels);
+                if (use_histogram) median_histogram_rows(padded, ldp, output, ldo, channels, width, rows, radius);
+                else median_sort_rows(padded, ldp, output, ldo, channels, width, rows, radius);
+
+                for (size_t y = 0; y < rows; y++)
+                    for (size_t x = 0; x < width; x++)
+                        for (int c = 0; c < channels; c++)
+                            bad += output[y * ldo + x * channels + c] != median_reference(padded, ldp, y, x, channels, c, radius);
+            }
+
+            for (int c = 0; c < channels; c++)
+            {
+                for (size_t y = 0; y < rows; y++)
+                {
+                    int hist[256];
+                    size_t hy, hx;
+                    hist_set(hist, NULL, padded, y, ldp, 0, channels, c, 2 * radius + 1, &hy, &hx);
+                    for (size_t x = 0; ; )
+                    {
+                        bad += get_median(hist, (2 * radius + 1) * (2 * radius + 1)) != median_reference(padded, ldp, y, x, channels, c, radius);
+                        if (++x == width) break;
+                        hist_move(hist, NULL, padded, y, ldp, &hx, channels, c, 2 * radius + 1);
+                    }
+                }
+            }
+
+            munmap(padded, padded_bytes);
+            munmap(output, output_bytes);
+        }
+    }
+    return bad;
+}
+
+// @brief Сравнивает строки периода результата с эталоном, пропуская фазы строк, зависящих от краев изображения.
+//
+// @param output    [in] Окно периода большого результата.
+// @param expected  [in] Эталонный результат для тех же фаз периода.
+// @param row_len   [in] Длина строки в байтах.
+// @param edge_rows [in] Сколько строк у верхнего и нижнего края зависит от обработки границ.
+// @param height    [in] Высота большого изображения.
+//
+// @return Количество неверных строк.
+static long compare_period(const unsigned char* output, const unsigned char* expected, const size_t row_len, const size_t edge_rows,
+                           const size_t height)
+{
+    size_t period_rows = PERIOD_BYTES / row_len;
+    long bad = 0;
+    for (size_t p = 0; p < period_rows; p++)
+    {
+        // Фаза края: строки 0..edge_rows-1 и height-edge_rows..height-1 большого изображения
+        if (p < edge_rows || (height - 1 + period_rows - p) % period_rows < edge_rows) continue;
+        bad += memcmp(output + p * row_len, expected + p * row_len, row_len) != 0;
+    }
+    return bad;
+}
+
+// @brief Прогоняет свертку Гаусса и оператор Собеля на большом периодическом изображении и на эталоне.
+//
+// @param reference [in] Три буфера по 3 периода: вход (три копии периода), промежуточный и результат.
+//
+// @return Количество расхождений с эталоном.
+static long run_periodic(const int channels, const Kernel* kernel, PeriodicMapping* input, PeriodicMapping* temp,
+                         PeriodicMapping* output, unsigned char* reference[3])
+{
+    size_t row_len = (size_t)IMAGE_WIDTH * channels;
+    size_t period_rows = PERIOD_BYTES / row_len;
+    size_t height = input->size / row_len;
+    size_t ref_height = 3 * period_rows;
+
+    // Средний период эталона не зависит от краев
+    for (int k = 0; k < 3; k++) memcpy(reference[0] + k * PERIOD_BYTES, input->data, PERIOD_BYTES);
+
+    horizontal_convolution(reference[0], reference[1], channels, IMAGE_WIDTH, ref_height, kernel);
+    vertical_convolution(reference[1], reference[2], channels, IMAGE_WIDTH, ref_height, kernel);
+    horizontal_convolution(input->data, temp->data, channels, IMAGE_WIDTH, height, kernel);
+    vertical_convolution(temp->data, output->data, channels, IMAGE_WIDTH, height, kernel);
+    long gaussian_bad = compare_period(output->data, reference[2] + PERIOD_BYTES, row_len, (size_t)kernel->radius, height);
+    printf("gaussian, %d channel(s), %d x %zu: %s\n", channels, IMAGE_WIDTH, height, gaussian_bad ? "FAILED" : "ok");
+
+    // Результат Собеля одноканальный: строка IMAGE_WIDTH байтов, в окне отображения channels его периодов.
+    // Первая и последняя строки не заполняются.
+    long sobel_bad = 0;
+    if (compute_sobel_magnitude_channels(reference[0], reference[2], IMAGE_WIDTH, ref_height, channels) != SUCCESS ||
+        compute_sobel_magnitude_channels(input->data, output->data, IMAGE_WIDTH, height, channels) != SUCCESS)
+    {
+        sobel_bad = 1;
+    }
+    else
+    {
+        const unsigned char* expected = reference[2] + period_rows * IMAGE_WIDTH;
+        size_t window_rows = PERIOD_BYTES / IMAGE_WIDTH;
+        for (size_t p = 1; p < window_rows; p++)
+            if (p != (height - 1) % window_rows)
+                sobel_bad += memcmp(output->data + p * IMAGE_WIDTH, expected + p % period_rows * IMAGE_WIDTH, IMAGE_WIDTH) != 0;
+    }
+    printf("sobel, %d channel(s), %d x %zu: %s\n", channels, IMAGE_WIDTH, height, sobel_bad ? "FAILED" : "ok");
+
+    return gaussian_bad + sobel_bad;
+}
+
+// @brief Свертка Гаусса (горизонтальный и вертикальный проходы) и оператор Собеля на изображении больше 4 ГБ.
+//
+// @return Количество расхождений с эталоном или -1, если память не удалось отобразить.
+static long check_periodic(const int channels)
+{
+    // За границей 4 ГБ остается не меньше двух полных периодов
+    size_t size = ((FOUR_GB + PERIOD_BYTES - 1) / PERIOD_BYTES + 2) * PERIOD_BYTES;
+
+    PeriodicMapping input, temp, output;
+    if (!map_periodic(&input, PERIOD_BYTES, size)) return -1;
+    if (!map_periodic(&temp, PERIOD_BYTES, size))
+    {
+        unmap_periodic(&input);
+        return -1;
+    }
+    if (!map_periodic(&output, PERIOD_BYTES, size))
+    {
+        unmap_periodic(&input);
+        unmap_periodic(&temp);
+        return -1;
+    }
+    fill_random(input.data, PERIOD_BYTES, (unsigned)channels);
+
+    unsigned char* reference[3];
+    for (int k = 0; k < 3; k++) reference[k] = (unsigned char*)malloc(3 * PERIOD_BYTES);
+    Kernel* kernel = generate_gaussian_kernel(2.0f);
+
+    long bad;
+    if (reference[0] && reference[1] && reference[2] && kernel)
+    {
+        bad = run_periodic(channels, kernel, &input, &temp, &output, reference);
+    }
+    else
+    {
+        fprintf(stderr, "out of memory\n");
+        bad = 1;
+    }
+
+    free_kernel(kernel);
+    for (int k = 0; k < 3; k++) free(reference[k]);
+    unmap_periodic(&input);
+    unmap_periodic(&temp);
+    unmap_periodic(&output);
+    return bad;
+}
+
+int main(void)
+{
+    if (ipl_context_init(NULL) != SUCCESS) return 1;
+
+    // Один поток: строки за границей 4 ГБ обрабатываются последними, и их результат не перезаписывается
+    TuningProfile profile = ipl_get_context()->profile;
+    profile.parallel_min_pixels = SIZE_MAX;
+    ipl_set_profile(&profile);
+
+    long median_bad = check_median();
+    if (median_bad < 0)
+    {
+        printf("skipped: cannot map strides above 4 GB\n");
+        return 0;
+    }
+    printf("median, strides above 4 GB: %s\n", median_bad ? "FAILED" : "ok");
+
+    long bad = median_bad;
+    for (int channels = 1; channels <= 4; channels += channels == 1 ? 2 : 1)
+    {
+        long result = check_periodic(channels);
+        if (result < 0)
+        {
+            printf("skipped: cannot map images above 4 GB\n");
+            break;
+        }
+        bad += result;
+    }
+
+    return bad ? 1 : 0;
+}
+
+#else
+
+int main(void)
+{
+    printf("skipped: large image check needs MAP_NORESERVE and memfd (Linux)\n");
+    return 0;
+}
+
+#endif